@@ -26,6 +26,10 @@ typedef enum PDAction {
     PDAction_Step,
     PDAction_StepOut,
     PDAction_StepOver,
+    // Moves the target back one instruction or to the last breakpoint that was hit (or as far back as the backend
+    // can go). Only supported by backends that keeps an execution history
+    PDAction_ReverseStep,
+    PDAction_ReverseContinue,
     PDAction_Custom = 0x1000
 } PDAction;
 
@@ -40,6 +44,15 @@ typedef enum PDDebugState {
     PDDebugState_Count
 } PDDebugState;
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accesses a data watchpoint stops on
+
+typedef enum PDWatchAccess {
+    PDWatchAccess_Read = 1 << 0,
+    PDWatchAccess_Write = 1 << 1,
+    PDWatchAccess_ReadWrite = PDWatchAccess_Read | PDWatchAccess_Write,
+} PDWatchAccess;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 typedef enum PDEventType {
@@ -99,6 +112,50 @@ typedef enum PDEventType {
     PDEventType_RequestEvalExpression,
     PDEventType_ReplyEvalExpression,
 
+    // Instruction tracing (see pd_trace.h). EnableTrace has "enable" (u8) and enabling clears the recorded trace.
+    // GetTrace asks for up to "max_count" (u32) of the oldest unread records which the backend replies to with
+    // SetTrace: "count" (u32), "data" (PDTraceRecords) and "dropped" (u64, records that was overwritten before they
+    // were read since tracing was enabled)
+
+    PDEventType_EnableTrace,
+    PDEventType_GetTrace,
+    PDEventType_SetTrace,
+
+    // Profiling (see pd_profile.h). EnableProfile has "enable" (u8), "mode" (u8, PDProfileMode) and "interval" (u32,
+    // clock ticks between samples) and enabling clears the profile. GetProfile is replied to with SetProfile: "mode"
+    // (u8), "ticks" (u64, clock ticks run since the last reply), "samples" (PDProfileEntries) and "calls"
+    // (PDProfileCalls)
+
+    PDEventType_EnableProfile,
+    PDEventType_GetProfile,
+    PDEventType_SetProfile,
+
+    // Resolves "addresses" (data with u64 addresses) using the debug info in the backend. Replied to with
+    // SetAddressInfo with an "info" array that has "address" (u64) and (if known) "symbol" (string, the function the
+    // address is in), "symbol_address" (u64), "filename" (string) and "line" (u32) for each address
+
+    PDEventType_GetAddressInfo,
+    PDEventType_SetAddressInfo,
+
+    // Data watchpoints. SetWatchpoint has "id" (u32), "address" (u64), "size" (u64) and "access" (u8, PDWatchAccess)
+    // and the backend replies with ReplyWatchpoint: "id" (u32) and "status" (u8, 1 if it could be set). The target
+    // stops after the instruction that did the access and SetExceptionLocation then also has "watch_id" (u32),
+    // "watch_address" (u64) and "watch_access" (u8, the access that was done). DeleteWatchpoint has "id" (u32)
+
+    PDEventType_SetWatchpoint,
+    PDEventType_ReplyWatchpoint,
+    PDEventType_DeleteWatchpoint,
+
+    // Memory search run by the backend (see pd_search.h). SearchMemory has "start" (u64), "end" (u64, exclusive),
+    // "pattern" (data), "mask" (data, optional, same size as the pattern and only the set bits are compared),
+    // "alignment" (u8, matches start at a multiple of it, 1 if not set) and "max_matches" (u32). Values (8/16/32/64
+    // bit) are searched for as a pattern in target byte order with the alignment set to the size. The backend
+    // replies with SetSearchResult: "matches" (data with the u64 addresses in order) and "truncated" (u8, 1 if there
+    // were more than max_matches)
+
+    PDEventType_SearchMemory,
+    PDEventType_SetSearchResult,
+
     // End of events
 
     PDEventType_End,
@@ -0,0 +1,47 @@
+#ifndef _PDPROFILE_H_
+#define _PDPROFILE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Profiles as sent with PDEventType_SetProfile. Each reply only has what has been counted since the previous
+// PDEventType_GetProfile so the host adds them up.
+
+typedef enum PDProfileMode {
+    // The pc (and the return address at the top of the stack) is sampled every "interval" clock ticks
+    PDProfileMode_Sample,
+    // Every instruction is counted with the number of clock ticks it took. Calls are tracked on a shadow stack
+    PDProfileMode_Exact,
+} PDProfileMode;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct PDProfileEntry {
+    uint64_t address;
+    // Number of samples (sample mode) or clock ticks (exact mode) at the address
+    uint64_t count;
+} PDProfileEntry;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct PDProfileCall {
+    // Address of the call instruction and where it called
+    uint64_t site;
+    uint64_t target;
+    // Sample mode: number of samples taken with this as the innermost call. Exact mode: number of calls
+    uint64_t count;
+    // Exact mode: clock ticks spent in the call including the calls it made (0 in sample mode)
+    uint64_t ticks;
+} PDProfileCall;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
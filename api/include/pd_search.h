@@ -0,0 +1,161 @@
+#ifndef _PDSEARCH_H_
+#define _PDSEARCH_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory search as requested with PDEventType_SearchMemory. Backends that have the target memory in their own address
+// space run the search directly over it with PDSearch_scan so only the match addresses are sent back.
+//
+// The scan looks for one byte of the pattern (the anchor) with memchr, which is vectorized in the C libraries we use,
+// and only compares the full pattern where the anchor was found. The anchor is picked to be a byte that is rare in
+// most memory (not 0x00 or 0xff) when the pattern has one.
+
+// Max number of matches sent in one PDEventType_SetSearchResult event so it fits in the event buffer
+#define PD_SEARCH_MAX_EVENT_MATCHES (64 * 1024)
+
+// Max size of the pattern (and mask)
+#define PD_SEARCH_MAX_PATTERN 256
+
+typedef struct PDSearch {
+    const uint8_t* pattern;
+    // Only the bits set in the mask are compared. NULL compares all bits
+    const uint8_t* mask;
+    uint32_t size;
+    // Matches have to start at an address that is a multiple of this (power of two)
+    uint32_t alignment;
+    // Offset in the pattern of the byte searched for with memchr or -1 if no byte is compared in full
+    int anchor;
+} PDSearch;
+
+#if defined(_MSC_VER)
+#define PD_SEARCH_INLINE static __inline
+#else
+#define PD_SEARCH_INLINE static inline
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns 0 if the pattern/alignment can't be searched for
+
+PD_SEARCH_INLINE int PDSearch_init(PDSearch* search, const uint8_t* pattern, const uint8_t* mask, uint32_t size,
+                                   uint32_t alignment) {
+    uint32_t i;
+
+    if (size == 0 || size > PD_SEARCH_MAX_PATTERN)
+        return 0;
+
+    if (alignment == 0)
+        alignment = 1;
+
+    if (alignment & (alignment - 1))
+        return 0;
+
+    search->pattern = pattern;
+    search->mask = mask;
+    search->size = size;
+    search->alignment = alignment;
+    search->anchor = -1;
+
+    for (i = 0; i < size; ++i) {
+        if (mask && mask[i] != 0xff)
+            continue;
+
+        if (search->anchor == -1)
+            search->anchor = (int)i;
+
+        if (pattern[i] != 0x00 && pattern[i] != 0xff) {
+            search->anchor = (int)i;
+            break;
+        }
+    }
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PD_SEARCH_INLINE int PDSearch_matches(const PDSearch* search, const uint8_t* data) {
+    uint32_t i;
+
+    if (!search->mask)
+        return memcmp(data, search->pattern, search->size) == 0;
+
+    for (i = 0; i < search->size; ++i) {
+        if ((data[i] ^ search->pattern[i]) & search->mask[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Finds the matches that are fully inside data (which is at address in the target) and writes their addresses to
+// matches in order. Stops after max_count matches so ask for one more than needed to know if there were more.
+// Returns the number of matches written
+
+PD_SEARCH_INLINE uint32_t PDSearch_scan(const PDSearch* search, const uint8_t* data, uint64_t size, uint64_t address,
+                                        uint64_t* matches, uint32_t max_count) {
+    const uint64_t align_mask = search->alignment - 1;
+    uint32_t count = 0;
+    uint64_t last, offset;
+
+    if (size < search->size || max_count == 0)
+        return 0;
+
+    last = size - search->size;
+
+    if (search->anchor == -1) {
+        offset = (search->alignment - (address & align_mask)) & align_mask;
+
+        for (; offset <= last; offset += search->alignment) {
+            if (PDSearch_matches(search, data + offset)) {
+                matches[count++] = address + offset;
+
+                if (count == max_count)
+                    break;
+            }
+        }
+
+        return count;
+    }
+
+    {
+        const uint8_t anchor = search->pattern[search->anchor];
+        const uint8_t* start = data + search->anchor;
+        const uint8_t* end = start + last + 1;
+        const uint8_t* p = start;
+
+        while (p < end) {
+            p = (const uint8_t*)memchr(p, anchor, (size_t)(end - p));
+
+            if (!p)
+                break;
+
+            offset = (uint64_t)(p - start);
+
+            if (((address + offset) & align_mask) == 0 && PDSearch_matches(search, data + offset)) {
+                matches[count++] = address + offset;
+
+                if (count == max_count)
+                    break;
+            }
+
+            p++;
+        }
+    }
+
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef _PDTRACE_H_
+#define _PDTRACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Instruction trace records as sent with PDEventType_SetTrace and a ring buffer backends can record them into.
+//
+// The ring buffer has one writer (the thread running the target) and one reader (the thread updating the backend).
+// Neither of them waits for the other: the writer always writes and overwrites the oldest records if the reader is
+// behind, and the reader skips (and counts) the records that was overwritten. This keeps the cost of tracing to a
+// record copy and a store per instruction on the target side.
+
+typedef struct PDTraceRecord {
+    // Address of the instruction
+    uint64_t pc;
+    // First (up to 4) bytes of the instruction with the first byte in the lowest 8 bits
+    uint32_t opcode;
+    // Bit n is set if the instruction changed register n (in the order sent with PDEventType_SetRegisters)
+    uint32_t changed_registers;
+    // New values of the changed registers in register order, each using the size of the register and stored
+    // little endian. Changes that doesn't fit are only flagged in changed_registers
+    uint8_t values[8];
+} PDTraceRecord;
+
+// Max number of records sent in one PDEventType_SetTrace event so it fits in the event buffer
+#define PD_TRACE_MAX_EVENT_RECORDS (32 * 1024)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct PDTraceBuffer {
+    PDTraceRecord* records;
+    uint32_t mask;
+    // Total number of records written/read. Wraps around, only the difference between them is used
+    volatile uint32_t write_count;
+    uint32_t read_count;
+    // Total number of records the writer has started to write. One ahead of write_count while a record is written
+    volatile uint32_t begin_count;
+    // Number of records that was overwritten before they were read
+    uint64_t dropped;
+} PDTraceBuffer;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The counters work as a seqlock over the slot being written. The writer stores begin_count followed by a release
+// fence before it writes the record, so the store is visible no later than any part of the new record, and then
+// publishes the record by storing write_count with release semantics. The reader loads write_count with acquire
+// semantics, copies the records and re-checks begin_count after an acquire fence to find the ones that may have been
+// overwritten while they were copied. The Interlocked functions used with MSVC are full barriers on all targets.
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PD_TRACE_INLINE static __inline
+#define PDTrace_load_acquire(p) ((uint32_t)_InterlockedOr((volatile long*)(p), 0))
+#define PDTrace_store_release(p, v) _InterlockedExchange((volatile long*)(p), (long)(v))
+#define PDTrace_store_then_fence(p, v) _InterlockedExchange((volatile long*)(p), (long)(v))
+#define PDTrace_fence_then_load(p) ((uint32_t)_InterlockedOr((volatile long*)(p), 0))
+#else
+#define PD_TRACE_INLINE static inline
+#define PDTrace_load_acquire(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define PDTrace_store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define PDTrace_store_then_fence(p, v) \
+    (__atomic_store_n(p, v, __ATOMIC_RELAXED), __atomic_thread_fence(__ATOMIC_RELEASE))
+#define PDTrace_fence_then_load(p) (__atomic_thread_fence(__ATOMIC_ACQUIRE), __atomic_load_n(p, __ATOMIC_RELAXED))
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// capacity has to be a power of two
+
+PD_TRACE_INLINE void PDTrace_init(PDTraceBuffer* buffer, PDTraceRecord* records, uint32_t capacity) {
+    buffer->records = records;
+    buffer->mask = capacity - 1;
+    buffer->write_count = 0;
+    buffer->read_count = 0;
+    buffer->begin_count = 0;
+    buffer->dropped = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Throws away all records. The writer must not be running when this is called
+
+PD_TRACE_INLINE void PDTrace_reset(PDTraceBuffer* buffer) {
+    buffer->write_count = 0;
+    buffer->read_count = 0;
+    buffer->begin_count = 0;
+    buffer->dropped = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PD_TRACE_INLINE void PDTrace_write(PDTraceBuffer* buffer, const PDTraceRecord* record) {
+    uint32_t count = buffer->write_count;
+    PDTrace_store_then_fence(&buffer->begin_count, count + 1);
+    buffer->records[count & buffer->mask] = *record;
+    PDTrace_store_release(&buffer->write_count, count + 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copies up to max_count of the oldest unread records to dest and returns how many was copied. Can be called while
+// the writer is running.
+
+PD_TRACE_INLINE uint32_t PDTrace_read(PDTraceBuffer* buffer, PDTraceRecord* dest, uint32_t max_count) {
+    uint32_t capacity = buffer->mask + 1;
+    uint32_t read = buffer->read_count;
+    uint32_t written = PDTrace_load_acquire(&buffer->write_count);
+    uint32_t begun, count, i;
+    int32_t torn;
+
+    if (written - read > capacity) {
+        buffer->dropped += written - read - capacity;
+        read = written - capacity;
+    }
+
+    count = written - read;
+
+    if (count > max_count) {
+        count = max_count;
+    }
+
+    for (i = 0; i < count; ++i) {
+        dest[i] = buffer->records[(read + i) & buffer->mask];
+    }
+
+    // The writer may have started overwriting the oldest of the copied records while they were copied so those are
+    // thrown away. Record n is safe as long as the writer hasn't begun record n + capacity
+
+    begun = PDTrace_fence_then_load(&buffer->begin_count);
+    torn = (int32_t)(begun - capacity - read);
+
+    buffer->read_count = read + count;
+
+    if (torn <= 0) {
+        return count;
+    }
+
+    if ((uint32_t)torn > count) {
+        torn = (int32_t)count;
+    }
+
+    buffer->dropped += (uint32_t)torn;
+    memmove(dest, dest + torn, (count - (uint32_t)torn) * sizeof(PDTraceRecord));
+
+    return count - (uint32_t)torn;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
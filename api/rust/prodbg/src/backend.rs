@@ -57,6 +57,27 @@ pub enum EventType {
     UpdateRegister,
     UpdatePc,
 
+    RequestEvalExpression,
+    ReplyEvalExpression,
+
+    EnableTrace,
+    GetTrace,
+    SetTrace,
+
+    EnableProfile,
+    GetProfile,
+    SetProfile,
+
+    GetAddressInfo,
+    SetAddressInfo,
+
+    SetWatchpoint,
+    ReplyWatchpoint,
+    DeleteWatchpoint,
+
+    SearchMemory,
+    SetSearchResult,
+
     // End of events
     End,
 
@@ -90,6 +90,10 @@ pub enum Opt {
     Mode, // OptMem
 }
 
+/// Values used together with set_option
+pub const CS_OPT_OFF: usize = 0;
+pub const CS_OPT_ON: usize = 3;
+
 #[repr(i32)]
 pub enum Error {
     /// No error: everything was fine
@@ -129,6 +133,10 @@ pub struct Capstone {
     pub handle: *const c_void,
 }
 
+// A Capstone handle can't be used from several threads at the same time but it's fine to move one
+// over to another thread. Use new_instance() to get a separate handle for each thread.
+unsafe impl Send for Capstone {}
+
 impl Capstone {
     pub fn open(&mut self, arch: Arch, mode: Mode) -> Result<(), Error> {
         // If handle is already setup we just return from here
@@ -152,6 +160,27 @@ impl Capstone {
         }
     }
 
+    /// Creates a new unopened instance using the same service api. Each instance has its own handle so
+    /// this is what should be used when disassembling on several threads at once.
+    pub fn new_instance(&self) -> Capstone {
+        Capstone {
+            api: self.api,
+            handle: ptr::null(),
+        }
+    }
+
+    pub fn close(&mut self) {
+        if self.handle == ptr::null() {
+            return;
+        }
+
+        unsafe {
+            ((*self.api).close)(&mut self.handle);
+        }
+
+        self.handle = ptr::null();
+    }
+
     pub fn set_option(&self, option: Opt, value: usize) -> Result<(), Error> {
         unsafe {
             match ((*self.api).option)(self.handle, option as c_int, value as usize) {
@@ -311,6 +340,29 @@ impl Insn {
                                         detail.regs_write_count as usize))
         }
     }
+
+    /// Registers read by the instruction as a mask where bit n is set for register id n.
+    /// Requires Opt::Detail to be on. Register ids above 63 are ignored.
+    pub fn regs_read_mask(&self) -> u64 {
+        Self::regs_to_mask(self.regs_read())
+    }
+
+    /// Same as regs_read_mask but for the registers written by the instruction
+    pub fn regs_write_mask(&self) -> u64 {
+        Self::regs_to_mask(self.regs_write())
+    }
+
+    fn regs_to_mask(regs: Option<&[u16]>) -> u64 {
+        let mut mask = 0u64;
+
+        if let Some(regs) = regs {
+            for reg in regs.iter().filter(|r| **r < 64) {
+                mask |= 1u64 << *reg;
+            }
+        }
+
+        mask
+    }
 }
 
 impl Debug for Insn {
@@ -8,6 +8,8 @@ pub const ACTION_RUN: i32 = 3;
 pub const ACTION_STEP: i32 = 4;
 pub const ACTION_STEP_OUT: i32 = 5;
 pub const ACTION_STEP_OVER: i32 = 6;
+pub const ACTION_REVERSE_STEP: i32 = 7;
+pub const ACTION_REVERSE_CONTINUE: i32 = 8;
 
 // Events
 
@@ -62,3 +64,26 @@ pub const EVENT_UPDATE_PC: i32 = 39;
 pub const EVENT_REQUEST_EVAL_EXPRESSION: i32 = 40;
 pub const EVENT_REPLY_EVAL_EXPRESSION: i32 = 41;
 
+pub const EVENT_ENABLE_TRACE: i32 = 42;
+pub const EVENT_GET_TRACE: i32 = 43;
+pub const EVENT_SET_TRACE: i32 = 44;
+
+pub const EVENT_ENABLE_PROFILE: i32 = 45;
+pub const EVENT_GET_PROFILE: i32 = 46;
+pub const EVENT_SET_PROFILE: i32 = 47;
+
+pub const EVENT_GET_ADDRESS_INFO: i32 = 48;
+pub const EVENT_SET_ADDRESS_INFO: i32 = 49;
+
+pub const EVENT_SET_WATCHPOINT: i32 = 50;
+pub const EVENT_REPLY_WATCHPOINT: i32 = 51;
+pub const EVENT_DELETE_WATCHPOINT: i32 = 52;
+
+pub const EVENT_SEARCH_MEMORY: i32 = 53;
+pub const EVENT_SET_SEARCH_RESULT: i32 = 54;
+
+// Watchpoint access
+pub const WATCH_ACCESS_READ: u8 = 1;
+pub const WATCH_ACCESS_WRITE: u8 = 2;
+pub const WATCH_ACCESS_READ_WRITE: u8 = 3;
+
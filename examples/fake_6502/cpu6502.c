@@ -0,0 +1,718 @@
+// Based on Fake6502 v1.1 by Mike Chambers (public domain)
+
+#include "cpu6502.h"
+#include "debugger6502.h"
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define FLAG_CARRY     0x01
+#define FLAG_ZERO      0x02
+#define FLAG_INTERRUPT 0x04
+#define FLAG_DECIMAL   0x08
+#define FLAG_BREAK     0x10
+#define FLAG_CONSTANT  0x20
+#define FLAG_OVERFLOW  0x40
+#define FLAG_SIGN      0x80
+
+#define BASE_STACK     0x100
+
+// gcc and clang can jump directly from the end of one handler to the next (labels as values) which gives each
+// handler its own indirect branch. Other compilers use a regular switch.
+
+#if defined(__GNUC__)
+#define CPU6502_COMPUTED_GOTO
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// All opcodes: OP(opcode, addressing mode, operation, ticks, page cross penalty). The penalty is the extra tick for
+// crossing a page in absx, absy and indy when reading. The undocumented read-modify-write opcodes doesn't get it.
+
+#define CPU6502_OPCODES(OP) \
+    OP(0x00, imp,  brk, 7, 0) \
+    OP(0x01, indx, ora, 6, 1) \
+    OP(0x02, imp,  nop, 2, 0) \
+    OP(0x03, indx, slo, 8, 0) \
+    OP(0x04, zp,   nop, 3, 0) \
+    OP(0x05, zp,   ora, 3, 1) \
+    OP(0x06, zp,   asl, 5, 0) \
+    OP(0x07, zp,   slo, 5, 0) \
+    OP(0x08, imp,  php, 3, 0) \
+    OP(0x09, imm,  ora, 2, 1) \
+    OP(0x0A, acc,  asl, 2, 0) \
+    OP(0x0B, imm,  nop, 2, 0) \
+    OP(0x0C, abso, nop, 4, 0) \
+    OP(0x0D, abso, ora, 4, 1) \
+    OP(0x0E, abso, asl, 6, 0) \
+    OP(0x0F, abso, slo, 6, 0) \
+    OP(0x10, rel,  bpl, 2, 0) \
+    OP(0x11, indy, ora, 5, 1) \
+    OP(0x12, imp,  nop, 2, 0) \
+    OP(0x13, indy, slo, 8, 0) \
+    OP(0x14, zpx,  nop, 4, 0) \
+    OP(0x15, zpx,  ora, 4, 1) \
+    OP(0x16, zpx,  asl, 6, 0) \
+    OP(0x17, zpx,  slo, 6, 0) \
+    OP(0x18, imp,  clc, 2, 0) \
+    OP(0x19, absy, ora, 4, 1) \
+    OP(0x1A, imp,  nop, 2, 0) \
+    OP(0x1B, absy, slo, 7, 0) \
+    OP(0x1C, absx, nop, 4, 1) \
+    OP(0x1D, absx, ora, 4, 1) \
+    OP(0x1E, absx, asl, 7, 0) \
+    OP(0x1F, absx, slo, 7, 0) \
+    OP(0x20, abso, jsr, 6, 0) \
+    OP(0x21, indx, and, 6, 1) \
+    OP(0x22, imp,  nop, 2, 0) \
+    OP(0x23, indx, rla, 8, 0) \
+    OP(0x24, zp,   bit, 3, 0) \
+    OP(0x25, zp,   and, 3, 1) \
+    OP(0x26, zp,   rol, 5, 0) \
+    OP(0x27, zp,   rla, 5, 0) \
+    OP(0x28, imp,  plp, 4, 0) \
+    OP(0x29, imm,  and, 2, 1) \
+    OP(0x2A, acc,  rol, 2, 0) \
+    OP(0x2B, imm,  nop, 2, 0) \
+    OP(0x2C, abso, bit, 4, 0) \
+    OP(0x2D, abso, and, 4, 1) \
+    OP(0x2E, abso, rol, 6, 0) \
+    OP(0x2F, abso, rla, 6, 0) \
+    OP(0x30, rel,  bmi, 2, 0) \
+    OP(0x31, indy, and, 5, 1) \
+    OP(0x32, imp,  nop, 2, 0) \
+    OP(0x33, indy, rla, 8, 0) \
+    OP(0x34, zpx,  nop, 4, 0) \
+    OP(0x35, zpx,  and, 4, 1) \
+    OP(0x36, zpx,  rol, 6, 0) \
+    OP(0x37, zpx,  rla, 6, 0) \
+    OP(0x38, imp,  sec, 2, 0) \
+    OP(0x39, absy, and, 4, 1) \
+    OP(0x3A, imp,  nop, 2, 0) \
+    OP(0x3B, absy, rla, 7, 0) \
+    OP(0x3C, absx, nop, 4, 1) \
+    OP(0x3D, absx, and, 4, 1) \
+    OP(0x3E, absx, rol, 7, 0) \
+    OP(0x3F, absx, rla, 7, 0) \
+    OP(0x40, imp,  rti, 6, 0) \
+    OP(0x41, indx, eor, 6, 1) \
+    OP(0x42, imp,  nop, 2, 0) \
+    OP(0x43, indx, sre, 8, 0) \
+    OP(0x44, zp,   nop, 3, 0) \
+    OP(0x45, zp,   eor, 3, 1) \
+    OP(0x46, zp,   lsr, 5, 0) \
+    OP(0x47, zp,   sre, 5, 0) \
+    OP(0x48, imp,  pha, 3, 0) \
+    OP(0x49, imm,  eor, 2, 1) \
+    OP(0x4A, acc,  lsr, 2, 0) \
+    OP(0x4B, imm,  nop, 2, 0) \
+    OP(0x4C, abso, jmp, 3, 0) \
+    OP(0x4D, abso, eor, 4, 1) \
+    OP(0x4E, abso, lsr, 6, 0) \
+    OP(0x4F, abso, sre, 6, 0) \
+    OP(0x50, rel,  bvc, 2, 0) \
+    OP(0x51, indy, eor, 5, 1) \
+    OP(0x52, imp,  nop, 2, 0) \
+    OP(0x53, indy, sre, 8, 0) \
+    OP(0x54, zpx,  nop, 4, 0) \
+    OP(0x55, zpx,  eor, 4, 1) \
+    OP(0x56, zpx,  lsr, 6, 0) \
+    OP(0x57, zpx,  sre, 6, 0) \
+    OP(0x58, imp,  cli, 2, 0) \
+    OP(0x59, absy, eor, 4, 1) \
+    OP(0x5A, imp,  nop, 2, 0) \
+    OP(0x5B, absy, sre, 7, 0) \
+    OP(0x5C, absx, nop, 4, 1) \
+    OP(0x5D, absx, eor, 4, 1) \
+    OP(0x5E, absx, lsr, 7, 0) \
+    OP(0x5F, absx, sre, 7, 0) \
+    OP(0x60, imp,  rts, 6, 0) \
+    OP(0x61, indx, adc, 6, 1) \
+    OP(0x62, imp,  nop, 2, 0) \
+    OP(0x63, indx, rra, 8, 0) \
+    OP(0x64, zp,   nop, 3, 0) \
+    OP(0x65, zp,   adc, 3, 1) \
+    OP(0x66, zp,   ror, 5, 0) \
+    OP(0x67, zp,   rra, 5, 0) \
+    OP(0x68, imp,  pla, 4, 0) \
+    OP(0x69, imm,  adc, 2, 1) \
+    OP(0x6A, acc,  ror, 2, 0) \
+    OP(0x6B, imm,  nop, 2, 0) \
+    OP(0x6C, ind,  jmp, 5, 0) \
+    OP(0x6D, abso, adc, 4, 1) \
+    OP(0x6E, abso, ror, 6, 0) \
+    OP(0x6F, abso, rra, 6, 0) \
+    OP(0x70, rel,  bvs, 2, 0) \
+    OP(0x71, indy, adc, 5, 1) \
+    OP(0x72, imp,  nop, 2, 0) \
+    OP(0x73, indy, rra, 8, 0) \
+    OP(0x74, zpx,  nop, 4, 0) \
+    OP(0x75, zpx,  adc, 4, 1) \
+    OP(0x76, zpx,  ror, 6, 0) \
+    OP(0x77, zpx,  rra, 6, 0) \
+    OP(0x78, imp,  sei, 2, 0) \
+    OP(0x79, absy, adc, 4, 1) \
+    OP(0x7A, imp,  nop, 2, 0) \
+    OP(0x7B, absy, rra, 7, 0) \
+    OP(0x7C, absx, nop, 4, 1) \
+    OP(0x7D, absx, adc, 4, 1) \
+    OP(0x7E, absx, ror, 7, 0) \
+    OP(0x7F, absx, rra, 7, 0) \
+    OP(0x80, imm,  nop, 2, 0) \
+    OP(0x81, indx, sta, 6, 0) \
+    OP(0x82, imm,  nop, 2, 0) \
+    OP(0x83, indx, sax, 6, 0) \
+    OP(0x84, zp,   sty, 3, 0) \
+    OP(0x85, zp,   sta, 3, 0) \
+    OP(0x86, zp,   stx, 3, 0) \
+    OP(0x87, zp,   sax, 3, 0) \
+    OP(0x88, imp,  dey, 2, 0) \
+    OP(0x89, imm,  nop, 2, 0) \
+    OP(0x8A, imp,  txa, 2, 0) \
+    OP(0x8B, imm,  nop, 2, 0) \
+    OP(0x8C, abso, sty, 4, 0) \
+    OP(0x8D, abso, sta, 4, 0) \
+    OP(0x8E, abso, stx, 4, 0) \
+    OP(0x8F, abso, sax, 4, 0) \
+    OP(0x90, rel,  bcc, 2, 0) \
+    OP(0x91, indy, sta, 6, 0) \
+    OP(0x92, imp,  nop, 2, 0) \
+    OP(0x93, indy, nop, 6, 0) \
+    OP(0x94, zpx,  sty, 4, 0) \
+    OP(0x95, zpx,  sta, 4, 0) \
+    OP(0x96, zpy,  stx, 4, 0) \
+    OP(0x97, zpy,  sax, 4, 0) \
+    OP(0x98, imp,  tya, 2, 0) \
+    OP(0x99, absy, sta, 5, 0) \
+    OP(0x9A, imp,  txs, 2, 0) \
+    OP(0x9B, absy, nop, 5, 0) \
+    OP(0x9C, absx, nop, 5, 0) \
+    OP(0x9D, absx, sta, 5, 0) \
+    OP(0x9E, absy, nop, 5, 0) \
+    OP(0x9F, absy, nop, 5, 0) \
+    OP(0xA0, imm,  ldy, 2, 1) \
+    OP(0xA1, indx, lda, 6, 1) \
+    OP(0xA2, imm,  ldx, 2, 1) \
+    OP(0xA3, indx, lax, 6, 1) \
+    OP(0xA4, zp,   ldy, 3, 1) \
+    OP(0xA5, zp,   lda, 3, 1) \
+    OP(0xA6, zp,   ldx, 3, 1) \
+    OP(0xA7, zp,   lax, 3, 1) \
+    OP(0xA8, imp,  tay, 2, 0) \
+    OP(0xA9, imm,  lda, 2, 1) \
+    OP(0xAA, imp,  tax, 2, 0) \
+    OP(0xAB, imm,  nop, 2, 0) \
+    OP(0xAC, abso, ldy, 4, 1) \
+    OP(0xAD, abso, lda, 4, 1) \
+    OP(0xAE, abso, ldx, 4, 1) \
+    OP(0xAF, abso, lax, 4, 1) \
+    OP(0xB0, rel,  bcs, 2, 0) \
+    OP(0xB1, indy, lda, 5, 1) \
+    OP(0xB2, imp,  nop, 2, 0) \
+    OP(0xB3, indy, lax, 5, 1) \
+    OP(0xB4, zpx,  ldy, 4, 1) \
+    OP(0xB5, zpx,  lda, 4, 1) \
+    OP(0xB6, zpy,  ldx, 4, 1) \
+    OP(0xB7, zpy,  lax, 4, 1) \
+    OP(0xB8, imp,  clv, 2, 0) \
+    OP(0xB9, absy, lda, 4, 1) \
+    OP(0xBA, imp,  tsx, 2, 0) \
+    OP(0xBB, absy, lax, 4, 1) \
+    OP(0xBC, absx, ldy, 4, 1) \
+    OP(0xBD, absx, lda, 4, 1) \
+    OP(0xBE, absy, ldx, 4, 1) \
+    OP(0xBF, absy, lax, 4, 1) \
+    OP(0xC0, imm,  cpy, 2, 0) \
+    OP(0xC1, indx, cmp, 6, 1) \
+    OP(0xC2, imm,  nop, 2, 0) \
+    OP(0xC3, indx, dcp, 8, 0) \
+    OP(0xC4, zp,   cpy, 3, 0) \
+    OP(0xC5, zp,   cmp, 3, 1) \
+    OP(0xC6, zp,   dec, 5, 0) \
+    OP(0xC7, zp,   dcp, 5, 0) \
+    OP(0xC8, imp,  iny, 2, 0) \
+    OP(0xC9, imm,  cmp, 2, 1) \
+    OP(0xCA, imp,  dex, 2, 0) \
+    OP(0xCB, imm,  nop, 2, 0) \
+    OP(0xCC, abso, cpy, 4, 0) \
+    OP(0xCD, abso, cmp, 4, 1) \
+    OP(0xCE, abso, dec, 6, 0) \
+    OP(0xCF, abso, dcp, 6, 0) \
+    OP(0xD0, rel,  bne, 2, 0) \
+    OP(0xD1, indy, cmp, 5, 1) \
+    OP(0xD2, imp,  nop, 2, 0) \
+    OP(0xD3, indy, dcp, 8, 0) \
+    OP(0xD4, zpx,  nop, 4, 0) \
+    OP(0xD5, zpx,  cmp, 4, 1) \
+    OP(0xD6, zpx,  dec, 6, 0) \
+    OP(0xD7, zpx,  dcp, 6, 0) \
+    OP(0xD8, imp,  cld, 2, 0) \
+    OP(0xD9, absy, cmp, 4, 1) \
+    OP(0xDA, imp,  nop, 2, 0) \
+    OP(0xDB, absy, dcp, 7, 0) \
+    OP(0xDC, absx, nop, 4, 1) \
+    OP(0xDD, absx, cmp, 4, 1) \
+    OP(0xDE, absx, dec, 7, 0) \
+    OP(0xDF, absx, dcp, 7, 0) \
+    OP(0xE0, imm,  cpx, 2, 0) \
+    OP(0xE1, indx, sbc, 6, 1) \
+    OP(0xE2, imm,  nop, 2, 0) \
+    OP(0xE3, indx, isb, 8, 0) \
+    OP(0xE4, zp,   cpx, 3, 0) \
+    OP(0xE5, zp,   sbc, 3, 1) \
+    OP(0xE6, zp,   inc, 5, 0) \
+    OP(0xE7, zp,   isb, 5, 0) \
+    OP(0xE8, imp,  inx, 2, 0) \
+    OP(0xE9, imm,  sbc, 2, 1) \
+    OP(0xEA, imp,  nop, 2, 0) \
+    OP(0xEB, imm,  sbc, 2, 1) \
+    OP(0xEC, abso, cpx, 4, 0) \
+    OP(0xED, abso, sbc, 4, 1) \
+    OP(0xEE, abso, inc, 6, 0) \
+    OP(0xEF, abso, isb, 6, 0) \
+    OP(0xF0, rel,  beq, 2, 0) \
+    OP(0xF1, indy, sbc, 5, 1) \
+    OP(0xF2, imp,  nop, 2, 0) \
+    OP(0xF3, indy, isb, 8, 0) \
+    OP(0xF4, zpx,  nop, 4, 0) \
+    OP(0xF5, zpx,  sbc, 4, 1) \
+    OP(0xF6, zpx,  inc, 6, 0) \
+    OP(0xF7, zpx,  isb, 6, 0) \
+    OP(0xF8, imp,  sed, 2, 0) \
+    OP(0xF9, absy, sbc, 4, 1) \
+    OP(0xFA, imp,  nop, 2, 0) \
+    OP(0xFB, absy, isb, 7, 0) \
+    OP(0xFC, absx, nop, 4, 1) \
+    OP(0xFD, absx, sbc, 4, 1) \
+    OP(0xFE, absx, inc, 7, 0) \
+    OP(0xFF, absx, isb, 7, 0)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Data reads and writes check the page flags and go through the bus callbacks for flagged pages. Instructions and
+// their operands are always fetched directly from memory
+
+#ifdef _WIN32
+#define inline __inline
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accesses to flagged pages are kept out of line so the handlers stay small. Only the first watched access in an
+// instruction is recorded
+
+static NOINLINE void checkWatch(Cpu6502* cpu, uint16_t address, uint8_t access)
+{
+    if (!(cpu->pageFlags[address >> 8] & Cpu6502Page_Watch) || !(cpu->watchpoints[address] & access))
+        return;
+
+    if (!cpu->watchAccess)
+    {
+        cpu->watchAddress = address;
+        cpu->watchAccess = access;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static NOINLINE uint8_t readFlagged(Cpu6502* cpu, const uint8_t* memory, uint16_t address)
+{
+    checkWatch(cpu, address, Cpu6502Watch_Read);
+
+    if (cpu->pageFlags[address >> 8] & Cpu6502Page_Bus)
+        return cpu->read(cpu->busData, address);
+
+    return memory[address];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static NOINLINE void writeFlagged(Cpu6502* cpu, uint8_t* memory, uint16_t address, uint8_t value)
+{
+    checkWatch(cpu, address, Cpu6502Watch_Write);
+
+    if (cpu->pageFlags[address >> 8] & Cpu6502Page_Bus)
+        cpu->write(cpu->busData, address, value);
+    else
+        memory[address] = value;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A watchpoint hit clears the local clock goal so the tick check after the instruction ends the slice
+
+static inline uint8_t readBus(Cpu6502* cpu, const uint8_t* memory, uint16_t address, uint32_t* clockgoal)
+{
+    if (cpu->pageFlags[address >> 8])
+    {
+        uint8_t value = readFlagged(cpu, memory, address);
+
+        if (cpu->watchAccess)
+            *clockgoal = 0;
+
+        return value;
+    }
+
+    return memory[address];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void writeBus(Cpu6502* cpu, uint8_t* memory, uint16_t address, uint8_t value, uint32_t* clockgoal)
+{
+    if (cpu->pageFlags[address >> 8])
+    {
+        writeFlagged(cpu, memory, address, value);
+
+        if (cpu->watchAccess)
+            *clockgoal = 0;
+    }
+    else
+        memory[address] = value;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory and flag helpers. These work on the local copies of the registers in Cpu6502_exec
+
+#define FETCH(addr) memory[(uint16_t)(addr)]
+#define FETCH16(addr) (uint16_t)(FETCH(addr) | (FETCH((addr) + 1) << 8))
+#define READ(addr) readBus(cpu, memory, (uint16_t)(addr), &clockgoal)
+#define WRITE(addr, v) writeBus(cpu, memory, (uint16_t)(addr), (uint8_t)(v), &clockgoal)
+#define READ16(addr) (uint16_t)(READ(addr) | (READ((addr) + 1) << 8))
+
+#define SET_FLAG(flag, cond) status = (cond) ? (status | (flag)) : (status & ~(flag))
+#define ZERO_SIGN(n) status = (status & ~(FLAG_ZERO | FLAG_SIGN)) | ((n) & 0xFF ? 0 : FLAG_ZERO) | ((n) & FLAG_SIGN)
+
+#define PUSH8(v) WRITE(BASE_STACK + sp--, v)
+
+#define PUSH16(v) \
+    { \
+        uint16_t pushval = (uint16_t)(v); \
+        WRITE(BASE_STACK + sp, pushval >> 8); \
+        WRITE(BASE_STACK + ((sp - 1) & 0xFF), pushval); \
+        sp -= 2; \
+    }
+
+#define PULL8() READ(BASE_STACK + ++sp)
+
+#define PULL16(dest) \
+    dest = (uint16_t)(READ(BASE_STACK + ((sp + 1) & 0xFF)) | (READ(BASE_STACK + ((sp + 2) & 0xFF)) << 8)); \
+    sp += 2;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Addressing modes. These calculate ea (or the branch offset for rel) and set crossed for the indexed modes
+
+#define ADDR_imp
+#define ADDR_acc
+#define ADDR_imm ea = pc++;
+#define ADDR_zp ea = FETCH(pc++);
+#define ADDR_zpx ea = (uint8_t)(FETCH(pc++) + x);
+#define ADDR_zpy ea = (uint8_t)(FETCH(pc++) + y);
+#define ADDR_rel ea = (uint16_t)(int8_t)FETCH(pc++);
+#define ADDR_abso ea = FETCH16(pc); pc += 2;
+#define ADDR_absx ea = FETCH16(pc); crossed = (uint8_t)ea + x > 0xFF; ea += x; pc += 2;
+#define ADDR_absy ea = FETCH16(pc); crossed = (uint8_t)ea + y > 0xFF; ea += y; pc += 2;
+
+// Replicates the 6502 page wraparound bug for the pointer
+#define ADDR_ind \
+    ea = FETCH16(pc); \
+    ea = (uint16_t)(READ(ea) | (READ((ea & 0xFF00) | ((ea + 1) & 0xFF)) << 8)); \
+    pc += 2;
+
+#define ADDR_indx \
+    ea = (uint8_t)(FETCH(pc++) + x); \
+    ea = (uint16_t)(READ(ea) | (READ((ea + 1) & 0xFF) << 8));
+
+#define ADDR_indy \
+    ea = FETCH(pc++); \
+    ea = (uint16_t)(READ(ea) | (READ((ea + 1) & 0xFF) << 8)); \
+    crossed = (uint8_t)ea + y > 0xFF; \
+    ea += y;
+
+// Modes that can cross a page
+#define CROSSED_imp 0
+#define CROSSED_acc 0
+#define CROSSED_imm 0
+#define CROSSED_zp 0
+#define CROSSED_zpx 0
+#define CROSSED_zpy 0
+#define CROSSED_rel 0
+#define CROSSED_abso 0
+#define CROSSED_absx crossed
+#define CROSSED_absy crossed
+#define CROSSED_ind 0
+#define CROSSED_indx 0
+#define CROSSED_indy crossed
+
+// Operand access, the accumulator for acc and memory at ea for everything else
+#define LOAD_acc a
+#define STORE_acc(v) a = (uint8_t)(v)
+#define LOAD_MEM READ(ea)
+#define STORE_MEM(v) WRITE(ea, v)
+
+#define LOAD_imm FETCH(ea)
+#define LOAD_zp LOAD_MEM
+#define LOAD_zpx LOAD_MEM
+#define LOAD_zpy LOAD_MEM
+#define LOAD_abso LOAD_MEM
+#define LOAD_absx LOAD_MEM
+#define LOAD_absy LOAD_MEM
+#define LOAD_indx LOAD_MEM
+#define LOAD_indy LOAD_MEM
+
+#define STORE_zp STORE_MEM
+#define STORE_zpx STORE_MEM
+#define STORE_zpy STORE_MEM
+#define STORE_abso STORE_MEM
+#define STORE_absx STORE_MEM
+#define STORE_absy STORE_MEM
+#define STORE_indx STORE_MEM
+#define STORE_indy STORE_MEM
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Operations. m is the addressing mode so operand access can be resolved at compile time
+
+#define ADD(v) \
+    value = (uint16_t)(v); \
+    result = (uint16_t)(a + value + (status & FLAG_CARRY)); \
+    SET_FLAG(FLAG_CARRY, result & 0xFF00); \
+    SET_FLAG(FLAG_OVERFLOW, (result ^ a) & (result ^ value) & 0x80); \
+    ZERO_SIGN(result); \
+    a = (uint8_t)result;
+
+#define COMPARE(reg, v) \
+    value = (v); \
+    SET_FLAG(FLAG_CARRY, reg >= value); \
+    ZERO_SIGN(reg - value);
+
+#define BRANCH(cond) \
+    if (cond) \
+    { \
+        uint16_t oldpc = pc; \
+        pc += ea; \
+        clockticks += ((oldpc ^ pc) & 0xFF00) ? 2 : 1; \
+    }
+
+#define TRANSFER(dest, src) dest = src; ZERO_SIGN(dest);
+
+#define INST_adc(m) ADD(LOAD_##m)
+#define INST_and(m) a &= LOAD_##m; ZERO_SIGN(a);
+#define INST_asl(m) value = LOAD_##m; result = (uint16_t)(value << 1); SET_FLAG(FLAG_CARRY, result & 0xFF00); ZERO_SIGN(result); STORE_##m(result);
+#define INST_bcc(m) BRANCH(!(status & FLAG_CARRY))
+#define INST_bcs(m) BRANCH(status & FLAG_CARRY)
+#define INST_beq(m) BRANCH(status & FLAG_ZERO)
+#define INST_bit(m) value = LOAD_##m; SET_FLAG(FLAG_ZERO, !(a & value)); status = (uint8_t)((status & 0x3F) | (value & 0xC0));
+#define INST_bmi(m) BRANCH(status & FLAG_SIGN)
+#define INST_bne(m) BRANCH(!(status & FLAG_ZERO))
+#define INST_bpl(m) BRANCH(!(status & FLAG_SIGN))
+#define INST_brk(m) pc++; PUSH16(pc); PUSH8(status | FLAG_BREAK); status |= FLAG_INTERRUPT; pc = READ16(0xFFFE);
+#define INST_bvc(m) BRANCH(!(status & FLAG_OVERFLOW))
+#define INST_bvs(m) BRANCH(status & FLAG_OVERFLOW)
+#define INST_clc(m) status &= ~FLAG_CARRY;
+#define INST_cld(m) status &= ~FLAG_DECIMAL;
+#define INST_cli(m) status &= ~FLAG_INTERRUPT;
+#define INST_clv(m) status &= ~FLAG_OVERFLOW;
+#define INST_cmp(m) COMPARE(a, LOAD_##m)
+#define INST_cpx(m) COMPARE(x, LOAD_##m)
+#define INST_cpy(m) COMPARE(y, LOAD_##m)
+#define INST_dec(m) result = (uint8_t)(LOAD_##m - 1); ZERO_SIGN(result); STORE_##m(result);
+#define INST_dex(m) x--; ZERO_SIGN(x);
+#define INST_dey(m) y--; ZERO_SIGN(y);
+#define INST_eor(m) a ^= LOAD_##m; ZERO_SIGN(a);
+#define INST_inc(m) result = (uint8_t)(LOAD_##m + 1); ZERO_SIGN(result); STORE_##m(result);
+#define INST_inx(m) x++; ZERO_SIGN(x);
+#define INST_iny(m) y++; ZERO_SIGN(y);
+#define INST_jmp(m) pc = ea;
+#define INST_jsr(m) PUSH16(pc - 1); pc = ea;
+#define INST_lda(m) a = LOAD_##m; ZERO_SIGN(a);
+#define INST_ldx(m) x = LOAD_##m; ZERO_SIGN(x);
+#define INST_ldy(m) y = LOAD_##m; ZERO_SIGN(y);
+#define INST_lsr(m) value = LOAD_##m; SET_FLAG(FLAG_CARRY, value & 1); result = value >> 1; ZERO_SIGN(result); STORE_##m(result);
+#define INST_nop(m)
+#define INST_ora(m) a |= LOAD_##m; ZERO_SIGN(a);
+#define INST_pha(m) PUSH8(a);
+#define INST_php(m) PUSH8(status | FLAG_BREAK);
+#define INST_pla(m) a = PULL8(); ZERO_SIGN(a);
+#define INST_plp(m) status = PULL8() | FLAG_CONSTANT;
+#define INST_rol(m) value = LOAD_##m; result = (uint16_t)((value << 1) | (status & FLAG_CARRY)); SET_FLAG(FLAG_CARRY, result & 0xFF00); ZERO_SIGN(result); STORE_##m(result);
+#define INST_ror(m) value = LOAD_##m; result = (uint16_t)((value >> 1) | ((status & FLAG_CARRY) << 7)); SET_FLAG(FLAG_CARRY, value & 1); ZERO_SIGN(result); STORE_##m(result);
+#define INST_rti(m) status = PULL8(); PULL16(pc);
+#define INST_rts(m) PULL16(pc); pc++;
+#define INST_sbc(m) ADD(LOAD_##m ^ 0xFF)
+#define INST_sec(m) status |= FLAG_CARRY;
+#define INST_sed(m) status |= FLAG_DECIMAL;
+#define INST_sei(m) status |= FLAG_INTERRUPT;
+#define INST_sta(m) STORE_##m(a);
+#define INST_stx(m) STORE_##m(x);
+#define INST_sty(m) STORE_##m(y);
+#define INST_tax(m) TRANSFER(x, a)
+#define INST_tay(m) TRANSFER(y, a)
+#define INST_tsx(m) TRANSFER(x, sp)
+#define INST_txa(m) TRANSFER(a, x)
+#define INST_txs(m) sp = x;
+#define INST_tya(m) TRANSFER(a, y)
+
+// Undocumented. The memory is read again for the second part like the original core does
+#define INST_lax(m) a = x = LOAD_##m; ZERO_SIGN(a);
+#define INST_sax(m) STORE_##m(a); STORE_##m(x); STORE_##m(a & x);
+#define INST_dcp(m) INST_dec(m) INST_cmp(m)
+#define INST_isb(m) INST_inc(m) INST_sbc(m)
+#define INST_slo(m) INST_asl(m) INST_ora(m)
+#define INST_rla(m) INST_rol(m) INST_and(m)
+#define INST_sre(m) INST_lsr(m) INST_eor(m)
+#define INST_rra(m) INST_ror(m) INST_adc(m)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Each opcode handler runs the addressing mode and the operation, adds the ticks, checks if the cpu should stop and
+// otherwise dispatches the next opcode
+
+#ifdef CPU6502_COMPUTED_GOTO
+
+#define OP_LABEL(code, mode, inst, ticks, penalty) [code] = &&op_##code,
+#define OP_BEGIN(code) op_##code:
+#define OP_DISPATCH() opcode = FETCH(pc++); status |= FLAG_CONSTANT; goto *dispatch[opcode];
+
+#else
+
+#define OP_BEGIN(code) case code:
+#define OP_DISPATCH() continue;
+
+#endif
+
+#define OP_HANDLER(code, mode, inst, ticks, penalty) \
+    OP_BEGIN(code) \
+    { \
+        ADDR_##mode \
+        INST_##inst(mode) \
+        clockticks += ticks; \
+        if (penalty && CROSSED_##mode) \
+            clockticks++; \
+        instructions++; \
+        if (breakpoints && (breakpoints[pc] & Breakpoint6502_Exec)) \
+        { \
+            hit = 1; \
+            goto done; \
+        } \
+        if (clockticks >= clockgoal) \
+            goto done; \
+        OP_DISPATCH() \
+    }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Cpu6502_init(Cpu6502* cpu, uint8_t* memory)
+{
+    memset(cpu, 0, sizeof(Cpu6502));
+    cpu->memory = memory;
+    Cpu6502_reset(cpu);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Cpu6502_reset(Cpu6502* cpu)
+{
+    cpu->pc = 0;
+    cpu->a = 0;
+    cpu->x = 0;
+    cpu->y = 0;
+    cpu->sp = 0xFD;
+    cpu->status |= FLAG_CONSTANT;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Cpu6502_setPageFlags(Cpu6502* cpu, uint16_t address, uint32_t size, uint8_t flags, int enable)
+{
+    uint32_t page;
+    uint32_t end = (uint32_t)address + size;
+
+    if (size == 0)
+        return;
+
+    if (end > 0x10000)
+        end = 0x10000;
+
+    for (page = address >> 8; page <= (end - 1) >> 8; ++page)
+    {
+        if (enable)
+            cpu->pageFlags[page] |= flags;
+        else
+            cpu->pageFlags[page] &= (uint8_t)~flags;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The registers are copied to locals while running so they don't have to be written back to memory after each
+// instruction. After each instruction the breakpoint map and the tick count are checked and the next opcode is
+// fetched and dispatched.
+
+int Cpu6502_exec(Cpu6502* cpu, uint32_t tickcount, const uint8_t* breakpoints)
+{
+    uint8_t* memory = cpu->memory;
+    uint16_t pc = cpu->pc;
+    uint8_t sp = cpu->sp, a = cpu->a, x = cpu->x, y = cpu->y, status = cpu->status;
+    uint32_t clockticks = cpu->clockticks;
+    uint32_t clockgoal = cpu->clockgoal + tickcount;
+    uint32_t instructions = cpu->instructions;
+    uint16_t ea = 0, value, result;
+    int crossed = 0;
+    int hit = 0;
+
+    cpu->watchAccess = 0;
+
+#ifdef CPU6502_COMPUTED_GOTO
+    static const void* dispatch[256] = { CPU6502_OPCODES(OP_LABEL) };
+#endif
+    uint8_t opcode;
+
+    if (clockticks >= clockgoal)
+        goto done;
+
+#ifdef CPU6502_COMPUTED_GOTO
+
+    OP_DISPATCH()
+    CPU6502_OPCODES(OP_HANDLER)
+
+#else
+
+    for (;;)
+    {
+        opcode = FETCH(pc++);
+        status |= FLAG_CONSTANT;
+
+        switch (opcode)
+        {
+            CPU6502_OPCODES(OP_HANDLER)
+        }
+    }
+
+#endif
+
+done:
+
+    if (cpu->watchAccess)
+        hit = 1;
+
+    // Stopping on a breakpoint resets the goal so the next slice starts counting from here
+    cpu->clockgoal = hit ? clockticks : clockgoal;
+
+    cpu->pc = pc;
+    cpu->sp = sp;
+    cpu->a = a;
+    cpu->x = x;
+    cpu->y = y;
+    cpu->status = status;
+    cpu->clockticks = clockticks;
+    cpu->instructions = instructions;
+
+    return hit;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Cpu6502_step(Cpu6502* cpu)
+{
+    // All instructions take at least two ticks so this runs exactly one
+    cpu->clockgoal = cpu->clockticks;
+    Cpu6502_exec(cpu, 1, 0);
+    cpu->clockgoal = cpu->clockticks;
+}
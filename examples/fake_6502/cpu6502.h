@@ -0,0 +1,82 @@
+#ifndef _CPU6502_H_
+#define _CPU6502_H_
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// 6502 core (NES cpu, that is no BCD, with the undocumented opcodes) with all state in a struct. Nothing is shared
+// between instances so any number of them can be run side by side, on the same thread or on different ones. The
+// addressing mode and operation of each opcode is expanded into one handler so the compiler can keep the registers
+// in host registers while running.
+//
+// Data accesses to pages that has a non-zero entry in pageFlags are passed to the read and write callbacks instead
+// of going to memory. This is used for memory mapped hardware. Instructions are always fetched from memory.
+//
+// Data watchpoints work the same way: pages with Cpu6502Page_Watch set have their accesses checked against the
+// watchpoints map and a hit stops exec after the instruction is done. Accesses to other pages only pay for the page
+// flag test that is done anyway.
+
+typedef uint8_t (*Cpu6502ReadFunc)(void* busData, uint16_t address);
+typedef void (*Cpu6502WriteFunc)(void* busData, uint16_t address, uint8_t value);
+
+enum
+{
+    Cpu6502Page_Bus = 1 << 0,
+    Cpu6502Page_Watch = 1 << 1,
+};
+
+// Bits in the watchpoints map
+enum
+{
+    Cpu6502Watch_Read = 1 << 0,
+    Cpu6502Watch_Write = 1 << 1,
+};
+
+typedef struct Cpu6502
+{
+    uint16_t pc;
+    uint8_t sp, a, x, y, status;
+
+    uint32_t clockticks;
+    uint32_t clockgoal;
+    uint32_t instructions;
+
+    // 64k of memory that the cpu reads and writes directly
+    uint8_t* memory;
+
+    // One entry per 256 byte page
+    uint8_t pageFlags[256];
+
+    Cpu6502ReadFunc read;
+    Cpu6502WriteFunc write;
+    void* busData;
+
+    // 64k, one byte per address with Cpu6502Watch bits. Only looked at for pages flagged with Cpu6502Page_Watch
+    const uint8_t* watchpoints;
+
+    // First watched access in the last exec or step (watchAccess is 0 if there was none)
+    uint16_t watchAddress;
+    uint8_t watchAccess;
+
+} Cpu6502;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Clears all state and resets the cpu
+void Cpu6502_init(Cpu6502* cpu, uint8_t* memory);
+
+void Cpu6502_reset(Cpu6502* cpu);
+
+// Sets or clears flags for all pages in the range. Set the callbacks before flagging any pages for the bus
+void Cpu6502_setPageFlags(Cpu6502* cpu, uint16_t address, uint32_t size, uint8_t flags, int enable);
+
+// Runs until tickcount clock ticks has passed or the next instruction has Breakpoint6502_Exec set in breakpoints
+// (64k, one byte per address, may be null) or a watchpoint was hit. Returns 1 if stopped on a breakpoint or a
+// watchpoint (watchAccess is set for the latter). The instruction at the current pc is always executed so continuing
+// from a breakpoint works.
+int Cpu6502_exec(Cpu6502* cpu, uint32_t tickcount, const uint8_t* breakpoints);
+
+// Executes a single instruction
+void Cpu6502_step(Cpu6502* cpu);
+
+#endif
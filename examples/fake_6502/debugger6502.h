@@ -1,17 +1,94 @@
 #ifndef _DEBUGGER6502_H_
 #define _DEBUGGER6502_H_
 
+#include <stdint.h>
+#include <pd_trace.h>
+#include "cpu6502.h"
+#include "history6502.h"
+#include "profile6502.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Data watchpoint as set by the debugger. All of them are put in g_watchpoints6502 for the cpu to check
+
+typedef struct Watchpoint6502
+{
+    uint32_t id;
+    uint16_t address;
+    uint32_t size;
+    uint8_t access;
+
+} Watchpoint6502;
+
+enum
+{
+    Watchpoint6502_Max = 64,
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 typedef struct Debugger6502
 {
-    int runState;
+    // Written by both the emulator thread and the debugger connection thread. Only changed while holding the cpu lock
+    volatile int runState;
+
+    // Last state the debugger was told about. Used to send the cpu state when the emulator has stopped
+    int sentState;
+
+    // Executed instructions are recorded here by the emulator thread while traceEnabled is set and read by the
+    // debugger connection thread
+    PDTraceBuffer trace;
+    volatile int traceEnabled;
+
+    // Snapshots taken by the emulator thread and used by the debugger connection thread to step backwards
+    History6502 history;
+
+    // Counted by the emulator thread while profileEnabled is set. Only read and cleared while holding the cpu lock
+    Profile6502 profile;
+    volatile int profileEnabled;
+
+    // Only changed by the debugger connection thread while holding the cpu lock
+    Watchpoint6502 watchpoints[Watchpoint6502_Max];
+    int watchpointCount;
 
 } Debugger6502;
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// One byte per address that is checked for each executed instruction so the emulator can run at full speed and still
+// stop exactly at a breakpoint
+
+enum
+{
+    Breakpoint6502_Exec = 1 << 0,
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Registers as sent to the debugger. Bits in PDTraceRecord::changed_registers uses the same order
+
+enum
+{
+    Register6502_Pc,
+    Register6502_Sp,
+    Register6502_A,
+    Register6502_X,
+    Register6502_Y,
+    Register6502_Status,
+};
+
+// Number of instructions kept in the trace (24 MB)
+#define TRACE6502_SIZE (1 << 20)
+
+// A snapshot every 50000 instructions keeps a step back to a few ms. With 1024 snapshots about 50M instructions can
+// be stepped back through
+#define HISTORY6502_INTERVAL 50000
+#define HISTORY6502_SNAPSHOTS 1024
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 extern Debugger6502* g_debugger;
+extern uint8_t g_breakpoints6502[65536];
+extern uint8_t g_watchpoints6502[65536];
 
-#endif
+// The cpu instance the debugger is attached to
+extern Cpu6502* g_cpu6502;
 
+#endif
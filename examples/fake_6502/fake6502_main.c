@@ -2,63 +2,513 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
-#ifndef _WIN32
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include <unistd.h>
 #endif
+#include "cpu6502.h"
 #include "debugger6502.h"
 #include <pd_backend.h>
 #include <pd_remote.h>
 
-uint8_t* s_memory6502; //[65536];
+// Memory of the instance the debugger is attached to (used by the disassembler)
+uint8_t* s_memory6502;
+
+Cpu6502* g_cpu6502;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Some exters from the 6502 emulator that we need to control it
 
-extern void reset6502();
-extern void execute6502();
 extern struct PDBackendPlugin s_debuggerPlugin;
-extern uint32_t clockticks6502;
-extern uint32_t clockgoal6502;
-void exec6502(uint32_t tickcount);
-void step6502();
 extern void disassemble(unsigned short begin, unsigned short end);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Read function  for the emulated 6502 CPU
+// Any number of cpu instances can be run from the same image (-instances). The debugger is attached to one of them
+// (-attach) which runs on the main thread and the debugger connection runs on its own thread. The cpu lock is held
+// while running a slice of instructions on the attached cpu and while the debugger connection is updated so the
+// plugin always sees the cpu between instructions. Breakpoints are checked for each instruction and watchpoints for
+// each access to a watched page (see Cpu6502_exec) so slices can be fairly large. While the debugger has tracing
+// enabled the attached cpu is instead stepped one instruction at a time and each instruction is recorded in the trace
+// buffer (see execRecorded). The same is done for the exact profile while the sampling profile runs the slice in
+// chunks of the sample interval.
+//
+// Snapshots for stepping backwards are taken between slices (see History6502_update) so the spacing between them is
+// at most one slice more than the snapshot interval.
+//
+// The other instances are split over a number of worker threads (-threads) and run freely.
+
+enum
+{
+    RunSliceTicks = 10000,
+    RemoteUpdateMs = 2,
+    BenchmarkTicks = 200 * 1000 * 1000,
+    MaxThreads = 64,
+};
+
+#ifdef _WIN32
+typedef HANDLE Thread;
+typedef DWORD (WINAPI* ThreadFunc)(void* data);
+#define THREAD_FUNC(name) static DWORD WINAPI name(void* data)
+static CRITICAL_SECTION s_cpuLock;
+#else
+typedef pthread_t Thread;
+typedef void* (*ThreadFunc)(void* data);
+#define THREAD_FUNC(name) static void* name(void* data)
+static pthread_mutex_t s_cpuLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+// Set while the remote thread waits for the cpu lock. The lock isn't fair so when the emulator releases it between
+// slices and takes it again right away the remote thread could wait for a long time. Instead the emulator yields until
+// the remote thread has the lock (see runEmulator)
+static volatile long s_remoteWaiting;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A range of instances run by one worker thread
+
+typedef struct FarmThread
+{
+    Cpu6502* cpus;
+    int count;
+
+    // Ticks to run each cpu for, 0 runs forever
+    uint32_t ticks;
+
+} FarmThread;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void lockCpu()
+{
+#ifdef _WIN32
+    EnterCriticalSection(&s_cpuLock);
+#else
+    pthread_mutex_lock(&s_cpuLock);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void unlockCpu()
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&s_cpuLock);
+#else
+    pthread_mutex_unlock(&s_cpuLock);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void setRemoteWaiting(long waiting)
+{
+#ifdef _WIN32
+    InterlockedExchange(&s_remoteWaiting, waiting);
+#else
+    __atomic_store_n(&s_remoteWaiting, waiting, __ATOMIC_SEQ_CST);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long isRemoteWaiting()
+{
+#ifdef _WIN32
+    return InterlockedCompareExchange(&s_remoteWaiting, 0, 0);
+#else
+    return __atomic_load_n(&s_remoteWaiting, __ATOMIC_SEQ_CST);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void yieldThread()
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void sleepMs(int ms)
+{
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    usleep((useconds_t)ms * 1000);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double timeSeconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int startThread(Thread* thread, ThreadFunc func, void* data)
+{
+#ifdef _WIN32
+    *thread = CreateThread(0, 0, func, data, 0, 0);
+    return *thread != 0;
+#else
+    return pthread_create(thread, 0, func, data) == 0;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void joinThread(Thread thread)
+{
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, 0);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Keeps the connection to the debugger updated. The plugin update is called from here
+
+THREAD_FUNC(remoteThread)
+{
+    (void)data;
+
+    for (;;)
+    {
+        setRemoteWaiting(1);
+        lockCpu();
+        setRemoteWaiting(0);
+
+        PDRemote_update(0);
+        unlockCpu();
+
+        sleepMs(RemoteUpdateMs);
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs the cpus in turns, one slice at a time. Nothing is shared between the instances so no locking is needed
+
+THREAD_FUNC(farmThread)
+{
+    FarmThread* farm = (FarmThread*)data;
+    uint32_t ticks = 0;
+
+    while (farm->ticks == 0 || ticks < farm->ticks)
+    {
+        int i;
+
+        for (i = 0; i < farm->count; ++i)
+            Cpu6502_exec(&farm->cpus[i], RunSliceTicks, 0);
+
+        ticks += RunSliceTicks;
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Splits the cpus evenly over the threads. Returns the number of threads started
+
+static int startFarm(Thread* threads, FarmThread* farms, int threadCount, Cpu6502* cpus, int count, uint32_t ticks)
+{
+    int i, started = 0, first = 0;
+
+    if (threadCount > count)
+        threadCount = count;
+
+    for (i = 0; i < threadCount; ++i)
+    {
+        int end = (int)(((int64_t)count * (i + 1)) / threadCount);
+
+        farms[i].cpus = cpus + first;
+        farms[i].count = end - first;
+        farms[i].ticks = ticks;
+
+        first = end;
+
+        if (!startThread(&threads[started], farmThread, &farms[i]))
+        {
+            printf("Unable to start worker thread\n");
+            break;
+        }
+
+        started++;
+    }
+
+    return started;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int startRemoteThread()
+{
+    Thread thread;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&s_cpuLock);
+#endif
+
+    return startThread(&thread, remoteThread, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Executes one instruction and records it with the registers it changed
+
+static void traceStep(Cpu6502* cpu, PDTraceBuffer* trace)
+{
+    PDTraceRecord record;
+    uint8_t before[5], after[5];
+    uint16_t pc = cpu->pc;
+    int i, count = 0;
+
+    before[0] = cpu->sp; before[1] = cpu->a; before[2] = cpu->x; before[3] = cpu->y; before[4] = cpu->status;
+
+    // 6502 instructions are at most 3 bytes
+    record.pc = pc;
+    record.opcode = cpu->memory[pc] | (cpu->memory[(uint16_t)(pc + 1)] << 8) |
+                    ((uint32_t)cpu->memory[(uint16_t)(pc + 2)] << 16);
+    record.changed_registers = 0;
+    memset(record.values, 0, sizeof(record.values));
+
+    Cpu6502_step(cpu);
+
+    after[0] = cpu->sp; after[1] = cpu->a; after[2] = cpu->x; after[3] = cpu->y; after[4] = cpu->status;
+
+    // pc changes for every instruction so it's not flagged
+
+    for (i = 0; i < 5; ++i)
+    {
+        if (before[i] != after[i])
+        {
+            record.changed_registers |= 1 << (Register6502_Sp + i);
+            record.values[count++] = after[i];
+        }
+    }
+
+    PDTrace_write(trace, &record);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Executes one instruction and records it in the trace and/or the exact profile (either may be null)
 
-uint8_t read6502(uint16_t address)
+static void stepRecorded(Cpu6502* cpu, PDTraceBuffer* trace, Profile6502* profile)
 {
-    return s_memory6502[address];
+    uint16_t pc = cpu->pc;
+    uint8_t sp = cpu->sp;
+    uint32_t clockticks = cpu->clockticks;
+
+    if (trace)
+        traceStep(cpu, trace);
+    else
+        Cpu6502_step(cpu);
+
+    if (profile)
+        Profile6502_countStep(profile, cpu, pc, sp, clockticks);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Write function for the 6402
+// Same as Cpu6502_exec but steps one instruction at a time so each of them can be recorded. This is a lot slower so
+// it's only used while tracing or exact profiling is enabled
 
-void write6502(uint16_t address, uint8_t value)
+static int execRecorded(Cpu6502* cpu, uint32_t tickcount, const uint8_t* breakpoints, PDTraceBuffer* trace,
+                        Profile6502* profile)
 {
-    s_memory6502[address] = value;
+    uint32_t goal = cpu->clockgoal + tickcount;
+
+    while (cpu->clockticks < goal)
+    {
+        stepRecorded(cpu, trace, profile);
+
+        if ((breakpoints[cpu->pc] & Breakpoint6502_Exec) || cpu->watchAccess)
+        {
+            cpu->clockgoal = cpu->clockticks;
+            return 1;
+        }
+    }
+
+    cpu->clockgoal = goal;
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void runEmulator()
+{
+    for (;;)
+    {
+        int state;
+
+        lockCpu();
+
+        state = g_debugger->runState;
+
+        switch (state)
+        {
+            case PDDebugState_Running:
+            {
+                int hit;
+
+                PDTraceBuffer* trace = g_debugger->traceEnabled ? &g_debugger->trace : 0;
+                Profile6502* profile = g_debugger->profileEnabled ? &g_debugger->profile : 0;
+
+                History6502_update(&g_debugger->history, g_cpu6502);
+
+                if (trace || (profile && profile->mode == PDProfileMode_Exact))
+                    hit = execRecorded(g_cpu6502, RunSliceTicks, g_breakpoints6502, trace, profile);
+                else if (profile)
+                    hit = Profile6502_execSampled(profile, g_cpu6502, RunSliceTicks, g_breakpoints6502);
+                else
+                    hit = Cpu6502_exec(g_cpu6502, RunSliceTicks, g_breakpoints6502);
+
+                if (hit)
+                    g_debugger->runState = PDDebugState_StopBreakpoint;
+
+                break;
+            }
+
+            case PDDebugState_Trace:
+            {
+                PDTraceBuffer* trace = g_debugger->traceEnabled ? &g_debugger->trace : 0;
+                Profile6502* profile = g_debugger->profileEnabled ? &g_debugger->profile : 0;
+
+                History6502_update(&g_debugger->history, g_cpu6502);
+
+                // Single steps are only worth counting in the exact profile
+
+                if (profile && profile->mode != PDProfileMode_Exact)
+                    profile = 0;
+
+                stepRecorded(g_cpu6502, trace, profile);
+
+                printf("pc %04x sp %02x a %02x x %02x y %02x status %02x\n",
+                       g_cpu6502->pc, g_cpu6502->sp, g_cpu6502->a, g_cpu6502->x, g_cpu6502->y, g_cpu6502->status);
+
+                g_debugger->runState = PDDebugState_StopException;
+                break;
+            }
+
+            default : break;
+        }
+
+        unlockCpu();
+
+        // Nothing to do until the debugger tells us to run or step
+
+        if (state != PDDebugState_Running)
+            sleepMs(1);
+
+        // Let the remote thread take the lock before the next slice so Break and breakpoint changes aren't delayed
+
+        while (isRemoteWaiting())
+            yieldThread();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs all instances for a fixed number of ticks on the worker threads and prints how fast they ran. Breakpoints
+// aren't checked
+
+static void benchmark(Cpu6502* cpus, int count, int threadCount)
+{
+    Thread threads[MaxThreads];
+    FarmThread farms[MaxThreads];
+    double start, time;
+    int i, started;
+
+    start = timeSeconds();
+
+    started = startFarm(threads, farms, threadCount, cpus, count, BenchmarkTicks);
+
+    for (i = 0; i < started; ++i)
+        joinThread(threads[i]);
+
+    time = timeSeconds() - start;
+
+    printf("%d instance(s) on %d thread(s): %.3f s, %.1f MHz per instance, %.1f MHz total\n",
+           count, started, time, BenchmarkTicks / time / 1000000.0, (double)count * BenchmarkTicks / time / 1000000.0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void printUsage()
+{
+    printf("Usage: Fake6502 [options] image.bin (max 64k in size)\n");
+    printf("  -instances n  Number of cpus to run (default 1)\n");
+    printf("  -threads n    Worker threads for the cpus the debugger isn't attached to (default 4)\n");
+    printf("  -attach n     Cpu the debugger is attached to (default 0)\n");
+    printf("  -bench        Run all cpus on the worker threads and print the speed\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int main(int argc, const char* argv[])
 {
+    Thread threads[MaxThreads];
+    FarmThread farms[MaxThreads];
+    Cpu6502* cpus;
+    uint8_t* image;
     FILE* f;
-    int size;
-
-    (void)argc;
-    (void)argv;
-    reset6502();
+    int size, i;
+    int instanceCount = 1;
+    int threadCount = 4;
+    int attach = 0;
+    int bench = 0;
+    const char* filename = argv[argc - 1];
 
     if (argc < 2)
     {
-        printf("Usage: Fake6502 image.bin (max 64k in size)\n");
+        printUsage();
         return 0;
     }
 
-    if ((f = fopen(argv[1], "rb")) == 0)
+    for (i = 1; i < argc - 1; ++i)
+    {
+        if (!strcmp(argv[i], "-bench"))
+            bench = 1;
+        else if (!strcmp(argv[i], "-instances") && i + 2 < argc)
+            instanceCount = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-threads") && i + 2 < argc)
+            threadCount = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-attach") && i + 2 < argc)
+            attach = atoi(argv[++i]);
+        else
+        {
+            printUsage();
+            return -1;
+        }
+    }
+
+    if (instanceCount < 1 || threadCount < 1 || threadCount > MaxThreads || attach < 0 || attach >= instanceCount)
     {
-        printf("Unable to open %s\n", argv[1]);
+        printUsage();
+        return -1;
+    }
+
+    if ((f = fopen(filename, "rb")) == 0)
+    {
+        printf("Unable to open %s\n", filename);
         return -1;
     }
 
@@ -68,25 +518,64 @@ int main(int argc, const char* argv[])
     size = ftell(f) - 6;
     fseek(f, 6, SEEK_SET);
 
-    s_memory6502 = malloc(65536);
-    memset(s_memory6502, 0, 65536);
+    if (size > 65536)
+        size = 65536;
 
-    fread(s_memory6502, 1, size, f);
+    image = malloc(65536);
+    memset(image, 0, 65536);
+
+    fread(image, 1, size, f);
     fclose(f);
     printf("size %d\n", (unsigned int)size);
 
+    // Each instance gets its own copy of the image
+
+    cpus = malloc(sizeof(Cpu6502) * (size_t)instanceCount);
+
+    for (i = 0; i < instanceCount; ++i)
+    {
+        uint8_t* memory = malloc(65536);
+        memcpy(memory, image, 65536);
+        Cpu6502_init(&cpus[i], memory);
+    }
+
+    free(image);
+
+    if (bench)
+    {
+        benchmark(cpus, instanceCount, threadCount);
+        return 0;
+    }
+
+    // The attached cpu is swapped to the front so the rest can be split over the worker threads
+
+    if (attach != 0)
+    {
+        Cpu6502 temp = cpus[0];
+        cpus[0] = cpus[attach];
+        cpus[attach] = temp;
+    }
+
+    g_cpu6502 = &cpus[0];
+    s_memory6502 = g_cpu6502->memory;
+
     disassemble(0, (unsigned short)size);
 
     if (!PDRemote_create(&s_debuggerPlugin, 0))
     {
         printf("Unable to setup debugger connection\n");
+        return -1;
     }
 
-    for (;;)    
+    if (!startRemoteThread())
     {
-        execute6502();
+        printf("Unable to start debugger connection thread\n");
+        return -1;
     }
 
+    startFarm(threads, farms, threadCount, cpus + 1, instanceCount - 1, 0);
+
+    runEmulator();
+
     //return 0;
 }
-
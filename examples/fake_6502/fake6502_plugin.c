@@ -1,15 +1,27 @@
 #include <pd_backend.h>
+#include <pd_readwrite.h>
+#include <pd_search.h>
 #include "debugger6502.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 
 Debugger6502* g_debugger;
-extern uint16_t pc;
-extern uint8_t sp, a, x, y, status;
+uint8_t g_breakpoints6502[65536];
+uint8_t g_watchpoints6502[65536];
 extern int disassembleToBuffer(char* dest, int* address, int* instCount);
 extern struct PDBackendPlugin s_debuggerPlugin;
 
+// Records are copied here from the trace buffer before they are sent
+static PDTraceRecord s_traceRecords[PD_TRACE_MAX_EVENT_RECORDS];
+
+// Profile counts are gathered here before they are sent. All 64k addresses fit in the event buffer (1 MB)
+static PDProfileEntry s_profileEntries[65536];
+static PDProfileCall s_profileCalls[Profile6502_MaxCalls];
+
+// Search matches (one extra to know if there were more than asked for)
+static uint64_t s_searchMatches[PD_SEARCH_MAX_EVENT_MATCHES + 1];
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 static void* createInstance(ServiceFunc* serviceFunc)
@@ -20,6 +32,11 @@ static void* createInstance(ServiceFunc* serviceFunc)
     memset(g_debugger, 0, sizeof(Debugger6502));
 
     g_debugger->runState = PDDebugState_Running;
+    g_debugger->sentState = PDDebugState_Running;
+
+    PDTrace_init(&g_debugger->trace, malloc(sizeof(PDTraceRecord) * TRACE6502_SIZE), TRACE6502_SIZE);
+    History6502_init(&g_debugger->history, HISTORY6502_SNAPSHOTS, HISTORY6502_INTERVAL);
+    Profile6502_init(&g_debugger->profile);
 
     return g_debugger;
 }
@@ -28,7 +45,12 @@ static void* createInstance(ServiceFunc* serviceFunc)
 
 static void destroyInstance(void* userData)
 {
-    free(userData);
+    Debugger6502* debugger = (Debugger6502*)userData;
+
+    free(debugger->trace.records);
+    History6502_destroy(&debugger->history);
+    Profile6502_destroy(&debugger->profile);
+    free(debugger);
     g_debugger = 0;
 }
 
@@ -58,12 +80,12 @@ static void setRegisters(PDWriter* writer)
     PDWrite_event_begin(writer, PDEventType_SetRegisters);
     PDWrite_array_begin(writer, "registers");
 
-    writeRegister(writer, "pc", 2, pc, 1);
-    writeRegister(writer, "sp", 1, sp, 0);
-    writeRegister(writer, "a", 1, a, 0);
-    writeRegister(writer, "x", 1, x, 0);
-    writeRegister(writer, "y", 1, y, 0);
-    writeRegister(writer, "status", 1, status, 1);
+    writeRegister(writer, "pc", 2, g_cpu6502->pc, 1);
+    writeRegister(writer, "sp", 1, g_cpu6502->sp, 0);
+    writeRegister(writer, "a", 1, g_cpu6502->a, 0);
+    writeRegister(writer, "x", 1, g_cpu6502->x, 0);
+    writeRegister(writer, "y", 1, g_cpu6502->y, 0);
+    writeRegister(writer, "status", 1, g_cpu6502->status, 1);
 
     PDWrite_array_end(writer);
     PDWrite_event_end(writer);
@@ -71,11 +93,41 @@ static void setRegisters(PDWriter* writer)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static const Watchpoint6502* findWatchpoint(Debugger6502* debugger, uint16_t address, uint8_t access)
+{
+    int i;
+
+    for (i = 0; i < debugger->watchpointCount; ++i)
+    {
+        const Watchpoint6502* watchpoint = &debugger->watchpoints[i];
+
+        if ((watchpoint->access & access) && (uint16_t)(address - watchpoint->address) < watchpoint->size)
+            return watchpoint;
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 static void setExceptionLocation(PDWriter* writer)
 {
     PDWrite_event_begin(writer,PDEventType_SetExceptionLocation);
-    PDWrite_u16(writer, "address", pc);
+    PDWrite_u16(writer, "address", g_cpu6502->pc);
     PDWrite_u8(writer, "address_size", 2);
+
+    if (g_cpu6502->watchAccess)
+    {
+        uint8_t access = g_cpu6502->watchAccess == Cpu6502Watch_Read ? PDWatchAccess_Read : PDWatchAccess_Write;
+        const Watchpoint6502* watchpoint = findWatchpoint(g_debugger, g_cpu6502->watchAddress, access);
+
+        if (watchpoint)
+            PDWrite_u32(writer, "watch_id", watchpoint->id);
+
+        PDWrite_u64(writer, "watch_address", g_cpu6502->watchAddress);
+        PDWrite_u8(writer, "watch_access", access);
+    }
+
     PDWrite_event_end(writer);
 }
 
@@ -120,6 +172,282 @@ static void sendState(PDWriter* writer)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static void toggleBreakpoint(PDReader* reader, int enable)
+{
+    uint64_t address = 0;
+
+    if (PDRead_find_u64(reader, &address, "address", 0) == PDReadStatus_NotFound)
+        return;
+
+    if (enable)
+        g_breakpoints6502[address & 0xffff] |= Breakpoint6502_Exec;
+    else
+        g_breakpoints6502[address & 0xffff] &= ~Breakpoint6502_Exec;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rebuilds the watchpoint map and the page flags from the watchpoint list. Pages without any watchpoint are left
+// unflagged so accessing them costs nothing extra
+
+static void updateWatchpoints(Debugger6502* debugger)
+{
+    int i;
+
+    memset(g_watchpoints6502, 0, sizeof(g_watchpoints6502));
+    Cpu6502_setPageFlags(g_cpu6502, 0, 0x10000, Cpu6502Page_Watch, 0);
+
+    for (i = 0; i < debugger->watchpointCount; ++i)
+    {
+        const Watchpoint6502* watchpoint = &debugger->watchpoints[i];
+        uint8_t bits = 0;
+        uint32_t j;
+
+        if (watchpoint->access & PDWatchAccess_Read)
+            bits |= Cpu6502Watch_Read;
+
+        if (watchpoint->access & PDWatchAccess_Write)
+            bits |= Cpu6502Watch_Write;
+
+        for (j = 0; j < watchpoint->size; ++j)
+            g_watchpoints6502[(uint16_t)(watchpoint->address + j)] |= bits;
+
+        // Ranges that wrap around the end of memory are flagged in two parts
+
+        Cpu6502_setPageFlags(g_cpu6502, watchpoint->address, watchpoint->size, Cpu6502Page_Watch, 1);
+
+        if ((uint32_t)watchpoint->address + watchpoint->size > 0x10000)
+            Cpu6502_setPageFlags(g_cpu6502, 0, watchpoint->address + watchpoint->size - 0x10000, Cpu6502Page_Watch, 1);
+    }
+
+    g_cpu6502->watchpoints = g_watchpoints6502;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void deleteWatchpoint(Debugger6502* debugger, uint32_t id)
+{
+    int i;
+
+    for (i = 0; i < debugger->watchpointCount; ++i)
+    {
+        if (debugger->watchpoints[i].id == id)
+        {
+            debugger->watchpoints[i] = debugger->watchpoints[--debugger->watchpointCount];
+            break;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setting a watchpoint with an id that is already used replaces it
+
+static void setWatchpoint(Debugger6502* debugger, PDReader* reader, PDWriter* writer)
+{
+    uint32_t id = 0;
+    uint64_t address = 0, size = 1;
+    uint8_t access = PDWatchAccess_Write;
+    uint8_t status = 0;
+
+    PDRead_find_u32(reader, &id, "id", 0);
+    PDRead_find_u64(reader, &address, "address", 0);
+    PDRead_find_u64(reader, &size, "size", 0);
+    PDRead_find_u8(reader, &access, "access", 0);
+
+    deleteWatchpoint(debugger, id);
+
+    if (address < 0x10000 && size > 0 && size <= 0x10000 && (access & PDWatchAccess_ReadWrite) &&
+        debugger->watchpointCount < Watchpoint6502_Max)
+    {
+        Watchpoint6502* watchpoint = &debugger->watchpoints[debugger->watchpointCount++];
+
+        watchpoint->id = id;
+        watchpoint->address = (uint16_t)address;
+        watchpoint->size = (uint32_t)size;
+        watchpoint->access = access & PDWatchAccess_ReadWrite;
+        status = 1;
+    }
+
+    updateWatchpoints(debugger);
+
+    PDWrite_event_begin(writer, PDEventType_ReplyWatchpoint);
+    PDWrite_u32(writer, "id", id);
+    PDWrite_u8(writer, "status", status);
+    PDWrite_event_end(writer);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void removeWatchpoint(Debugger6502* debugger, PDReader* reader)
+{
+    uint32_t id = 0;
+
+    if (PDRead_find_u32(reader, &id, "id", 0) == PDReadStatus_NotFound)
+        return;
+
+    deleteWatchpoint(debugger, id);
+    updateWatchpoints(debugger);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The emulator thread is stopped (we hold the cpu lock) so the trace can be reset here
+
+static void enableTrace(Debugger6502* debugger, PDReader* reader)
+{
+    uint8_t enable = 0;
+
+    PDRead_find_u8(reader, &enable, "enable", 0);
+
+    if (enable)
+        PDTrace_reset(&debugger->trace);
+
+    debugger->traceEnabled = enable;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void getTrace(Debugger6502* debugger, PDReader* reader, PDWriter* writer)
+{
+    uint32_t maxCount = PD_TRACE_MAX_EVENT_RECORDS;
+    uint32_t count;
+
+    PDRead_find_u32(reader, &maxCount, "max_count", 0);
+
+    if (maxCount > PD_TRACE_MAX_EVENT_RECORDS)
+        maxCount = PD_TRACE_MAX_EVENT_RECORDS;
+
+    count = PDTrace_read(&debugger->trace, s_traceRecords, maxCount);
+
+    PDWrite_event_begin(writer, PDEventType_SetTrace);
+    PDWrite_u32(writer, "count", count);
+    PDWrite_u64(writer, "dropped", debugger->trace.dropped);
+    PDWrite_data(writer, "data", s_traceRecords, count * sizeof(PDTraceRecord));
+    PDWrite_event_end(writer);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void enableProfile(Debugger6502* debugger, PDReader* reader)
+{
+    uint8_t enable = 0;
+    uint8_t mode = PDProfileMode_Sample;
+    uint32_t interval = 1000;
+
+    PDRead_find_u8(reader, &enable, "enable", 0);
+    PDRead_find_u8(reader, &mode, "mode", 0);
+    PDRead_find_u32(reader, &interval, "interval", 0);
+
+    if (enable)
+        Profile6502_start(&debugger->profile, g_cpu6502, (PDProfileMode)mode, interval);
+
+    debugger->profileEnabled = enable;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sends what has been counted since the last read and clears it
+
+static void getProfile(Debugger6502* debugger, PDWriter* writer)
+{
+    Profile6502* profile = &debugger->profile;
+    uint32_t entryCount = 0, callCount = 0;
+    int i;
+
+    for (i = 0; i < 65536; ++i)
+    {
+        if (profile->counts[i] == 0)
+            continue;
+
+        s_profileEntries[entryCount].address = (uint64_t)i;
+        s_profileEntries[entryCount].count = profile->counts[i];
+        entryCount++;
+    }
+
+    for (i = 0; i < Profile6502_MaxCalls; ++i)
+    {
+        const ProfileCall6502* call = &profile->calls[i];
+
+        if (!call->used)
+            continue;
+
+        s_profileCalls[callCount].site = call->site;
+        s_profileCalls[callCount].target = call->target;
+        s_profileCalls[callCount].count = call->count;
+        s_profileCalls[callCount].ticks = call->ticks;
+        callCount++;
+    }
+
+    PDWrite_event_begin(writer, PDEventType_SetProfile);
+    PDWrite_u8(writer, "mode", (uint8_t)profile->mode);
+    PDWrite_u64(writer, "ticks", (uint64_t)(g_cpu6502->clockticks - profile->readTicks));
+    PDWrite_data(writer, "samples", s_profileEntries, entryCount * sizeof(PDProfileEntry));
+    PDWrite_data(writer, "calls", s_profileCalls, callCount * sizeof(PDProfileCall));
+    PDWrite_event_end(writer);
+
+    Profile6502_clear(profile, g_cpu6502);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The memory is searched in place as the emulator thread is stopped while we hold the cpu lock
+
+static void searchMemory(PDReader* reader, PDWriter* writer)
+{
+    PDSearch search;
+    void* pattern = 0;
+    void* mask = 0;
+    uint64_t patternSize = 0, maskSize = 0;
+    uint64_t start = 0, end = 0x10000;
+    uint8_t alignment = 1;
+    uint32_t maxMatches = PD_SEARCH_MAX_EVENT_MATCHES;
+    uint32_t count = 0;
+
+    PDRead_find_u64(reader, &start, "start", 0);
+    PDRead_find_u64(reader, &end, "end", 0);
+    PDRead_find_data(reader, &pattern, &patternSize, "pattern", 0);
+    PDRead_find_data(reader, &mask, &maskSize, "mask", 0);
+    PDRead_find_u8(reader, &alignment, "alignment", 0);
+    PDRead_find_u32(reader, &maxMatches, "max_matches", 0);
+
+    if (maxMatches > PD_SEARCH_MAX_EVENT_MATCHES)
+        maxMatches = PD_SEARCH_MAX_EVENT_MATCHES;
+
+    if (end > 0x10000)
+        end = 0x10000;
+
+    // A mask that isn't the same size as the pattern is an invalid search so nothing is found
+
+    if (pattern && start < end && (!mask || maskSize == patternSize) &&
+        PDSearch_init(&search, (const uint8_t*)pattern, (const uint8_t*)mask, (uint32_t)patternSize, alignment))
+    {
+        count = PDSearch_scan(&search, g_cpu6502->memory + start, end - start, start, s_searchMatches, maxMatches + 1);
+    }
+
+    PDWrite_event_begin(writer, PDEventType_SetSearchResult);
+    PDWrite_data(writer, "matches", s_searchMatches, (count > maxMatches ? maxMatches : count) * sizeof(uint64_t));
+    PDWrite_u8(writer, "truncated", count > maxMatches ? 1 : 0);
+    PDWrite_event_end(writer);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The cpu is moved back directly from here (the emulator thread is waiting for the cpu lock) so the state is sent
+// right away
+
+static void stepBack(Debugger6502* debugger, PDWriter* writer, int toBreakpoint)
+{
+    int hit = 0;
+
+    if (toBreakpoint)
+        hit = History6502_continueBack(&debugger->history, g_cpu6502, g_breakpoints6502);
+    else
+        History6502_stepBack(&debugger->history, g_cpu6502);
+
+    debugger->runState = hit ? PDDebugState_StopBreakpoint : PDDebugState_StopException;
+    debugger->sentState = debugger->runState;
+
+    sendState(writer);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 static void doAction(Debugger6502* debugger, PDAction action, PDWriter* writer)
 {
     int t = (int)action;
@@ -132,7 +460,6 @@ static void doAction(Debugger6502* debugger, PDAction action, PDWriter* writer)
 
             printf("Fake6502Debugger: break\n");
             debugger->runState = PDDebugState_StopException;
-            sendState(writer);
             break;
         }
 
@@ -146,10 +473,23 @@ static void doAction(Debugger6502* debugger, PDAction action, PDWriter* writer)
 
         case PDAction_Step :
         {
-            // on this target we can always stepp
+            // on this target we can always stepp. The emulator thread steps and the state is sent when it's done
             printf("Fake6502Debugger: step\n");
             debugger->runState = PDDebugState_Trace;
-            sendState(writer);
+            break;
+        }
+
+        case PDAction_ReverseStep :
+        {
+            printf("Fake6502Debugger: reverse step\n");
+            stepBack(debugger, writer, 0);
+            break;
+        }
+
+        case PDAction_ReverseContinue :
+        {
+            printf("Fake6502Debugger: reverse continue\n");
+            stepBack(debugger, writer, 1);
             break;
         }
     }
@@ -158,26 +498,41 @@ static void doAction(Debugger6502* debugger, PDAction action, PDWriter* writer)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Called on the debugger connection thread with the cpu lock held so the emulator is between instructions here
+
 static PDDebugState update(void* userData, PDAction action, PDReader* reader, PDWriter* writer)
 {
-    //int event = 0;
-
-    (void)reader;
+    int event = 0;
 
     Debugger6502* debugger = (Debugger6502*)userData;
 
     doAction(debugger, action, writer);
 
-	/*
     while ((event = PDRead_get_event(reader)) != 0)
     {
         switch (event)
         {
-            case PDEventType_getDisassembly : getDisassembly(reader, writer); break;
-            case PDEventType_getRegisters : setRegisters(writer); break;
+            case PDEventType_SetBreakpoint : toggleBreakpoint(reader, 1); break;
+            case PDEventType_DeleteBreakpoint : toggleBreakpoint(reader, 0); break;
+            case PDEventType_EnableTrace : enableTrace(debugger, reader); break;
+            case PDEventType_GetTrace : getTrace(debugger, reader, writer); break;
+            case PDEventType_EnableProfile : enableProfile(debugger, reader); break;
+            case PDEventType_GetProfile : getProfile(debugger, writer); break;
+            case PDEventType_SetWatchpoint : setWatchpoint(debugger, reader, writer); break;
+            case PDEventType_DeleteWatchpoint : removeWatchpoint(debugger, reader); break;
+            case PDEventType_SearchMemory : searchMemory(reader, writer); break;
         }
     }
-    */
+
+    // The emulator thread stops by itself on breakpoints and after a step so send the state when that has happened
+
+    if (debugger->runState != debugger->sentState)
+    {
+        if (debugger->runState != PDDebugState_Running && debugger->runState != PDDebugState_Trace)
+            sendState(writer);
+
+        debugger->sentState = debugger->runState;
+    }
 
     return debugger->runState;
 }
@@ -0,0 +1,289 @@
+#include "history6502.h"
+#include "debugger6502.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void History6502_init(History6502* history, int maxCount, uint32_t interval)
+{
+    memset(history, 0, sizeof(History6502));
+
+    history->snapshots = malloc(sizeof(Snapshot6502) * (size_t)maxCount);
+    history->maxCount = maxCount;
+    history->interval = interval;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void History6502_destroy(History6502* history)
+{
+    Page6502* page;
+
+    History6502_clear(history);
+
+    while ((page = history->freePages) != 0)
+    {
+        history->freePages = page->next;
+        free(page);
+    }
+
+    free(history->snapshots);
+    history->snapshots = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static Snapshot6502* getSnapshot(History6502* history, int index)
+{
+    return &history->snapshots[(history->first + index) % history->maxCount];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static Page6502* allocPage(History6502* history)
+{
+    Page6502* page = history->freePages;
+
+    if (page)
+        history->freePages = page->next;
+    else
+        page = malloc(sizeof(Page6502));
+
+    page->refCount = 1;
+    page->next = 0;
+
+    return page;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void releasePages(History6502* history, Snapshot6502* snapshot)
+{
+    int i;
+
+    for (i = 0; i < 256; ++i)
+    {
+        Page6502* page = snapshot->pages[i];
+
+        if (--page->refCount == 0)
+        {
+            page->next = history->freePages;
+            history->freePages = page;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void History6502_clear(History6502* history)
+{
+    while (history->count > 0)
+    {
+        releasePages(history, getSnapshot(history, history->count - 1));
+        history->count--;
+    }
+
+    history->first = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Drops the snapshots taken after the given instruction. They are still correct (the cpu will end up in the same
+// state again when it runs forward) but snapshots have to be in order for the interval check in History6502_update
+
+static void dropNewerThan(History6502* history, uint32_t instructions)
+{
+    while (history->count > 0)
+    {
+        Snapshot6502* snapshot = getSnapshot(history, history->count - 1);
+
+        if ((int32_t)(snapshot->instructions - instructions) <= 0)
+            break;
+
+        releasePages(history, snapshot);
+        history->count--;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void takeSnapshot(History6502* history, const Cpu6502* cpu)
+{
+    Page6502* pages[256];
+    Snapshot6502* prev = history->count > 0 ? getSnapshot(history, history->count - 1) : 0;
+    Snapshot6502* snapshot;
+    int i;
+
+    // Pages that are the same as in the previous snapshot are shared
+
+    for (i = 0; i < 256; ++i)
+    {
+        const uint8_t* data = cpu->memory + (i << 8);
+
+        if (prev && !memcmp(prev->pages[i]->data, data, 256))
+        {
+            pages[i] = prev->pages[i];
+            pages[i]->refCount++;
+        }
+        else
+        {
+            pages[i] = allocPage(history);
+            memcpy(pages[i]->data, data, 256);
+        }
+    }
+
+    if (history->count == history->maxCount)
+    {
+        releasePages(history, getSnapshot(history, 0));
+        history->first = (history->first + 1) % history->maxCount;
+        history->count--;
+    }
+
+    snapshot = getSnapshot(history, history->count++);
+
+    snapshot->pc = cpu->pc;
+    snapshot->sp = cpu->sp;
+    snapshot->a = cpu->a;
+    snapshot->x = cpu->x;
+    snapshot->y = cpu->y;
+    snapshot->status = cpu->status;
+    snapshot->clockticks = cpu->clockticks;
+    snapshot->instructions = cpu->instructions;
+
+    memcpy(snapshot->pages, pages, sizeof(pages));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void restoreSnapshot(const Snapshot6502* snapshot, Cpu6502* cpu)
+{
+    int i;
+
+    for (i = 0; i < 256; ++i)
+        memcpy(cpu->memory + (i << 8), snapshot->pages[i]->data, 256);
+
+    cpu->pc = snapshot->pc;
+    cpu->sp = snapshot->sp;
+    cpu->a = snapshot->a;
+    cpu->x = snapshot->x;
+    cpu->y = snapshot->y;
+    cpu->status = snapshot->status;
+    cpu->clockticks = snapshot->clockticks;
+    cpu->clockgoal = snapshot->clockticks;
+    cpu->instructions = snapshot->instructions;
+    cpu->watchAccess = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void runInstructions(Cpu6502* cpu, uint32_t count)
+{
+    while (count--)
+        Cpu6502_step(cpu);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Restores the closest snapshot at or before the instruction and runs forward to it. Returns 0 if the instruction is
+// before the start of the history
+
+static int moveTo(History6502* history, Cpu6502* cpu, uint32_t instructions)
+{
+    int i;
+
+    for (i = history->count - 1; i >= 0; --i)
+    {
+        const Snapshot6502* snapshot = getSnapshot(history, i);
+
+        if ((int32_t)(instructions - snapshot->instructions) < 0)
+            continue;
+
+        restoreSnapshot(snapshot, cpu);
+        runInstructions(cpu, instructions - snapshot->instructions);
+        dropNewerThan(history, instructions);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void History6502_update(History6502* history, const Cpu6502* cpu)
+{
+    if (history->count > 0)
+    {
+        const Snapshot6502* last = getSnapshot(history, history->count - 1);
+
+        if (cpu->instructions - last->instructions < history->interval)
+            return;
+    }
+
+    takeSnapshot(history, cpu);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int History6502_stepBack(History6502* history, Cpu6502* cpu)
+{
+    return moveTo(history, cpu, cpu->instructions - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Each interval between two snapshots is replayed, newest first, until one of them has a breakpoint in it or an
+// access to a watchpoint. The last hit in that interval is where we stop. Watchpoints stop after the instruction that
+// did the access, the same as when running forward
+
+int History6502_continueBack(History6502* history, Cpu6502* cpu, const uint8_t* breakpoints)
+{
+    uint32_t current = cpu->instructions;
+    int i;
+
+    if (history->count == 0)
+        return 0;
+
+    for (i = history->count - 1; i >= 0; --i)
+    {
+        const Snapshot6502* snapshot = getSnapshot(history, i);
+        uint32_t end = current;
+        uint32_t hit = 0;
+        int found = 0;
+
+        if ((int32_t)(current - snapshot->instructions) <= 0)
+            continue;
+
+        if (i + 1 < history->count)
+        {
+            uint32_t next = getSnapshot(history, i + 1)->instructions;
+
+            if ((int32_t)(current - next) > 0)
+                end = next;
+        }
+
+        restoreSnapshot(snapshot, cpu);
+
+        while (cpu->instructions != end)
+        {
+            if (breakpoints[cpu->pc] & Breakpoint6502_Exec)
+            {
+                hit = cpu->instructions;
+                found = 1;
+            }
+
+            Cpu6502_step(cpu);
+
+            if (cpu->watchAccess && cpu->instructions != current)
+            {
+                hit = cpu->instructions;
+                found = 1;
+            }
+        }
+
+        if (found)
+            return moveTo(history, cpu, hit);
+    }
+
+    moveTo(history, cpu, getSnapshot(history, 0)->instructions);
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#ifndef _HISTORY6502_H_
+#define _HISTORY6502_H_
+
+#include <stdint.h>
+#include "cpu6502.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Execution history used for stepping backwards. The cpu is deterministic (as long as nothing is mapped on the bus)
+// so instead of recording each instruction a snapshot of the registers and memory is taken every interval
+// instructions and any earlier point is reached by restoring the closest snapshot before it and running forward
+// again. A step back therefore never replays more than about interval instructions.
+//
+// Memory is stored as 256 byte pages that are shared between snapshots as long as they are unchanged, so a
+// snapshot only costs a compare of the 64k and a copy of the pages that has been written since the previous one.
+// When all snapshots are used the oldest is dropped.
+//
+// Instruction counts are compared with wrap around so the history can span at most 2^31 instructions.
+
+typedef struct Page6502
+{
+    // Number of snapshots using the page
+    uint32_t refCount;
+    // Next page when on the free list
+    struct Page6502* next;
+    uint8_t data[256];
+
+} Page6502;
+
+typedef struct Snapshot6502
+{
+    uint16_t pc;
+    uint8_t sp, a, x, y, status;
+    uint32_t clockticks;
+    uint32_t instructions;
+
+    Page6502* pages[256];
+
+} Snapshot6502;
+
+typedef struct History6502
+{
+    // Ring of snapshots, oldest first
+    Snapshot6502* snapshots;
+    int maxCount;
+    int first;
+    int count;
+
+    uint32_t interval;
+
+    Page6502* freePages;
+
+} History6502;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void History6502_init(History6502* history, int maxCount, uint32_t interval);
+void History6502_destroy(History6502* history);
+
+// Drops all snapshots. Has to be called if the registers or memory are changed from the outside as the history
+// doesn't match the cpu anymore
+void History6502_clear(History6502* history);
+
+// Takes a snapshot if interval instructions has been executed since the last one (or if there is none)
+void History6502_update(History6502* history, const Cpu6502* cpu);
+
+// Moves the cpu back one instruction. Returns 0 if the cpu is at the start of the history
+int History6502_stepBack(History6502* history, Cpu6502* cpu);
+
+// Moves the cpu back to the last executed instruction that has Breakpoint6502_Exec set in breakpoints or to right
+// after the last access to a watchpoint. Returns 1 if stopped on either and 0 if there was none so the cpu was moved
+// to the start of the history
+int History6502_continueBack(History6502* history, Cpu6502* cpu, const uint8_t* breakpoints);
+
+#endif
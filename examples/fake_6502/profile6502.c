@@ -0,0 +1,203 @@
+#include "profile6502.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum
+{
+    Opcode6502_Jsr = 0x20,
+    Opcode6502_Rts = 0x60,
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profile6502_init(Profile6502* profile)
+{
+    memset(profile, 0, sizeof(Profile6502));
+
+    profile->counts = malloc(sizeof(uint64_t) * 65536);
+    profile->calls = malloc(sizeof(ProfileCall6502) * Profile6502_MaxCalls);
+    profile->random = 0x6502;
+
+    memset(profile->counts, 0, sizeof(uint64_t) * 65536);
+    memset(profile->calls, 0, sizeof(ProfileCall6502) * Profile6502_MaxCalls);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profile6502_destroy(Profile6502* profile)
+{
+    free(profile->counts);
+    free(profile->calls);
+    profile->counts = 0;
+    profile->calls = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Clock ticks to the next sample. Evenly spread between 3/4 and 5/4 of the interval (xorshift)
+
+static uint32_t nextInterval(Profile6502* profile)
+{
+    uint32_t r = profile->random;
+
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    profile->random = r;
+
+    return profile->interval - profile->interval / 4 + r % (profile->interval / 2 + 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profile6502_start(Profile6502* profile, const Cpu6502* cpu, PDProfileMode mode, uint32_t interval)
+{
+    profile->mode = mode;
+    profile->interval = interval > 0 ? interval : 1;
+    profile->nextSample = cpu->clockgoal + nextInterval(profile);
+    profile->depth = 0;
+
+    Profile6502_clear(profile, cpu);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profile6502_clear(Profile6502* profile, const Cpu6502* cpu)
+{
+    memset(profile->counts, 0, sizeof(uint64_t) * 65536);
+
+    if (profile->callCount > 0)
+        memset(profile->calls, 0, sizeof(ProfileCall6502) * Profile6502_MaxCalls);
+
+    profile->callCount = 0;
+    profile->readTicks = cpu->clockticks;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns 0 if the table is full. It's kept at most 3/4 full so the probing stays short
+
+static ProfileCall6502* findCall(Profile6502* profile, uint16_t site, uint16_t target)
+{
+    uint32_t key = ((uint32_t)site << 16) | target;
+    uint32_t index = (key * 2654435761u) >> 20;
+
+    for (;;)
+    {
+        ProfileCall6502* call = &profile->calls[index];
+
+        if (!call->used)
+            break;
+
+        if (call->site == site && call->target == target)
+            return call;
+
+        index = (index + 1) & (Profile6502_MaxCalls - 1);
+    }
+
+    if (profile->callCount >= Profile6502_MaxCalls * 3 / 4)
+        return 0;
+
+    profile->callCount++;
+
+    profile->calls[index].site = site;
+    profile->calls[index].target = target;
+    profile->calls[index].used = 1;
+
+    return &profile->calls[index];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The return address pushed by JSR is the address of its last byte
+
+static void sample(Profile6502* profile, const Cpu6502* cpu)
+{
+    const uint8_t* memory = cpu->memory;
+    uint16_t ret = (uint16_t)(memory[0x100 + (uint8_t)(cpu->sp + 1)] | (memory[0x100 + (uint8_t)(cpu->sp + 2)] << 8));
+    uint16_t site = (uint16_t)(ret - 2);
+
+    profile->counts[cpu->pc]++;
+
+    if (memory[site] == Opcode6502_Jsr)
+    {
+        uint16_t target = (uint16_t)(memory[(uint16_t)(site + 1)] | (memory[(uint16_t)(site + 2)] << 8));
+        ProfileCall6502* call = findCall(profile, site, target);
+
+        if (call)
+            call->count++;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int Profile6502_execSampled(Profile6502* profile, Cpu6502* cpu, uint32_t tickcount, const uint8_t* breakpoints)
+{
+    uint32_t goal = cpu->clockgoal + tickcount;
+
+    while (cpu->clockgoal != goal)
+    {
+        uint32_t chunk = goal - cpu->clockgoal;
+        uint32_t untilSample = profile->nextSample - cpu->clockgoal;
+
+        if ((int32_t)untilSample <= 0)
+        {
+            sample(profile, cpu);
+            profile->nextSample = cpu->clockgoal + nextInterval(profile);
+            continue;
+        }
+
+        if (chunk > untilSample)
+            chunk = untilSample;
+
+        if (Cpu6502_exec(cpu, chunk, breakpoints))
+            return 1;
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void popFrame(Profile6502* profile, const Cpu6502* cpu)
+{
+    const ProfileFrame6502* frame = &profile->stack[--profile->depth];
+    ProfileCall6502* call = findCall(profile, frame->site, frame->target);
+
+    if (call)
+        call->ticks += cpu->clockticks - frame->startTicks;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profile6502_countStep(Profile6502* profile, const Cpu6502* cpu, uint16_t pc, uint8_t sp, uint32_t clockticks)
+{
+    uint8_t opcode = cpu->memory[pc];
+
+    profile->counts[pc] += cpu->clockticks - clockticks;
+
+    if (opcode == Opcode6502_Jsr)
+    {
+        ProfileCall6502* call = findCall(profile, pc, cpu->pc);
+
+        if (call)
+            call->count++;
+
+        if (profile->depth < Profile6502_MaxDepth)
+        {
+            ProfileFrame6502* frame = &profile->stack[profile->depth++];
+
+            frame->site = pc;
+            frame->target = cpu->pc;
+            frame->sp = cpu->sp;
+            frame->startTicks = clockticks;
+        }
+    }
+    else if (opcode == Opcode6502_Rts)
+    {
+        // Frames deeper down the stack than the one returning never returned so they end here as well
+
+        while (profile->depth > 0 && profile->stack[profile->depth - 1].sp < sp)
+            popFrame(profile, cpu);
+
+        if (profile->depth > 0 && profile->stack[profile->depth - 1].sp == sp)
+            popFrame(profile, cpu);
+    }
+}
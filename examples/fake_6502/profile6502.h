@@ -0,0 +1,91 @@
+#ifndef _PROFILE6502_H_
+#define _PROFILE6502_H_
+
+#include <stdint.h>
+#include <pd_profile.h>
+#include "cpu6502.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Profiler for the cpu the debugger is attached to. There are two modes (see PDProfileMode):
+//
+// Sample runs the cpu at full speed in chunks of about interval clock ticks and counts the pc between them. The
+// return address at the top of the stack is checked against the JSR before it so each sample is also counted for
+// the call it was taken in. The chunks are jittered so loops that happen to take the same number of ticks as the
+// interval don't always get sampled at the same instruction.
+//
+// Exact steps the cpu one instruction at a time and counts the clock ticks of each instruction. JSR and RTS are
+// tracked on a shadow stack to get the number of calls and the clock ticks spent in each of them (including the
+// calls they make). Frames are matched on the stack pointer so code that drops its return address or returns with
+// something else than RTS doesn't throw the rest of the stack off.
+//
+// Counts are kept until they are read with Profile6502_clear so only what happened since the last read is sent.
+
+enum
+{
+    // Max number of distinct (call site, target) pairs kept between two reads
+    Profile6502_MaxCalls = 4096,
+    Profile6502_MaxDepth = 256,
+};
+
+typedef struct ProfileCall6502
+{
+    uint16_t site;
+    uint16_t target;
+    uint32_t used;
+    uint64_t count;
+    uint64_t ticks;
+
+} ProfileCall6502;
+
+typedef struct ProfileFrame6502
+{
+    uint16_t site;
+    uint16_t target;
+    // Stack pointer after the return address was pushed
+    uint8_t sp;
+    uint32_t startTicks;
+
+} ProfileFrame6502;
+
+typedef struct Profile6502
+{
+    PDProfileMode mode;
+    uint32_t interval;
+
+    // Clock ticks (cpu->clockgoal) of the next sample
+    uint32_t nextSample;
+    uint32_t random;
+
+    // Clock ticks (cpu->clockticks) at the last read
+    uint32_t readTicks;
+
+    // Samples or clock ticks for each address
+    uint64_t* counts;
+
+    // Open addressing hash of the calls
+    ProfileCall6502* calls;
+    int callCount;
+
+    ProfileFrame6502 stack[Profile6502_MaxDepth];
+    int depth;
+
+} Profile6502;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profile6502_init(Profile6502* profile);
+void Profile6502_destroy(Profile6502* profile);
+
+// Throws away all counts and the shadow stack and starts over in the given mode
+void Profile6502_start(Profile6502* profile, const Cpu6502* cpu, PDProfileMode mode, uint32_t interval);
+
+// Throws away the counts after they have been read
+void Profile6502_clear(Profile6502* profile, const Cpu6502* cpu);
+
+// Same as Cpu6502_exec but samples the cpu every interval clock ticks (sample mode)
+int Profile6502_execSampled(Profile6502* profile, Cpu6502* cpu, uint32_t tickcount, const uint8_t* breakpoints);
+
+// Counts an instruction that has just been executed (exact mode). pc, sp and clockticks are from before it ran
+void Profile6502_countStep(Profile6502* profile, const Cpu6502* cpu, uint16_t pc, uint8_t sp, uint32_t clockticks);
+
+#endif
@@ -0,0 +1,618 @@
+use std::env;
+use std::fs::{self, File};
+use std::io::{self, Read, Write};
+use std::path::PathBuf;
+use std::sync::mpsc::{channel, Receiver, TryRecvError};
+use std::thread;
+use std::collections::HashMap;
+use std::cmp::Ordering;
+use prodbg_api::Capstone;
+use amiga_hunk_parser::{HunkType, MappedHunkFile};
+use parallel_disasm;
+
+macro_rules! try_opt {
+    ($e:expr) => (match $e { Some(v) => v, None => return None })
+}
+
+// 'PDCA' ProDBG Code Analysis
+const CACHE_MAGIC: u32 = 0x50444341;
+// Bump this if the layout of the cache file (or the analysis itself) changes
+const CACHE_VERSION: u32 = 1;
+
+#[derive(Clone, Copy, PartialEq, Debug)]
+pub enum BranchKind {
+    Jump = 0,
+    CondJump = 1,
+    Call = 2,
+    Return = 3,
+}
+
+/// Location in the executable given as hunk + offset so it's independent of where it has been loaded
+#[derive(Clone, Copy, PartialEq, Debug)]
+pub struct CodeRef {
+    pub hunk: u32,
+    pub offset: u32,
+}
+
+#[derive(Clone, Debug)]
+pub struct Branch {
+    pub offset: u32,
+    pub size: u16,
+    pub kind: BranchKind,
+    /// Target of the branch if it could be resolved (not set for indirect jumps, returns, etc)
+    pub target: Option<CodeRef>,
+}
+
+#[derive(Clone, Debug)]
+pub struct BasicBlock {
+    pub start: u32,
+    pub end: u32,
+}
+
+/// Analysis for one code hunk. All arrays are sorted on offset.
+#[derive(Clone, Debug)]
+pub struct HunkAnalysis {
+    pub blocks: Vec<BasicBlock>,
+    pub branches: Vec<Branch>,
+    pub functions: Vec<u32>,
+}
+
+#[derive(Clone, Copy, Debug)]
+pub struct CallEdge {
+    /// Function the call is made from
+    pub caller: CodeRef,
+    pub callee: CodeRef,
+}
+
+///
+/// Basic blocks, branches and call graph for a whole executable. Hunks are filled in as the analysis
+/// of them completes so any of them may be missing while the background analysis is running.
+///
+pub struct CodeAnalysis {
+    pub hunks: Vec<Option<HunkAnalysis>>,
+    /// Sorted on callee and then caller
+    pub calls: Vec<CallEdge>,
+}
+
+impl CodeAnalysis {
+    pub fn new() -> CodeAnalysis {
+        CodeAnalysis {
+            hunks: Vec::new(),
+            calls: Vec::new(),
+        }
+    }
+
+    fn get_hunk(&self, hunk: u32) -> Option<&HunkAnalysis> {
+        match self.hunks.get(hunk as usize) {
+            Some(&Some(ref analysis)) => Some(analysis),
+            _ => None,
+        }
+    }
+
+    pub fn branch_at(&self, hunk: u32, offset: u32) -> Option<&Branch> {
+        self.get_hunk(hunk).and_then(|h| {
+            h.branches.binary_search_by(|b| b.offset.cmp(&offset)).ok().map(|index| &h.branches[index])
+        })
+    }
+
+    pub fn is_block_start(&self, hunk: u32, offset: u32) -> bool {
+        self.get_hunk(hunk).map_or(false, |h| h.blocks.binary_search_by(|b| b.start.cmp(&offset)).is_ok())
+    }
+
+    /// Returns the start of the function that offset is in
+    pub fn function_at(&self, hunk: u32, offset: u32) -> Option<u32> {
+        self.get_hunk(hunk).and_then(|h| {
+            match h.functions.binary_search(&offset) {
+                Ok(index) => Some(h.functions[index]),
+                Err(0) => None,
+                Err(index) => Some(h.functions[index - 1]),
+            }
+        })
+    }
+
+    pub fn is_function_start(&self, hunk: u32, offset: u32) -> bool {
+        self.get_hunk(hunk).map_or(false, |h| h.functions.binary_search(&offset).is_ok())
+    }
+
+    /// Calls to function (one per call site)
+    pub fn callers(&self, function: CodeRef) -> &[CallEdge] {
+        let key = (function.hunk, function.offset);
+        // Never equal so the search ends up at the first call to the function
+        let start = self.calls
+            .binary_search_by(|c| (c.callee.hunk, c.callee.offset).cmp(&key).then(Ordering::Greater))
+            .unwrap_err();
+        let count = self.calls[start..].iter().take_while(|c| c.callee == function).count();
+
+        &self.calls[start..start + count]
+    }
+
+    pub fn insert_hunk(&mut self, index: usize, analysis: HunkAnalysis) {
+        if self.hunks.len() <= index {
+            let count = index + 1 - self.hunks.len();
+            self.hunks.extend((0..count).map(|_| None));
+        }
+
+        self.hunks[index] = Some(analysis);
+        self.update_calls();
+    }
+
+    // Calls between hunks are only known when both ends have been analysed so the call targets are added
+    // as function entries and the call graph is rebuilt each time a new hunk arrives.
+
+    fn update_calls(&mut self) {
+        let mut targets = Vec::new();
+
+        for (hunk_index, hunk) in self.hunks.iter().enumerate() {
+            if let Some(ref hunk) = *hunk {
+                for branch in hunk.branches.iter().filter(|b| b.kind == BranchKind::Call) {
+                    if let Some(target) = branch.target {
+                        let site = CodeRef {
+                            hunk: hunk_index as u32,
+                            offset: branch.offset,
+                        };
+                        targets.push((site, target));
+                    }
+                }
+            }
+        }
+
+        for &(_, target) in &targets {
+            if let Some(&mut Some(ref mut hunk)) = self.hunks.get_mut(target.hunk as usize) {
+                if let Err(index) = hunk.functions.binary_search(&target.offset) {
+                    hunk.functions.insert(index, target.offset);
+                }
+            }
+        }
+
+        self.calls.clear();
+
+        for &(site, callee) in &targets {
+            if let Some(caller) = self.function_at(site.hunk, site.offset) {
+                self.calls.push(CallEdge {
+                    caller: CodeRef {
+                        hunk: site.hunk,
+                        offset: caller,
+                    },
+                    callee: callee,
+                });
+            }
+        }
+
+        self.calls.sort_by_key(|c| (c.callee.hunk, c.callee.offset, c.caller.hunk, c.caller.offset));
+    }
+}
+
+///
+/// Classifies the instruction from its mnemonic (size suffix such as .s/.w is ignored)
+///
+fn branch_kind(mnemonic: &str) -> Option<BranchKind> {
+    let name = mnemonic.split('.').next().unwrap_or("");
+
+    match name {
+        "rts" | "rte" | "rtr" | "rtd" => Some(BranchKind::Return),
+        "bra" | "jmp" => Some(BranchKind::Jump),
+        "bsr" | "jsr" => Some(BranchKind::Call),
+        "bhs" | "blo" | "bhi" | "bls" | "bcc" | "bcs" | "bne" | "beq" | "bvc" | "bvs" | "bpl" | "bmi" | "bge" |
+        "blt" | "bgt" | "ble" => Some(BranchKind::CondJump),
+        _ if name.starts_with("db") => Some(BranchKind::CondJump),
+        _ => None,
+    }
+}
+
+fn parse_hex(text: &str) -> Option<u32> {
+    u32::from_str_radix(text, 16).ok()
+}
+
+///
+/// Resolves the target of a branch from the operand text as printed by Capstone. The hunk is
+/// disassembled at address 0 so targets are given as offsets into the hunk. Absolute addresses are
+/// only resolved if there is a relocation for them (which also tells which hunk they point into)
+///
+fn branch_target(hunk_index: u32,
+                 offset: u32,
+                 operands: &str,
+                 relocs: &HashMap<u32, u32>)
+                 -> Option<CodeRef> {
+    // Bcc/DBcc have the target last as #$target
+    let last = operands.rsplit(',').next().unwrap_or("").trim();
+
+    if last.starts_with("#$") {
+        return parse_hex(&last[2..]).map(|target| {
+            CodeRef {
+                hunk: hunk_index,
+                offset: target,
+            }
+        });
+    }
+
+    let operands = operands.trim();
+
+    if !operands.starts_with("$") {
+        return None;
+    }
+
+    if operands.ends_with("(pc)") {
+        let disp = match parse_hex(&operands[1..operands.len() - 4]) {
+            Some(disp) => disp,
+            None => return None,
+        };
+
+        return Some(CodeRef {
+            hunk: hunk_index,
+            offset: (offset + 2).wrapping_add(disp as i16 as i32 as u32),
+        });
+    }
+
+    if operands.ends_with(".l") {
+        if let Some(&target_hunk) = relocs.get(&(offset + 2)) {
+            return parse_hex(&operands[1..operands.len() - 2]).map(|target| {
+                CodeRef {
+                    hunk: target_hunk,
+                    offset: target,
+                }
+            });
+        }
+    }
+
+    None
+}
+
+fn analyse_hunk(capstone: &Capstone, file: &MappedHunkFile, hunk_index: usize, worker_count: usize) -> Option<HunkAnalysis> {
+    if file.hunks()[hunk_index].hunk_type != HunkType::Code {
+        return None;
+    }
+
+    let code = match file.code_data(hunk_index) {
+        Some(code) => code.to_vec(),
+        None => return None,
+    };
+
+    let code_len = code.len() as u32;
+    let lines = parallel_disasm::disassemble_hunk(capstone, file, hunk_index, code, 0, worker_count);
+
+    let mut relocs = HashMap::new();
+
+    for reloc in file.relocs(hunk_index) {
+        for offset in reloc.offsets {
+            relocs.insert(offset, reloc.target as u32);
+        }
+    }
+
+    let mut branches = Vec::new();
+    let mut leaders = vec![0u32];
+    let mut functions = vec![0u32];
+
+    for symbol in file.symbols(hunk_index) {
+        leaders.push(symbol.offset);
+        functions.push(symbol.offset);
+    }
+
+    for line in &lines {
+        let mut parts = line.text.splitn(2, ' ');
+        let mnemonic = parts.next().unwrap_or("");
+        let operands = parts.next().unwrap_or("");
+
+        let kind = match branch_kind(mnemonic) {
+            Some(kind) => kind,
+            None => continue,
+        };
+
+        let offset = line.address;
+        let target = branch_target(hunk_index as u32, offset, operands, &relocs);
+
+        if let Some(target) = target {
+            if target.hunk == hunk_index as u32 && kind != BranchKind::Call {
+                leaders.push(target.offset);
+            }
+        }
+
+        // Calls return to the next instruction but it still starts a new block so step over/call graph
+        // lookups line up with block boundaries
+        leaders.push(offset + line.size as u32);
+
+        branches.push(Branch {
+            offset: offset,
+            size: line.size,
+            kind: kind,
+            target: target,
+        });
+    }
+
+    leaders.retain(|&o| o < code_len);
+    leaders.sort();
+    leaders.dedup();
+
+    functions.retain(|&o| o < code_len);
+    functions.sort();
+    functions.dedup();
+
+    let mut blocks = Vec::with_capacity(leaders.len());
+
+    for (i, &start) in leaders.iter().enumerate() {
+        let end = leaders.get(i + 1).map_or(code_len, |e| *e);
+        blocks.push(BasicBlock {
+            start: start,
+            end: end,
+        });
+    }
+
+    Some(HunkAnalysis {
+        blocks: blocks,
+        branches: branches,
+        functions: functions,
+    })
+}
+
+fn hash_data(data: &[u8]) -> u64 {
+    // FNV-1a
+    let mut hash = 0xcbf29ce484222325u64;
+
+    for b in data {
+        hash ^= *b as u64;
+        hash = hash.wrapping_mul(0x100000001b3);
+    }
+
+    hash
+}
+
+fn cache_path(hash: u64) -> PathBuf {
+    env::temp_dir().join("prodbg").join(format!("analysis_{:016x}.bin", hash))
+}
+
+fn write_u32(out: &mut Vec<u8>, v: u32) {
+    out.push((v >> 24) as u8);
+    out.push((v >> 16) as u8);
+    out.push((v >> 8) as u8);
+    out.push(v as u8);
+}
+
+struct CacheReader<'a> {
+    data: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> CacheReader<'a> {
+    fn read_u32(&mut self) -> Option<u32> {
+        if self.pos + 4 > self.data.len() {
+            return None;
+        }
+
+        let d = &self.data[self.pos..];
+        self.pos += 4;
+
+        Some(((d[0] as u32) << 24) | ((d[1] as u32) << 16) | ((d[2] as u32) << 8) | (d[3] as u32))
+    }
+}
+
+fn save_cache(hash: u64, hunks: &[Option<HunkAnalysis>]) -> io::Result<()> {
+    let mut out = Vec::new();
+
+    write_u32(&mut out, CACHE_MAGIC);
+    write_u32(&mut out, CACHE_VERSION);
+    write_u32(&mut out, hunks.len() as u32);
+
+    for hunk in hunks {
+        let hunk = match *hunk {
+            Some(ref hunk) => hunk,
+            None => {
+                write_u32(&mut out, 0);
+                continue;
+            }
+        };
+
+        write_u32(&mut out, 1);
+
+        write_u32(&mut out, hunk.blocks.len() as u32);
+        for block in &hunk.blocks {
+            write_u32(&mut out, block.start);
+            write_u32(&mut out, block.end);
+        }
+
+        write_u32(&mut out, hunk.branches.len() as u32);
+        for branch in &hunk.branches {
+            write_u32(&mut out, branch.offset);
+            write_u32(&mut out, ((branch.kind as u32) << 16) | branch.size as u32);
+
+            match branch.target {
+                Some(target) => {
+                    write_u32(&mut out, target.hunk);
+                    write_u32(&mut out, target.offset);
+                }
+                None => {
+                    write_u32(&mut out, !0);
+                    write_u32(&mut out, 0);
+                }
+            }
+        }
+
+        write_u32(&mut out, hunk.functions.len() as u32);
+        for function in &hunk.functions {
+            write_u32(&mut out, *function);
+        }
+    }
+
+    let path = cache_path(hash);
+
+    if let Some(dir) = path.parent() {
+        try!(fs::create_dir_all(dir));
+    }
+
+    let mut file = try!(File::create(&path));
+    file.write_all(&out)
+}
+
+fn load_cache(hash: u64) -> Option<Vec<Option<HunkAnalysis>>> {
+    let mut data = Vec::new();
+
+    match File::open(cache_path(hash)) {
+        Ok(mut file) => {
+            if file.read_to_end(&mut data).is_err() {
+                return None;
+            }
+        }
+        Err(_) => return None,
+    }
+
+    let mut reader = CacheReader {
+        data: &data,
+        pos: 0,
+    };
+
+    if reader.read_u32() != Some(CACHE_MAGIC) || reader.read_u32() != Some(CACHE_VERSION) {
+        return None;
+    }
+
+    let hunk_count = match reader.read_u32() {
+        Some(count) => count,
+        None => return None,
+    };
+
+    let mut hunks = Vec::new();
+
+    for _ in 0..hunk_count {
+        if reader.read_u32() != Some(1) {
+            hunks.push(None);
+            continue;
+        }
+
+        let mut blocks = Vec::new();
+        let block_count = try_opt!(reader.read_u32());
+
+        for _ in 0..block_count {
+            let start = try_opt!(reader.read_u32());
+            let end = try_opt!(reader.read_u32());
+
+            blocks.push(BasicBlock {
+                start: start,
+                end: end,
+            });
+        }
+
+        let mut branches = Vec::new();
+        let branch_count = try_opt!(reader.read_u32());
+
+        for _ in 0..branch_count {
+            let offset = try_opt!(reader.read_u32());
+            let kind_size = try_opt!(reader.read_u32());
+            let target_hunk = try_opt!(reader.read_u32());
+            let target_offset = try_opt!(reader.read_u32());
+
+            let kind = match kind_size >> 16 {
+                0 => BranchKind::Jump,
+                1 => BranchKind::CondJump,
+                2 => BranchKind::Call,
+                3 => BranchKind::Return,
+                _ => return None,
+            };
+
+            branches.push(Branch {
+                offset: offset,
+                size: kind_size as u16,
+                kind: kind,
+                target: if target_hunk == !0 {
+                    None
+                } else {
+                    Some(CodeRef {
+                        hunk: target_hunk,
+                        offset: target_offset,
+                    })
+                },
+            });
+        }
+
+        let mut functions = Vec::new();
+        let function_count = try_opt!(reader.read_u32());
+
+        for _ in 0..function_count {
+            functions.push(try_opt!(reader.read_u32()));
+        }
+
+        hunks.push(Some(HunkAnalysis {
+            blocks: blocks,
+            branches: branches,
+            functions: functions,
+        }));
+    }
+
+    Some(hunks)
+}
+
+pub enum AnalysisEvent {
+    Hunk(usize, HunkAnalysis),
+    Done,
+}
+
+///
+/// Runs the analysis of an executable on a background thread. Results for each hunk are sent back
+/// as soon as they are done and are picked up with poll(). If the same file (by content hash) has
+/// been analysed before the result is loaded from the cache instead.
+///
+pub struct AnalysisJob {
+    rx: Receiver<AnalysisEvent>,
+}
+
+impl AnalysisJob {
+    pub fn start(capstone: Capstone, path: PathBuf, worker_count: usize) -> AnalysisJob {
+        let (tx, rx) = channel();
+
+        thread::spawn(move || {
+            let file = match MappedHunkFile::open(&path) {
+                Ok(file) => file,
+                Err(e) => {
+                    println!("Code analysis: Unable to open {:?} {:?}", path, e);
+                    let _ = tx.send(AnalysisEvent::Done);
+                    return;
+                }
+            };
+
+            let hash = hash_data(file.data());
+
+            if let Some(cached) = load_cache(hash) {
+                for (index, hunk) in cached.into_iter().enumerate() {
+                    if let Some(hunk) = hunk {
+                        let _ = tx.send(AnalysisEvent::Hunk(index, hunk));
+                    }
+                }
+
+                let _ = tx.send(AnalysisEvent::Done);
+                return;
+            }
+
+            let hunk_count = file.hunks().len();
+            let mut results = Vec::with_capacity(hunk_count);
+
+            for index in 0..hunk_count {
+                let analysis = analyse_hunk(&capstone, &file, index, worker_count);
+
+                if let Some(ref analysis) = analysis {
+                    if tx.send(AnalysisEvent::Hunk(index, analysis.clone())).is_err() {
+                        // Nobody is interested in the result anymore
+                        return;
+                    }
+                }
+
+                results.push(analysis);
+            }
+
+            if let Err(e) = save_cache(hash, &results) {
+                println!("Code analysis: Unable to write cache {:?}", e);
+            }
+
+            let _ = tx.send(AnalysisEvent::Done);
+        });
+
+        AnalysisJob { rx: rx }
+    }
+
+    /// Moves the results that are ready into analysis. Returns true when the job has finished
+    pub fn poll(&self, analysis: &mut CodeAnalysis) -> bool {
+        loop {
+            match self.rx.try_recv() {
+                Ok(AnalysisEvent::Hunk(index, hunk)) => analysis.insert_hunk(index, hunk),
+                Ok(AnalysisEvent::Done) => return true,
+                Err(TryRecvError::Empty) => return false,
+                Err(TryRecvError::Disconnected) => return true,
+            }
+        }
+    }
+}
@@ -1,91 +1,152 @@
-use std::path::Path;
-use amiga_hunk_parser::{Hunk, HunkParser, SourceLine};
+use std::collections::HashMap;
+use std::path::{Path, PathBuf};
+use amiga_hunk_parser::MappedHunkFile;
+
+// Line entry in the per hunk table that is sorted on offset
+
+struct LineEntry {
+    offset: u32,
+    line: u32,
+    file: u32,
+}
+
+struct SourceFileInfo {
+    name: String,
+    // Last offset that has a line in this file (per hunk)
+    end_offsets: HashMap<u32, u32>,
+    // line -> (hunk, offset) of the first code generated for the line
+    lines: HashMap<u32, (u32, u32)>,
+}
 
 pub struct DebugInfo {
-    pub hunks: Vec<Hunk>,
+    pub file: Option<MappedHunkFile>,
+    hunk_lines: Vec<Vec<LineEntry>>,
+    source_files: Vec<SourceFileInfo>,
+    source_file_lookup: HashMap<String, u32>,
 }
 
 impl DebugInfo {
     pub fn new() -> DebugInfo {
         DebugInfo {
-            hunks: Vec::new(),
+            file: None,
+            hunk_lines: Vec::new(),
+            source_files: Vec::new(),
+            source_file_lookup: HashMap::new(),
         }
     }
 
-    pub fn load_info(&mut self, uae_path: &str, amiga_exe: &str) {
+    // Path to the executable on the host given the path as seen from inside UAE
+
+    pub fn exe_path(uae_path: &str, amiga_exe: &str) -> PathBuf {
         // TODO: Not assume dhx: path
-        let path = Path::new(uae_path).join(&amiga_exe[4..]);
-        println!("Trying debug data from {:?}", path);
-        if let Ok(hunks) = HunkParser::parse_file(path.to_str().unwrap()) {
-            println!("Loading ok!");
-            self.hunks = hunks;
-        }
+        Path::new(uae_path).join(&amiga_exe[4..])
     }
 
-    fn try_find_line(filename: &str,
-                     lines: &Vec<SourceLine>,
-                     offset: u32) -> Option<(String, u32)> {
-        let mut source_line = 0u32;
-        let mut was_over = false;
-
-        for line in lines {
-            if line.offset == offset {
-                //println!("Matching source {} line {}", filename, line.line);
-                return Some((filename.to_owned(), line.line));
-            } if line.offset <= offset {
-                source_line = line.line;
-            } else if line.offset > offset {
-                was_over = true;
+    pub fn load_info(&mut self, uae_path: &str, amiga_exe: &str) {
+        let path = Self::exe_path(uae_path, amiga_exe);
+        println!("Trying debug data from {:?}", path);
+        // The file is kept for the whole session so it's read rather than mapped
+        match MappedHunkFile::read(&path) {
+            Ok(file) => {
+                println!("Loading ok!");
+                self.build_line_tables(&file);
+                self.file = Some(file);
             }
-        }
-
-        if was_over {
-            //println!("Partial Matching source {} line {}", filename, source_line);
-            Some((filename.to_owned(), source_line))
-        } else {
-            None
+            Err(e) => println!("Unable to load {:?} {:?}", path, e),
         }
     }
 
-    pub fn resolve_file_line(&self, offset: u32, seg_id: u32) -> Option<(String, u32)> {
-        if seg_id >= self.hunks.len() as u32 {
-            return None;
-        }
+    //
+    // Builds the lookup tables used for address <-> line. This is done once when loading so
+    // resolve_file_line (called on each pc change) and get_address_seg doesn't need to scan the line info
+    //
+    fn build_line_tables(&mut self, file: &MappedHunkFile) {
+        self.hunk_lines.clear();
+        self.source_files.clear();
+        self.source_file_lookup.clear();
 
-        let hunk = &self.hunks[seg_id as usize];
+        for hunk in 0..file.hunks().len() {
+            let mut entries = Vec::new();
+
+            for src_file in file.source_files(hunk) {
+                let file_index = match self.source_file_lookup.get(&*src_file.name) {
+                    Some(index) => *index,
+                    None => {
+                        let index = self.source_files.len() as u32;
+                        self.source_files.push(SourceFileInfo {
+                            name: src_file.name.clone().into_owned(),
+                            end_offsets: HashMap::new(),
+                            lines: HashMap::new(),
+                        });
+                        self.source_file_lookup.insert(src_file.name.clone().into_owned(), index);
+                        index
+                    }
+                };
 
-        if let Some(ref source_files) = hunk.line_debug_info {
-            for src_file in source_files {
-                //if offset > src_file.base_offset {
-                //    continue;
-                //}
+                let info = &mut self.source_files[file_index as usize];
+                entries.reserve(src_file.line_count());
 
-                if let Some(data) = Self::try_find_line(&src_file.name, &src_file.lines, offset) {
-                    return Some(data);
+                for line in src_file.lines() {
+                    // Keep the first location of a line to match the order the lines were searched before
+                    info.lines.entry(line.line).or_insert((hunk as u32, line.offset));
+
+                    let end = info.end_offsets.entry(hunk as u32).or_insert(line.offset);
+                    if line.offset > *end {
+                        *end = line.offset;
+                    }
+
+                    entries.push(LineEntry {
+                        offset: line.offset,
+                        line: line.line,
+                        file: file_index,
+                    });
                 }
             }
-        }
 
-        None
+            // Stable sort so lines with the same offset stays in file order
+            entries.sort_by(|a, b| a.offset.cmp(&b.offset));
+
+            self.hunk_lines.push(entries);
+        }
     }
 
-    pub fn get_address_seg(&self, filename: &str, file_line: u32) -> Option<(u32, u32)> {
-        for (i, hunk) in self.hunks.iter().enumerate() {
-            if let Some(ref source_files) = hunk.line_debug_info {
-                for src_file in source_files {
-                    if src_file.name != filename {
-                        continue;
-                    }
+    pub fn resolve_file_line(&self, offset: u32, seg_id: u32) -> Option<(String, u32)> {
+        let entries = match self.hunk_lines.get(seg_id as usize) {
+            Some(entries) => entries,
+            None => return None,
+        };
 
-                    for line in &src_file.lines {
-                        if line.line == file_line {
-                            return Some((i as u32, line.offset));
-                        }
-                    }
+        // Find the last line that starts at or before offset
+        let index = match entries.binary_search_by(|e| e.offset.cmp(&offset)) {
+            Ok(mut index) => {
+                // Several lines can map to the same offset, pick the first one
+                while index > 0 && entries[index - 1].offset == offset {
+                    index -= 1;
                 }
+                index
+            }
+            Err(0) => return None,
+            Err(index) => index - 1,
+        };
+
+        let entry = &entries[index];
+        let src_file = &self.source_files[entry.file as usize];
+
+        // If there is no exact match the offset has to be inside the range of the file
+        if entry.offset != offset {
+            match src_file.end_offsets.get(&seg_id) {
+                Some(end) if offset < *end => (),
+                _ => return None,
             }
         }
 
-        None
+        Some((src_file.name.clone(), entry.line))
+    }
+
+    pub fn get_address_seg(&self, filename: &str, file_line: u32) -> Option<(u32, u32)> {
+        self.source_file_lookup
+            .get(filename)
+            .and_then(|index| self.source_files[*index as usize].lines.get(&file_line))
+            .map(|location| *location)
     }
 }
@@ -0,0 +1,422 @@
+//
+// Small expression compiler used for breakpoint conditions. Expressions are compiled once to a list of
+// stack operations so evaluating them when a breakpoint is hit is cheap.
+//
+// The syntax is the same as for ExpressionEvaluator in the frontend so a condition gives the same result no matter
+// where it's evaluated. Values are unsigned 64-bit.
+//
+//   numbers: 123, 0x7f, $7f
+//   registers: any name that the register lookup knows about (such as d0, a7, pc)
+//   memory: [expr] (4 bytes), [expr].b, [expr].w, [expr].l, [expr].q (big endian)
+//   operators (C precedence): unary - ~ ! +, * / %, + -, << >>, < <= > >=, == !=, &, ^, |, &&, ||
+//
+
+#[derive(Clone, Copy, Debug, PartialEq)]
+enum BinOp {
+    Mul,
+    Div,
+    Mod,
+    Add,
+    Sub,
+    Shl,
+    Shr,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+    Eq,
+    Ne,
+    And,
+    Xor,
+    Or,
+    LogicalAnd,
+    LogicalOr,
+}
+
+#[derive(Clone, Copy, Debug)]
+enum Op {
+    Const(u64),
+    Reg(usize),
+    Load(u8),
+    Neg,
+    Not,
+    LogicalNot,
+    Bin(BinOp),
+}
+
+#[derive(Clone, Debug, PartialEq)]
+enum Token {
+    Number(u64),
+    Ident(String),
+    Op(&'static str),
+    LParen,
+    RParen,
+    LBracket,
+    RBracket,
+    Size(u8),
+}
+
+pub struct Expression {
+    ops: Vec<Op>,
+    stack_size: usize,
+}
+
+// Longest operators first so "<<" is matched before "<"
+static OPERATORS: [&'static str; 20] = ["<<", ">>", "<=", ">=", "==", "!=", "&&", "||", "*", "/", "%", "+", "-",
+                                        "<", ">", "&", "^", "|", "~", "!"];
+
+fn tokenize(text: &str) -> Result<Vec<Token>, String> {
+    let chars: Vec<char> = text.chars().collect();
+    let mut tokens = Vec::new();
+    let mut i = 0;
+
+    while i < chars.len() {
+        let c = chars[i];
+
+        if c.is_whitespace() {
+            i += 1;
+            continue;
+        }
+
+        if c.is_digit(10) || c == '$' {
+            let (radix, start) = if c == '$' {
+                (16, i + 1)
+            } else if c == '0' && i + 1 < chars.len() && (chars[i + 1] == 'x' || chars[i + 1] == 'X') {
+                (16, i + 2)
+            } else {
+                (10, i)
+            };
+
+            let mut end = start;
+
+            while end < chars.len() && chars[end].is_digit(radix) {
+                end += 1;
+            }
+
+            let digits: String = chars[start..end].iter().cloned().collect();
+
+            match u64::from_str_radix(&digits, radix) {
+                Ok(v) => tokens.push(Token::Number(v)),
+                Err(_) => return Err(format!("Invalid number at {}", i)),
+            }
+
+            i = end;
+            continue;
+        }
+
+        if c.is_alphabetic() || c == '_' {
+            let start = i;
+
+            while i < chars.len() && (chars[i].is_alphanumeric() || chars[i] == '_') {
+                i += 1;
+            }
+
+            let ident: String = chars[start..i].iter().cloned().collect();
+            tokens.push(Token::Ident(ident.to_lowercase()));
+            continue;
+        }
+
+        match c {
+            '(' => tokens.push(Token::LParen),
+            ')' => tokens.push(Token::RParen),
+            '[' => tokens.push(Token::LBracket),
+            ']' => {
+                tokens.push(Token::RBracket);
+
+                // Optional size for memory access
+                if i + 2 < chars.len() && chars[i + 1] == '.' {
+                    let size = match chars[i + 2] {
+                        'b' | 'B' => 1,
+                        'w' | 'W' => 2,
+                        'l' | 'L' => 4,
+                        'q' | 'Q' => 8,
+                        _ => return Err(format!("Invalid memory size at {}", i + 2)),
+                    };
+
+                    tokens.push(Token::Size(size));
+                    i += 2;
+                }
+            }
+
+            _ => {
+                let rest: String = chars[i..].iter().take(2).cloned().collect();
+
+                match OPERATORS.iter().find(|op| rest.starts_with(*op)) {
+                    Some(op) => {
+                        tokens.push(Token::Op(*op));
+                        i += op.len();
+                        continue;
+                    }
+                    None => return Err(format!("Unexpected character '{}' at {}", c, i)),
+                }
+            }
+        }
+
+        i += 1;
+    }
+
+    Ok(tokens)
+}
+
+fn binary_op(op: &str) -> Option<(BinOp, u32)> {
+    // (operator, precedence). Higher binds tighter
+    match op {
+        "*" => Some((BinOp::Mul, 10)),
+        "/" => Some((BinOp::Div, 10)),
+        "%" => Some((BinOp::Mod, 10)),
+        "+" => Some((BinOp::Add, 9)),
+        "-" => Some((BinOp::Sub, 9)),
+        "<<" => Some((BinOp::Shl, 8)),
+        ">>" => Some((BinOp::Shr, 8)),
+        "<" => Some((BinOp::Lt, 7)),
+        "<=" => Some((BinOp::Le, 7)),
+        ">" => Some((BinOp::Gt, 7)),
+        ">=" => Some((BinOp::Ge, 7)),
+        "==" => Some((BinOp::Eq, 6)),
+        "!=" => Some((BinOp::Ne, 6)),
+        "&" => Some((BinOp::And, 5)),
+        "^" => Some((BinOp::Xor, 4)),
+        "|" => Some((BinOp::Or, 3)),
+        "&&" => Some((BinOp::LogicalAnd, 2)),
+        "||" => Some((BinOp::LogicalOr, 1)),
+        _ => None,
+    }
+}
+
+struct Parser<'a> {
+    tokens: Vec<Token>,
+    pos: usize,
+    ops: Vec<Op>,
+    reg_lookup: &'a Fn(&str) -> Option<usize>,
+}
+
+impl<'a> Parser<'a> {
+    fn peek(&self) -> Option<&Token> {
+        self.tokens.get(self.pos)
+    }
+
+    fn next(&mut self) -> Option<Token> {
+        let t = self.tokens.get(self.pos).cloned();
+        self.pos += 1;
+        t
+    }
+
+    fn expect(&mut self, token: Token) -> Result<(), String> {
+        match self.next() {
+            Some(ref t) if *t == token => Ok(()),
+            t => Err(format!("Expected {:?} but got {:?}", token, t)),
+        }
+    }
+
+    fn parse_primary(&mut self) -> Result<(), String> {
+        match self.next() {
+            Some(Token::Number(v)) => self.ops.push(Op::Const(v)),
+
+            Some(Token::Ident(name)) => {
+                match (self.reg_lookup)(&name) {
+                    Some(reg) => self.ops.push(Op::Reg(reg)),
+                    None => return Err(format!("Unknown register {}", name)),
+                }
+            }
+
+            Some(Token::LParen) => {
+                try!(self.parse_expression(0));
+                try!(self.expect(Token::RParen));
+            }
+
+            Some(Token::LBracket) => {
+                try!(self.parse_expression(0));
+                try!(self.expect(Token::RBracket));
+
+                let size = match self.peek() {
+                    Some(&Token::Size(size)) => Some(size),
+                    _ => None,
+                };
+
+                if size.is_some() {
+                    self.pos += 1;
+                }
+
+                self.ops.push(Op::Load(size.unwrap_or(4)));
+            }
+
+            Some(Token::Op("-")) => {
+                try!(self.parse_primary());
+                self.ops.push(Op::Neg);
+            }
+
+            Some(Token::Op("~")) => {
+                try!(self.parse_primary());
+                self.ops.push(Op::Not);
+            }
+
+            Some(Token::Op("!")) => {
+                try!(self.parse_primary());
+                self.ops.push(Op::LogicalNot);
+            }
+
+            Some(Token::Op("+")) => try!(self.parse_primary()),
+
+            t => return Err(format!("Unexpected {:?}", t)),
+        }
+
+        Ok(())
+    }
+
+    // Precedence climbing
+
+    fn parse_expression(&mut self, min_prec: u32) -> Result<(), String> {
+        try!(self.parse_primary());
+
+        loop {
+            let (op, prec) = match self.peek() {
+                Some(&Token::Op(op)) => {
+                    match binary_op(op) {
+                        Some(op) => op,
+                        None => return Err(format!("Unexpected operator {}", op)),
+                    }
+                }
+                _ => return Ok(()),
+            };
+
+            if prec < min_prec {
+                return Ok(());
+            }
+
+            self.pos += 1;
+
+            try!(self.parse_expression(prec + 1));
+            self.ops.push(Op::Bin(op));
+        }
+    }
+}
+
+impl Expression {
+    ///
+    /// Compiles the expression. reg_lookup maps a (lower case) register name to the index in the
+    /// register array that is passed to eval.
+    ///
+    pub fn compile(text: &str, reg_lookup: &Fn(&str) -> Option<usize>) -> Result<Expression, String> {
+        let tokens = try!(tokenize(text));
+
+        if tokens.len() == 0 {
+            return Err("Empty expression".to_owned());
+        }
+
+        let mut parser = Parser {
+            tokens: tokens,
+            pos: 0,
+            ops: Vec::new(),
+            reg_lookup: reg_lookup,
+        };
+
+        try!(parser.parse_expression(0));
+
+        if parser.pos != parser.tokens.len() {
+            return Err(format!("Unexpected {:?}", parser.tokens[parser.pos]));
+        }
+
+        // Calculate the max stack depth so eval only needs to allocate once
+        let mut depth = 0i32;
+        let mut max_depth = 0i32;
+
+        for op in &parser.ops {
+            depth += match *op {
+                Op::Const(_) | Op::Reg(_) => 1,
+                Op::Bin(_) => -1,
+                _ => 0,
+            };
+
+            max_depth = max_depth.max(depth);
+        }
+
+        Ok(Expression {
+            ops: parser.ops,
+            stack_size: max_depth as usize,
+        })
+    }
+
+    ///
+    /// Evaluates the expression. read_memory is called with (address, size) for memory accesses.
+    /// Returns None if a register is out of range, memory can't be read or on division by zero.
+    ///
+    pub fn eval<F: FnMut(u32, u8) -> Option<u64>>(&self, registers: &[u32], mut read_memory: F) -> Option<u64> {
+        let mut stack: Vec<u64> = Vec::with_capacity(self.stack_size);
+
+        for op in &self.ops {
+            match *op {
+                Op::Const(v) => stack.push(v),
+                Op::Reg(reg) => {
+                    match registers.get(reg) {
+                        Some(v) => stack.push(*v as u64),
+                        None => return None,
+                    }
+                }
+
+                Op::Load(size) => {
+                    let address = stack.pop().unwrap();
+
+                    match read_memory(address as u32, size) {
+                        Some(v) => stack.push(v),
+                        None => return None,
+                    }
+                }
+
+                Op::Neg => {
+                    let v = stack.pop().unwrap();
+                    stack.push(v.wrapping_neg());
+                }
+
+                Op::Not => {
+                    let v = stack.pop().unwrap();
+                    stack.push(!v);
+                }
+
+                Op::LogicalNot => {
+                    let v = stack.pop().unwrap();
+                    stack.push((v == 0) as u64);
+                }
+
+                Op::Bin(op) => {
+                    let b = stack.pop().unwrap();
+                    let a = stack.pop().unwrap();
+
+                    let v = match op {
+                        BinOp::Mul => a.wrapping_mul(b),
+                        BinOp::Div => {
+                            if b == 0 {
+                                return None;
+                            }
+                            a / b
+                        }
+                        BinOp::Mod => {
+                            if b == 0 {
+                                return None;
+                            }
+                            a % b
+                        }
+                        BinOp::Add => a.wrapping_add(b),
+                        BinOp::Sub => a.wrapping_sub(b),
+                        BinOp::Shl => if b < 64 { a << b } else { 0 },
+                        BinOp::Shr => if b < 64 { a >> b } else { 0 },
+                        BinOp::Lt => (a < b) as u64,
+                        BinOp::Le => (a <= b) as u64,
+                        BinOp::Gt => (a > b) as u64,
+                        BinOp::Ge => (a >= b) as u64,
+                        BinOp::Eq => (a == b) as u64,
+                        BinOp::Ne => (a != b) as u64,
+                        BinOp::And => a & b,
+                        BinOp::Xor => a ^ b,
+                        BinOp::Or => a | b,
+                        BinOp::LogicalAnd => (a != 0 && b != 0) as u64,
+                        BinOp::LogicalOr => (a != 0 || b != 0) as u64,
+                    };
+
+                    stack.push(v);
+                }
+            }
+        }
+
+        stack.pop()
+    }
+}
@@ -4,17 +4,35 @@ extern crate gdb_remote;
 extern crate amiga_hunk_parser;
 
 mod debug_info;
+mod parallel_disasm;
+mod code_analysis;
+mod expression;
 
 use prodbg_api::*;
 use std::str;
 use std::io::Result;
-use gdb_remote::GdbRemote;
+use gdb_remote::{GdbRemote, MemorySearch, WatchKind};
 use debug_info::DebugInfo;
+use parallel_disasm::DisasmLine;
+use code_analysis::{AnalysisJob, BranchKind, CodeAnalysis, CodeRef};
+use expression::Expression;
 //use std::path::{Path, PathBuf};
 
 struct Breakpoint {
     file_line: Option<(String, u32)>,
     address: Option<u32>,
+    // Compiled once when the breakpoint is set so it's cheap to evaluate each time it's hit
+    condition: Option<Expression>,
+    // Only stop when the breakpoint has been hit (with the condition being true) this many times
+    hit_count: u32,
+    hits: u32,
+}
+
+struct Watchpoint {
+    id: u32,
+    address: u32,
+    size: u32,
+    kind: WatchKind,
 }
 
 struct Segment {
@@ -22,6 +40,16 @@ struct Segment {
     size: u32,
 }
 
+// Number of threads used when disassembling a whole code hunk
+const DISASM_WORKER_COUNT: usize = 4;
+
+// Flags sent with each disassembly entry (if code analysis is available for it)
+const DISASM_FLAG_BLOCK_START: u8 = 1 << 0;
+const DISASM_FLAG_FUNCTION_START: u8 = 1 << 1;
+const DISASM_FLAG_BRANCH: u8 = 1 << 2;
+const DISASM_FLAG_CALL: u8 = 1 << 3;
+const DISASM_FLAG_RETURN: u8 = 1 << 4;
+
 struct AmigaUaeBackend {
     capstone: Capstone,
     conn: GdbRemote,
@@ -34,9 +62,19 @@ struct AmigaUaeBackend {
     _break_at_start: bool,
     debug_info: DebugInfo,
     segments: Vec<Segment>,
+    // Disassembly of each code hunk (same order as segments). Built on first request
+    segment_disassembly: Vec<Option<Vec<DisasmLine>>>,
+    register_names_sent: bool,
+    code_analysis: CodeAnalysis,
+    analysis_job: Option<AnalysisJob>,
     status: String,
     debug_state: DebugState,
     breakpoints: Vec<Breakpoint>,
+    watchpoints: Vec<Watchpoint>,
+    // Watchpoint kind and the accessed address if the last stop was caused by a watchpoint
+    watch_hit: Option<(WatchKind, u64)>,
+    // Set when the target is continued so a stop can be from a breakpoint. Conditions aren't checked after steps
+    check_conditions: bool,
 }
 
 impl AmigaUaeBackend {
@@ -100,6 +138,109 @@ impl AmigaUaeBackend {
         writer.event_end();
     }
 
+    // Registers read/written by instructions are sent as masks (bit n = Capstone register id n) and the
+    // names for the bits are sent with the first disassembly reply only. The UI keeps the table around
+    // for the rest of the session.
+
+    fn write_register_names(&mut self, writer: &mut Writer) {
+        if self.register_names_sent {
+            return;
+        }
+
+        writer.array_begin("register_names");
+
+        for reg_id in 0..capstone_m68k::m68k_reg::M68K_REG_ENDING as u16 {
+            writer.array_entry_begin();
+
+            if reg_id == 0 {
+                writer.write_string("name", "");
+            } else {
+                writer.write_string("name", self.capstone.reg_name(reg_id));
+            }
+
+            writer.array_entry_end();
+        }
+
+        writer.array_end();
+
+        self.register_names_sent = true;
+    }
+
+    fn write_register_masks(writer: &mut Writer, regs_read: u64, regs_write: u64) {
+        if regs_read != 0 {
+            writer.write_u64("regs_read", regs_read);
+        }
+
+        if regs_write != 0 {
+            writer.write_u64("regs_write", regs_write);
+        }
+    }
+
+    // Basic block/function/branch info from the background code analysis. Branch targets are sent as
+    // absolute addresses so the UI can jump to them directly.
+
+    fn write_analysis_info(&self, writer: &mut Writer, address: u32) {
+        let seg_index = match self.find_segment(address) {
+            Some(index) => index,
+            None => return,
+        };
+
+        let hunk = seg_index as u32;
+        let offset = address - self.segments[seg_index].address;
+        let mut flags = 0;
+
+        if self.code_analysis.is_block_start(hunk, offset) {
+            flags |= DISASM_FLAG_BLOCK_START;
+        }
+
+        if self.code_analysis.is_function_start(hunk, offset) {
+            flags |= DISASM_FLAG_FUNCTION_START;
+
+            let caller_count = self.code_analysis.callers(CodeRef { hunk: hunk, offset: offset }).len();
+
+            if caller_count > 0 {
+                writer.write_u32("caller_count", caller_count as u32);
+            }
+        }
+
+        if let Some(branch) = self.code_analysis.branch_at(hunk, offset) {
+            flags |= match branch.kind {
+                BranchKind::Call => DISASM_FLAG_CALL,
+                BranchKind::Return => DISASM_FLAG_RETURN,
+                _ => DISASM_FLAG_BRANCH,
+            };
+
+            if let Some(target) = branch.target {
+                if let Some(seg) = self.segments.get(target.hunk as usize) {
+                    writer.write_u64("branch_target", (seg.address + target.offset) as u64);
+                }
+            }
+        }
+
+        if flags != 0 {
+            writer.write_u8("flags", flags);
+        }
+    }
+
+    fn update_code_analysis(&mut self) {
+        let done = match self.analysis_job {
+            Some(ref job) => job.poll(&mut self.code_analysis),
+            None => return,
+        };
+
+        if done {
+            println!("Code analysis done");
+            self.analysis_job = None;
+        }
+    }
+
+    fn start_code_analysis(&mut self) {
+        let path = DebugInfo::exe_path(&self.uae_partition_path, &self.amiga_exe_file_path);
+
+        self.code_analysis = CodeAnalysis::new();
+        self.analysis_job = Some(AnalysisJob::start(self.capstone.new_instance(), path, DISASM_WORKER_COUNT));
+    }
+
     fn write_disassembly(&mut self, reader: &mut Reader, writer: &mut Writer) {
         match self.capstone.open(Arch::M68K, CS_MODE_M68K_000) {
             Err(e) => {
@@ -109,11 +250,18 @@ impl AmigaUaeBackend {
             _ => (),
         }
 
-        //let mut scratch_string = String::with_capacity(256);
+        // Needed to get the registers read/written by each instruction
+        if self.capstone.set_option(Opt::Detail, CS_OPT_ON).is_err() {
+            println!("Unable to enable Capstone instruction details");
+        }
 
         let address = reader.find_u64("address_start").ok().unwrap();
         let count = reader.find_u32("instruction_count").ok().unwrap();
 
+        if self.write_segment_disassembly(address as u32, count, writer) {
+            return;
+        }
+
         let mut data = Vec::<u8>::with_capacity(256 * 1024);
         let memory_fetch_size = count * 4;
 
@@ -130,45 +278,18 @@ impl AmigaUaeBackend {
             writer.event_begin(EventType::SetDisassembly as u16);
             writer.write_u32("address_width", 4);
 
+            self.write_register_names(writer);
+
             writer.array_begin("disassembly");
             let mut c = 0;
 
             for i in insns.iter() {
-                let text = format!("{0: <10} {1: <10}",
-                                   i.mnemonic().unwrap(),
-                                   i.op_str().unwrap_or(""));
+                let text = parallel_disasm::format_instruction(i.mnemonic().unwrap(), i.op_str().unwrap_or(""));
                 writer.array_entry_begin();
                 writer.write_u32("address", i.address as u32);
                 writer.write_string("line", &text);
-
-                /*
-                scratch_string.clear();
-
-                for register in i.regs_read().unwrap() {
-                    let reg_name = self.capstone.reg_name(*register);
-                    scratch_string.push_str(reg_name);
-                    scratch_string.push(' ');
-                }
-
-                if scratch_string.len() > 0 {
-                    let t = scratch_string.trim_right();
-                    writer.write_string("registers_read", t);
-                }
-
-                scratch_string.clear();
-
-                for register in i.regs_write().unwrap() {
-                    let reg_name = self.capstone.reg_name(*register);
-                    scratch_string.push_str(reg_name);
-                    scratch_string.push(' ');
-                }
-
-                if scratch_string.len() > 0 {
-                    let t = scratch_string.trim_right();
-                    writer.write_string("registers_write", t);
-                }
-                */
-
+                Self::write_register_masks(writer, i.regs_read_mask(), i.regs_write_mask());
+                self.write_analysis_info(writer, i.address as u32);
                 writer.array_entry_end();
 
                 c += 1;
@@ -183,6 +304,85 @@ impl AmigaUaeBackend {
         }
     }
 
+    fn find_segment(&self, address: u32) -> Option<usize> {
+        self.segments.iter().position(|seg| address >= seg.address && address < seg.address + seg.size)
+    }
+
+    // Disassemble the whole hunk that address is in (if we have it loaded) using several threads
+
+    fn build_segment_disassembly(&mut self, seg_index: usize) {
+        let file = match self.debug_info.file {
+            Some(ref file) => file,
+            None => return,
+        };
+
+        if seg_index >= file.hunks().len() {
+            return;
+        }
+
+        let bases: Vec<u32> = self.segments.iter().map(|seg| seg.address).collect();
+
+        if let Some(code) = parallel_disasm::relocate_hunk(file, seg_index, &bases) {
+            let lines = parallel_disasm::disassemble_hunk(&self.capstone,
+                                                          file,
+                                                          seg_index,
+                                                          code,
+                                                          bases[seg_index],
+                                                          DISASM_WORKER_COUNT);
+            self.segment_disassembly[seg_index] = Some(lines);
+        }
+    }
+
+    fn write_segment_disassembly(&mut self, address: u32, count: u32, writer: &mut Writer) -> bool {
+        let seg_index = match self.find_segment(address) {
+            Some(index) => index,
+            None => return false,
+        };
+
+        if self.segment_disassembly.len() != self.segments.len() {
+            self.segment_disassembly = (0..self.segments.len()).map(|_| None).collect();
+        }
+
+        if self.segment_disassembly[seg_index].is_none() {
+            self.build_segment_disassembly(seg_index);
+        }
+
+        let (start, end) = match self.segment_disassembly[seg_index] {
+            // If address isn't at the start of an instruction (according to our disassembly) we let UAE give us
+            // the memory and disassemble from there instead
+            Some(ref lines) => {
+                match lines.binary_search_by(|line| line.address.cmp(&address)) {
+                    Ok(index) => (index, (index + count as usize).min(lines.len())),
+                    Err(_) => return false,
+                }
+            }
+            None => return false,
+        };
+
+        writer.event_begin(EventType::SetDisassembly as u16);
+        writer.write_u32("address_width", 4);
+
+        self.write_register_names(writer);
+
+        writer.array_begin("disassembly");
+
+        let lines = self.segment_disassembly[seg_index].as_ref().unwrap();
+
+        for line in &lines[start..end] {
+            writer.array_entry_begin();
+            writer.write_u32("address", line.address);
+            writer.write_string("line", &line.text);
+            Self::write_register_masks(writer, line.regs_read, line.regs_write);
+            self.write_analysis_info(writer, line.address);
+            writer.array_entry_end();
+        }
+
+        writer.array_end();
+        writer.event_end();
+
+        true
+    }
+
     fn get_memory(&mut self, reader: &mut Reader, writer: &mut Writer) {
         let mut data = Vec::<u8>::with_capacity(256 * 1024);
 
@@ -201,6 +401,46 @@ impl AmigaUaeBackend {
         writer.event_end();
     }
 
+    // The search runs here (reading the memory from UAE in chunks) so only the matches are sent to the UI
+
+    fn search_memory(&mut self, reader: &mut Reader, writer: &mut Writer) {
+        let start = reader.find_u64("start").unwrap_or(0);
+        let end = reader.find_u64("end").unwrap_or(0x1000000);
+        let alignment = reader.find_u8("alignment").unwrap_or(1);
+        let max_count = reader.find_u32("max_matches").unwrap_or(64 * 1024) as usize;
+        let mut matches = Vec::new();
+
+        let search = match reader.find_data("pattern") {
+            Ok(pattern) => MemorySearch::new(pattern, reader.find_data("mask").ok(), alignment as u64),
+            Err(_) => None,
+        };
+
+        if let Some(search) = search {
+            if self.conn.is_connected() && start < end {
+                // One extra match to know if there were more
+                if let Err(err) = self.conn.search_memory(&search, start, end, &mut matches, max_count + 1) {
+                    println!("Unable to search memory {:x} - {:x} - {:?}", start, end, err);
+                }
+            }
+        }
+
+        let truncated = matches.len() > max_count;
+        matches.truncate(max_count);
+
+        let mut data = Vec::with_capacity(matches.len() * 8);
+
+        for address in &matches {
+            for i in 0..8 {
+                data.push((address >> (i * 8)) as u8);
+            }
+        }
+
+        writer.event_begin(EventType::SetSearchResult as u16);
+        writer.write_data("matches", &data);
+        writer.write_u8("truncated", if truncated { 1 } else { 0 });
+        writer.event_end();
+    }
+
     // Write source/line if we can find debug info for it
 
     fn write_source_line_location(&mut self, writer: &mut Writer) {
@@ -222,6 +462,77 @@ impl AmigaUaeBackend {
         //println!("Location not found :(");
     }
 
+    // Symbols of a hunk sorted on offset so the one an address is in can be binary searched
+
+    fn sorted_symbols(&self, hunk: usize) -> Vec<(u32, String)> {
+        let file = match self.debug_info.file {
+            Some(ref file) if hunk < file.hunks().len() => file,
+            _ => return Vec::new(),
+        };
+
+        let mut symbols: Vec<(u32, String)> =
+            file.symbols(hunk).iter().map(|sym| (sym.offset, sym.name.to_string())).collect();
+
+        symbols.sort_by(|a, b| a.0.cmp(&b.0));
+        symbols
+    }
+
+    // Resolves addresses (from the profiler) to the function and source line they are in. The function is the
+    // closest symbol before the address or, if there are no symbols, the function start found by the code analysis
+
+    fn write_address_info(&self, reader: &mut Reader, writer: &mut Writer) {
+        let data = match reader.find_data("addresses") {
+            Ok(data) => data,
+            Err(_) => return,
+        };
+
+        let mut hunk_symbols: Vec<Option<Vec<(u32, String)>>> = (0..self.segments.len()).map(|_| None).collect();
+
+        writer.event_begin(EventType::SetAddressInfo as u16);
+        writer.array_begin("info");
+
+        for bytes in data.chunks(8).filter(|bytes| bytes.len() == 8) {
+            let address = bytes.iter().rev().fold(0u64, |acc, b| (acc << 8) | *b as u64);
+
+            writer.array_entry_begin();
+            writer.write_u64("address", address);
+
+            if let Some(seg_index) = self.find_segment(address as u32) {
+                let seg_start = self.segments[seg_index].address;
+                let offset = address as u32 - seg_start;
+
+                if hunk_symbols[seg_index].is_none() {
+                    hunk_symbols[seg_index] = Some(self.sorted_symbols(seg_index));
+                }
+
+                let symbols = hunk_symbols[seg_index].as_ref().unwrap();
+
+                let symbol = match symbols.binary_search_by(|sym| sym.0.cmp(&offset)) {
+                    Ok(index) => Some(&symbols[index]),
+                    Err(0) => None,
+                    Err(index) => Some(&symbols[index - 1]),
+                };
+
+                if let Some(sym) = symbol {
+                    writer.write_string("symbol", &sym.1);
+                    writer.write_u64("symbol_address", (seg_start + sym.0) as u64);
+                } else if let Some(start) = self.code_analysis.function_at(seg_index as u32, offset) {
+                    writer.write_u64("symbol_address", (seg_start + start) as u64);
+                }
+
+                if let Some(src_line) = self.debug_info.resolve_file_line(offset, seg_index as u32) {
+                    writer.write_string("filename", &src_line.0);
+                    writer.write_u32("line", src_line.1);
+                }
+            }
+
+            writer.array_entry_end();
+        }
+
+        writer.array_end();
+        writer.event_end();
+    }
+
     fn write_exception_location(&mut self, writer: &mut Writer) {
         writer.event_begin(EventType::SetExceptionLocation as u16);
         writer.write_u64("address", self.exception_location as u64);
@@ -229,6 +540,17 @@ impl AmigaUaeBackend {
 
         self.write_source_line_location(writer);
 
+        if let Some((kind, address)) = self.watch_hit {
+            if let Some(wp) = self.watchpoints.iter().find(|wp| {
+                wp.kind == kind && address >= wp.address as u64 && address < wp.address as u64 + wp.size as u64
+            }) {
+                writer.write_u32("watch_id", wp.id);
+            }
+
+            writer.write_u64("watch_address", address);
+            writer.write_u8("watch_access", Self::watch_access(kind));
+        }
+
         writer.event_end();
     }
 
@@ -251,25 +573,80 @@ impl AmigaUaeBackend {
         }
     }
 
-    fn set_breakpoint_file_line(&mut self, filename: &str, line: u32) {
-        Self::toggle_breakpoint_fileline(&mut self.conn, &self.debug_info, filename, line, true);
+    // Maps a register name used in a breakpoint condition to the index in the gdb register reply
+
+    fn register_index(name: &str) -> Option<usize> {
+        match name {
+            "sp" => Some(15),
+            "sr" => Some(16),
+            "pc" => Some(17),
+            _ => {
+                let mut chars = name.chars();
+                let first = chars.next();
+                let reg: Option<usize> = chars.as_str().parse().ok();
+
+                match (first, reg) {
+                    (Some('d'), Some(reg)) if reg < 8 => Some(reg),
+                    (Some('a'), Some(reg)) if reg < 8 => Some(8 + reg),
+                    _ => None,
+                }
+            }
+        }
+    }
+
+    fn compile_condition(reader: &mut Reader) -> Option<Expression> {
+        let text = match reader.find_string("condition") {
+            Ok(text) if text.trim().len() > 0 => text,
+            _ => return None,
+        };
+
+        match Expression::compile(text, &Self::register_index) {
+            Ok(expr) => Some(expr),
+            Err(err) => {
+                println!("Unable to compile breakpoint condition \"{}\" - {}", text, err);
+                None
+            }
+        }
+    }
 
-        self.breakpoints.push(Breakpoint {
-            file_line: Some((filename.to_owned(), line)),
-            address: None
-        });
+    fn add_breakpoint(&mut self, breakpoint: Breakpoint) {
+        // If the breakpoint is already set (UI sends all breakpoints again on start) only update the condition
+        if let Some(bp) = self.breakpoints
+            .iter_mut()
+            .find(|bp| bp.file_line == breakpoint.file_line && bp.address == breakpoint.address) {
+            bp.condition = breakpoint.condition;
+            bp.hit_count = breakpoint.hit_count;
+            bp.hits = 0;
+            return;
+        }
+
+        self.breakpoints.push(breakpoint);
     }
 
     fn set_breakpoint(&mut self, reader: &mut Reader, _writer: &mut Writer) {
+        let condition = Self::compile_condition(reader);
+        let hit_count = reader.find_u32("hit_count").unwrap_or(0);
+
         if let Ok(filename) = reader.find_string("filename") {
             if let Ok(line) = reader.find_u32("line") {
                 println!("trying to add breakpoint {} - {}", filename, line);
-                self.set_breakpoint_file_line(filename, line);
+                Self::toggle_breakpoint_fileline(&mut self.conn, &self.debug_info, filename, line, true);
+
+                self.add_breakpoint(Breakpoint {
+                    file_line: Some((filename.to_owned(), line)),
+                    address: None,
+                    condition: condition,
+                    hit_count: hit_count,
+                    hits: 0,
+                });
             }
         } else if let Some(address) = reader.find_u64("address").ok() {
-            self.breakpoints.push(Breakpoint {
+            self.add_breakpoint(Breakpoint {
                 file_line: None,
                 address: Some(address as u32),
+                condition: condition,
+                hit_count: hit_count,
+                hits: 0,
             });
 
             if self.conn.set_breakpoint_at_address(address as u64).is_err() {
@@ -279,13 +656,165 @@ impl AmigaUaeBackend {
     }
 
     fn delete_breakpoint(&mut self, reader: &mut Reader, _writer: &mut Writer) {
-        if let Ok(address) = reader.find_u64("address") {
+        if let Ok(filename) = reader.find_string("filename") {
+            if let Ok(line) = reader.find_u32("line") {
+                let file_line = Some((filename.to_owned(), line));
+                self.breakpoints.retain(|bp| bp.file_line != file_line);
+
+                if self.conn.is_connected() {
+                    Self::toggle_breakpoint_fileline(&mut self.conn, &self.debug_info, filename, line, false);
+                }
+            }
+        } else if let Ok(address) = reader.find_u64("address") {
+            self.breakpoints.retain(|bp| bp.address != Some(address as u32));
+
             if self.conn.remove_breakpoint_at_address(address).is_err() {
                 println!("Unable to remove breakpoint at 0x{:08x}", address);
             }
         }
     }
 
+    fn watch_kind(access: u8) -> Option<WatchKind> {
+        match access {
+            WATCH_ACCESS_READ => Some(WatchKind::Read),
+            WATCH_ACCESS_WRITE => Some(WatchKind::Write),
+            WATCH_ACCESS_READ_WRITE => Some(WatchKind::Access),
+            _ => None,
+        }
+    }
+
+    fn watch_access(kind: WatchKind) -> u8 {
+        match kind {
+            WatchKind::Read => WATCH_ACCESS_READ,
+            WatchKind::Write => WATCH_ACCESS_WRITE,
+            WatchKind::Access => WATCH_ACCESS_READ_WRITE,
+        }
+    }
+
+    fn remove_watchpoint(&mut self, id: u32) {
+        if let Some(index) = self.watchpoints.iter().position(|wp| wp.id == id) {
+            let wp = self.watchpoints.remove(index);
+
+            if self.conn.is_connected() {
+                if let Err(err) = self.conn.remove_watchpoint(wp.kind, wp.address as u64, wp.size as u64) {
+                    println!("Unable to remove watchpoint at 0x{:08x} - {:?}", wp.address, err);
+                }
+            }
+        }
+    }
+
+    // Watchpoints are handled by UAE (Z2/Z3/Z4). If we aren't connected yet they are sent when the target is started
+
+    fn set_watchpoint(&mut self, reader: &mut Reader, writer: &mut Writer) {
+        let id = reader.find_u32("id").unwrap_or(0);
+        let address = reader.find_u64("address").unwrap_or(0) as u32;
+        let size = reader.find_u64("size").unwrap_or(1) as u32;
+        let access = reader.find_u8("access").unwrap_or(WATCH_ACCESS_WRITE);
+        let mut status = 0;
+
+        self.remove_watchpoint(id);
+
+        if let Some(kind) = Self::watch_kind(access) {
+            let result = if self.conn.is_connected() {
+                self.conn.set_watchpoint(kind, address as u64, size as u64)
+            } else {
+                Ok(())
+            };
+
+            match result {
+                Ok(()) => {
+                    self.watchpoints.push(Watchpoint {
+                        id: id,
+                        address: address,
+                        size: size,
+                        kind: kind,
+                    });
+
+                    status = 1;
+                }
+
+                Err(err) => println!("Unable to set watchpoint at 0x{:08x} - {:?}", address, err),
+            }
+        }
+
+        writer.event_begin(EventType::ReplyWatchpoint as u16);
+        writer.write_u32("id", id);
+        writer.write_u8("status", status);
+        writer.event_end();
+    }
+
+    fn delete_watchpoint(&mut self, reader: &mut Reader) {
+        if let Ok(id) = reader.find_u32("id") {
+            self.remove_watchpoint(id);
+        }
+    }
+
+    fn send_watchpoints(&mut self) {
+        for wp in &self.watchpoints {
+            if let Err(err) = self.conn.set_watchpoint(wp.kind, wp.address as u64, wp.size as u64) {
+                println!("Unable to set watchpoint at 0x{:08x} - {:?}", wp.address, err);
+            }
+        }
+    }
+
+    fn breakpoint_address(&self, breakpoint: &Breakpoint) -> Option<u32> {
+        if let Some(address) = breakpoint.address {
+            return Some(address);
+        }
+
+        if let Some((ref file, line)) = breakpoint.file_line {
+            if let Some((seg, offset)) = self.debug_info.get_address_seg(file, line) {
+                return self.segments.get(seg as usize).map(|s| s.address + offset);
+            }
+        }
+
+        None
+    }
+
+    //
+    // Called when UAE stops at a breakpoint. Returns false if the breakpoint has a condition that isn't
+    // met (or hasn't been hit enough times yet) so execution should continue without the UI knowing about it
+    //
+    fn should_stop_at(&mut self, pc: u32, register_data: &[u8]) -> bool {
+        let index = match (0..self.breakpoints.len())
+            .find(|i| self.breakpoint_address(&self.breakpoints[*i]) == Some(pc)) {
+            Some(index) => index,
+            None => return true,
+        };
+
+        let conn = &mut self.conn;
+        let bp = &mut self.breakpoints[index];
+
+        if let Some(ref condition) = bp.condition {
+            let mut registers = [0u32; 18];
+
+            for (i, reg) in registers.iter_mut().enumerate() {
+                *reg = Self::get_u32(&register_data[i * 4..]);
+            }
+
+            let result = condition.eval(&registers, |address, size| {
+                let mut data = Vec::new();
+
+                if conn.get_memory(&mut data, address as u64, size as u64).is_err() || data.len() < size as usize {
+                    return None;
+                }
+
+                Some(data[..size as usize].iter().fold(0, |v, b| (v << 8) | *b as u64))
+            });
+
+            match result {
+                Some(0) => return false,
+                Some(_) => (),
+                // Stop if the condition can't be evaluated so the user can see what is going on
+                None => println!("Unable to evaluate breakpoint condition at 0x{:08x}", pc),
+            }
+        }
+
+        bp.hits += 1;
+
+        bp.hits >= bp.hit_count
+    }
+
     fn send_breakpoints(&mut self) {
         for breakpoint in &self.breakpoints {
             if let Some((ref file, line)) = breakpoint.file_line {
@@ -333,12 +862,14 @@ impl AmigaUaeBackend {
 
     fn update_conn_incoming(&mut self, writer: &mut Writer) {
         let mut should_break = false;
+        let mut watch_hit = None;
 
         if self.conn.is_connected() {
             if let Some(ref event) = self.conn.read_incoming_event() {
                 if let Some(ref data) = event.begins_with("QDmaFrame:") {
                     Self::process_dma_frame(self.id_amiga_uae_dma_time, &data, writer);
-                } else if let Some(ref _data) = event.begins_with("S") {
+                } else if event.stop_signal().is_some() {
+                    watch_hit = event.stop_watchpoint();
                     should_break = true;
                 }
             }
@@ -348,10 +879,30 @@ impl AmigaUaeBackend {
         }
 
         if should_break {
+            let mut register_data = [0; 1024];
+            if self.conn.get_registers(&mut register_data).is_err() {
+                println!("Unable to get registers!");
+                return;
+            }
+
+            let pc = Self::get_u32(&register_data[64 + 4..]);
+
+            // Conditions only apply when the target was continued and stopped at a breakpoint. A step over that
+            // ends on a breakpoint is a normal stop
+            if watch_hit.is_none() && self.check_conditions && !self.should_stop_at(pc, &register_data) {
+                if let Err(err) = self.conn.cont() {
+                    println!("Unable to continue after conditional breakpoint {:?}", err);
+                }
+
+                return;
+            }
+
             println!("Should break!");
             self.debug_state = DebugState::StopException;
 
-            self.update_pc(writer);
+            self.exception_location = pc;
+            self.watch_hit = watch_hit;
+            self.write_exception_location(writer);
         }
     }
 
@@ -368,6 +919,9 @@ impl AmigaUaeBackend {
     }
 
     fn step(&mut self, writer: &mut Writer) {
+        self.watch_hit = None;
+        self.check_conditions = false;
+
         let mut step_res = [0; 16];
         if self.conn.step(&mut step_res).is_err() {
             println!("Unable to step!");
@@ -378,6 +932,8 @@ impl AmigaUaeBackend {
     }
 
     fn step_over(&mut self) {
+        self.check_conditions = false;
+
         if self.conn.step_over().is_err() {
             println!("Unable to step over!");
             return;
@@ -418,6 +974,7 @@ impl AmigaUaeBackend {
         println!("store segments {:?}", segs);
 
         self.segments = Vec::new();
+        self.segment_disassembly = Vec::new();
 
         if segs.len() == 0 || segs[0] != "AS" {
             return;
@@ -451,9 +1008,16 @@ impl Backend for AmigaUaeBackend {
             _break_at_start: false,
             debug_info: DebugInfo::new(),
             segments: Vec::new(),
+            segment_disassembly: Vec::new(),
+            register_names_sent: false,
+            code_analysis: CodeAnalysis::new(),
+            analysis_job: None,
             status: "Not Connected".to_owned(),
             debug_state: DebugState::NoTarget,
             breakpoints: Vec::new(),
+            watchpoints: Vec::new(),
+            watch_hit: None,
+            check_conditions: false,
         }
     }
 
@@ -469,6 +1033,7 @@ impl Backend for AmigaUaeBackend {
 
     fn update(&mut self, action: i32, reader: &mut Reader, writer: &mut Writer) -> DebugState {
         self.update_conn_incoming(writer);
+        self.update_code_analysis();
 
         for event in reader.get_event() {
             //println!("getting event {}", event);
@@ -499,6 +1064,24 @@ impl Backend for AmigaUaeBackend {
                     self.write_exception_location(writer);
                 }
 
+                // Only used to resolve profiles from other backends. UAE itself isn't profiled: the gdb
+                // connection can only stop and inspect the target so sampling would mean stopping it for each sample
+                EVENT_GET_ADDRESS_INFO => {
+                    self.write_address_info(reader, writer);
+                }
+
+                EVENT_SET_WATCHPOINT => {
+                    self.set_watchpoint(reader, writer);
+                }
+
+                EVENT_DELETE_WATCHPOINT => {
+                    self.delete_watchpoint(reader);
+                }
+
+                EVENT_SEARCH_MEMORY => {
+                    self.search_memory(reader, writer);
+                }
+
                 _ => {
                     if event as u16 == self.id_amiga_uae_set_file {
                         self.set_file(reader);
@@ -517,6 +1100,8 @@ impl Backend for AmigaUaeBackend {
             ACTION_RUN => {
                 let mut res = [0; 1024];
 
+                self.check_conditions = true;
+
                 // If wa are already in trace mode we can just continue the execution
                 if self.debug_state == DebugState::Trace {
                     if let Err(err) = self.conn.cont() {
@@ -536,6 +1121,7 @@ impl Backend for AmigaUaeBackend {
                 }
 
                 self.debug_info.load_info(&self.uae_partition_path, &self.amiga_exe_file_path);
+                self.start_code_analysis();
 
                 if let Err(err) = self.connect() {
                     println!("Unable to connect {:?}", err);
@@ -544,6 +1130,7 @@ impl Backend for AmigaUaeBackend {
 
                 println!("Sending breakpoints...");
                 self.send_breakpoints();
+                self.send_watchpoints();
                 println!("Sending breakpoints... Done");
 
                 let run_cmd = format!("vRun;{};", self.amiga_exe_file_path);
@@ -576,6 +1163,9 @@ impl Backend for AmigaUaeBackend {
                 } else {
                     // clear debug info
                     self.debug_info = DebugInfo::new();
+                    self.segment_disassembly = Vec::new();
+                    self.code_analysis = CodeAnalysis::new();
+                    self.analysis_job = None;
                     self.status = "Connected (127.0.0.1)".to_owned();
                     self.debug_state = DebugState::NoTarget;
                 }
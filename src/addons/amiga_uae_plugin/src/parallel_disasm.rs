@@ -0,0 +1,379 @@
+use std::sync::Arc;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::mpsc::channel;
+use std::thread;
+use prodbg_api::{Arch, Capstone, Opt, CS_MODE_M68K_000, CS_OPT_ON};
+use amiga_hunk_parser::{HunkType, MappedHunkFile};
+
+// Average number of chunks each worker gets. Having more chunks than workers evens out the load
+// when some parts of a hunk takes longer to decode than others.
+const CHUNKS_PER_WORKER: usize = 4;
+
+// Chunks smaller than this isn't worth handing over to another thread
+const MIN_CHUNK_SIZE: usize = 4 * 1024;
+
+// Longest 68000 instruction is 10 bytes. Chunks are decoded a bit past their end so the last
+// instruction in a chunk can always be completed.
+const MAX_INSTRUCTION_SIZE: usize = 10;
+
+// Width the mnemonic and operand columns are padded to in the disassembly text
+const COLUMN_WIDTH: usize = 10;
+
+const HEX_DIGITS: &'static [u8; 16] = b"0123456789abcdef";
+
+pub struct DisasmLine {
+    pub address: u32,
+    pub size: u16,
+    pub text: String,
+    pub regs_read: u64,
+    pub regs_write: u64,
+}
+
+#[derive(Clone, Copy)]
+struct Chunk {
+    start: usize,
+    end: usize,
+}
+
+struct ChunkResult {
+    index: usize,
+    lines: Option<Vec<DisasmLine>>,
+}
+
+#[inline]
+fn get_u32(data: &[u8]) -> u32 {
+    ((data[0] as u32) << 24) | ((data[1] as u32) << 16) | ((data[2] as u32) << 8) | (data[3] as u32)
+}
+
+#[inline]
+fn put_u32(data: &mut [u8], v: u32) {
+    data[0] = (v >> 24) as u8;
+    data[1] = (v >> 16) as u8;
+    data[2] = (v >> 8) as u8;
+    data[3] = v as u8;
+}
+
+///
+/// Returns a copy of the code for a hunk with all the 32-bit relocations applied. segments holds the
+/// address each hunk has been loaded at (same order as the hunks)
+///
+pub fn relocate_hunk(file: &MappedHunkFile, hunk_index: usize, segments: &[u32]) -> Option<Vec<u8>> {
+    if file.hunks()[hunk_index].hunk_type != HunkType::Code {
+        return None;
+    }
+
+    let mut code = match file.code_data(hunk_index) {
+        Some(data) => data.to_vec(),
+        None => return None,
+    };
+
+    for reloc in file.relocs(hunk_index) {
+        if reloc.target >= segments.len() {
+            continue;
+        }
+
+        let base = segments[reloc.target];
+
+        for offset in reloc.offsets {
+            let offset = offset as usize;
+
+            if offset + 4 <= code.len() {
+                let v = get_u32(&code[offset..]);
+                put_u32(&mut code[offset..], v.wrapping_add(base));
+            }
+        }
+    }
+
+    Some(code)
+}
+
+///
+/// Collects offsets inside a hunk that are known to start an instruction. Symbols and line table
+/// entries are taken as they are. Relocation targets pointing into the hunk are used as well but
+/// as they may also point at data inside the code they are only treated as hints (see stitch_chunks)
+///
+fn instruction_boundaries(file: &MappedHunkFile, hunk_index: usize, code_len: usize) -> Vec<usize> {
+    let mut offsets = Vec::new();
+
+    for symbol in file.symbols(hunk_index) {
+        offsets.push(symbol.offset as usize);
+    }
+
+    for src_file in file.source_files(hunk_index) {
+        for line in src_file.lines() {
+            offsets.push(line.offset as usize);
+        }
+    }
+
+    for other in 0..file.hunks().len() {
+        let code_data = match file.code_data(other) {
+            Some(data) => data,
+            None => continue,
+        };
+
+        for reloc in file.relocs(other).into_iter().filter(|r| r.target == hunk_index) {
+            for offset in reloc.offsets {
+                let offset = offset as usize;
+                if offset + 4 <= code_data.len() {
+                    offsets.push(get_u32(&code_data[offset..]) as usize);
+                }
+            }
+        }
+    }
+
+    // 68k instructions are always word aligned
+    offsets.retain(|&o| o > 0 && o < code_len && (o & 1) == 0);
+    offsets.sort();
+    offsets.dedup();
+
+    offsets
+}
+
+fn split_chunks(boundaries: &[usize], code_len: usize, chunk_count: usize) -> Vec<Chunk> {
+    let mut target_size = code_len / chunk_count.max(1);
+
+    if target_size < MIN_CHUNK_SIZE {
+        target_size = MIN_CHUNK_SIZE;
+    }
+
+    let mut chunks = Vec::with_capacity(chunk_count + 1);
+    let mut start = 0;
+
+    for &offset in boundaries {
+        if offset - start >= target_size {
+            chunks.push(Chunk {
+                start: start,
+                end: offset,
+            });
+            start = offset;
+        }
+    }
+
+    chunks.push(Chunk {
+        start: start,
+        end: code_len,
+    });
+
+    chunks
+}
+
+///
+/// Linear sweep decode of code[start..end]. The last instruction may end past the end of the range.
+/// If Capstone is unable to decode a word it's emitted as dc.w and decoding continues after it.
+///
+fn open_capstone(capstone: &mut Capstone) -> bool {
+    if capstone.open(Arch::M68K, CS_MODE_M68K_000).is_err() {
+        return false;
+    }
+
+    capstone.set_option(Opt::Detail, CS_OPT_ON).is_ok()
+}
+
+fn push_padded(text: &mut String, s: &str) {
+    text.push_str(s);
+
+    // Capstone only produces ascii so the byte length is the number of chars
+    for _ in s.len()..COLUMN_WIDTH {
+        text.push(' ');
+    }
+}
+
+///
+/// Builds the text for an instruction. Same output as format!("{0: <10} {1: <10}") but without going
+/// through the formatting machinery which was the main cost of building the text for a whole hunk.
+///
+pub fn format_instruction(mnemonic: &str, operands: &str) -> String {
+    let mut text = String::with_capacity(COLUMN_WIDTH * 2 + 1 + operands.len());
+    push_padded(&mut text, mnemonic);
+    text.push(' ');
+    push_padded(&mut text, operands);
+    text
+}
+
+///
+/// Text for a word that isn't a valid instruction ("dc.w       $xxxx")
+///
+pub fn format_data_word(word: u16) -> String {
+    let mut text = String::with_capacity(COLUMN_WIDTH + 6);
+    push_padded(&mut text, "dc.w");
+    text.push(' ');
+    text.push('$');
+
+    for shift in &[12, 8, 4, 0] {
+        text.push(HEX_DIGITS[((word >> *shift) & 0xf) as usize] as char);
+    }
+
+    text
+}
+
+fn decode_range(capstone: &Capstone, code: &[u8], base_address: u32, start: usize, end: usize) -> Vec<DisasmLine> {
+    let mut lines = Vec::with_capacity((end - start) / 4);
+    let mut pos = start;
+
+    while pos < end {
+        let slice_end = (end + MAX_INSTRUCTION_SIZE).min(code.len());
+        let address = base_address.wrapping_add(pos as u32);
+        let mut decoded = false;
+
+        if let Ok(insns) = capstone.disasm(&code[pos..slice_end], address as u64, 0) {
+            for i in insns.iter() {
+                lines.push(DisasmLine {
+                    address: i.address as u32,
+                    size: i.size,
+                    text: format_instruction(i.mnemonic().unwrap(), i.op_str().unwrap_or("")),
+                    regs_read: i.regs_read_mask(),
+                    regs_write: i.regs_write_mask(),
+                });
+
+                pos += i.size as usize;
+                decoded = true;
+
+                if pos >= end {
+                    break;
+                }
+            }
+        }
+
+        if !decoded && pos < end {
+            let word = if pos + 2 <= code.len() {
+                ((code[pos] as u16) << 8) | (code[pos + 1] as u16)
+            } else {
+                (code[pos] as u16) << 8
+            };
+
+            lines.push(DisasmLine {
+                address: address,
+                size: 2,
+                text: format_data_word(word),
+                regs_read: 0,
+                regs_write: 0,
+            });
+
+            pos += 2;
+        }
+    }
+
+    lines
+}
+
+///
+/// Puts the decoded chunks together in order. If the last instruction of a chunk runs into the next
+/// one the next chunk didn't actually start at an instruction boundary (as seen by a linear sweep).
+/// In that case we skip lines until we are in sync again and if that never happens the chunk is
+/// decoded again from where the previous one ended.
+///
+fn stitch_chunks(capstone: &Capstone,
+                 code: &[u8],
+                 base_address: u32,
+                 chunks: &[Chunk],
+                 results: Vec<Option<Vec<DisasmLine>>>)
+                 -> Vec<DisasmLine> {
+    let mut output: Vec<DisasmLine> = Vec::with_capacity(code.len() / 4);
+    let mut expected = 0usize;
+
+    for (chunk, lines) in chunks.iter().zip(results.into_iter()) {
+        if expected >= chunk.end {
+            continue;
+        }
+
+        let expected_address = base_address.wrapping_add(expected as u32);
+
+        let lines = match lines {
+            Some(lines) => lines,
+            None => decode_range(capstone, code, base_address, expected, chunk.end),
+        };
+
+        if let Some(sync) = lines.iter().position(|l| l.address == expected_address) {
+            output.extend(lines.into_iter().skip(sync));
+        } else {
+            output.extend(decode_range(capstone, code, base_address, expected, chunk.end));
+        }
+
+        if let Some(last) = output.last() {
+            expected = (last.address.wrapping_sub(base_address) as usize) + last.size as usize;
+        }
+    }
+
+    output
+}
+
+///
+/// Disassembles a whole code hunk. The hunk is split at known instruction boundaries and the chunks are
+/// decoded on worker_count threads with a Capstone handle each. code is the (relocated) code of the
+/// hunk and base_address is the address it's loaded at.
+///
+pub fn disassemble_hunk(capstone: &Capstone,
+                        file: &MappedHunkFile,
+                        hunk_index: usize,
+                        code: Vec<u8>,
+                        base_address: u32,
+                        worker_count: usize)
+                        -> Vec<DisasmLine> {
+    let mut stitch_capstone = capstone.new_instance();
+
+    if !open_capstone(&mut stitch_capstone) {
+        println!("Unable to open Capstone for disassembly stitching");
+        return Vec::new();
+    }
+
+    // Capstone builds its M68K opcode table on the first decode and that isn't safe to do from several
+    // threads at once, so decode a nop here before the workers are started.
+    let _ = stitch_capstone.disasm(&[0x4e, 0x71], base_address as u64, 1);
+
+    let boundaries = instruction_boundaries(file, hunk_index, code.len());
+    let chunks = Arc::new(split_chunks(&boundaries, code.len(), worker_count * CHUNKS_PER_WORKER));
+    let code = Arc::new(code);
+    let next_chunk = Arc::new(AtomicUsize::new(0));
+    let (tx, rx) = channel();
+
+    let worker_count = worker_count.max(1).min(chunks.len());
+
+    for _ in 0..worker_count {
+        let mut worker_capstone = capstone.new_instance();
+        let chunks = chunks.clone();
+        let code = code.clone();
+        let next_chunk = next_chunk.clone();
+        let tx = tx.clone();
+
+        thread::spawn(move || {
+            let opened = open_capstone(&mut worker_capstone);
+
+            loop {
+                let index = next_chunk.fetch_add(1, Ordering::SeqCst);
+
+                if index >= chunks.len() {
+                    break;
+                }
+
+                let chunk = chunks[index];
+
+                // If the handle couldn't be opened the chunk is decoded when stitching instead
+                let lines = if opened {
+                    Some(decode_range(&worker_capstone, &code, base_address, chunk.start, chunk.end))
+                } else {
+                    None
+                };
+
+                if tx.send(ChunkResult { index: index, lines: lines }).is_err() {
+                    break;
+                }
+            }
+
+            worker_capstone.close();
+        });
+    }
+
+    drop(tx);
+
+    let mut results: Vec<Option<Vec<DisasmLine>>> = (0..chunks.len()).map(|_| None).collect();
+
+    for result in rx.iter() {
+        results[result.index] = result.lines;
+    }
+
+    let lines = stitch_chunks(&stitch_capstone, &code, base_address, &chunks, results);
+
+    stitch_capstone.close();
+
+    lines
+}
@@ -1,10 +1,11 @@
-extern crate byteorder;
+extern crate memmap;
 
 use std::fmt;
-use std::fs::File;
-use byteorder::{BigEndian, ReadBytesExt};
 use std::io;
-use std::io::{Error, ErrorKind, Seek, Read};
+
+mod mapped;
+
+pub use mapped::*;
 
 const HUNK_HEADER: u32 = 1011;
 // hunk types
@@ -38,8 +39,8 @@ pub struct RelocInfo32 {
 }
 
 pub struct Symbol {
-    name: String,
-    offset: u32,
+    pub name: String,
+    pub offset: u32,
 }
 
 impl fmt::Debug for Symbol {
@@ -85,18 +86,7 @@ pub enum MemoryType {
     Fast,
 }
 
-struct SizesTypes {
-    mem_type: MemoryType,
-    size: usize,
-}
-
 impl HunkParser {
-    fn skip_hunk(file: &mut File, name: &'static str) -> io::Result<()> {
-        println!("Skipping {}\n", name);
-        let seek_offset = try!(file.read_u32::<BigEndian>());
-        file.seek(io::SeekFrom::Current(seek_offset as i64)).map(|_|())
-    }
-
     fn get_size_type(t: u32) -> (usize, MemoryType) {
         let size = (t & 0x0fffffff) * 4;
         let mem_t = t & 0xf0000000;
@@ -109,230 +99,12 @@ impl HunkParser {
         (size as usize, mem_type)
     }
 
-    fn parse_bss(hunk: &mut Hunk, file: &mut File) -> io::Result<()> {
-        let (size, mem_type) = Self::get_size_type(try!(file.read_u32::<BigEndian>()));
-        hunk.hunk_type = HunkType::Bss;
-        hunk.data_size = size;
-        hunk.mem_type = mem_type;
-        Ok(())
-    }
-
-    fn parse_code_or_data(hunk_type: HunkType, hunk: &mut Hunk, file: &mut File) -> io::Result<()> {
-        let (size, mem_type) = Self::get_size_type(try!(file.read_u32::<BigEndian>()));
-        let mut code_data: Vec<u8> = vec![0; size];
-
-        hunk.data_size = size;
-        hunk.hunk_type = hunk_type;
-        hunk.mem_type = mem_type;
-
-        try!(file.read(&mut code_data));
-
-        hunk.code_data = Some(code_data);
-
-        Ok(())
-    }
-
-    fn find_string_end(name: &[u8]) -> usize {
-        for (i, val) in name.iter().enumerate() {
-            if *val == 0 {
-                return i;
-            }
-        }
-
-        name.len()
-    }
-
-    fn read_name_size(file: &mut File, num_longs: u32) -> io::Result<String> {
-        let len = num_longs * 4;
-        let mut temp_buffer: [u8; 512] = [0; 512];
-        let mut dest = &mut temp_buffer[..len as usize];
-        try!(file.read_exact(dest));
-        Ok(String::from_utf8_lossy(&dest[..Self::find_string_end(&dest)]).into_owned())
-        //Ok(String::from_utf8_lossy(&dest).into_owned())
-    }
-
-    /*
-    fn read_name(file: &mut File) -> Option<io::Result<String>> {
-        let num_longs = try!(file.read_u32::<BigEndian>());
-    }
-    */
-
-    fn parse_symbols(hunk: &mut Hunk, file: &mut File) -> io::Result<()> {
-        let mut symbols = Vec::new();
-
-        loop { 
-            let num_longs = try!(file.read_u32::<BigEndian>());
-
-            if num_longs == 0 {
-                break;
-            }
-
-            let symbol = Symbol {
-                name: try!(Self::read_name_size(file, num_longs)),
-                offset: try!(file.read_u32::<BigEndian>()),
-            };
-
-            symbols.push(symbol);
-        }
-
-        if symbols.len() > 0 {
-            symbols.sort_by(|a, b| a.offset.cmp(&b.offset));
-            hunk.symbols = Some(symbols);
-        }
-
-        Ok(())
-    }
-
-    fn fill_debug_info(base_offset: u32, num_longs: u32, file: &mut File) -> io::Result<SourceFile> {
-        let num_name_longs = try!(file.read_u32::<BigEndian>());
-        let name = try!(Self::read_name_size(file, num_name_longs));
-        let num_lines = (num_longs - num_name_longs - 1) / 2;
-        let mut lines = Vec::with_capacity(num_lines as usize);
-
-        for _ in 0..num_lines {
-            let line_no = try!(file.read_u32::<BigEndian>()) & 0xffffff; // mask for SAS/C extra info
-            let offset = try!(file.read_u32::<BigEndian>());
-            lines.push(SourceLine {
-                line: line_no,
-                offset: base_offset + offset,
-            });
-        }
-
-        Ok(SourceFile {
-            name: name,
-            base_offset: base_offset,
-            lines: lines,
-        })
-    }
-
-    fn parse_debug(hunk: &mut Hunk, file: &mut File) -> io::Result<()> {
-        let num_longs = try!(file.read_u32::<BigEndian>()) - 2; // skip base offset and tag
-        let base_offset = try!(file.read_u32::<BigEndian>());
-        let debug_tag = try!(file.read_u32::<BigEndian>());
-
-        // We only support debug line as debug format currently so skip if not found
-        if debug_tag != DEBUG_LINE {
-            try!(file.seek(io::SeekFrom::Current((num_longs * 4) as i64)).map(|_|()));
-            return Ok(());
-        }
-
-        if let Some(ref mut debug_info) = hunk.line_debug_info {
-            let source_file = try!(Self::fill_debug_info(base_offset, num_longs, file));
-            debug_info.push(source_file);
-        } else {
-            let mut debug_info = Vec::new();
-            let source_file = try!(Self::fill_debug_info(base_offset, num_longs, file));
-            debug_info.push(source_file);
-            hunk.line_debug_info = Some(debug_info);
-        }
-
-        return Ok(());
-    }
-
-    fn parse_reloc32(hunk: &mut Hunk, file: &mut File) -> io::Result<()> {
-        let mut relocs = Vec::<RelocInfo32>::new();  
-
-        loop {
-            let count = try!(file.read_u32::<BigEndian>()) as usize;
-
-            if count == 0 {
-                break;
-            }
-
-            let target = try!(file.read_u32::<BigEndian>()) as usize;
-
-            let mut reloc = RelocInfo32 {
-                target: target,
-                data: Vec::<u32>::with_capacity(count),
-            };
-
-            for _ in 0..count {
-                reloc.data.push(try!(file.read_u32::<BigEndian>()));
-            }
-
-            relocs.push(reloc);
-        }
-
-        hunk.reloc_32 = Some(relocs);
-
-        Ok(())
-    }
-
-    fn fill_hunk(hunk: &mut Hunk, file: &mut File) -> io::Result<()> {
-        loop {
-            let hunk_type = try!(file.read_u32::<BigEndian>());
-
-            match hunk_type {
-                HUNK_UNIT => { try!(Self::skip_hunk(file, "HUNK_UNIT")) }
-                HUNK_NAME => { try!(Self::skip_hunk(file, "HUNK_NAME")) }
-                HUNK_DEBUG => { try!(Self::parse_debug(hunk, file)) }
-                HUNK_CODE => { try!(Self::parse_code_or_data(HunkType::Code, hunk, file)) }
-                HUNK_DATA => { try!(Self::parse_code_or_data(HunkType::Data, hunk, file)) }
-                HUNK_BSS => { try!(Self::parse_bss(hunk, file)) }
-                HUNK_RELOC32 => { try!(Self::parse_reloc32(hunk, file)) }
-                HUNK_SYMBOL => { try!(Self::parse_symbols(hunk, file)) }
-                HUNK_END => {
-                    return Ok(());
-                }
-
-                _ => {
-                    println!("Unknown hunk type {:x}", hunk_type);
-                    return Err(Error::new(ErrorKind::Other, "Unsupported hunk"));
-                }
-            }
-        }
-    }
-
+    ///
+    /// Parses the whole file into owned hunks. Use MappedHunkFile directly to only decode the parts
+    /// that are needed.
+    ///
     pub fn parse_file(filename: &str) -> Result<Vec<Hunk>, io::Error> {
-        let mut file = try!(File::open(filename));
-
-        let hunk_header = try!(file.read_u32::<BigEndian>());
-        if hunk_header != HUNK_HEADER  {
-            return Err(Error::new(ErrorKind::Other, "Unable to find correct HUNK_HEADER"));
-        };
-
-        // Skip header/string section
-        try!(file.read_u32::<BigEndian>());
-
-        let table_size = try!(file.read_u32::<BigEndian>()) as i32;
-        let first_hunk = try!(file.read_u32::<BigEndian>()) as i32;
-        let last_hunk = try!(file.read_u32::<BigEndian>()) as i32;
-
-        if table_size < 0 || first_hunk < 0 || last_hunk < 0 {
-            return Err(Error::new(ErrorKind::Other, "Invalid sizes for hunks"));
-        }
-
-        let hunk_count = (last_hunk - first_hunk + 1) as usize;
-
-        let mut hunk_table = Vec::with_capacity(hunk_count);
-
-        for _ in 0..hunk_count {
-            let (size, mem_type) = Self::get_size_type(try!(file.read_u32::<BigEndian>()));
-            hunk_table.push(SizesTypes {
-                mem_type: mem_type,
-                size: size 
-            });
-        }
-
-        let mut hunks = Vec::with_capacity(hunk_count);
-
-        for i in 0..hunk_count {
-            let mut hunk = Hunk {
-                mem_type: hunk_table[i].mem_type, 
-                    hunk_type: HunkType::Bss,
-                    alloc_size: hunk_table[i].size as usize,
-                    data_size: 0,
-                    code_data: None, 
-                    reloc_32: None, 
-                    symbols: None, 
-                    line_debug_info: None,
-            };
-
-            try!(Self::fill_hunk(&mut hunk, &mut file));
-
-            hunks.push(hunk);
-        }
-
-        Ok(hunks)
+        let file = try!(MappedHunkFile::open(filename));
+        Ok(file.to_hunks())
     }
 }
@@ -0,0 +1,490 @@
+use std::borrow::Cow;
+use std::fs::File;
+use std::io;
+use std::io::{Error, ErrorKind, Read};
+use std::ops::Range;
+use std::path::Path;
+use memmap::{Mmap, Protection};
+use super::*;
+
+///
+/// Location of the different blocks for a hunk inside the file. Only the boundaries are found when
+/// opening the file, the content is decoded when accessed.
+///
+pub struct MappedHunk {
+    pub mem_type: MemoryType,
+    pub hunk_type: HunkType,
+    pub alloc_size: usize,
+    pub data_size: usize,
+    code_data: Option<Range<usize>>,
+    reloc_32: Vec<Range<usize>>,
+    symbols: Vec<Range<usize>>,
+    line_debug_info: Vec<Range<usize>>,
+}
+
+// A mapping is only meant to be kept for a short while. If the file is rewritten while it's mapped accessing it
+// gives SIGBUS (and on Windows the file can't be rewritten at all) so files that are kept around are read instead
+
+enum FileData {
+    Mapped(Mmap),
+    Read(Vec<u8>),
+}
+
+///
+/// Hunk executable that is memory mapped (or read in one go) instead of parsed into owned hunks.
+/// Opening the file only does a single pass over it to find where all the blocks are. Code,
+/// relocations, symbols and line info are decoded on access and borrow from the file data.
+///
+pub struct MappedHunkFile {
+    data: FileData,
+    hunks: Vec<MappedHunk>,
+}
+
+#[inline]
+fn get_u32(data: &[u8], offset: usize) -> u32 {
+    let d = &data[offset..offset + 4];
+    ((d[0] as u32) << 24) | ((d[1] as u32) << 16) | ((d[2] as u32) << 8) | (d[3] as u32)
+}
+
+fn unexpected_eof() -> Error {
+    Error::new(ErrorKind::UnexpectedEof, "Hunk file is truncated")
+}
+
+// Cursor over the mapped data that checks the bounds on each read
+
+struct Cursor<'a> {
+    data: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Cursor<'a> {
+    fn read_u32(&mut self) -> io::Result<u32> {
+        if self.pos + 4 > self.data.len() {
+            return Err(unexpected_eof());
+        }
+
+        let v = get_u32(self.data, self.pos);
+        self.pos += 4;
+        Ok(v)
+    }
+
+    fn skip_longs(&mut self, count: u32) -> io::Result<()> {
+        let size = count as usize * 4;
+
+        if self.pos + size > self.data.len() {
+            return Err(unexpected_eof());
+        }
+
+        self.pos += size;
+        Ok(())
+    }
+
+    fn range_longs(&mut self, count: u32) -> io::Result<Range<usize>> {
+        let start = self.pos;
+        try!(self.skip_longs(count));
+        Ok(start..self.pos)
+    }
+}
+
+/// Big endian u32 values stored directly in the file (such as the offsets for a relocation)
+#[derive(Clone)]
+pub struct U32Iter<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> Iterator for U32Iter<'a> {
+    type Item = u32;
+
+    fn next(&mut self) -> Option<u32> {
+        if self.data.len() < 4 {
+            return None;
+        }
+
+        let v = get_u32(self.data, 0);
+        self.data = &self.data[4..];
+        Some(v)
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        let len = self.data.len() / 4;
+        (len, Some(len))
+    }
+}
+
+pub struct MappedReloc32<'a> {
+    pub target: usize,
+    pub offsets: U32Iter<'a>,
+}
+
+pub struct MappedSymbol<'a> {
+    pub name: Cow<'a, str>,
+    pub offset: u32,
+}
+
+pub struct MappedSourceFile<'a> {
+    pub name: Cow<'a, str>,
+    pub base_offset: u32,
+    lines: &'a [u8],
+}
+
+impl<'a> MappedSourceFile<'a> {
+    pub fn line_count(&self) -> usize {
+        self.lines.len() / 8
+    }
+
+    /// Lines with the offset adjusted with base_offset (same as SourceFile)
+    pub fn lines(&self) -> LineIter<'a> {
+        LineIter {
+            data: self.lines,
+            base_offset: self.base_offset,
+        }
+    }
+}
+
+pub struct LineIter<'a> {
+    data: &'a [u8],
+    base_offset: u32,
+}
+
+impl<'a> Iterator for LineIter<'a> {
+    type Item = SourceLine;
+
+    fn next(&mut self) -> Option<SourceLine> {
+        if self.data.len() < 8 {
+            return None;
+        }
+
+        let line = get_u32(self.data, 0) & 0xffffff; // mask for SAS/C extra info
+        let offset = get_u32(self.data, 4);
+        self.data = &self.data[8..];
+
+        Some(SourceLine {
+            line: line,
+            offset: self.base_offset + offset,
+        })
+    }
+}
+
+fn name_from_bytes(name: &[u8]) -> Cow<str> {
+    let end = name.iter().position(|c| *c == 0).unwrap_or(name.len());
+    String::from_utf8_lossy(&name[..end])
+}
+
+impl MappedHunkFile {
+    /// Maps the file. Use this when the file is only needed for a short while
+    pub fn open<P: AsRef<Path>>(path: P) -> io::Result<MappedHunkFile> {
+        let map = try!(Mmap::open_path(path, Protection::Read));
+        let hunks = try!(Self::index_hunks(unsafe { map.as_slice() }));
+
+        Ok(MappedHunkFile {
+            data: FileData::Mapped(map),
+            hunks: hunks,
+        })
+    }
+
+    /// Reads the file into memory. Use this when the file is kept (such as for a whole debug session) so the
+    /// file can be rebuilt while it's in use
+    pub fn read<P: AsRef<Path>>(path: P) -> io::Result<MappedHunkFile> {
+        let mut data = Vec::new();
+        try!(try!(File::open(path)).read_to_end(&mut data));
+        let hunks = try!(Self::index_hunks(&data));
+
+        Ok(MappedHunkFile {
+            data: FileData::Read(data),
+            hunks: hunks,
+        })
+    }
+
+    fn index_block(hunk: &mut MappedHunk, cursor: &mut Cursor) -> io::Result<bool> {
+        let hunk_type = try!(cursor.read_u32());
+
+        match hunk_type {
+            HUNK_UNIT | HUNK_NAME => {
+                let num_longs = try!(cursor.read_u32());
+                try!(cursor.skip_longs(num_longs));
+            }
+
+            HUNK_CODE | HUNK_DATA => {
+                let (size, mem_type) = HunkParser::get_size_type(try!(cursor.read_u32()));
+                hunk.hunk_type = if hunk_type == HUNK_CODE { HunkType::Code } else { HunkType::Data };
+                hunk.mem_type = mem_type;
+                hunk.data_size = size;
+                hunk.code_data = Some(try!(cursor.range_longs((size / 4) as u32)));
+            }
+
+            HUNK_BSS => {
+                let (size, mem_type) = HunkParser::get_size_type(try!(cursor.read_u32()));
+                hunk.hunk_type = HunkType::Bss;
+                hunk.mem_type = mem_type;
+                hunk.data_size = size;
+            }
+
+            HUNK_RELOC32 => {
+                let start = cursor.pos;
+
+                loop {
+                    let count = try!(cursor.read_u32());
+
+                    if count == 0 {
+                        break;
+                    }
+
+                    // target
+                    try!(cursor.read_u32());
+                    try!(cursor.skip_longs(count));
+                }
+
+                hunk.reloc_32.push(start..cursor.pos);
+            }
+
+            HUNK_SYMBOL => {
+                let start = cursor.pos;
+
+                loop {
+                    let num_longs = try!(cursor.read_u32());
+
+                    if num_longs == 0 {
+                        break;
+                    }
+
+                    try!(cursor.skip_longs(num_longs));
+                    // offset
+                    try!(cursor.read_u32());
+                }
+
+                hunk.symbols.push(start..cursor.pos);
+            }
+
+            HUNK_DEBUG => {
+                let num_longs = try!(cursor.read_u32());
+                let range = try!(cursor.range_longs(num_longs));
+
+                // We only support debug line as debug format currently so skip if not found
+                if num_longs >= 3 && get_u32(cursor.data, range.start + 4) == DEBUG_LINE {
+                    hunk.line_debug_info.push(range);
+                }
+            }
+
+            HUNK_END => return Ok(false),
+
+            _ => {
+                println!("Unknown hunk type {:x}", hunk_type);
+                return Err(Error::new(ErrorKind::Other, "Unsupported hunk"));
+            }
+        }
+
+        Ok(true)
+    }
+
+    fn index_hunks(data: &[u8]) -> io::Result<Vec<MappedHunk>> {
+        let mut cursor = Cursor {
+            data: data,
+            pos: 0,
+        };
+
+        if try!(cursor.read_u32()) != HUNK_HEADER {
+            return Err(Error::new(ErrorKind::Other, "Unable to find correct HUNK_HEADER"));
+        }
+
+        // Skip header/string section
+        try!(cursor.read_u32());
+
+        let table_size = try!(cursor.read_u32()) as i32;
+        let first_hunk = try!(cursor.read_u32()) as i32;
+        let last_hunk = try!(cursor.read_u32()) as i32;
+
+        if table_size < 0 || first_hunk < 0 || last_hunk < first_hunk {
+            return Err(Error::new(ErrorKind::Other, "Invalid sizes for hunks"));
+        }
+
+        let hunk_count = (last_hunk - first_hunk + 1) as usize;
+        let mut hunks = Vec::with_capacity(hunk_count);
+
+        for _ in 0..hunk_count {
+            let (size, mem_type) = HunkParser::get_size_type(try!(cursor.read_u32()));
+
+            hunks.push(MappedHunk {
+                mem_type: mem_type,
+                hunk_type: HunkType::Bss,
+                alloc_size: size,
+                data_size: 0,
+                code_data: None,
+                reloc_32: Vec::new(),
+                symbols: Vec::new(),
+                line_debug_info: Vec::new(),
+            });
+        }
+
+        for hunk in hunks.iter_mut() {
+            while try!(Self::index_block(hunk, &mut cursor)) {}
+        }
+
+        Ok(hunks)
+    }
+
+    /// The raw content of the whole file
+    #[inline]
+    pub fn data(&self) -> &[u8] {
+        match self.data {
+            FileData::Mapped(ref map) => unsafe { map.as_slice() },
+            FileData::Read(ref data) => data,
+        }
+    }
+
+    pub fn hunks(&self) -> &[MappedHunk] {
+        &self.hunks
+    }
+
+    pub fn code_data(&self, hunk: usize) -> Option<&[u8]> {
+        self.hunks[hunk].code_data.as_ref().map(|r| &self.data()[r.clone()])
+    }
+
+    pub fn relocs<'a>(&'a self, hunk: usize) -> Vec<MappedReloc32<'a>> {
+        let data = self.data();
+        let mut relocs = Vec::new();
+
+        for range in &self.hunks[hunk].reloc_32 {
+            let mut pos = range.start;
+
+            // Ranges have been validated when indexing so no need to check bounds here
+            loop {
+                let count = get_u32(data, pos) as usize;
+
+                if count == 0 {
+                    break;
+                }
+
+                let target = get_u32(data, pos + 4) as usize;
+                let start = pos + 8;
+                pos = start + count * 4;
+
+                relocs.push(MappedReloc32 {
+                    target: target,
+                    offsets: U32Iter { data: &data[start..pos] },
+                });
+            }
+        }
+
+        relocs
+    }
+
+    /// Symbols in the order they are stored in the file
+    pub fn symbols<'a>(&'a self, hunk: usize) -> Vec<MappedSymbol<'a>> {
+        let data = self.data();
+        let mut symbols = Vec::new();
+
+        for range in &self.hunks[hunk].symbols {
+            let mut pos = range.start;
+
+            loop {
+                let num_longs = get_u32(data, pos) as usize;
+
+                if num_longs == 0 {
+                    break;
+                }
+
+                let name_start = pos + 4;
+                pos = name_start + num_longs * 4;
+
+                symbols.push(MappedSymbol {
+                    name: name_from_bytes(&data[name_start..pos]),
+                    offset: get_u32(data, pos),
+                });
+
+                pos += 4;
+            }
+        }
+
+        symbols
+    }
+
+    pub fn source_files<'a>(&'a self, hunk: usize) -> Vec<MappedSourceFile<'a>> {
+        let data = self.data();
+        let mut files = Vec::new();
+
+        for range in &self.hunks[hunk].line_debug_info {
+            let block = &data[range.clone()];
+
+            // base offset, tag, name size, name, (line, offset) pairs
+            let base_offset = get_u32(block, 0);
+            let num_name_longs = get_u32(block, 8) as usize;
+            let name_end = 12 + num_name_longs * 4;
+
+            if name_end > block.len() {
+                continue;
+            }
+
+            let lines = &block[name_end..];
+
+            files.push(MappedSourceFile {
+                name: name_from_bytes(&block[12..name_end]),
+                base_offset: base_offset,
+                lines: &lines[..lines.len() & !7],
+            });
+        }
+
+        files
+    }
+
+    ///
+    /// Decodes everything into owned hunks (same result as HunkParser::parse_file)
+    ///
+    pub fn to_hunks(&self) -> Vec<Hunk> {
+        let mut hunks = Vec::with_capacity(self.hunks.len());
+
+        for (index, mapped) in self.hunks.iter().enumerate() {
+            let relocs = self.relocs(index);
+            let mut symbols = self.symbols(index);
+            let source_files = self.source_files(index);
+
+            symbols.sort_by(|a, b| a.offset.cmp(&b.offset));
+
+            hunks.push(Hunk {
+                mem_type: mapped.mem_type,
+                hunk_type: mapped.hunk_type,
+                alloc_size: mapped.alloc_size,
+                data_size: mapped.data_size,
+                code_data: self.code_data(index).map(|d| d.to_vec()),
+                reloc_32: if mapped.reloc_32.len() > 0 {
+                    Some(relocs.into_iter()
+                        .map(|r| {
+                            RelocInfo32 {
+                                target: r.target,
+                                data: r.offsets.collect(),
+                            }
+                        })
+                        .collect())
+                } else {
+                    None
+                },
+                symbols: if symbols.len() > 0 {
+                    Some(symbols.into_iter()
+                        .map(|s| {
+                            Symbol {
+                                name: s.name.into_owned(),
+                                offset: s.offset,
+                            }
+                        })
+                        .collect())
+                } else {
+                    None
+                },
+                line_debug_info: if source_files.len() > 0 {
+                    Some(source_files.into_iter()
+                        .map(|f| {
+                            SourceFile {
+                                lines: f.lines().collect(),
+                                name: f.name.into_owned(),
+                                base_offset: f.base_offset,
+                            }
+                        })
+                        .collect())
+                } else {
+                    None
+                },
+            });
+        }
+
+        hunks
+    }
+}
@@ -1,4 +1,5 @@
 use std::str;
+use WatchKind;
 
 pub struct IncomingResult<'a> {
     pub data: &'a [u8],
@@ -21,6 +22,46 @@ impl<'a> IncomingResult<'a> {
 
         Some(&self.data[len..])
     }
+
+    /// Returns the signal if this is a stop reply (S or T packet)
+    pub fn stop_signal(&self) -> Option<u8> {
+        if self.data.len() < 3 || (self.data[0] != b'S' && self.data[0] != b'T') {
+            return None;
+        }
+
+        Self::parse_hex(&self.data[1..3]).map(|signal| signal as u8)
+    }
+
+    /// If this is a T stop reply caused by a watchpoint the kind of watchpoint and the address that was accessed is
+    /// returned. Looks like "T05watch:0001f000;thread:1;"
+    pub fn stop_watchpoint(&self) -> Option<(WatchKind, u64)> {
+        if self.data.len() < 3 || self.data[0] != b'T' {
+            return None;
+        }
+
+        for pair in self.data[3..].split(|c| *c == b';') {
+            let mut parts = pair.splitn(2, |c| *c == b':');
+            let (name, value) = match (parts.next(), parts.next()) {
+                (Some(name), Some(value)) => (name, value),
+                _ => continue,
+            };
+
+            let kind = match name {
+                b"watch" => WatchKind::Write,
+                b"rwatch" => WatchKind::Read,
+                b"awatch" => WatchKind::Access,
+                _ => continue,
+            };
+
+            return Self::parse_hex(value).map(|address| (kind, address));
+        }
+
+        None
+    }
+
+    fn parse_hex(data: &[u8]) -> Option<u64> {
+        str::from_utf8(data).ok().and_then(|text| u64::from_str_radix(text, 16).ok())
+    }
 }
 
 #[cfg(test)]
@@ -47,6 +88,28 @@ mod tests {
         assert_eq!(true, res.begins_with("S10").is_some());
     }
 
+    #[test]
+    fn test_stop_signal() {
+        assert_eq!(IncomingResult { data: b"S05" }.stop_signal(), Some(5));
+        assert_eq!(IncomingResult { data: b"T0bthread:1;" }.stop_signal(), Some(11));
+        assert_eq!(IncomingResult { data: b"OK" }.stop_signal(), None);
+    }
+
+    #[test]
+    fn test_stop_watchpoint() {
+        let res = IncomingResult { data: b"T05thread:1;watch:0001f000;" };
+        assert_eq!(res.stop_watchpoint(), Some((WatchKind::Write, 0x1f000)));
+
+        let res = IncomingResult { data: b"T05rwatch:10" };
+        assert_eq!(res.stop_watchpoint(), Some((WatchKind::Read, 0x10)));
+
+        let res = IncomingResult { data: b"T05awatch:dff180;" };
+        assert_eq!(res.stop_watchpoint(), Some((WatchKind::Access, 0xdff180)));
+
+        assert!(IncomingResult { data: b"T05thread:1;" }.stop_watchpoint().is_none());
+        assert!(IncomingResult { data: b"S05" }.stop_watchpoint().is_none());
+    }
+
     #[test]
     fn test_bad_data() {
         let res = IncomingResult { data: &[0,244,239] };
@@ -1,12 +1,17 @@
 pub mod incoming_result;
+pub mod search;
 
 use std::net::{TcpStream, ToSocketAddrs};
 use std::io::{Read, Write};
 use std::io;
+use std::cmp;
+use std::collections::VecDeque;
 use std::time::Duration;
 use incoming_result::IncomingResult;
 use std::str;
 
+pub use search::MemorySearch;
+
 #[cfg(target_os = "windows")]
 use std::os::windows::io::AsRawSocket;
 
@@ -27,10 +32,20 @@ pub enum NeedsAck {
 pub struct GdbRemote {
     pub stream: Option<TcpStream>,
     temp_data: Vec<u8>,
+    // Data read from the stream that is part of a packet that read_packet hasn't returned yet
+    packet_data: Vec<u8>,
     temp_string: String,
     needs_ack: NeedsAck,
 }
 
+/// Access a watchpoint stops on. The values are the types used in the Z/z packets
+#[derive(Clone, Copy, PartialEq, Debug)]
+pub enum WatchKind {
+    Write = 2,
+    Read = 3,
+    Access = 4,
+}
+
 pub struct Memory {
     pub address: u64,
     pub data: Vec<u8>
@@ -47,6 +62,8 @@ extern "C" {
 }
 
 const PACKET_SIZE: usize = 1024;
+// Number of memory reads search_memory keeps in flight when acks are off
+const SEARCH_PIPELINE_DEPTH: usize = 16;
 static HEX_CHARS: &'static [u8; 16] = b"0123456789abcdef";
 static HEX_TO_BYTE: [u8; 256] = [
     0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
@@ -120,6 +137,7 @@ impl GdbRemote {
             needs_ack: NeedsAck::Yes,
             temp_string: String::with_capacity(PACKET_SIZE + 4), // + 4 for header and checksum
             temp_data: Vec::with_capacity(16 * 1024), // 16 temp buffer for incoming data
+            packet_data: Vec::with_capacity(PACKET_SIZE * 2),
             stream: None,
             //hex_to_byte: build_hex_to_byte_table(),
         }
@@ -359,6 +377,147 @@ impl GdbRemote {
         Ok(trans_size as usize)
     }
 
+    /// Reads one packet into dest (without the $ and checksum). Unlike read_reply this handles more than one packet
+    /// arriving in the same read, which happens when several requests are in flight. Returns false if the reply was
+    /// a nak or a packet with a broken checksum. Both still answer one request so the stream stays in step with the
+    /// requests; errors are only given when reading from the stream fails
+    fn read_packet(&mut self, dest: &mut Vec<u8>) -> io::Result<bool> {
+        let mut temp_buffer = [0; PACKET_SIZE];
+
+        loop {
+            let acks = self.packet_data.iter().take_while(|b| **b == b'+').count();
+            self.packet_data.drain(..acks);
+
+            if !self.packet_data.is_empty() && self.packet_data[0] == b'-' {
+                self.packet_data.drain(..1);
+                dest.clear();
+                return Ok(false);
+            }
+
+            // Anything else outside of a packet is skipped
+            if !self.packet_data.is_empty() && self.packet_data[0] != b'$' {
+                let junk = self.packet_data.iter().position(|b| *b == b'$' || *b == b'+' || *b == b'-');
+                let junk = junk.unwrap_or(self.packet_data.len());
+                self.packet_data.drain(..junk);
+                continue;
+            }
+
+            if let Some(end) = self.packet_data.iter().position(|b| *b == b'#') {
+                if self.packet_data.len() >= end + 3 {
+                    let checksum = from_pair_hex((self.packet_data[end + 1], self.packet_data[end + 2]));
+                    let valid = calc_checksum(&self.packet_data[1..end]) == checksum;
+
+                    dest.clear();
+                    dest.extend_from_slice(&self.packet_data[1..end]);
+                    self.packet_data.drain(..end + 3);
+
+                    return Ok(valid);
+                }
+            }
+
+            let len = match self.stream {
+                Some(ref mut stream) => try!(stream.read(&mut temp_buffer)),
+                None => return Err(io::Error::new(io::ErrorKind::NotConnected, "No connection with a server.")),
+            };
+
+            if len == 0 {
+                self.stream = None;
+                return Err(io::Error::new(io::ErrorKind::ConnectionAborted, "Disconnected from server."));
+            }
+
+            self.packet_data.extend_from_slice(&temp_buffer[..len]);
+        }
+    }
+
+    /// Searches [start, end) for the pattern and adds the addresses of the matches to matches, stopping when it has
+    /// max_count entries. The memory is read in packet sized chunks that are scanned as they arrive so only the
+    /// matches are kept, and with acks off several reads are kept in flight to hide the round trip to the target.
+    /// Memory that can't be read is skipped. A broken reply (bad checksum or a nak) stops the search with an error
+    /// once the replies to the reads still in flight have been read. If reading from the stream fails the connection
+    /// is dropped as those replies would otherwise be taken as the replies to the next commands.
+    pub fn search_memory(&mut self, search: &MemorySearch, start: u64, end: u64, matches: &mut Vec<u64>,
+                         max_count: usize) -> io::Result<()> {
+        match self.search_memory_pipelined(search, start, end, matches, max_count) {
+            Ok(true) => Ok(()),
+            Ok(false) => Err(io::Error::new(io::ErrorKind::InvalidData, "Broken reply from server while searching.")),
+            Err(err) => {
+                self.stream = None;
+                self.packet_data.clear();
+                Err(err)
+            }
+        }
+    }
+
+    /// Returns false if a reply was broken
+    fn search_memory_pipelined(&mut self, search: &MemorySearch, start: u64, end: u64, matches: &mut Vec<u64>,
+                               max_count: usize) -> io::Result<bool> {
+        let size_per_loop = ((PACKET_SIZE - 4) / 2) as u64;
+        let depth = if self.needs_ack == NeedsAck::No { SEARCH_PIPELINE_DEPTH } else { 1 };
+        let mut in_flight = VecDeque::with_capacity(depth);
+        let mut reply = Vec::with_capacity(PACKET_SIZE);
+        // Chunks read so far that a match can still start in
+        let mut window = Vec::with_capacity(size_per_loop as usize + search.size());
+        let mut window_address = start;
+        let mut addr = start;
+        let mut broken = false;
+
+        loop {
+            while !broken && addr < end && in_flight.len() < depth && matches.len() < max_count {
+                let size = cmp::min(end - addr, size_per_loop);
+                // TODO: This allocates memory, would be nice to format to existing string.
+                let mem_req = format!("m{:x},{:x}", addr, size);
+                try!(self.send_command(&mem_req));
+                in_flight.push_back((addr, size));
+                addr += size;
+            }
+
+            let (chunk_address, chunk_size) = match in_flight.pop_front() {
+                Some(chunk) => chunk,
+                None => break,
+            };
+
+            // Replies to reads that are still in flight when all matches are found or a reply is broken are just
+            // skipped
+            if !try!(self.read_packet(&mut reply)) {
+                broken = true;
+            }
+
+            if broken || matches.len() >= max_count {
+                continue;
+            }
+
+            // Errors and short replies leave a gap that a match can't span
+            let valid = if reply.len() == 3 && reply[0] == b'E' {
+                0
+            } else {
+                cmp::min(reply.len() / 2, chunk_size as usize)
+            };
+
+            if window_address + window.len() as u64 != chunk_address {
+                window.clear();
+                window_address = chunk_address;
+            }
+
+            let old_len = window.len();
+            window.resize(old_len + valid, 0);
+            Self::convert_hex_data_to_binary(&mut window[old_len..], &reply[..valid * 2]);
+
+            search.scan(&window, window_address, matches, max_count);
+
+            if valid < chunk_size as usize {
+                window.clear();
+                window_address = chunk_address + chunk_size;
+            } else {
+                let keep = cmp::min(window.len(), search.size() - 1);
+                let drop = window.len() - keep;
+                window.drain(..drop);
+                window_address += drop as u64;
+            }
+        }
+
+        Ok(!broken)
+    }
+
     pub fn set_breakpoint_at_address(&mut self, address: u64) -> io::Result<usize> {
         let mut temp_buffer = [0; PACKET_SIZE];
         // TODO: This allocates memory, would be nice to format to existing string.
@@ -373,6 +532,31 @@ impl GdbRemote {
         self.send_command_wait_reply_raw(&mut temp_buffer, &breakpoint_req)
     }
 
+    /// Asks the target to stop when any byte in the range is accessed. Gives an error if the target replies with
+    /// anything else than OK (an empty reply means that the target doesn't support this kind of watchpoint)
+    pub fn set_watchpoint(&mut self, kind: WatchKind, address: u64, size: u64) -> io::Result<()> {
+        self.send_watchpoint_request(b'Z', kind, address, size)
+    }
+
+    pub fn remove_watchpoint(&mut self, kind: WatchKind, address: u64, size: u64) -> io::Result<()> {
+        self.send_watchpoint_request(b'z', kind, address, size)
+    }
+
+    fn send_watchpoint_request(&mut self, packet: u8, kind: WatchKind, address: u64, size: u64) -> io::Result<()> {
+        let mut temp_buffer = [0; PACKET_SIZE];
+        // TODO: This allocates memory, would be nice to format to existing string.
+        let watchpoint_req = format!("{}{},{:x},{:x}", packet as char, kind as u8, address, size);
+        let len = try!(self.send_command_wait_reply_raw(&mut temp_buffer, &watchpoint_req));
+
+        if len >= 2 && temp_buffer[0] == b'O' && temp_buffer[1] == b'K' {
+            Ok(())
+        } else if len == 0 {
+            Err(io::Error::new(io::ErrorKind::Other, "Watchpoint not supported by target"))
+        } else {
+            Err(io::Error::new(io::ErrorKind::Other, "Unable to set watchpoint"))
+        }
+    }
+
     fn clone_slice(dst: &mut [u8], src: &[u8]) {
         for (d, s) in dst.iter_mut().zip(src.iter()) {
             *d = *s;
@@ -497,9 +681,21 @@ mod tests {
         }
     }
 
+    fn next_packet(pending: &mut Vec<u8>, dest: &mut [u8]) -> Option<usize> {
+        let end = match pending.iter().position(|b| *b == b'#') {
+            Some(end) if pending.len() >= end + 3 => end + 3,
+            _ => return None,
+        };
+
+        dest[..end].copy_from_slice(&pending[..end]);
+        pending.drain(..end);
+        Some(end)
+    }
+
     fn server(mut stream: TcpStream, state: &Arc<Mutex<u32>>) {
         let mut temp_send_data = [0; 4096];
         let mut buffer = [0; 2048];
+        let mut pending = Vec::new();
         let value = get_mutex_value(state);
         let mut needs_ack = NeedsAck::Yes;
 
@@ -564,11 +760,15 @@ mod tests {
                 break;
             }
 
-            let len = stream.read(&mut buffer).unwrap();
-
-            if len == 0 {
-                continue;
-            }
+            // Requests can be pipelined so a read may have more than one packet in it. They are handled one at a time
+            let len = match next_packet(&mut pending, &mut buffer) {
+                Some(len) => len,
+                None => {
+                    let len = stream.read(&mut buffer).unwrap();
+                    pending.extend_from_slice(&buffer[..len]);
+                    continue;
+                }
+            };
 
             let data = get_string_from_buf_trim(&buffer, len);
 
@@ -603,11 +803,19 @@ mod tests {
                             let mut dest = String::new();
                             let (addr, size) = parse_memory_req(&data);
 
-                            // Reply error back if we can't read from here
-                            if addr >= 4096 {
+                            // Reads from here are rejected
+                            if addr >= 12288 {
+                                stream.write_all(b"-").unwrap();
+                            } else if addr >= 8192 {
+                                // Replies from here have a broken checksum
+                                stream.write_all(b"$00#00").unwrap();
+                            } else if addr >= 4096 {
+                                // Reply error back if we can't read from here
                                 GdbRemote::build_processed_string(&mut dest, "E01");
                                 stream.write_all(dest.as_bytes()).unwrap();
                             } else {
+                                // Only what is there is sent back if the read goes past the end
+                                let size = if addr + size > 4096 { 4096 - addr } else { size };
                                 convert_binary_to_hex_data(&mut buffer, &temp_send_data[addr..addr+size]);
                                 // * 2 in size here because converted from binary -> hex
                                 GdbRemote::build_processed_string(&mut dest, str::from_utf8(&buffer[..size*2]).unwrap());
@@ -627,15 +835,16 @@ mod tests {
                             stream.write_all(dest.as_bytes()).unwrap();
                         }
 
-                        b'z' => {
+                        b'z' | b'Z' => {
                             let mut dest = String::new();
-                            GdbRemote::build_processed_string(&mut dest, "OK");
-                            stream.write_all(dest.as_bytes()).unwrap();
-                        }
 
-                        b'Z' => {
-                            let mut dest = String::new();
-                            GdbRemote::build_processed_string(&mut dest, "OK");
+                            // Only breakpoints and write watchpoints are supported
+                            if buffer[2] == b'0' || buffer[2] == b'2' {
+                                GdbRemote::build_processed_string(&mut dest, "OK");
+                            } else {
+                                GdbRemote::build_processed_string(&mut dest, "");
+                            }
+
                             stream.write_all(dest.as_bytes()).unwrap();
                         }
 
@@ -962,6 +1171,80 @@ mod tests {
         update_mutex(&lock, SHOULD_QUIT);
     }
 
+    #[test]
+    fn test_set_watchpoint() {
+        let port = 6817u16;
+        let lock = Arc::new(Mutex::new(0));
+        let thread_lock = lock.clone();
+
+        thread::spawn(move || { setup_listener(&thread_lock, READ_DATA, port) });
+        wait_for_thread_init(&lock);
+
+        let mut gdb = GdbRemote::new();
+        gdb.connect(("127.0.0.1", port)).unwrap();
+        gdb.set_watchpoint(WatchKind::Write, 0x4444, 4).unwrap();
+        gdb.remove_watchpoint(WatchKind::Write, 0x4444, 4).unwrap();
+
+        // Server only supports write watchpoints
+        assert!(gdb.set_watchpoint(WatchKind::Read, 0x4444, 4).is_err());
+
+        update_mutex(&lock, SHOULD_QUIT);
+    }
+
+    #[test]
+    fn test_search_memory() {
+        let port = 6818u16;
+        let lock = Arc::new(Mutex::new(0));
+        let thread_lock = lock.clone();
+
+        thread::spawn(move || { setup_listener(&thread_lock, READ_DATA, port) });
+        wait_for_thread_init(&lock);
+
+        let mut gdb = GdbRemote::new();
+        gdb.connect(("127.0.0.1", port)).unwrap();
+
+        // Server memory is 0x00 - 0xff repeated over 4096 bytes. The pattern crosses the first read at 0x1fe
+        let search = MemorySearch::new(&[0xfd, 0xfe, 0xff], None, 1).unwrap();
+        let expected: Vec<u64> = (0..16).map(|i| 0xfd + i * 0x100).collect();
+
+        let mut matches = Vec::new();
+        gdb.search_memory(&search, 0, 0x1000, &mut matches, 1000).unwrap();
+        assert_eq!(matches, expected);
+
+        // With several reads in flight
+        gdb.request_no_ack_mode().unwrap();
+
+        matches.clear();
+        gdb.search_memory(&search, 0, 0x1000, &mut matches, 1000).unwrap();
+        assert_eq!(matches, expected);
+
+        // Stops at max_count and skips the replies still in flight
+        matches.clear();
+        gdb.search_memory(&search, 0, 0x1000, &mut matches, 2).unwrap();
+        assert_eq!(matches, vec![0xfd, 0x1fd]);
+
+        // Memory from 0x1000 can't be read
+        matches.clear();
+        gdb.search_memory(&search, 0xe00, 0x2000, &mut matches, 1000).unwrap();
+        assert_eq!(matches, vec![0xefd, 0xffd]);
+
+        // Replies from 0x2000 have a broken checksum and reads from 0x3000 are rejected. The search fails but the
+        // replies still in flight are read so the connection can still be used
+        matches.clear();
+        assert!(gdb.search_memory(&search, 0x1000, 0x3000, &mut matches, 1000).is_err());
+        assert!(gdb.is_connected());
+
+        matches.clear();
+        assert!(gdb.search_memory(&search, 0x2f00, 0x3100, &mut matches, 1000).is_err());
+        assert!(gdb.is_connected());
+
+        matches.clear();
+        gdb.search_memory(&search, 0, 0x1000, &mut matches, 1000).unwrap();
+        assert_eq!(matches, expected);
+
+        update_mutex(&lock, SHOULD_QUIT);
+    }
+
     #[test]
     fn test_read_incoming() {
         let port = 6816u16;
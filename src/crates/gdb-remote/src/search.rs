@@ -0,0 +1,213 @@
+use std::os::raw::{c_int, c_void};
+
+extern "C" {
+    fn memchr(s: *const c_void, c: c_int, n: usize) -> *mut c_void;
+}
+
+/// Max size of the pattern (and mask)
+pub const MAX_PATTERN_SIZE: usize = 256;
+
+/// Byte pattern to search memory for. Only the bits set in the mask are compared and matches have to start at an
+/// address that is a multiple of the alignment. Values (8/16/32/64 bit) are searched for as a pattern in target
+/// byte order with the alignment set to the size of the value.
+///
+/// This works the same way as PDSearch in pd_search.h: one byte of the pattern (the anchor) is searched for with
+/// memchr and the full pattern is only compared where it was found. The anchor is a byte that is compared in full
+/// and if possible one that is rare in memory (not 0x00 or 0xff)
+pub struct MemorySearch {
+    pattern: Vec<u8>,
+    mask: Option<Vec<u8>>,
+    alignment: u64,
+    anchor: Option<usize>,
+}
+
+impl MemorySearch {
+    pub fn new(pattern: &[u8], mask: Option<&[u8]>, alignment: u64) -> Option<MemorySearch> {
+        let alignment = if alignment == 0 { 1 } else { alignment };
+
+        if pattern.is_empty() || pattern.len() > MAX_PATTERN_SIZE || !alignment.is_power_of_two() {
+            return None;
+        }
+
+        if let Some(mask) = mask {
+            if mask.len() != pattern.len() {
+                return None;
+            }
+        }
+
+        let mut anchor = None;
+
+        for (i, byte) in pattern.iter().enumerate() {
+            if let Some(mask) = mask {
+                if mask[i] != 0xff {
+                    continue;
+                }
+            }
+
+            if anchor.is_none() {
+                anchor = Some(i);
+            }
+
+            if *byte != 0x00 && *byte != 0xff {
+                anchor = Some(i);
+                break;
+            }
+        }
+
+        Some(MemorySearch {
+            pattern: pattern.to_vec(),
+            mask: mask.map(|m| m.to_vec()),
+            alignment: alignment,
+            anchor: anchor,
+        })
+    }
+
+    pub fn size(&self) -> usize {
+        self.pattern.len()
+    }
+
+    fn matches_at(&self, data: &[u8]) -> bool {
+        match self.mask {
+            Some(ref mask) => {
+                data.iter()
+                    .zip(self.pattern.iter().zip(mask.iter()))
+                    .all(|(d, (p, m))| (d ^ p) & m == 0)
+            }
+            None => data[..self.pattern.len()] == self.pattern[..],
+        }
+    }
+
+    fn find_byte(data: &[u8], byte: u8) -> Option<usize> {
+        if data.is_empty() {
+            return None;
+        }
+
+        unsafe {
+            let p = memchr(data.as_ptr() as *const c_void, byte as c_int, data.len());
+
+            if p.is_null() {
+                None
+            } else {
+                Some(p as usize - data.as_ptr() as usize)
+            }
+        }
+    }
+
+    /// Adds the addresses of the matches fully inside data (which is at address in the target) to matches. Stops
+    /// when matches has max_count entries
+    pub fn scan(&self, data: &[u8], address: u64, matches: &mut Vec<u64>, max_count: usize) {
+        let align_mask = self.alignment - 1;
+        let size = self.pattern.len();
+
+        if data.len() < size || matches.len() >= max_count {
+            return;
+        }
+
+        let last = data.len() - size;
+
+        let anchor = match self.anchor {
+            Some(anchor) => anchor,
+            None => {
+                let mut offset = ((self.alignment - (address & align_mask)) & align_mask) as usize;
+
+                while offset <= last {
+                    if self.matches_at(&data[offset..]) {
+                        matches.push(address + offset as u64);
+
+                        if matches.len() >= max_count {
+                            return;
+                        }
+                    }
+
+                    offset += self.alignment as usize;
+                }
+
+                return;
+            }
+        };
+
+        let byte = self.pattern[anchor];
+        let candidates = &data[anchor..anchor + last + 1];
+        let mut pos = 0;
+
+        while let Some(found) = Self::find_byte(&candidates[pos..], byte) {
+            let offset = pos + found;
+
+            if ((address + offset as u64) & align_mask) == 0 && self.matches_at(&data[offset..]) {
+                matches.push(address + offset as u64);
+
+                if matches.len() >= max_count {
+                    return;
+                }
+            }
+
+            pos = offset + 1;
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn naive(search: &MemorySearch, data: &[u8], address: u64) -> Vec<u64> {
+        let mut res = Vec::new();
+
+        if data.len() < search.size() {
+            return res;
+        }
+
+        for offset in 0..data.len() - search.size() + 1 {
+            if (address + offset as u64) % search.alignment == 0 && search.matches_at(&data[offset..]) {
+                res.push(address + offset as u64);
+            }
+        }
+
+        res
+    }
+
+    fn test_data() -> Vec<u8> {
+        let mut seed = 1u32;
+
+        (0..8192).map(|_| {
+            seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
+            ((seed >> 16) & 0x1f) as u8
+        }).collect()
+    }
+
+    #[test]
+    fn test_search_same_as_naive() {
+        let data = test_data();
+        let searches = vec![
+            MemorySearch::new(&[0x01, 0x02], None, 1).unwrap(),
+            MemorySearch::new(&[0x00, 0x03], None, 2).unwrap(),
+            MemorySearch::new(&[0x10, 0x00, 0x05], Some(&[0xf0, 0x00, 0xff]), 1).unwrap(),
+            MemorySearch::new(&[0x10, 0x02], Some(&[0xf0, 0x0f]), 1).unwrap(),
+        ];
+
+        for search in &searches {
+            for start in 0..3 {
+                let mut matches = Vec::new();
+                search.scan(&data[start..], 0x1000 + start as u64, &mut matches, 1 << 20);
+                assert_eq!(matches, naive(search, &data[start..], 0x1000 + start as u64));
+            }
+        }
+    }
+
+    #[test]
+    fn test_search_max_count() {
+        let data = [0x11u8; 64];
+        let search = MemorySearch::new(&[0x11, 0x11], None, 4).unwrap();
+        let mut matches = Vec::new();
+
+        search.scan(&data, 0x2002, &mut matches, 3);
+        assert_eq!(matches, vec![0x2004, 0x2008, 0x200c]);
+    }
+
+    #[test]
+    fn test_search_invalid() {
+        assert!(MemorySearch::new(&[], None, 1).is_none());
+        assert!(MemorySearch::new(&[1, 2], Some(&[0xff]), 1).is_none());
+        assert!(MemorySearch::new(&[1, 2], None, 3).is_none());
+    }
+}
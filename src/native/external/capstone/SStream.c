@@ -36,6 +36,57 @@ void SStream_concat0(SStream *ss, char *s)
 #endif
 }
 
+void SStream_concat1(SStream *ss, char c)
+{
+#ifndef CAPSTONE_DIET
+	ss->buffer[ss->index++] = c;
+	ss->buffer[ss->index] = '\0';
+#endif
+}
+
+void SStream_concatHex(SStream *ss, uint32_t val)
+{
+#ifndef CAPSTONE_DIET
+	static const char hex_digits[] = "0123456789abcdef";
+	char temp[8];
+	int count = 0;
+
+	do {
+		temp[count++] = hex_digits[val & 0xf];
+		val >>= 4;
+	} while (val != 0);
+
+	while (count > 0)
+		ss->buffer[ss->index++] = temp[--count];
+
+	ss->buffer[ss->index] = '\0';
+#endif
+}
+
+void SStream_concatDec(SStream *ss, int32_t val)
+{
+#ifndef CAPSTONE_DIET
+	char temp[10];
+	int count = 0;
+	uint32_t v = (uint32_t)val;
+
+	if (val < 0) {
+		ss->buffer[ss->index++] = '-';
+		v = 0 - v;
+	}
+
+	do {
+		temp[count++] = (char)('0' + (v % 10));
+		v /= 10;
+	} while (v != 0);
+
+	while (count > 0)
+		ss->buffer[ss->index++] = temp[--count];
+
+	ss->buffer[ss->index] = '\0';
+#endif
+}
+
 void SStream_concat(SStream *ss, const char *fmt, ...)
 {
 #ifndef CAPSTONE_DIET
@@ -17,6 +17,13 @@ void SStream_concat(SStream *ss, const char *fmt, ...);
 
 void SStream_concat0(SStream *ss, char *s);
 
+// Fast paths for printers that are hot enough that vsnprintf shows up. Same output as "%c", "%x" and "%d"
+void SStream_concat1(SStream *ss, char c);
+
+void SStream_concatHex(SStream *ss, uint32_t val);
+
+void SStream_concatDec(SStream *ss, int32_t val);
+
 void printInt64Bang(SStream *O, int64_t val);
 
 void printUInt64Bang(SStream *O, uint64_t val);
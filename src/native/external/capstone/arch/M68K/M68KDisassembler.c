@@ -222,6 +222,7 @@ static int make_int_16(int value);
 
 /* Stuff to build the opcode handler jump table */
 static void build_opcode_table(void);
+static void init_opcode_table(void);
 static int valid_ea(uint opcode, uint mask);
 static int DECL_SPEC compare_nof_true_bits(const void *aptr, const void *bptr);
 static void d68000_invalid(m68k_info *info);
@@ -247,9 +248,6 @@ typedef struct {
 /* ================================= DATA ================================= */
 /* ======================================================================== */
 
-/* Opcode handler jump table */
-static instruction_struct g_instruction_table[0x10000];
-
 /* used by ops like asr, ror, addq, etc */
 static uint g_3bit_qdata_table[8] = {8, 1, 2, 3, 4, 5, 6, 7};
 
@@ -3777,52 +3775,98 @@ static int DECL_SPEC compare_nof_true_bits(const void *aptr, const void *bptr)
 	return b - a; /* reversed to get greatest to least sorting */
 }
 
+/* Opcode handler jump table. Each opcode maps to an entry in g_instruction_info (entry 0 is the invalid
+ * instruction) which keeps the table at 128KB and the handlers it points to in a few KB that stays in cache */
+static uint16_t g_instruction_index[0x10000];
+static instruction_struct g_instruction_info[sizeof(g_opcode_info) / sizeof(g_opcode_info[0])];
+
+#define INSTRUCTION(ir) (&g_instruction_info[g_instruction_index[(ir) & 0xffff]])
+
 /* build the opcode handler jump table */
 static void build_opcode_table(void)
 {
 	uint i;
 	uint opcode;
+	uint free_bits;
+	uint bits;
 	opcode_struct* ostruct;
 	uint opcode_info_length = 0;
 
-	/* Already initialized ? */
-	if (g_instruction_table[0].instruction != NULL) {
-		return;
-	}
-
 	for(ostruct = g_opcode_info;ostruct->opcode_handler != 0;ostruct++)
 		opcode_info_length++;
 
 	qsort((void *)g_opcode_info, opcode_info_length, sizeof(g_opcode_info[0]), compare_nof_true_bits);
 
-	for(i=0;i<0x10000;i++) {
-		g_instruction_table[i].instruction = d68000_invalid; /* default to invalid, undecoded opcode */
-		opcode = i;
-		/* search through opcode info for a match */
-		for(ostruct = g_opcode_info;ostruct->opcode_handler != 0;ostruct++) {
-			/* match opcode mask and allowed ea modes */
-			if ((opcode & ostruct->mask) == ostruct->match) {
-				/* Handle destination ea for move instructions */
-				if ((ostruct->opcode_handler == d68000_move_8 ||
-							ostruct->opcode_handler == d68000_move_16 ||
-							ostruct->opcode_handler == d68000_move_32) &&
-						!valid_ea(((opcode>>9)&7) | ((opcode>>3)&0x38), 0xbf8))
-					continue;
-				if (valid_ea(opcode, ostruct->ea_mask)) {
-					g_instruction_table[i].instruction = ostruct->opcode_handler;
-					g_instruction_table[i].word2_mask = ostruct->mask2;
-					g_instruction_table[i].word2_match = ostruct->match2;
-					break;
-				}
-			}
-		}
+	g_instruction_info[0].instruction = d68000_invalid; /* default to invalid, undecoded opcode */
+	memset(g_instruction_index, 0, sizeof(g_instruction_index));
+
+	/* The first (most specific) matching entry wins for each opcode. Instead of testing all entries for all
+	 * opcodes only the opcodes each entry can match (match with any combination of the bits outside the mask)
+	 * are visited, most specific entry first */
+	for(i=0;i<opcode_info_length;i++) {
+		ostruct = &g_opcode_info[i];
+
+		g_instruction_info[i + 1].instruction = ostruct->opcode_handler;
+		g_instruction_info[i + 1].word2_mask = ostruct->mask2;
+		g_instruction_info[i + 1].word2_match = ostruct->match2;
+
+		free_bits = ~ostruct->mask & 0xffff;
+		bits = 0;
+
+		do {
+			opcode = ostruct->match | bits;
+			bits = (bits - free_bits) & free_bits;
+
+			/* already taken by a more specific entry */
+			if (g_instruction_index[opcode] != 0)
+				continue;
+
+			/* Handle destination ea for move instructions */
+			if ((ostruct->opcode_handler == d68000_move_8 ||
+						ostruct->opcode_handler == d68000_move_16 ||
+						ostruct->opcode_handler == d68000_move_32) &&
+					!valid_ea(((opcode>>9)&7) | ((opcode>>3)&0x38), 0xbf8))
+				continue;
+
+			if (valid_ea(opcode, ostruct->ea_mask))
+				g_instruction_index[opcode] = (uint16_t)(i + 1);
+		} while (bits != 0);
+	}
+}
+
+/* The table is built by the first thread that disassembles and other threads wait for it to be done.
+ * 0 = not built, 1 = being built, 2 = ready */
+static volatile long g_opcode_table_state = 0;
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define M68K_CAS(ptr, old, val) (_InterlockedCompareExchange((ptr), (val), (old)) == (old))
+#define M68K_LOAD(ptr) _InterlockedOr((ptr), 0)
+#else
+#define M68K_CAS(ptr, old, val) __sync_bool_compare_and_swap((ptr), (old), (val))
+#define M68K_LOAD(ptr) __sync_fetch_and_or((ptr), 0)
+#endif
+
+static void init_opcode_table(void)
+{
+	if (M68K_LOAD(&g_opcode_table_state) == 2)
+		return;
+
+	if (M68K_CAS(&g_opcode_table_state, 0, 1)) {
+		build_opcode_table();
+		M68K_CAS(&g_opcode_table_state, 1, 2);
+		return;
 	}
+
+	/* another thread is building the table. It only takes a moment */
+	while (M68K_LOAD(&g_opcode_table_state) != 2)
+		;
 }
 
 static int instruction_is_valid(m68k_info *info, const unsigned int word_check)
 {
 	const unsigned int instruction = info->ir;
-	instruction_struct *i = &g_instruction_table[instruction];
+	instruction_struct *i = INSTRUCTION(instruction);
 
 	if ( (i->word2_mask && ((word_check & i->word2_mask) != i->word2_match)) ||
 		(i->instruction == d68000_invalid) ) {
@@ -4014,7 +4058,7 @@ static unsigned int m68k_disassemble(m68k_info *info, uint64_t pc)
 
 	inst->Opcode = M68K_INS_INVALID;
 
-	build_opcode_table();
+	init_opcode_table();
 
 	memset(ext, 0, sizeof(cs_m68k));
 	ext->op_size.type = M68K_SIZE_TYPE_CPU;
@@ -4025,7 +4069,7 @@ static unsigned int m68k_disassemble(m68k_info *info, uint64_t pc)
 	info->ir = peek_imm_16(info);
 	if (instruction_is_valid(info, peek_imm_32(info) & 0xffff)) {
 		info->ir = read_imm_16(info);
-		g_instruction_table[info->ir].instruction(info);
+		INSTRUCTION(info->ir)->instruction(info);
 	}
 
 	return info->pc - (unsigned int)pc;
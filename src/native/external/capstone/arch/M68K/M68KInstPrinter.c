@@ -71,7 +71,7 @@ const char* getRegName(m68k_reg reg)
 	return s_reg_names[(int)reg];
 }
 
-static void printRegbitsRange(char* buffer, uint32_t data, const char* prefix)
+static void printRegbitsRange(SStream* O, uint32_t data, const char* prefix, int* first_range)
 {
 	unsigned int first = 0;
 	unsigned int run_length = 0;
@@ -87,34 +87,67 @@ static void printRegbitsRange(char* buffer, uint32_t data, const char* prefix)
 				run_length++;
 			}
 
-			if (buffer[0] != 0)
-				strcat(buffer, "/");
+			if (!*first_range)
+				SStream_concat1(O, '/');
 
-			sprintf(buffer + strlen(buffer), "%s%d", prefix, first);
-			if (run_length > 0)
-				sprintf(buffer + strlen(buffer), "-%s%d", prefix, first + run_length);
+			*first_range = 0;
+
+			SStream_concat0(O, (char*)prefix);
+			SStream_concat1(O, (char)('0' + first));
+
+			if (run_length > 0) {
+				SStream_concat1(O, '-');
+				SStream_concat0(O, (char*)prefix);
+				SStream_concat1(O, (char)('0' + first + run_length));
+			}
 		}
 	}
 }
 
 static void registerBits(SStream* O, const cs_m68k_op* op)
 {
-	char buffer[128];
 	unsigned int data = op->register_bits;
+	int first_range = 1;
+
+	printRegbitsRange(O, data & 0xff, "d", &first_range);
+	printRegbitsRange(O, (data >> 8) & 0xff, "a", &first_range);
+	printRegbitsRange(O, (data >> 16) & 0xff, "fp", &first_range);
+}
 
-	buffer[0] = 0;
+static void registerPair(SStream* O, const cs_m68k_op* op)
+{
+	SStream_concat0(O, (char*)s_reg_names[M68K_REG_D0 + op->reg_pair.reg_0]);
+	SStream_concat1(O, ':');
+	SStream_concat0(O, (char*)s_reg_names[M68K_REG_D0 + op->reg_pair.reg_1]);
+}
 
-	printRegbitsRange(buffer, data & 0xff, "d");
-	printRegbitsRange(buffer, (data >> 8) & 0xff, "a");
-	printRegbitsRange(buffer, (data >> 16) & 0xff, "fp");
+/* Small helpers so the common addressing modes are written without going through vsnprintf */
 
-	SStream_concat(O, "%s", buffer);
+static void printHex(SStream* O, uint32_t value)
+{
+	SStream_concat1(O, '$');
+	SStream_concatHex(O, value);
 }
 
-static void registerPair(SStream* O, const cs_m68k_op* op)
+static void printAReg(SStream* O, int reg)
+{
+	SStream_concat1(O, 'a');
+	SStream_concatDec(O, reg);
+}
+
+static void printIndex(SStream* O, const cs_m68k_op* op)
+{
+	SStream_concat0(O, (char*)getRegName(op->mem.index_reg));
+	SStream_concat1(O, '.');
+	SStream_concat1(O, op->mem.index_size ? 'l' : 'w');
+}
+
+static void printScale(SStream* O, const cs_m68k_op* op)
 {
-	SStream_concat(O, "%s:%s", s_reg_names[M68K_REG_D0 + op->reg_pair.reg_0],
-			s_reg_names[M68K_REG_D0 + op->reg_pair.reg_1]);
+	SStream_concat0(O, (char*)s_spacing);
+	SStream_concat1(O, '*');
+	SStream_concat0(O, (char*)s_spacing);
+	SStream_concatDec(O, op->mem.scale);
 }
 
 void printAddressingMode(SStream* O, const cs_m68k* inst, const cs_m68k_op* op)
@@ -129,22 +162,53 @@ void printAddressingMode(SStream* O, const cs_m68k* inst, const cs_m68k_op* op)
 					registerPair(O, op);
 					break;
 				case M68K_OP_REG:
-					SStream_concat(O, "%s", s_reg_names[op->reg]);
+					SStream_concat0(O, (char*)s_reg_names[op->reg]);
 					break;
 				default:
 					break;
 			}
 			break;
 
-		case M68K_AM_REG_DIRECT_DATA: SStream_concat(O, "d%d", (op->reg - M68K_REG_D0)); break;
-		case M68K_AM_REG_DIRECT_ADDR: SStream_concat(O, "a%d", (op->reg - M68K_REG_A0)); break;
-		case M68K_AM_REGI_ADDR: SStream_concat(O, "(a%d)", (op->reg - M68K_REG_A0)); break;
-		case M68K_AM_REGI_ADDR_POST_INC: SStream_concat(O, "(a%d)+", (op->reg - M68K_REG_A0)); break;
-		case M68K_AM_REGI_ADDR_PRE_DEC: SStream_concat(O, "-(a%d)", (op->reg - M68K_REG_A0)); break;
-		case M68K_AM_REGI_ADDR_DISP: SStream_concat(O, "$%x(a%d)", op->mem.disp, (op->reg - M68K_REG_A0)); break;
-		case M68K_AM_PCI_DISP: SStream_concat(O, "$%x(pc)", op->mem.disp); break;
-		case M68K_AM_ABSOLUTE_DATA_SHORT: SStream_concat(O, "$%x.w", op->imm); break;
-		case M68K_AM_ABSOLUTE_DATA_LONG: SStream_concat(O, "$%x.l", op->imm); break;
+		case M68K_AM_REG_DIRECT_DATA:
+			SStream_concat1(O, 'd');
+			SStream_concatDec(O, op->reg - M68K_REG_D0);
+			break;
+		case M68K_AM_REG_DIRECT_ADDR:
+			printAReg(O, op->reg - M68K_REG_A0);
+			break;
+		case M68K_AM_REGI_ADDR:
+			SStream_concat1(O, '(');
+			printAReg(O, op->reg - M68K_REG_A0);
+			SStream_concat1(O, ')');
+			break;
+		case M68K_AM_REGI_ADDR_POST_INC:
+			SStream_concat1(O, '(');
+			printAReg(O, op->reg - M68K_REG_A0);
+			SStream_concat0(O, ")+");
+			break;
+		case M68K_AM_REGI_ADDR_PRE_DEC:
+			SStream_concat0(O, "-(");
+			printAReg(O, op->reg - M68K_REG_A0);
+			SStream_concat1(O, ')');
+			break;
+		case M68K_AM_REGI_ADDR_DISP:
+			printHex(O, op->mem.disp);
+			SStream_concat1(O, '(');
+			printAReg(O, op->reg - M68K_REG_A0);
+			SStream_concat1(O, ')');
+			break;
+		case M68K_AM_PCI_DISP:
+			printHex(O, op->mem.disp);
+			SStream_concat0(O, "(pc)");
+			break;
+		case M68K_AM_ABSOLUTE_DATA_SHORT:
+			printHex(O, (uint32_t)op->imm);
+			SStream_concat0(O, ".w");
+			break;
+		case M68K_AM_ABSOLUTE_DATA_LONG:
+			printHex(O, (uint32_t)op->imm);
+			SStream_concat0(O, ".l");
+			break;
 		case M68K_AM_IMMIDIATE:
 			 if (inst->op_size.type == M68K_SIZE_TYPE_FPU) {
 #if defined(_KERNEL_MODE)
@@ -161,33 +225,48 @@ void printAddressingMode(SStream* O, const cs_m68k* inst, const cs_m68k_op* op)
 				 break;
 #endif
 			 }
-			 SStream_concat(O, "#$%x", op->imm);
+			 SStream_concat1(O, '#');
+			 printHex(O, (uint32_t)op->imm);
 			 break;
 		case M68K_AM_PCI_INDEX_8_BIT_DISP:
-			SStream_concat(O, "$%x(pc,%s%s.%c)", op->mem.disp, s_spacing, getRegName(op->mem.index_reg), op->mem.index_size ? 'l' : 'w');
+			printHex(O, op->mem.disp);
+			SStream_concat0(O, "(pc,");
+			SStream_concat0(O, (char*)s_spacing);
+			printIndex(O, op);
+			SStream_concat1(O, ')');
 			break;
 		case M68K_AM_AREGI_INDEX_8_BIT_DISP:
-			SStream_concat(O, "$%x(%s,%s%s.%c)", op->mem.disp, getRegName(op->mem.base_reg), s_spacing, getRegName(op->mem.index_reg), op->mem.index_size ? 'l' : 'w');
+			printHex(O, op->mem.disp);
+			SStream_concat1(O, '(');
+			SStream_concat0(O, (char*)getRegName(op->mem.base_reg));
+			SStream_concat1(O, ',');
+			SStream_concat0(O, (char*)s_spacing);
+			printIndex(O, op);
+			SStream_concat1(O, ')');
 			break;
 		case M68K_AM_PCI_INDEX_BASE_DISP:
 		case M68K_AM_AREGI_INDEX_BASE_DISP:
 			if (op->mem.in_disp > 0)
-			    SStream_concat(O, "$%x", op->mem.in_disp);
+			    printHex(O, op->mem.in_disp);
 
-			SStream_concat(O, "(");
+			SStream_concat1(O, '(');
 
 			if (op->address_mode == M68K_AM_PCI_INDEX_BASE_DISP) {
-			    SStream_concat(O, "pc,%s.%c", getRegName(op->mem.index_reg), op->mem.index_size ? 'l' : 'w');
+			    SStream_concat0(O, "pc,");
+			    printIndex(O, op);
 			} else {
-				if (op->mem.base_reg != M68K_REG_INVALID)
-					SStream_concat(O, "a%d,%s", op->mem.base_reg - M68K_REG_A0, s_spacing);
-				SStream_concat(O, "%s.%c", getRegName(op->mem.index_reg), op->mem.index_size ? 'l' : 'w');
+				if (op->mem.base_reg != M68K_REG_INVALID) {
+					printAReg(O, op->mem.base_reg - M68K_REG_A0);
+					SStream_concat1(O, ',');
+					SStream_concat0(O, (char*)s_spacing);
+				}
+				printIndex(O, op);
 			}
 
 			if (op->mem.scale > 0)
-			    SStream_concat(O, "%s*%s%d)", s_spacing, s_spacing, op->mem.scale);
-			else
-			    SStream_concat(O, ")");
+			    printScale(O, op);
+
+			SStream_concat1(O, ')');
 			break;
 			// It's ok to just use PCMI here as is as we set base_reg to PC in the disassembler. While this is not strictly correct it makes the code
 			// easier and that is what actually happens when the code is executed anyway.
@@ -196,40 +275,52 @@ void printAddressingMode(SStream* O, const cs_m68k* inst, const cs_m68k_op* op)
 		case M68K_AM_PC_MEMI_PRE_INDEX:
 		case M68K_AM_MEMI_PRE_INDEX:
 		case M68K_AM_MEMI_POST_INDEX:
-			SStream_concat(O, "([");
+			SStream_concat0(O, "([");
 			if (op->mem.in_disp > 0)
-			    SStream_concat(O, "$%x", op->mem.in_disp);
+			    printHex(O, op->mem.in_disp);
 
 			if (op->mem.base_reg != M68K_REG_INVALID) {
-				if (op->mem.in_disp > 0)
-					SStream_concat(O, ",%s%s", s_spacing, getRegName(op->mem.base_reg));
-				else
-					SStream_concat(O, "%s", getRegName(op->mem.base_reg));
+				if (op->mem.in_disp > 0) {
+					SStream_concat1(O, ',');
+					SStream_concat0(O, (char*)s_spacing);
+				}
+				SStream_concat0(O, (char*)getRegName(op->mem.base_reg));
 			}
 
 			if (op->address_mode == M68K_AM_MEMI_POST_INDEX || op->address_mode == M68K_AM_PC_MEMI_POST_INDEX)
-			    SStream_concat(O, "]");
+			    SStream_concat1(O, ']');
 
-			if (op->mem.index_reg != M68K_REG_INVALID)
-			    SStream_concat(O, ",%s%s.%c", s_spacing, getRegName(op->mem.index_reg), op->mem.index_size ? 'l' : 'w');
+			if (op->mem.index_reg != M68K_REG_INVALID) {
+			    SStream_concat1(O, ',');
+			    SStream_concat0(O, (char*)s_spacing);
+			    printIndex(O, op);
+			}
 
 			if (op->mem.scale > 0)
-			    SStream_concat(O, "%s*%s%d", s_spacing, s_spacing, op->mem.scale);
+			    printScale(O, op);
 
 			if (op->address_mode == M68K_AM_MEMI_PRE_INDEX || op->address_mode == M68K_AM_PC_MEMI_PRE_INDEX)
-			    SStream_concat(O, "]");
+			    SStream_concat1(O, ']');
 
-			if (op->mem.out_disp > 0)
-			    SStream_concat(O, ",%s$%x", s_spacing, op->mem.out_disp);
+			if (op->mem.out_disp > 0) {
+			    SStream_concat1(O, ',');
+			    SStream_concat0(O, (char*)s_spacing);
+			    printHex(O, op->mem.out_disp);
+			}
 
-			SStream_concat(O, ")");
+			SStream_concat1(O, ')');
 			break;
 		default:
 			break;
 	}
 
-	if (op->mem.bitfield)
-		SStream_concat(O, "{%d:%d}", op->mem.offset, op->mem.width);
+	if (op->mem.bitfield) {
+		SStream_concat1(O, '{');
+		SStream_concatDec(O, op->mem.offset);
+		SStream_concat1(O, ':');
+		SStream_concatDec(O, op->mem.width);
+		SStream_concat1(O, '}');
+	}
 }
 #endif
 
@@ -256,9 +347,10 @@ void M68K_printInst(MCInst* MI, SStream* O, void* PrinterInfo)
 	}
 
 	if (MI->Opcode == M68K_INS_INVALID) {
-		if (ext->op_count)
-			SStream_concat(O, "dc.w $%x", ext->operands[0].imm);
-		else
+		if (ext->op_count) {
+			SStream_concat0(O, "dc.w ");
+			printHex(O, (uint32_t)ext->operands[0].imm);
+		} else
 			SStream_concat(O, "dc.w $<unknown>");
 		return;
 	}
@@ -298,14 +390,20 @@ void M68K_printInst(MCInst* MI, SStream* O, void* PrinterInfo)
 		printAddressingMode(O, ext, &ext->operands[1]); SStream_concat0(O, ",");
 		reg_value_0 = ext->operands[2].register_bits >> 4;
 		reg_value_1 = ext->operands[2].register_bits & 0xf;
-		SStream_concat(O, "(%s):(%s)", s_reg_names[M68K_REG_D0 + reg_value_0], s_reg_names[M68K_REG_D0 + reg_value_1]);
+		SStream_concat1(O, '(');
+		SStream_concat0(O, (char*)s_reg_names[M68K_REG_D0 + reg_value_0]);
+		SStream_concat0(O, "):(");
+		SStream_concat0(O, (char*)s_reg_names[M68K_REG_D0 + reg_value_1]);
+		SStream_concat1(O, ')');
 		return;
 	}
 
 	for (i  = 0; i < ext->op_count; ++i) {
 		printAddressingMode(O, ext, &ext->operands[i]);
-		if ((i + 1) != ext->op_count)
-			SStream_concat(O, ",%s", s_spacing);
+		if ((i + 1) != ext->op_count) {
+			SStream_concat1(O, ',');
+			SStream_concat0(O, (char*)s_spacing);
+		}
 	}
 #endif
 }
@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+#include <capstone/capstone.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Measures M68K decode speed of the capstone M68K disassembler.
+//
+// The first decode in the process builds the opcode table so it's timed on its own. With -threads the first decode
+// is done by all threads at once (which is what happens when the Amiga backend disassembles in parallel) and the
+// output of each thread is checked to be the same. After that the code is decoded a number of times on one thread,
+// with and without instruction details, and the number of instructions per second is printed.
+//
+// Without an input file every opcode is decoded once, each followed by a few extension words.
+
+enum
+{
+    ExtensionWords = 4,
+    DefaultPasses = 20,
+    MaxThreads = 64,
+};
+
+#ifdef _WIN32
+typedef HANDLE Thread;
+typedef DWORD (WINAPI* ThreadFunc)(void*);
+#define THREAD_FUNC(name) static DWORD WINAPI name(void* data)
+#define THREAD_RETURN return 0
+#else
+typedef pthread_t Thread;
+typedef void* (*ThreadFunc)(void*);
+#define THREAD_FUNC(name) static void* name(void* data)
+#define THREAD_RETURN return 0
+#endif
+
+typedef struct DecodeResult
+{
+    const uint8_t* code;
+    size_t size;
+    int detail;
+    uint64_t count;
+    uint64_t hash;
+    double firstTime;
+    double time;
+} DecodeResult;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double timeSeconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int startThread(Thread* thread, ThreadFunc func, void* data)
+{
+#ifdef _WIN32
+    *thread = CreateThread(0, 0, func, data, 0, 0);
+    return *thread != 0;
+#else
+    return pthread_create(thread, 0, func, data) == 0;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void joinThread(Thread thread)
+{
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, 0);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t i;
+
+    for (i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+
+    return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Decodes all of the code once. Words that can't be decoded are skipped
+
+static void decode(DecodeResult* result)
+{
+    const uint8_t* code = result->code;
+    size_t size = result->size;
+    uint64_t address = 0;
+    double start;
+    int first = 1;
+    cs_insn* insn;
+    csh handle;
+
+    result->count = 0;
+    result->hash = 0xcbf29ce484222325ull;
+
+    if (cs_open(CS_ARCH_M68K, CS_MODE_M68K_000, &handle) != CS_ERR_OK)
+        return;
+
+    cs_option(handle, CS_OPT_DETAIL, result->detail ? CS_OPT_ON : CS_OPT_OFF);
+    insn = cs_malloc(handle);
+
+    start = timeSeconds();
+
+    while (size >= 2)
+    {
+        int ok = cs_disasm_iter(handle, &code, &size, &address, insn);
+
+        if (first)
+        {
+            result->firstTime = timeSeconds() - start;
+            first = 0;
+        }
+
+        if (!ok)
+        {
+            code += 2;
+            size -= 2;
+            address += 2;
+            continue;
+        }
+
+        result->hash = hashBytes(result->hash, &insn->id, sizeof(insn->id));
+        result->hash = hashBytes(result->hash, insn->op_str, strlen(insn->op_str));
+        result->count++;
+    }
+
+    result->time = timeSeconds() - start;
+
+    cs_free(insn, 1);
+    cs_close(&handle);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+THREAD_FUNC(decodeThread)
+{
+    decode((DecodeResult*)data);
+    THREAD_RETURN;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Every opcode followed by extension words from a fixed pseudo random sequence so runs can be compared
+
+static uint8_t* allOpcodes(size_t* size)
+{
+    uint32_t seed = 0x12345678;
+    uint8_t* code;
+    uint8_t* out;
+    uint32_t opcode;
+    int i;
+
+    *size = 0x10000 * (1 + ExtensionWords) * 2;
+    code = out = malloc(*size);
+
+    for (opcode = 0; opcode < 0x10000; ++opcode)
+    {
+        *out++ = (uint8_t)(opcode >> 8);
+        *out++ = (uint8_t)opcode;
+
+        for (i = 0; i < ExtensionWords * 2; ++i)
+        {
+            seed = seed * 1664525 + 1013904223;
+            *out++ = (uint8_t)(seed >> 24);
+        }
+    }
+
+    return code;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t* readFile(const char* filename, size_t* size)
+{
+    uint8_t* code;
+    long length;
+    FILE* f;
+
+    if ((f = fopen(filename, "rb")) == 0)
+        return 0;
+
+    fseek(f, 0, SEEK_END);
+    length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (length < 2)
+    {
+        fclose(f);
+        return 0;
+    }
+
+    code = malloc((size_t)length);
+    *size = fread(code, 1, (size_t)length, f);
+    fclose(f);
+
+    return code;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void printSpeed(const char* name, const DecodeResult* result, int passes, double time)
+{
+    printf("%-10s %llu instructions in %.3f s, %.2fM instructions/s\n", name,
+           (unsigned long long)result->count * (unsigned long long)passes, time,
+           (double)result->count * passes / time / 1000000.0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void printUsage()
+{
+    printf("Usage: m68k_bench [options] [code.bin]\n");
+    printf("  -threads n  Threads doing the first decode at the same time (default 1)\n");
+    printf("  -passes n   Times the code is decoded when measuring speed (default %d)\n", DefaultPasses);
+    printf("Without code.bin every opcode is decoded, each followed by %d extension words\n", ExtensionWords);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    Thread threads[MaxThreads];
+    DecodeResult results[MaxThreads];
+    DecodeResult result;
+    const char* filename = 0;
+    int threadCount = 1;
+    int passes = DefaultPasses;
+    int detail, i, started, same;
+    double time;
+    uint8_t* code;
+    size_t size;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-threads") && i + 1 < argc)
+            threadCount = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-passes") && i + 1 < argc)
+            passes = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !filename)
+            filename = argv[i];
+        else
+        {
+            printUsage();
+            return -1;
+        }
+    }
+
+    if (threadCount < 1 || threadCount > MaxThreads || passes < 1)
+    {
+        printUsage();
+        return -1;
+    }
+
+    if (filename)
+        code = readFile(filename, &size);
+    else
+        code = allOpcodes(&size);
+
+    if (!code)
+    {
+        printf("Unable to read %s\n", filename);
+        return -1;
+    }
+
+    // First decode, which includes building the opcode table
+
+    memset(results, 0, sizeof(results));
+
+    for (i = 0, started = 0; i < threadCount; ++i)
+    {
+        results[i].code = code;
+        results[i].size = size;
+        results[i].detail = 1;
+
+        if (startThread(&threads[started], decodeThread, &results[i]))
+            started++;
+    }
+
+    for (i = 0; i < started; ++i)
+        joinThread(threads[i]);
+
+    time = 0.0;
+
+    for (i = 0, same = 1; i < started; ++i)
+    {
+        same &= results[i].count == results[0].count && results[i].hash == results[0].hash;
+        time = results[i].firstTime > time ? results[i].firstTime : time;
+    }
+
+    printf("first instruction on %d thread(s): %.3f ms, %s output\n", started, time * 1000.0,
+           same ? "same" : "DIFFERENT");
+
+    // Steady decode speed with the table in place
+
+    for (detail = 0; detail < 2; ++detail)
+    {
+        memset(&result, 0, sizeof(result));
+        result.code = code;
+        result.size = size;
+        result.detail = detail;
+
+        time = 0.0;
+
+        for (i = 0; i < passes; ++i)
+        {
+            decode(&result);
+            time += result.time;
+        }
+
+        if (result.hash != results[0].hash)
+            same = 0;
+
+        printSpeed(detail ? "detail on" : "detail off", &result, passes, time);
+    }
+
+    free(code);
+
+    return same ? 0 : -1;
+}
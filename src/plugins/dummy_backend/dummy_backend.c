@@ -2,6 +2,8 @@
 #include "pd_host.h"
 #include "pd_menu.h"
 #include "pd_io.h"
+#include "pd_search.h"
+#include "pd_trace.h"
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -10,6 +12,9 @@
 
 #define sizeof_array(t) (sizeof(t) / sizeof(t[0]))
 
+// Number of steps kept in the instruction trace
+#define TRACE_SIZE (64 * 1024)
+
 typedef struct DisasmData {
     uint16_t address;
     const char* string;
@@ -420,8 +425,18 @@ typedef struct DummyPlugin {
     int register_type;
     Register *registers;
     int registers_count;
+    // Each step is recorded here while trace_enabled is set
+    PDTraceBuffer trace;
+    int trace_enabled;
+    // Number of steps taken that can be stepped back
+    uint64_t step_count;
 } DummyPlugin;
 
+static PDTraceRecord s_trace_records[PD_TRACE_MAX_EVENT_RECORDS];
+
+// One extra match is asked for to know if there were more than max_matches
+static uint64_t s_search_matches[PD_SEARCH_MAX_EVENT_MATCHES + 1];
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void fill_register(Register* reg, char* name, uint8_t size, void* initial_data, uint8_t read_only) {
@@ -444,6 +459,8 @@ void* create_instance(ServiceFunc* serviceFunc) {
     plugin->memory_start = 0;
     plugin->memory_end = (1 * 1024 * 1024) + plugin->memory_start;
 
+    PDTrace_init(&plugin->trace, malloc(sizeof(PDTraceRecord) * TRACE_SIZE), TRACE_SIZE);
+
     srand(0xc0cac01a);
 
     for (i = 0; i < 1024 * 1024; ++i) {
@@ -510,7 +527,9 @@ void* create_instance(ServiceFunc* serviceFunc) {
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void destroy_instance(void* user_data) {
-    free(user_data);
+    DummyPlugin* plugin = (DummyPlugin*)user_data;
+    free(plugin->trace.records);
+    free(plugin);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -610,9 +629,30 @@ static void update_register(DummyPlugin* plugin, PDReader* reader) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static void trace_location(DummyPlugin* plugin) {
+    PDTraceRecord record;
+    uint8_t* code = plugin->memory + (plugin->exception_location - plugin->memory_start);
+
+    // There is no cpu behind the disassembly so the instruction bytes are whatever is in memory and no registers change
+
+    memset(&record, 0, sizeof(record));
+    record.pc = (uint64_t)plugin->exception_location;
+    record.opcode = code[0] | (code[1] << 8) | (code[2] << 16) | ((uint32_t)code[3] << 24);
+
+    PDTrace_write(&plugin->trace, &record);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 static void step_to_next_location(DummyPlugin* plugin) {
     int i;
 
+    if (plugin->trace_enabled) {
+        trace_location(plugin);
+    }
+
+    plugin->step_count++;
+
     for (i = 0; i < (int)sizeof_array(s_disasm_data) - 1; ++i) {
         if (s_disasm_data[i].address == plugin->exception_location) {
             plugin->exception_location = s_disasm_data[i + 1].address;
@@ -625,6 +665,29 @@ static void step_to_next_location(DummyPlugin* plugin) {
     printf("reseting to start\n");
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stepping only moves to the next entry in the disassembly (and wraps around at the end) so there is nothing to
+// snapshot and the previous location is always the previous entry
+
+static void step_to_prev_location(DummyPlugin* plugin) {
+    int i;
+
+    if (plugin->step_count == 0) {
+        return;
+    }
+
+    plugin->step_count--;
+
+    for (i = 1; i < (int)sizeof_array(s_disasm_data); ++i) {
+        if (s_disasm_data[i].address == plugin->exception_location) {
+            plugin->exception_location = s_disasm_data[i - 1].address;
+            return;
+        }
+    }
+
+    plugin->exception_location = s_disasm_data[sizeof_array(s_disasm_data) - 1].address;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 static void set_exception_location(DummyPlugin* data, PDWriter* writer) {
@@ -694,6 +757,90 @@ static void update_memory(DummyPlugin* plugin, PDReader* reader) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static void enable_trace(DummyPlugin* plugin, PDReader* reader) {
+    uint8_t enable = 0;
+
+    PDRead_find_u8(reader, &enable, "enable", 0);
+
+    if (enable) {
+        PDTrace_reset(&plugin->trace);
+    }
+
+    plugin->trace_enabled = enable;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void get_trace(DummyPlugin* plugin, PDReader* reader, PDWriter* writer) {
+    uint32_t max_count = PD_TRACE_MAX_EVENT_RECORDS;
+    uint32_t count;
+
+    PDRead_find_u32(reader, &max_count, "max_count", 0);
+
+    if (max_count > PD_TRACE_MAX_EVENT_RECORDS) {
+        max_count = PD_TRACE_MAX_EVENT_RECORDS;
+    }
+
+    count = PDTrace_read(&plugin->trace, s_trace_records, max_count);
+
+    PDWrite_event_begin(writer, PDEventType_SetTrace);
+    PDWrite_u32(writer, "count", count);
+    PDWrite_u64(writer, "dropped", plugin->trace.dropped);
+    PDWrite_data(writer, "data", s_trace_records, count * sizeof(PDTraceRecord));
+    PDWrite_event_end(writer);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void search_memory(DummyPlugin* plugin, PDReader* reader, PDWriter* writer) {
+    PDSearch search;
+    void* pattern = 0;
+    void* mask = 0;
+    uint64_t pattern_size = 0;
+    uint64_t mask_size = 0;
+    uint64_t start = (uint64_t)plugin->memory_start;
+    uint64_t end = (uint64_t)plugin->memory_end;
+    uint8_t alignment = 1;
+    uint32_t max_matches = PD_SEARCH_MAX_EVENT_MATCHES;
+    uint32_t count = 0;
+
+    PDRead_find_u64(reader, &start, "start", 0);
+    PDRead_find_u64(reader, &end, "end", 0);
+    PDRead_find_data(reader, &pattern, &pattern_size, "pattern", 0);
+    PDRead_find_data(reader, &mask, &mask_size, "mask", 0);
+    PDRead_find_u8(reader, &alignment, "alignment", 0);
+    PDRead_find_u32(reader, &max_matches, "max_matches", 0);
+
+    if (max_matches > PD_SEARCH_MAX_EVENT_MATCHES) {
+        max_matches = PD_SEARCH_MAX_EVENT_MATCHES;
+    }
+
+    // clamp the range to the memory we have
+
+    if (start < (uint64_t)plugin->memory_start) {
+        start = (uint64_t)plugin->memory_start;
+    }
+
+    if (end > (uint64_t)plugin->memory_end) {
+        end = (uint64_t)plugin->memory_end;
+    }
+
+    // a mask that isn't the same size as the pattern is an invalid search so nothing is found
+
+    if (pattern && start < end && (!mask || mask_size == pattern_size) &&
+        PDSearch_init(&search, (const uint8_t*)pattern, (const uint8_t*)mask, (uint32_t)pattern_size, alignment)) {
+        const uint8_t* memory = plugin->memory + (start - (uint64_t)plugin->memory_start);
+        count = PDSearch_scan(&search, memory, end - start, start, s_search_matches, max_matches + 1);
+    }
+
+    PDWrite_event_begin(writer, PDEventType_SetSearchResult);
+    PDWrite_data(writer, "matches", s_search_matches, (count > max_matches ? max_matches : count) * sizeof(uint64_t));
+    PDWrite_u8(writer, "truncated", count > max_matches ? 1 : 0);
+    PDWrite_event_end(writer);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 static int find_instruction_index(uint64_t address) {
     int i = 0;
 
@@ -840,6 +987,23 @@ static PDDebugState update(void* user_data,
             break;
         }
 
+        case PDAction_ReverseStep:
+        {
+            step_to_prev_location(data);
+            break;
+        }
+
+        case PDAction_ReverseContinue:
+        {
+            // There are no breakpoints here so this goes back to where we started
+
+            while (data->step_count > 0) {
+                step_to_prev_location(data);
+            }
+
+            break;
+        }
+
         default :
         {
 
@@ -879,6 +1043,24 @@ static PDDebugState update(void* user_data,
                 break;
             }
 
+            case PDEventType_EnableTrace:
+            {
+                enable_trace(data, reader);
+                break;
+            }
+
+            case PDEventType_GetTrace:
+            {
+                get_trace(data, reader, writer);
+                break;
+            }
+
+            case PDEventType_SearchMemory:
+            {
+                search_memory(data, reader, writer);
+                break;
+            }
+
             /*
             case PDEventType_RequestEvalExpression:
             {
@@ -8,13 +8,23 @@ namespace prodbg {
 BackendRequests::BackendRequests(BackendSession* session)
 {
     connect(this, &BackendRequests::sendCustomStr, session, &BackendSession::sendCustomString);
+    connect(this, &BackendRequests::transactionBegin, session, &BackendSession::beginTransaction);
+    connect(this, &BackendRequests::transactionCommit, session, &BackendSession::commitTransaction);
 
     connect(this, &BackendRequests::requestMem, session, &BackendSession::beginReadMemory);
     connect(this, &BackendRequests::requestDisassembly, session, &BackendSession::beginDisassembly);
     connect(this, &BackendRequests::readRegisters, session, &BackendSession::beginReadRegisters);
+    connect(this, &BackendRequests::enableTrace, session, &BackendSession::enableTrace);
+    connect(this, &BackendRequests::readTrace, session, &BackendSession::beginReadTrace);
+    connect(this, &BackendRequests::enableProfiler, session, &BackendSession::enableProfiler);
+    connect(this, &BackendRequests::readProfile, session, &BackendSession::beginReadProfile);
+    connect(this, &BackendRequests::resolveAddressInfo, session, &BackendSession::beginResolveAddressInfo);
+    connect(this, &BackendRequests::searchMemory, session, &BackendSession::beginSearchMemory);
 
     connect(this, &BackendRequests::toggleAddressBreakpoint, session, &BackendSession::toggleAddressBreakpoint);
     connect(this, &BackendRequests::toggleFileLineBreakpoint, session, &BackendSession::toggleFileLineBreakpoint);
+    connect(this, &BackendRequests::addWatchpoint, session, &BackendSession::addWatchpoint);
+    connect(this, &BackendRequests::removeWatchpoint, session, &BackendSession::removeWatchpoint);
 
     connect(this, &BackendRequests::evalExpression, session, &BackendSession::evalExpression);
 
@@ -22,6 +32,12 @@ BackendRequests::BackendRequests(BackendSession* session)
     connect(session, &BackendSession::endDisassembly, this, &BackendRequests::endDisassembly);
     connect(session, &BackendSession::endReadRegisters, this, &BackendRequests::endReadRegisters);
     connect(session, &BackendSession::endResolveAddress, this, &BackendRequests::endResolveAddress);
+    connect(session, &BackendSession::endReadTrace, this, &BackendRequests::endReadTrace);
+    connect(session, &BackendSession::endReadProfile, this, &BackendRequests::endReadProfile);
+    connect(session, &BackendSession::endResolveAddressInfo, this, &BackendRequests::endResolveAddressInfo);
+    connect(session, &BackendSession::endAddWatchpoint, this, &BackendRequests::endAddWatchpoint);
+    connect(session, &BackendSession::endSearchMemory, this, &BackendRequests::endSearchMemory);
+    connect(session, &BackendSession::endCommitTransaction, this, &BackendRequests::endCommitTransaction);
 
     connect(session, &BackendSession::programCounterChanged, this, &BackendRequests::programCounterChanged);
     connect(session, &BackendSession::sessionEnded, this, &BackendRequests::sessionEnded);
@@ -36,30 +52,59 @@ void BackendRequests::sendCustomString(uint16_t id, const QString& text)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void BackendRequests::beginAddAddressBreakpoint(uint64_t address)
+void BackendRequests::beginTransaction()
 {
-    toggleAddressBreakpoint(address, true);
+    transactionBegin();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void BackendRequests::beginAddFileLineBreakpoint(const QString& filename, int line)
+void BackendRequests::commitTransaction()
 {
-    toggleFileLineBreakpoint(filename, line, true);
+    transactionCommit();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendRequests::beginAddAddressBreakpoint(uint64_t address, const QString& condition, uint32_t hitCount)
+{
+    toggleAddressBreakpoint(address, true, condition, hitCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendRequests::beginAddFileLineBreakpoint(const QString& filename, int line, const QString& condition,
+                                                 uint32_t hitCount)
+{
+    toggleFileLineBreakpoint(filename, line, true, condition, hitCount);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void BackendRequests::beginRemoveAddressBreakpoint(uint64_t address)
 {
-    toggleAddressBreakpoint(address, false);
+    toggleAddressBreakpoint(address, false, QString(), 0);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void BackendRequests::beginRemoveFileLineBreakpoint(const QString& filename, int line)
 {
-    toggleFileLineBreakpoint(filename, line, false);
+    toggleFileLineBreakpoint(filename, line, false, QString(), 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendRequests::beginAddWatchpoint(uint32_t id, uint64_t address, uint64_t size, WatchAccess access)
+{
+    addWatchpoint(id, address, size, int(access));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendRequests::beginRemoveWatchpoint(uint32_t id)
+{
+    removeWatchpoint(id);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -106,5 +151,48 @@ bool BackendRequests::beginReadMemory(uint64_t lo, uint64_t hi, QVector<uint16_t
     return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendRequests::beginEnableTrace(bool enable)
+{
+    enableTrace(enable);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendRequests::beginReadTrace(uint32_t maxCount, QVector<IBackendRequests::TraceRecord>* records)
+{
+    readTrace(maxCount, records);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendRequests::beginEnableProfiler(bool enable, ProfileMode mode, uint32_t interval)
+{
+    enableProfiler(enable, int(mode), interval);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendRequests::beginReadProfile(IBackendRequests::Profile* profile)
+{
+    readProfile(profile);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendRequests::beginResolveAddressInfo(const QVector<uint64_t>& addresses,
+                                              QVector<IBackendRequests::AddressInfo>* info)
+{
+    resolveAddressInfo(addresses, info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendRequests::beginSearchMemory(IBackendRequests::MemorySearch* search)
+{
+    searchMemory(search);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 }
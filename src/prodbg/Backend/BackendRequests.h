@@ -21,11 +21,16 @@ public:
     // to the backend that doesn't fit any general backend
     void sendCustomString(uint16_t id, const QString& text);
 
+    // Queue events and send them in one go on commit
+    void beginTransaction();
+    void commitTransaction();
+
     // Add a breakpoint at a specific address
-    void beginAddAddressBreakpoint(uint64_t address);
+    void beginAddAddressBreakpoint(uint64_t address, const QString& condition = QString(), uint32_t hitCount = 0);
 
     // Add a breakpoint on a specific file and line number
-    void beginAddFileLineBreakpoint(const QString& filename, int line);
+    void beginAddFileLineBreakpoint(const QString& filename, int line, const QString& condition = QString(),
+                                    uint32_t hitCount = 0);
 
     // Remove a breakpoint at a specific address
     void beginRemoveAddressBreakpoint(uint64_t address);
@@ -33,6 +38,10 @@ public:
     // Remove a breakpoint on a specific file and line number
     void beginRemoveFileLineBreakpoint(const QString& filename, int line);
 
+    // Add/remove a data watchpoint
+    void beginAddWatchpoint(uint32_t id, uint64_t address, uint64_t size, WatchAccess access);
+    void beginRemoveWatchpoint(uint32_t id);
+
     // Get hw registers from the backend
     // registers = array of registers
     void beginReadRegisters(QVector<Register>* registers);
@@ -52,17 +61,46 @@ public:
     // Readable/Writeable/etc
     bool beginReadMemory(uint64_t lo, uint64_t hi, QVector<uint16_t>* target);
 
+    // Start/stop instruction tracing in the backend
+    void beginEnableTrace(bool enable);
+
+    // Read the instructions recorded since the last read
+    void beginReadTrace(uint32_t maxCount, QVector<TraceRecord>* records);
+
+    // Start/stop the profiler in the backend
+    void beginEnableProfiler(bool enable, ProfileMode mode, uint32_t interval);
+
+    // Read what has been counted since the last read
+    void beginReadProfile(Profile* profile);
+
+    // Resolve addresses to function/file/line
+    void beginResolveAddressInfo(const QVector<uint64_t>& addresses, QVector<AddressInfo>* info);
+
+    // Search target memory in the backend
+    void beginSearchMemory(MemorySearch* search);
+
 private:
     Q_SIGNAL void evalExpression(const QString& expr, uint64_t* out);
     Q_SIGNAL void sendCustomStr(uint16_t id, const QString& text);
+    Q_SIGNAL void transactionBegin();
+    Q_SIGNAL void transactionCommit();
 
-    Q_SIGNAL void toggleFileLineBreakpoint(const QString& filename, int line, bool add);
-    Q_SIGNAL void toggleAddressBreakpoint(uint64_t address, bool add);
+    Q_SIGNAL void toggleFileLineBreakpoint(const QString& filename, int line, bool add, const QString& condition,
+                                           uint32_t hitCount);
+    Q_SIGNAL void toggleAddressBreakpoint(uint64_t address, bool add, const QString& condition, uint32_t hitCount);
+    Q_SIGNAL void addWatchpoint(uint32_t id, uint64_t address, uint64_t size, int access);
+    Q_SIGNAL void removeWatchpoint(uint32_t id);
 
     Q_SIGNAL void readRegisters(QVector<Register>* registers);
     Q_SIGNAL void requestMem(uint64_t lo, uint64_t hi, QVector<uint16_t>* target);
     Q_SIGNAL void requestDisassembly(uint64_t address, uint32_t count,
                                      QVector<IBackendRequests::AssemblyInstruction>* instructions);
+    Q_SIGNAL void enableTrace(bool enable);
+    Q_SIGNAL void readTrace(uint32_t maxCount, QVector<IBackendRequests::TraceRecord>* records);
+    Q_SIGNAL void enableProfiler(bool enable, int mode, uint32_t interval);
+    Q_SIGNAL void readProfile(IBackendRequests::Profile* profile);
+    Q_SIGNAL void resolveAddressInfo(const QVector<uint64_t>& addresses, QVector<IBackendRequests::AddressInfo>* info);
+    Q_SIGNAL void searchMemory(IBackendRequests::MemorySearch* search);
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -8,8 +8,10 @@
 #include <QTimer>
 #include <pd_backend.h>
 #include <pd_io.h>
+#include <pd_profile.h>
 #include <pd_readwrite.h>
-#include <tinyexpr.h>
+#include <pd_trace.h>
+#include <string.h>
 
 namespace prodbg {
 
@@ -77,6 +79,10 @@ bool BackendSession::setBackend(const QString& backendName)
     destroyPluginData();
 
     m_backendPlugin = plugin;
+    m_registerNames.clear();
+    m_expressions.clear();
+    m_registers = RegisterSnapshot();
+    m_expressionRegistersVersion = 0;
 
     // Asserts here to verify that these are always set. TODO: Better user facing error?
 
@@ -101,6 +107,204 @@ void BackendSession::destroyPluginData()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+QString BackendSession::backendName() const
+{
+    return m_backendPlugin ? QString::fromUtf8(m_backendPlugin->name) : QString();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Plugin state is stored as a stream of tagged values so a plugin reading something else than it wrote gets an
+// error (or a conversion) instead of garbage
+
+enum StateTag
+{
+    StateTag_Int,
+    StateTag_Double,
+    StateTag_String,
+};
+
+struct StateReader
+{
+    const QByteArray* data;
+    int offset;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void stateWriteInt(void* privData, const int64_t v)
+{
+    QByteArray* out = (QByteArray*)privData;
+    out->append(char(StateTag_Int));
+    out->append((const char*)&v, sizeof(v));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void stateWriteDouble(void* privData, const double v)
+{
+    QByteArray* out = (QByteArray*)privData;
+    out->append(char(StateTag_Double));
+    out->append((const char*)&v, sizeof(v));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void stateWriteString(void* privData, const char* str)
+{
+    QByteArray* out = (QByteArray*)privData;
+    int32_t len = str ? int32_t(strlen(str)) : 0;
+    out->append(char(StateTag_String));
+    out->append((const char*)&len, sizeof(len));
+    out->append(str, len);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool stateReadValue(StateReader* reader, StateTag* tag, void* value)
+{
+    const QByteArray& data = *reader->data;
+
+    if (reader->offset + 1 + 8 > data.size()) {
+        return false;
+    }
+
+    *tag = StateTag(data[reader->offset]);
+    memcpy(value, data.constData() + reader->offset + 1, 8);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PDLoadStatus stateReadInt(void* privData, int64_t* dest)
+{
+    StateReader* reader = (StateReader*)privData;
+    StateTag tag;
+    uint64_t value;
+
+    if (!stateReadValue(reader, &tag, &value)) {
+        return PDLoadStatus_OutOfData;
+    }
+
+    if (tag == StateTag_Int) {
+        memcpy(dest, &value, sizeof(value));
+    } else if (tag == StateTag_Double) {
+        double v;
+        memcpy(&v, &value, sizeof(v));
+        *dest = int64_t(v);
+    } else {
+        return PDLoadStatus_Fail;
+    }
+
+    reader->offset += 1 + 8;
+
+    return tag == StateTag_Int ? PDLoadStatus_Ok : PDLoadStatus_Converted;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PDLoadStatus stateReadDouble(void* privData, double* dest)
+{
+    StateReader* reader = (StateReader*)privData;
+    StateTag tag;
+    uint64_t value;
+
+    if (!stateReadValue(reader, &tag, &value)) {
+        return PDLoadStatus_OutOfData;
+    }
+
+    if (tag == StateTag_Double) {
+        memcpy(dest, &value, sizeof(value));
+    } else if (tag == StateTag_Int) {
+        int64_t v;
+        memcpy(&v, &value, sizeof(v));
+        *dest = double(v);
+    } else {
+        return PDLoadStatus_Fail;
+    }
+
+    reader->offset += 1 + 8;
+
+    return tag == StateTag_Double ? PDLoadStatus_Ok : PDLoadStatus_Converted;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PDLoadStatus stateReadString(void* privData, char* dest, int maxLen)
+{
+    StateReader* reader = (StateReader*)privData;
+    const QByteArray& data = *reader->data;
+    int32_t len;
+
+    if (reader->offset + 1 + int(sizeof(len)) > data.size()) {
+        return PDLoadStatus_OutOfData;
+    }
+
+    if (data[reader->offset] != char(StateTag_String)) {
+        return PDLoadStatus_Fail;
+    }
+
+    memcpy(&len, data.constData() + reader->offset + 1, sizeof(len));
+
+    int start = reader->offset + 1 + int(sizeof(len));
+
+    if (len < 0 || start + len > data.size()) {
+        return PDLoadStatus_OutOfData;
+    }
+
+    reader->offset = start + len;
+
+    if (maxLen <= 0) {
+        return PDLoadStatus_Truncated;
+    }
+
+    int copyLen = qMin(int(len), maxLen - 1);
+    memcpy(dest, data.constData() + start, size_t(copyLen));
+    dest[copyLen] = 0;
+
+    return copyLen < len ? PDLoadStatus_Truncated : PDLoadStatus_Ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::saveState(QByteArray* state)
+{
+    state->clear();
+
+    if (!m_backendPlugin || !m_backendPluginData || !m_backendPlugin->save_state) {
+        return;
+    }
+
+    PDSaveState saveState;
+    saveState.priv_data = state;
+    saveState.write_int = stateWriteInt;
+    saveState.write_double = stateWriteDouble;
+    saveState.write_string = stateWriteString;
+
+    m_backendPlugin->save_state(m_backendPluginData, &saveState);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::loadState(const QByteArray& state)
+{
+    if (state.isEmpty() || !m_backendPlugin || !m_backendPluginData || !m_backendPlugin->load_state) {
+        return;
+    }
+
+    StateReader reader = { &state, 0 };
+
+    PDLoadState loadState;
+    loadState.priv_data = &reader;
+    loadState.read_int = stateReadInt;
+    loadState.read_double = stateReadDouble;
+    loadState.read_string = stateReadString;
+
+    m_backendPlugin->load_state(m_backendPluginData, &loadState);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void BackendSession::threadFinished()
 {
     delete this;
@@ -137,6 +341,27 @@ static const QString& getStateName(int state)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static QString getWatchpointStatus(const IBackendRequests::ProgramCounterChange& pc)
+{
+    QString access = QStringLiteral("Read/write");
+
+    if (pc.watchAccess == IBackendRequests::WatchAccess_Read) {
+        access = QStringLiteral("Read");
+    } else if (pc.watchAccess == IBackendRequests::WatchAccess_Write) {
+        access = QStringLiteral("Write");
+    }
+
+    QString status = QStringLiteral("Stop (watchpoint): %1 at 0x%2").arg(access).arg(pc.watchAddress, 0, 16);
+
+    if (pc.watchId) {
+        status += QStringLiteral(" (watchpoint %1)").arg(pc.watchId);
+    }
+
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 static uint32_t updateMemory(QVector<uint16_t>* target, PDReader* reader)
 {
     uint8_t* data;
@@ -165,68 +390,97 @@ static uint32_t updateMemory(QVector<uint16_t>* target, PDReader* reader)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static uint32_t updateDisassembly(QVector<IBackendRequests::AssemblyInstruction>* instructions, PDReader* reader)
+static void updateRegisterNames(QVector<QString>* registerNames, PDReader* reader)
 {
-    uint32_t addressWidth = 0;
-
     PDReaderIterator it;
 
-    PDRead_find_u32(reader, &addressWidth, "address_width", 0);
-
-    if (PDRead_find_array(reader, &it, "disassembly", 0) == PDReadStatus_NotFound) {
-        return addressWidth;
+    if (PDRead_find_array(reader, &it, "register_names", 0) == PDReadStatus_NotFound) {
+        return;
     }
 
+    registerNames->resize(0);
+
     while (PDRead_get_next_entry(reader, &it)) {
-        uint64_t address;
-        const char* text;
+        const char* name = "";
 
-        IBackendRequests::AssemblyInstruction inst;
+        PDRead_find_string(reader, &name, "name", it);
 
-        PDRead_find_u64(reader, &address, "address", it);
-        PDRead_find_string(reader, &text, "line", it);
+        registerNames->append(QString::fromUtf8(name));
+    }
+}
 
-        inst.text = QString::fromUtf8(text);
-        inst.address = address;
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The backend sends registers used by an instruction as a mask of register ids. The names are taken from the table
+// given by the backend (see updateRegisterNames) so no strings needs to be allocated here.
 
-        instructions->append(inst);
-    }
+static void resolveRegisterMask(QVector<QString>* target, const QVector<QString>& registerNames, uint64_t mask)
+{
+    const int count = qMin(registerNames.size(), 64);
 
-    return addressWidth;
+    for (int i = 0; i < count && mask; ++i) {
+        const uint64_t bit = uint64_t(1) << i;
+
+        if (mask & bit) {
+            target->append(registerNames[i]);
+            mask &= ~bit;
+        }
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void updateRegisters(QVector<IBackendRequests::Register>* target, PDReader* reader)
+static uint32_t updateDisassembly(QVector<IBackendRequests::AssemblyInstruction>* instructions,
+                                  QVector<QString>* registerNames, PDReader* reader)
 {
+    uint32_t addressWidth = 0;
+
     PDReaderIterator it;
 
-    if (PDRead_find_array(reader, &it, "registers", 0) == PDReadStatus_NotFound) {
-        printf("Unable to find registers array\n");
-        return;
+    PDRead_find_u32(reader, &addressWidth, "address_width", 0);
+
+    updateRegisterNames(registerNames, reader);
+
+    if (PDRead_find_array(reader, &it, "disassembly", 0) == PDReadStatus_NotFound) {
+        return addressWidth;
     }
 
     while (PDRead_get_next_entry(reader, &it)) {
-        const char* name = "";
-        uint8_t* data = 0;
-        uint64_t size = 0;
-        uint8_t read_only = 0;
+        uint64_t address;
+        uint64_t readMask = 0;
+        uint64_t writeMask = 0;
+        uint64_t branchTarget = 0;
+        uint8_t flags = 0;
+        uint32_t callerCount = 0;
+        const char* text;
 
-        IBackendRequests::Register reg;
+        IBackendRequests::AssemblyInstruction inst;
 
-        PDRead_find_string(reader, &name, "name", it);
-        PDRead_find_u8(reader, &read_only, "read_only", it);
-        PDRead_find_data(reader, (void**)&data, &size, "register", it);
+        PDRead_find_u64(reader, &address, "address", it);
+        PDRead_find_string(reader, &text, "line", it);
+        PDRead_find_u64(reader, &readMask, "regs_read", it);
+        PDRead_find_u64(reader, &writeMask, "regs_write", it);
+        PDRead_find_u8(reader, &flags, "flags", it);
+        PDRead_find_u32(reader, &callerCount, "caller_count", it);
+
+        if (PDRead_find_u64(reader, &branchTarget, "branch_target", it) != PDReadStatus_NotFound) {
+            inst.branch_target = branchTarget;
+            inst.has_branch_target = true;
+        }
 
-        reg.name = QString::fromUtf8(name);
-        reg.read_only = read_only ? true : false;
+        inst.text = QString::fromUtf8(text);
+        inst.address = address;
+        inst.read_mask = readMask;
+        inst.write_mask = writeMask;
+        inst.flags = flags;
+        inst.caller_count = callerCount;
 
-        for (int i = 0; i < size; ++i) {
-            reg.data.append(data[i]);
-        }
+        resolveRegisterMask(&inst.read_registers, *registerNames, readMask);
+        resolveRegisterMask(&inst.write_registers, *registerNames, writeMask);
 
-        target->append(reg);
+        instructions->append(inst);
     }
+
+    return addressWidth;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -285,15 +539,19 @@ static uint64_t getRegValue(uint8_t* data, int size)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static int buildExpressionVars(te_variable* variables, uint64_t* values, int maxRegs, PDReader* reader)
+// Decodes a register reply into the snapshot. The register layout (names, sizes) is the same between stops for a
+// target so if it matches the previous reply the data is updated in place and no strings are created.
+
+void BackendSession::decodeRegisters(PDReader* reader)
 {
     PDReaderIterator it;
 
     if (PDRead_find_array(reader, &it, "registers", 0) == PDReadStatus_NotFound) {
         printf("Unable to find registers array\n");
-        return 0;
+        return;
     }
 
+    RegisterSnapshot& snapshot = m_registers;
     int index = 0;
 
     while (PDRead_get_next_entry(reader, &it)) {
@@ -306,68 +564,217 @@ static int buildExpressionVars(te_variable* variables, uint64_t* values, int max
         PDRead_find_u8(reader, &read_only, "read_only", it);
         PDRead_find_data(reader, (void**)&data, &size, "register", it);
 
-        values[index] = getRegValue(data, size);
+        if (index >= snapshot.registers.count() || snapshot.rawNames[index] != name) {
+            // Layout changed. Drop everything from here and build it again
+            snapshot.registers.resize(index);
+            snapshot.rawNames.resize(index);
+            snapshot.names.resize(index);
+            snapshot.values.resize(index);
+
+            IBackendRequests::Register reg;
+            reg.name = QString::fromUtf8(name);
+
+            snapshot.registers.append(reg);
+            snapshot.rawNames.append(QByteArray(name));
+            snapshot.names.append(reg.name);
+            snapshot.values.append(0);
+        }
+
+        IBackendRequests::Register& reg = snapshot.registers[index];
+
+        reg.read_only = read_only ? true : false;
+        reg.data.resize(int(size));
+
+        if (size > 0) {
+            memcpy(reg.data.data(), data, size);
+        }
 
-        variables[index].name = name; // this is safe as we use this result directly without reseting any streams
-        variables[index].address = &values[index];
-        variables[index].type = 0;
-        variables[index].context = nullptr;
+        snapshot.values[index] = data ? getRegValue(data, size) : 0;
 
         ++index;
+    }
 
-        if (index >= maxRegs) {
-            printf("buildExpressionVars: Reached max regs, no more will be added");
-            break;
+    snapshot.registers.resize(index);
+    snapshot.rawNames.resize(index);
+    snapshot.names.resize(index);
+    snapshot.values.resize(index);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the registers for the current stop. They are only requested from the backend the first time after the
+// target has stopped (or stepped) and then shared between the register view and expression evaluation
+
+const BackendSession::RegisterSnapshot& BackendSession::registerSnapshot()
+{
+    if (m_registers.valid) {
+        return m_registers;
+    }
+
+    uint32_t event = 0;
+
+    PDWrite_event_begin(m_currentWriter, PDEventType_GetRegisters);
+    PDWrite_event_end(m_currentWriter);
+
+    update();
+
+    while ((event = PDRead_get_event(m_reader))) {
+        if (event != PDEventType_SetRegisters) {
+            continue;
         }
+
+        decodeRegisters(m_reader);
+
+        m_registers.valid = true;
+        m_registers.version++;
+        break;
     }
 
-    return index;
+    return m_registers;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void BackendSession::toggleAddressBreakpoint(uint64_t address, bool add)
+void BackendSession::invalidateRegisters()
 {
-    PDWrite_event_begin(m_currentWriter, PDEventType_SetBreakpoint);
+    m_registers.valid = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Condition and hit count are optional. Backends that doesn't support them will just ignore the extra fields
+
+static void writeBreakpointCondition(PDWriter* writer, const QString& condition, uint32_t hitCount)
+{
+    if (!condition.isEmpty()) {
+        PDWrite_string(writer, "condition", condition.toUtf8().data());
+    }
+
+    if (hitCount > 0) {
+        PDWrite_u32(writer, "hit_count", hitCount);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Events that don't need a reply are queued while a transaction is open and sent with a single update on commit
+
+void BackendSession::flushEvents()
+{
+    if (m_transactionDepth > 0) {
+        m_transactionEvents++;
+        return;
+    }
+
+    update();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::beginTransaction()
+{
+    m_transactionDepth++;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::commitTransaction()
+{
+    if (m_transactionDepth == 0 || --m_transactionDepth > 0) {
+        return;
+    }
+
+    int eventCount = m_transactionEvents;
+    m_transactionEvents = 0;
+
+    if (eventCount > 0) {
+        update();
+    }
+
+    endCommitTransaction(eventCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::toggleAddressBreakpoint(uint64_t address, bool add, const QString& condition, uint32_t hitCount)
+{
+    PDWrite_event_begin(m_currentWriter, add ? PDEventType_SetBreakpoint : PDEventType_DeleteBreakpoint);
     PDWrite_u64(m_currentWriter, "address", address);
+    writeBreakpointCondition(m_currentWriter, condition, hitCount);
     PDWrite_event_end(m_currentWriter);
 
-    update();
+    flushEvents();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void BackendSession::toggleFileLineBreakpoint(const QString& filename, int line, bool add)
+void BackendSession::toggleFileLineBreakpoint(const QString& filename, int line, bool add, const QString& condition,
+                                              uint32_t hitCount)
 {
-    PDWrite_event_begin(m_currentWriter, PDEventType_SetBreakpoint);
+    PDWrite_event_begin(m_currentWriter, add ? PDEventType_SetBreakpoint : PDEventType_DeleteBreakpoint);
     PDWrite_string(m_currentWriter, "filename", filename.toUtf8().data());
     PDWrite_u32(m_currentWriter, "line", line);
+    writeBreakpointCondition(m_currentWriter, condition, hitCount);
     PDWrite_event_end(m_currentWriter);
 
-    update();
+    flushEvents();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Backends that don't support watchpoints doesn't reply so that is treated the same as failing to set it
 
-void BackendSession::beginReadRegisters(QVector<IBackendRequests::Register>* target)
+void BackendSession::addWatchpoint(uint32_t id, uint64_t address, uint64_t size, int access)
 {
-    uint32_t event = 0;
+    uint32_t event;
+    bool ok = false;
 
-    PDWrite_event_begin(m_currentWriter, PDEventType_GetRegisters);
+    PDWrite_event_begin(m_currentWriter, PDEventType_SetWatchpoint);
+    PDWrite_u32(m_currentWriter, "id", id);
+    PDWrite_u64(m_currentWriter, "address", address);
+    PDWrite_u64(m_currentWriter, "size", size);
+    PDWrite_u8(m_currentWriter, "access", uint8_t(access));
     PDWrite_event_end(m_currentWriter);
 
     update();
 
-    target->resize(0);
-
     while ((event = PDRead_get_event(m_reader))) {
-        if (event != PDEventType_SetRegisters) {
-            continue;
-        }
+        switch (event) {
+            case PDEventType_ReplyWatchpoint: {
+                uint32_t replyId = 0;
+                uint8_t status = 0;
+
+                PDRead_find_u32(m_reader, &replyId, "id", 0);
+                PDRead_find_u8(m_reader, &status, "status", 0);
 
-        updateRegisters(target, m_reader);
+                if (replyId == id) {
+                    ok = status != 0;
+                }
+
+                break;
+            }
+        }
     }
 
+    endAddWatchpoint(id, ok);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::removeWatchpoint(uint32_t id)
+{
+    PDWrite_event_begin(m_currentWriter, PDEventType_DeleteWatchpoint);
+    PDWrite_u32(m_currentWriter, "id", id);
+    PDWrite_event_end(m_currentWriter);
+
+    flushEvents();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::beginReadRegisters(QVector<IBackendRequests::Register>* target)
+{
+    // Implicitly shared so this doesn't copy the register data
+    *target = registerSnapshot().registers;
+
     endReadRegisters(target);
 }
 
@@ -421,7 +828,7 @@ void BackendSession::beginDisassembly(uint64_t address, uint32_t count,
     while ((event = PDRead_get_event(m_reader))) {
         switch (event) {
             case PDEventType_SetDisassembly: {
-                addressWidth = updateDisassembly(target, m_reader);
+                addressWidth = updateDisassembly(target, &m_registerNames, m_reader);
                 break;
             }
         }
@@ -432,53 +839,377 @@ void BackendSession::beginDisassembly(uint64_t address, uint32_t count,
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void BackendSession::sendCustomString(uint16_t id, const QString& text)
+void BackendSession::enableTrace(bool enable)
 {
-    PDWrite_event_begin(m_currentWriter, id);
-    PDWrite_string(m_currentWriter, "text", text.toUtf8().data());
+    PDWrite_event_begin(m_currentWriter, PDEventType_EnableTrace);
+    PDWrite_u8(m_currentWriter, "enable", enable ? 1 : 0);
+    PDWrite_event_end(m_currentWriter);
+
+    flushEvents();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Appends the records in a SetTrace event to target and returns how many there was
+
+static uint32_t updateTrace(QVector<IBackendRequests::TraceRecord>* target, uint64_t* dropped, PDReader* reader)
+{
+    void* data = nullptr;
+    uint64_t size = 0;
+    uint32_t count = 0;
+
+    PDRead_find_u32(reader, &count, "count", 0);
+    PDRead_find_u64(reader, dropped, "dropped", 0);
+
+    if (PDRead_find_data(reader, &data, &size, "data", 0) == PDReadStatus_NotFound) {
+        return 0;
+    }
+
+    count = qMin<uint32_t>(count, uint32_t(size / sizeof(PDTraceRecord)));
+
+    const PDTraceRecord* records = (const PDTraceRecord*)data;
+    int start = target->size();
+
+    target->resize(start + int(count));
+    IBackendRequests::TraceRecord* dest = target->data() + start;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        dest[i].pc = records[i].pc;
+        dest[i].opcode = records[i].opcode;
+        dest[i].changedRegisters = records[i].changed_registers;
+        memcpy(dest[i].values, records[i].values, sizeof(dest[i].values));
+    }
+
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The backend sends a limited number of records per event so this keeps asking for more until it runs out or
+// maxCount has been read
+
+void BackendSession::beginReadTrace(uint32_t maxCount, QVector<IBackendRequests::TraceRecord>* target)
+{
+    uint64_t dropped = 0;
+
+    target->resize(0);
+
+    while (uint32_t(target->size()) < maxCount) {
+        uint32_t request = qMin<uint32_t>(maxCount - uint32_t(target->size()), PD_TRACE_MAX_EVENT_RECORDS);
+        uint32_t received = 0;
+        uint32_t event;
+
+        PDWrite_event_begin(m_currentWriter, PDEventType_GetTrace);
+        PDWrite_u32(m_currentWriter, "max_count", request);
+        PDWrite_event_end(m_currentWriter);
+
+        update();
+
+        while ((event = PDRead_get_event(m_reader))) {
+            switch (event) {
+                case PDEventType_SetTrace: {
+                    received += updateTrace(target, &dropped, m_reader);
+                    break;
+                }
+            }
+        }
+
+        if (received < request) {
+            break;
+        }
+    }
+
+    endReadTrace(target, dropped);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::enableProfiler(bool enable, int mode, uint32_t interval)
+{
+    PDWrite_event_begin(m_currentWriter, PDEventType_EnableProfile);
+    PDWrite_u8(m_currentWriter, "enable", enable ? 1 : 0);
+    PDWrite_u8(m_currentWriter, "mode", uint8_t(mode));
+    PDWrite_u32(m_currentWriter, "interval", interval);
+    PDWrite_event_end(m_currentWriter);
+
+    flushEvents();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void updateProfile(IBackendRequests::Profile* target, PDReader* reader)
+{
+    void* data = nullptr;
+    uint64_t size = 0;
+    uint8_t mode = 0;
+
+    PDRead_find_u8(reader, &mode, "mode", 0);
+    PDRead_find_u64(reader, &target->ticks, "ticks", 0);
+
+    target->mode = IBackendRequests::ProfileMode(mode);
+
+    if (PDRead_find_data(reader, &data, &size, "samples", 0) != PDReadStatus_NotFound) {
+        const PDProfileEntry* entries = (const PDProfileEntry*)data;
+        int count = int(size / sizeof(PDProfileEntry));
+
+        target->samples.resize(count);
+
+        for (int i = 0; i < count; ++i) {
+            target->samples[i].address = entries[i].address;
+            target->samples[i].count = entries[i].count;
+        }
+    }
+
+    if (PDRead_find_data(reader, &data, &size, "calls", 0) != PDReadStatus_NotFound) {
+        const PDProfileCall* calls = (const PDProfileCall*)data;
+        int count = int(size / sizeof(PDProfileCall));
+
+        target->calls.resize(count);
+
+        for (int i = 0; i < count; ++i) {
+            target->calls[i].site = calls[i].site;
+            target->calls[i].target = calls[i].target;
+            target->calls[i].count = calls[i].count;
+            target->calls[i].ticks = calls[i].ticks;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::beginReadProfile(IBackendRequests::Profile* target)
+{
+    uint32_t event;
+
+    target->supported = false;
+    target->ticks = 0;
+    target->samples.resize(0);
+    target->calls.resize(0);
+
+    PDWrite_event_begin(m_currentWriter, PDEventType_GetProfile);
     PDWrite_event_end(m_currentWriter);
 
     update();
+
+    while ((event = PDRead_get_event(m_reader))) {
+        switch (event) {
+            case PDEventType_SetProfile: {
+                target->supported = true;
+                updateProfile(target, m_reader);
+                break;
+            }
+        }
+    }
+
+    endReadProfile(target);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void BackendSession::evalExpression(const QString& expression, uint64_t* out)
+static void updateAddressInfo(QVector<IBackendRequests::AddressInfo>* target, PDReader* reader)
 {
-    te_variable variables[512];
-    uint64_t values[512];
+    PDReaderIterator it;
 
-    uint32_t event = 0;
-    int error = 0;
-    int maxRegs = 512;
-    int regCount = 0;
+    if (PDRead_find_array(reader, &it, "info", 0) == PDReadStatus_NotFound) {
+        return;
+    }
 
-    // Get the registers
+    while (PDRead_get_next_entry(reader, &it)) {
+        IBackendRequests::AddressInfo info;
+        const char* symbol = nullptr;
+        const char* filename = nullptr;
+        uint32_t line = 0;
 
-    PDWrite_event_begin(m_currentWriter, PDEventType_GetRegisters);
+        PDRead_find_u64(reader, &info.address, "address", it);
+
+        if (PDRead_find_string(reader, &symbol, "symbol", it) != PDReadStatus_NotFound) {
+            info.symbol = QString::fromUtf8(symbol);
+        }
+
+        if (PDRead_find_u64(reader, &info.symbolAddress, "symbol_address", it) != PDReadStatus_NotFound) {
+            info.hasSymbolAddress = true;
+        }
+
+        if (PDRead_find_string(reader, &filename, "filename", it) != PDReadStatus_NotFound) {
+            info.filename = QString::fromUtf8(filename);
+            PDRead_find_u32(reader, &line, "line", it);
+            info.line = int(line);
+        }
+
+        target->append(info);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Addresses are sent a few thousand at a time to keep the replies (with file names and symbols) well within the
+// event buffer. Backends that don't have any debug info doesn't reply so those addresses are left with no info
+
+void BackendSession::beginResolveAddressInfo(const QVector<uint64_t>& addresses,
+                                             QVector<IBackendRequests::AddressInfo>* target)
+{
+    const int chunkSize = 4096;
+
+    target->resize(0);
+
+    for (int start = 0; start < addresses.size(); start += chunkSize) {
+        int count = qMin(chunkSize, addresses.size() - start);
+        int received = target->size();
+        uint32_t event;
+
+        PDWrite_event_begin(m_currentWriter, PDEventType_GetAddressInfo);
+        PDWrite_data(m_currentWriter, "addresses", (void*)(addresses.constData() + start),
+                     uint32_t(count * sizeof(uint64_t)));
+        PDWrite_event_end(m_currentWriter);
+
+        update();
+
+        while ((event = PDRead_get_event(m_reader))) {
+            switch (event) {
+                case PDEventType_SetAddressInfo: {
+                    updateAddressInfo(target, m_reader);
+                    break;
+                }
+            }
+        }
+
+        // Pad with empty info if the backend didn't reply (or replied with less) so the entries still match
+        // the addresses
+
+        int replied = qMin(target->size() - received, count);
+
+        target->resize(received + count);
+
+        for (int i = replied; i < count; ++i) {
+            (*target)[received + i].address = addresses[start + i];
+        }
+    }
+
+    endResolveAddressInfo(target);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The whole range is searched in one request as the backend limits the number of matches to what fits in the reply
+
+void BackendSession::beginSearchMemory(IBackendRequests::MemorySearch* search)
+{
+    uint32_t event;
+
+    search->matches.resize(0);
+    search->truncated = false;
+
+    PDWrite_event_begin(m_currentWriter, PDEventType_SearchMemory);
+    PDWrite_u64(m_currentWriter, "start", search->start);
+    PDWrite_u64(m_currentWriter, "end", search->end);
+    PDWrite_data(m_currentWriter, "pattern", (void*)search->pattern.constData(), uint32_t(search->pattern.size()));
+
+    if (!search->mask.isEmpty()) {
+        PDWrite_data(m_currentWriter, "mask", (void*)search->mask.constData(), uint32_t(search->mask.size()));
+    }
+
+    PDWrite_u8(m_currentWriter, "alignment", search->alignment);
+    PDWrite_u32(m_currentWriter, "max_matches", search->maxMatches);
     PDWrite_event_end(m_currentWriter);
 
     update();
 
     while ((event = PDRead_get_event(m_reader))) {
-        if (event != PDEventType_SetRegisters) {
+        switch (event) {
+            case PDEventType_SetSearchResult: {
+                void* data = nullptr;
+                uint64_t size = 0;
+                uint8_t truncated = 0;
+
+                if (PDRead_find_data(m_reader, &data, &size, "matches", 0) != PDReadStatus_NotFound) {
+                    int count = int(size / sizeof(uint64_t));
+                    search->matches.resize(count);
+                    memcpy(search->matches.data(), data, count * sizeof(uint64_t));
+                }
+
+                PDRead_find_u8(m_reader, &truncated, "truncated", 0);
+                search->truncated = truncated != 0;
+                break;
+            }
+        }
+    }
+
+    endSearchMemory(search);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::sendCustomString(uint16_t id, const QString& text)
+{
+    PDWrite_event_begin(m_currentWriter, id);
+    PDWrite_string(m_currentWriter, "text", text.toUtf8().data());
+    PDWrite_event_end(m_currentWriter);
+
+    flushEvents();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::updateExpressionRegisters()
+{
+    const RegisterSnapshot& snapshot = registerSnapshot();
+
+    if (snapshot.version != m_expressionRegistersVersion) {
+        m_expressions.setRegisters(snapshot.names, snapshot.values);
+        m_expressionRegistersVersion = snapshot.version;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Used for memory dereferences ([address]) in expressions. Values are read in big endian order the same way as
+// register values are
+
+bool BackendSession::readExpressionMemory(void* userData, uint64_t address, int size, uint64_t* value)
+{
+    BackendSession* session = (BackendSession*)userData;
+    uint32_t event = 0;
+    bool found = false;
+
+    PDWrite_event_begin(session->m_currentWriter, PDEventType_GetMemory);
+    PDWrite_u64(session->m_currentWriter, "address_start", address);
+    PDWrite_u64(session->m_currentWriter, "size", size);
+    PDWrite_event_end(session->m_currentWriter);
+
+    session->update();
+
+    while ((event = PDRead_get_event(session->m_reader))) {
+        if (event != PDEventType_SetMemory) {
             continue;
         }
 
-        regCount = buildExpressionVars(variables, values, maxRegs, m_reader);
+        uint8_t* data = 0;
+        uint64_t dataSize = 0;
+
+        if (PDRead_find_data(session->m_reader, (void**)&data, &dataSize, "data", 0) == PDReadStatus_NotFound ||
+            dataSize < uint64_t(size)) {
+            break;
+        }
+
+        uint64_t v = 0;
+
+        for (int i = 0; i < size; ++i) {
+            v = (v << 8) | data[i];
+        }
 
+        *value = v;
+        found = true;
         break;
     }
 
-    // qDebug() << "eval expression " << expression;
+    return found;
+}
 
-    te_expr* expr = te_compile(expression.toUtf8().data(), variables, regCount, &error);
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    if (error != 0) {
-        endResolveAddress(nullptr);
-    } else {
-        *out = te_eval(expr);
+void BackendSession::evalExpression(const QString& expression, uint64_t* out)
+{
+    updateExpressionRegisters();
+
+    if (m_expressions.eval(expression, out, readExpressionMemory, this)) {
         endResolveAddress(out);
+    } else {
+        endResolveAddress(nullptr);
     }
 }
 
@@ -495,6 +1226,9 @@ void BackendSession::updateCurrentPc()
             continue;
         }
 
+        // Target has stopped at a new location so registers needs to be fetched again
+        invalidateRegisters();
+
         IBackendRequests::ProgramCounterChange pcChange;
 
         uint64_t pc = 0;
@@ -524,7 +1258,21 @@ void BackendSession::updateCurrentPc()
 
         pcChange.programCounter = pc;
 
-        if (pc != m_currentPc || fileLineChaged) {
+        uint8_t watchAccess = 0;
+
+        if (PDRead_find_u8(m_reader, &watchAccess, "watch_access", 0) != PDReadStatus_NotFound) {
+            PDRead_find_u64(m_reader, &pcChange.watchAddress, "watch_address", 0);
+            PDRead_find_u32(m_reader, &pcChange.watchId, "watch_id", 0);
+            pcChange.watchAccess = watchAccess;
+
+            // Sent after the state name so the status bar shows the watchpoint instead of a breakpoint stop
+            statusUpdate(getWatchpointStatus(pcChange));
+        }
+
+        // A watchpoint can be hit again without the pc moving (a loop that only writes to it) so that is always
+        // sent
+
+        if (pc != m_currentPc || fileLineChaged || pcChange.watchAccess) {
             m_currentPc = pc;
             programCounterChanged(pcChange);
         }
@@ -551,6 +1299,10 @@ PDDebugState BackendSession::internalUpdate(PDAction action)
 
     PDDebugState state = m_backendPlugin->update(m_backendPluginData, action, m_reader, m_prevWriter);
 
+    if (action != PDAction_None || state == PDDebugState_Running) {
+        invalidateRegisters();
+    }
+
     pd_binary_writer_finalize(m_prevWriter);
 
     pd_binary_reader_init_stream(m_reader, pd_binary_writer_get_data(m_prevWriter),
@@ -645,5 +1397,22 @@ void BackendSession::stepOver()
     updateCurrentPc();
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Backends without an execution history ignores these
+
+void BackendSession::reverseStep()
+{
+    internalUpdate(PDAction_ReverseStep);
+    updateCurrentPc();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BackendSession::reverseContinue()
+{
+    internalUpdate(PDAction_ReverseContinue);
+    updateCurrentPc();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 }
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "ExpressionEvaluator.h"
 #include "IBackendRequests.h"
+#include <QByteArray>
 #include <QObject>
+#include <QVector>
 #include <pd_backend.h>
 
 class QString;
@@ -25,10 +28,15 @@ public:
     static BackendSession* createBackendSession(const QString& backendName);
     bool setBackend(const QString& backendName);
 
+    // Name of the backend plugin. Set when the session is created so it's safe to call from any thread
+    QString backendName() const;
+
     Q_SLOT void start();
     Q_SLOT void stop();
     Q_SLOT void stepIn();
     Q_SLOT void stepOver();
+    Q_SLOT void reverseStep();
+    Q_SLOT void reverseContinue();
     Q_SLOT void update();
     Q_SLOT void breakContDebug();
 
@@ -37,36 +45,95 @@ public:
 
     Q_SLOT void sendCustomString(uint16_t id, const QString& text);
 
-    Q_SLOT void toggleAddressBreakpoint(uint64_t address, bool add);
-    Q_SLOT void toggleFileLineBreakpoint(const QString& filename, int line, bool add);
+    Q_SLOT void beginTransaction();
+    Q_SLOT void commitTransaction();
+
+    // Plugin state (save_state/load_state) for the session file. The data is only understood by the plugin
+    Q_SLOT void saveState(QByteArray* state);
+    Q_SLOT void loadState(const QByteArray& state);
+
+    Q_SLOT void toggleAddressBreakpoint(uint64_t address, bool add, const QString& condition, uint32_t hitCount);
+    Q_SLOT void addWatchpoint(uint32_t id, uint64_t address, uint64_t size, int access);
+    Q_SLOT void removeWatchpoint(uint32_t id);
+    Q_SLOT void toggleFileLineBreakpoint(const QString& filename, int line, bool add, const QString& condition,
+                                         uint32_t hitCount);
 
     Q_SLOT void beginReadRegisters(QVector<IBackendRequests::Register>* target);
     Q_SLOT void beginReadMemory(uint64_t lo, uint64_t hi, QVector<uint16_t>* target);
     Q_SLOT void beginDisassembly(uint64_t address, uint32_t count,
                                  QVector<IBackendRequests::AssemblyInstruction>* target);
 
+    Q_SLOT void enableTrace(bool enable);
+    Q_SLOT void beginReadTrace(uint32_t maxCount, QVector<IBackendRequests::TraceRecord>* target);
+
+    Q_SLOT void enableProfiler(bool enable, int mode, uint32_t interval);
+    Q_SLOT void beginReadProfile(IBackendRequests::Profile* target);
+    Q_SLOT void beginResolveAddressInfo(const QVector<uint64_t>& addresses,
+                                        QVector<IBackendRequests::AddressInfo>* target);
+    Q_SLOT void beginSearchMemory(IBackendRequests::MemorySearch* search);
+
     // Signals
     Q_SIGNAL void endResolveAddress(uint64_t* out);
+    Q_SIGNAL void endCommitTransaction(int eventCount);
     Q_SIGNAL void endReadRegisters(QVector<IBackendRequests::Register>* registers);
     Q_SIGNAL void endDisassembly(QVector<IBackendRequests::AssemblyInstruction>* instructions, int adressWidth);
     Q_SIGNAL void endReadMemory(QVector<uint16_t>* res, uint64_t address, int addressWidth);
+    Q_SIGNAL void endReadTrace(QVector<IBackendRequests::TraceRecord>* records, uint64_t dropped);
+    Q_SIGNAL void endReadProfile(IBackendRequests::Profile* profile);
+    Q_SIGNAL void endResolveAddressInfo(QVector<IBackendRequests::AddressInfo>* info);
+    Q_SIGNAL void endAddWatchpoint(uint32_t id, bool ok);
+    Q_SIGNAL void endSearchMemory(IBackendRequests::MemorySearch* search);
     Q_SIGNAL void programCounterChanged(const IBackendRequests::ProgramCounterChange& pc);
     Q_SIGNAL void statusUpdate(const QString& update);
     Q_SIGNAL void sourceFileLineChanged(const QString& filename, uint32_t line);
     Q_SIGNAL void sessionEnded();
 
 private:
+    //
+    // Registers for the current stop. version is bumped each time the registers are fetched from the backend so
+    // users can tell if anything needs to be updated
+    //
+    struct RegisterSnapshot
+    {
+        QVector<IBackendRequests::Register> registers;
+        QVector<QByteArray> rawNames;
+        QVector<QString> names;
+        QVector<uint64_t> values;
+        uint32_t version = 0;
+        bool valid = false;
+    };
+
+    const RegisterSnapshot& registerSnapshot();
+    void decodeRegisters(PDReader* reader);
+    void invalidateRegisters();
+
     void updateCurrentPc();
+    void updateExpressionRegisters();
+    void flushEvents();
+    static bool readExpressionMemory(void* userData, uint64_t address, int size, uint64_t* value);
     void destroyPluginData();
 
     PDDebugState internalUpdate(PDAction action);
 
     PDDebugState m_debugState = PDDebugState_NoTarget;
 
+    // Open transactions (nested begin/commit) and the number of events queued in them
+    int m_transactionDepth = 0;
+    int m_transactionEvents = 0;
+
     QString m_currentFile;
     uint32_t m_currentLine = 0;
     uint64_t m_currentPc = 0;
 
+    // Register names sent by the backend with the first disassembly. Used to resolve the register masks
+    QVector<QString> m_registerNames;
+
+    // Compiled watch/memory view expressions and the register snapshot they are evaluated against
+    ExpressionEvaluator m_expressions;
+    uint32_t m_expressionRegistersVersion = 0;
+
+    RegisterSnapshot m_registers;
+
     // Writers/Read for communitaction between backend and UI
     PDWriter* m_writer0;
     PDWriter* m_writer1;
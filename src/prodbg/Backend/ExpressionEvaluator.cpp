@@ -0,0 +1,423 @@
+#include "ExpressionEvaluator.h"
+#include <ctype.h>
+#include <string.h>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Recursive descent parser that emits the bytecode directly (in RPN order) while parsing
+
+class ExpressionParser
+{
+public:
+    typedef ExpressionEvaluator::Instruction Instruction;
+    typedef ExpressionEvaluator::Opcode Opcode;
+
+    ExpressionParser(const QString& text, const QHash<QString, int>& registerSlots, QVector<Instruction>* code)
+        : m_text(text)
+        , m_registerSlots(registerSlots)
+        , m_code(code)
+    {
+    }
+
+    bool parse()
+    {
+        if (!parseBinary(0)) {
+            return false;
+        }
+
+        skipSpaces();
+
+        return m_pos == m_text.size();
+    }
+
+private:
+    void skipSpaces()
+    {
+        while (m_pos < m_text.size() && m_text[m_pos].isSpace()) {
+            m_pos++;
+        }
+    }
+
+    bool accept(const char* token)
+    {
+        skipSpaces();
+
+        int len = int(strlen(token));
+
+        if (m_text.midRef(m_pos, len) != QLatin1String(token)) {
+            return false;
+        }
+
+        m_pos += len;
+
+        return true;
+    }
+
+    void addInstruction(Opcode op, uint64_t arg = 0)
+    {
+        Instruction inst = { op, arg };
+        m_code->append(inst);
+    }
+
+    bool parseNumber()
+    {
+        int base = 10;
+        int start = m_pos;
+
+        if (m_text[m_pos] == QLatin1Char('$')) {
+            base = 16;
+            start = ++m_pos;
+        } else if (m_text.midRef(m_pos, 2).compare(QLatin1String("0x"), Qt::CaseInsensitive) == 0) {
+            base = 16;
+            m_pos += 2;
+            start = m_pos;
+        }
+
+        while (m_pos < m_text.size() && (base == 16 ? isxdigit(m_text[m_pos].toLatin1()) : m_text[m_pos].isDigit())) {
+            m_pos++;
+        }
+
+        bool ok = false;
+        uint64_t value = m_text.midRef(start, m_pos - start).toULongLong(&ok, base);
+
+        if (!ok) {
+            return false;
+        }
+
+        addInstruction(ExpressionEvaluator::Op_Const, value);
+
+        return true;
+    }
+
+    bool parseRegister()
+    {
+        int start = m_pos;
+
+        while (m_pos < m_text.size() && (m_text[m_pos].isLetterOrNumber() || m_text[m_pos] == QLatin1Char('_'))) {
+            m_pos++;
+        }
+
+        auto it = m_registerSlots.constFind(m_text.mid(start, m_pos - start).toLower());
+
+        if (it == m_registerSlots.constEnd()) {
+            return false;
+        }
+
+        addInstruction(ExpressionEvaluator::Op_Reg, uint64_t(it.value()));
+
+        return true;
+    }
+
+    bool parseMemory()
+    {
+        if (!parseBinary(0) || !accept("]")) {
+            return false;
+        }
+
+        int size = 4;
+
+        if (m_pos + 1 < m_text.size() && m_text[m_pos] == QLatin1Char('.')) {
+            switch (m_text[m_pos + 1].toLower().toLatin1()) {
+                case 'b': size = 1; break;
+                case 'w': size = 2; break;
+                case 'l': size = 4; break;
+                case 'q': size = 8; break;
+                default: return false;
+            }
+
+            m_pos += 2;
+        }
+
+        addInstruction(ExpressionEvaluator::Op_Load, uint64_t(size));
+
+        return true;
+    }
+
+    bool parseUnary()
+    {
+        skipSpaces();
+
+        if (m_pos >= m_text.size()) {
+            return false;
+        }
+
+        QChar c = m_text[m_pos];
+
+        if (c.isDigit() || c == QLatin1Char('$')) {
+            return parseNumber();
+        }
+
+        if (c.isLetter() || c == QLatin1Char('_')) {
+            return parseRegister();
+        }
+
+        m_pos++;
+
+        switch (c.toLatin1()) {
+            case '(': return parseBinary(0) && accept(")");
+            case '[': return parseMemory();
+            case '-': return parseUnaryOp(ExpressionEvaluator::Op_Neg);
+            case '~': return parseUnaryOp(ExpressionEvaluator::Op_Not);
+            case '!': return parseUnaryOp(ExpressionEvaluator::Op_LogicalNot);
+            case '+': return parseUnary();
+        }
+
+        return false;
+    }
+
+    bool parseUnaryOp(Opcode op)
+    {
+        if (!parseUnary()) {
+            return false;
+        }
+
+        addInstruction(op);
+
+        return true;
+    }
+
+    // Returns the precedence of the binary operator at the current position (and the length of it) or -1
+
+    int peekBinary(Opcode* op, int* len)
+    {
+        struct BinaryOp
+        {
+            const char* token;
+            Opcode op;
+            int precedence;
+        };
+
+        // Longer tokens first so "<<" is found before "<"
+        static const BinaryOp ops[] = {
+            { "||", ExpressionEvaluator::Op_LogicalOr, 1 },
+            { "&&", ExpressionEvaluator::Op_LogicalAnd, 2 },
+            { "==", ExpressionEvaluator::Op_Eq, 6 },
+            { "!=", ExpressionEvaluator::Op_Ne, 6 },
+            { "<=", ExpressionEvaluator::Op_Le, 7 },
+            { ">=", ExpressionEvaluator::Op_Ge, 7 },
+            { "<<", ExpressionEvaluator::Op_Shl, 8 },
+            { ">>", ExpressionEvaluator::Op_Shr, 8 },
+            { "|", ExpressionEvaluator::Op_Or, 3 },
+            { "^", ExpressionEvaluator::Op_Xor, 4 },
+            { "&", ExpressionEvaluator::Op_And, 5 },
+            { "<", ExpressionEvaluator::Op_Lt, 7 },
+            { ">", ExpressionEvaluator::Op_Gt, 7 },
+            { "+", ExpressionEvaluator::Op_Add, 9 },
+            { "-", ExpressionEvaluator::Op_Sub, 9 },
+            { "*", ExpressionEvaluator::Op_Mul, 10 },
+            { "/", ExpressionEvaluator::Op_Div, 10 },
+            { "%", ExpressionEvaluator::Op_Mod, 10 },
+        };
+
+        skipSpaces();
+
+        for (const BinaryOp& b : ops) {
+            int l = int(strlen(b.token));
+
+            if (m_text.midRef(m_pos, l) == QLatin1String(b.token)) {
+                *op = b.op;
+                *len = l;
+                return b.precedence;
+            }
+        }
+
+        return -1;
+    }
+
+    // Precedence climbing
+
+    bool parseBinary(int minPrecedence)
+    {
+        if (!parseUnary()) {
+            return false;
+        }
+
+        for (;;) {
+            Opcode op;
+            int len = 0;
+            int precedence = peekBinary(&op, &len);
+
+            if (precedence < 0 || precedence < minPrecedence) {
+                return true;
+            }
+
+            m_pos += len;
+
+            if (!parseBinary(precedence + 1)) {
+                return false;
+            }
+
+            addInstruction(op);
+        }
+    }
+
+    const QString& m_text;
+    const QHash<QString, int>& m_registerSlots;
+    QVector<Instruction>* m_code;
+    int m_pos = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ExpressionEvaluator::setRegisters(const QVector<QString>& names, const QVector<uint64_t>& values)
+{
+    if (names != m_registerNames) {
+        m_cache.clear();
+        m_registerSlots.clear();
+        m_registerNames = names;
+
+        for (int i = 0; i < names.count(); ++i) {
+            m_registerSlots.insert(names[i].toLower(), i);
+        }
+    }
+
+    m_registerValues = values;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ExpressionEvaluator::clear()
+{
+    m_cache.clear();
+    m_registerSlots.clear();
+    m_registerNames.clear();
+    m_registerValues.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ExpressionEvaluator::compile(const QString& expression, Program* program)
+{
+    ExpressionParser parser(expression, m_registerSlots, &program->code);
+
+    program->valid = parser.parse();
+
+    if (!program->valid) {
+        program->code.clear();
+        return;
+    }
+
+    // Max stack depth so eval can use a fixed size stack
+
+    int depth = 0;
+
+    for (const Instruction& inst : program->code) {
+        if (inst.op == Op_Const || inst.op == Op_Reg) {
+            depth++;
+        } else if (inst.op >= Op_Mul) {
+            depth--;
+        }
+
+        program->stackSize = qMax(program->stackSize, depth);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ExpressionEvaluator::eval(const QString& expression, uint64_t* out, ReadMemory readMemory, void* userData)
+{
+    auto it = m_cache.find(expression);
+
+    if (it == m_cache.end()) {
+        it = m_cache.insert(expression, Program());
+        compile(expression, &it.value());
+    }
+
+    const Program& program = it.value();
+
+    if (!program.valid) {
+        return false;
+    }
+
+    uint64_t localStack[32];
+    QVector<uint64_t> heapStack;
+    uint64_t* stack = localStack;
+    int sp = 0;
+
+    if (program.stackSize > 32) {
+        heapStack.resize(program.stackSize);
+        stack = heapStack.data();
+    }
+
+    for (const Instruction& inst : program.code) {
+        switch (inst.op) {
+            case Op_Const: {
+                stack[sp++] = inst.arg;
+                break;
+            }
+
+            case Op_Reg: {
+                // Register can be missing if the snapshot is shorter than the one the expression was compiled with
+                if (inst.arg >= uint64_t(m_registerValues.count())) {
+                    return false;
+                }
+
+                stack[sp++] = m_registerValues[int(inst.arg)];
+                break;
+            }
+
+            case Op_Load: {
+                if (!readMemory || !readMemory(userData, stack[sp - 1], int(inst.arg), &stack[sp - 1])) {
+                    return false;
+                }
+
+                break;
+            }
+
+            case Op_Neg: stack[sp - 1] = uint64_t(-int64_t(stack[sp - 1])); break;
+            case Op_Not: stack[sp - 1] = ~stack[sp - 1]; break;
+            case Op_LogicalNot: stack[sp - 1] = stack[sp - 1] == 0; break;
+
+            default: {
+                uint64_t b = stack[--sp];
+                uint64_t& a = stack[sp - 1];
+
+                switch (inst.op) {
+                    case Op_Mul: a = a * b; break;
+                    case Op_Div: {
+                        if (b == 0) {
+                            return false;
+                        }
+
+                        a = a / b;
+                        break;
+                    }
+                    case Op_Mod: {
+                        if (b == 0) {
+                            return false;
+                        }
+
+                        a = a % b;
+                        break;
+                    }
+                    case Op_Add: a = a + b; break;
+                    case Op_Sub: a = a - b; break;
+                    case Op_Shl: a = b < 64 ? a << b : 0; break;
+                    case Op_Shr: a = b < 64 ? a >> b : 0; break;
+                    case Op_Lt: a = a < b; break;
+                    case Op_Le: a = a <= b; break;
+                    case Op_Gt: a = a > b; break;
+                    case Op_Ge: a = a >= b; break;
+                    case Op_Eq: a = a == b; break;
+                    case Op_Ne: a = a != b; break;
+                    case Op_And: a = a & b; break;
+                    case Op_Xor: a = a ^ b; break;
+                    case Op_Or: a = a | b; break;
+                    case Op_LogicalAnd: a = a && b; break;
+                    case Op_LogicalOr: a = a || b; break;
+                    default: return false;
+                }
+
+                break;
+            }
+        }
+    }
+
+    *out = stack[0];
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
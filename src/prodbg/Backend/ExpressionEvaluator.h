@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <stdint.h>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Evaluates expressions such as "a0 + 0x20" or "[sp + 4].w" for the memory view.
+//
+// Expressions are compiled once to flat bytecode and cached on the expression string. Registers are bound to a slot
+// (index in the register snapshot) at compile time so evaluating only needs to index an array. As the slots depends
+// on the register layout the cache is flushed if a snapshot with different register names is set.
+//
+// Supported syntax:
+//
+//   numbers: 123, 0x7f, $7f
+//   registers: any register name in the current snapshot (case insensitive)
+//   memory: [expr] (4 bytes), [expr].b, [expr].w, [expr].l, [expr].q (big endian)
+//   operators (C precedence): unary - ~ !, * / %, + -, << >>, < <= > >=, == !=, &, ^, |, &&, ||
+
+class ExpressionEvaluator
+{
+public:
+    // Called for memory dereferences. Return false if the memory can't be read
+    typedef bool (*ReadMemory)(void* userData, uint64_t address, int size, uint64_t* value);
+
+    void setRegisters(const QVector<QString>& names, const QVector<uint64_t>& values);
+    void clear();
+
+    bool eval(const QString& expression, uint64_t* out, ReadMemory readMemory, void* userData);
+
+private:
+    enum Opcode : uint8_t
+    {
+        Op_Const,
+        Op_Reg,
+        Op_Load,
+        Op_Neg,
+        Op_Not,
+        Op_LogicalNot,
+        Op_Mul,
+        Op_Div,
+        Op_Mod,
+        Op_Add,
+        Op_Sub,
+        Op_Shl,
+        Op_Shr,
+        Op_Lt,
+        Op_Le,
+        Op_Gt,
+        Op_Ge,
+        Op_Eq,
+        Op_Ne,
+        Op_And,
+        Op_Xor,
+        Op_Or,
+        Op_LogicalAnd,
+        Op_LogicalOr,
+    };
+
+    struct Instruction
+    {
+        Opcode op;
+        // Register slot for Op_Reg, size in bytes for Op_Load, value for Op_Const
+        uint64_t arg;
+    };
+
+    struct Program
+    {
+        QVector<Instruction> code;
+        int stackSize = 0;
+        // Failed compiles are cached as well so a bad expression isn't parsed over and over
+        bool valid = false;
+    };
+
+    friend class ExpressionParser;
+
+    void compile(const QString& expression, Program* program);
+
+    QHash<QString, Program> m_cache;
+    QHash<QString, int> m_registerSlots;
+    QVector<QString> m_registerNames;
+    QVector<uint64_t> m_registerValues;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
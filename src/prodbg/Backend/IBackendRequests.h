@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QByteArray>
 #include <QObject>
 #include <QVector>
 #include <stdint.h>
@@ -38,6 +39,131 @@ public:
         QString filename;
         uint64_t programCounter;
         int line;
+        // Set if the target stopped because of a watchpoint (watchAccess is 0 otherwise). The id is only known if
+        // the backend could tell which watchpoint it was
+        uint64_t watchAddress = 0;
+        uint32_t watchId = 0;
+        int watchAccess = 0;
+    };
+
+    //
+    // Accesses a watchpoint stops on (same values as PDWatchAccess)
+    //
+    enum WatchAccess
+    {
+        WatchAccess_Read = 1,
+        WatchAccess_Write = 2,
+        WatchAccess_ReadWrite = 3,
+    };
+
+    //
+    // One executed instruction as recorded by the backend when tracing is enabled
+    //
+    struct TraceRecord
+    {
+        // Address of the instruction
+        uint64_t pc;
+        // First (up to 4) bytes of the instruction with the first byte in the lowest 8 bits
+        uint32_t opcode;
+        // Bit n is set if the instruction changed register n (same order as from beginReadRegisters)
+        uint32_t changedRegisters;
+        // New values of the changed registers in register order, each using the size of the register and
+        // stored little endian
+        uint8_t values[8];
+    };
+
+    //
+    // How the backend profiles the target (same values as PDProfileMode)
+    //
+    enum ProfileMode
+    {
+        // The program counter is sampled at an interval. Cheap enough to leave running
+        ProfileMode_Sample,
+        // Every instruction is counted with the clock ticks it took and calls are tracked. Much slower
+        ProfileMode_Exact,
+    };
+
+    //
+    // Number of samples (sample mode) or clock ticks (exact mode) at an address
+    //
+    struct ProfileSample
+    {
+        uint64_t address;
+        uint64_t count;
+    };
+
+    //
+    // A call from site (the address of the call instruction) to target. In sample mode count is the number of
+    // samples taken with this as the innermost call and ticks is 0. In exact mode count is the number of calls and
+    // ticks the clock ticks spent in them (including the calls they made)
+    //
+    struct ProfileCall
+    {
+        uint64_t site;
+        uint64_t target;
+        uint64_t count;
+        uint64_t ticks;
+    };
+
+    //
+    // What the backend has counted since the previous beginReadProfile
+    //
+    struct Profile
+    {
+        ProfileMode mode = ProfileMode_Sample;
+        // False if the backend didn't reply (it can't profile the target)
+        bool supported = false;
+        // Clock ticks the target has run
+        uint64_t ticks = 0;
+        QVector<ProfileSample> samples;
+        QVector<ProfileCall> calls;
+    };
+
+    //
+    // Debug info for an address as resolved by the backend. Everything but the address is optional
+    //
+    struct AddressInfo
+    {
+        uint64_t address = 0;
+        // Name and start of the function the address is in. The backend may know where the function starts
+        // without having a name for it
+        QString symbol;
+        uint64_t symbolAddress = 0;
+        bool hasSymbolAddress = false;
+        QString filename;
+        int line = -1;
+    };
+
+    //
+    // Memory search run by the backend so only the matches are sent back. Only the bits set in the mask are
+    // compared (an empty mask compares all of them) and matches have to start at a multiple of alignment. Values are
+    // searched for by putting them in the pattern in target byte order with the alignment set to their size
+    //
+    struct MemorySearch
+    {
+        // Range to search, end is exclusive
+        uint64_t start = 0;
+        uint64_t end = 0;
+        QByteArray pattern;
+        QByteArray mask;
+        uint8_t alignment = 1;
+        uint32_t maxMatches = 64 * 1024;
+        // Filled in by the backend. truncated is set if there were more than maxMatches
+        QVector<uint64_t> matches;
+        bool truncated = false;
+    };
+
+    //
+    // Flags for AssemblyInstruction. These are only set if the backend has done code analysis on the
+    // executable
+    //
+    enum AssemblyFlags
+    {
+        AssemblyFlag_BlockStart = 1 << 0,
+        AssemblyFlag_FunctionStart = 1 << 1,
+        AssemblyFlag_Branch = 1 << 2,
+        AssemblyFlag_Call = 1 << 3,
+        AssemblyFlag_Return = 1 << 4,
     };
 
     //
@@ -56,6 +182,17 @@ public:
         // List of hw registers that this instrution reads
         // This may be empty if the backend doesn't support to fill this info in
         QVector<QString> write_registers;
+        // Same as read_registers/write_registers but as masks where bit n is set for register id n
+        // as given by the backend. Useful to quickly check if two instructions use the same registers
+        uint64_t read_mask = 0;
+        uint64_t write_mask = 0;
+        // Address a branch/call goes to. Only valid if has_branch_target is set
+        uint64_t branch_target = 0;
+        bool has_branch_target = false;
+        // Combination of AssemblyFlags
+        uint32_t flags = 0;
+        // Number of calls to this instruction found by the code analysis (only set at function starts)
+        uint32_t caller_count = 0;
     };
 
     //
@@ -76,11 +213,20 @@ public:
     // to the backend that doesn't fit any general backend
     virtual void sendCustomString(uint16_t id, const QString& text) = 0;
 
-    // Add a breakpoint at a specific address
-    virtual void beginAddAddressBreakpoint(uint64_t address) = 0;
+    // Events sent (custom strings, breakpoints) between beginTransaction and commitTransaction are queued and sent
+    // to the backend in one update on commit instead of one update per event. Transactions can be nested and are
+    // sent when the outer most one is committed. Requests that needs a reply (registers, memory, etc) are still
+    // sent directly and will send the queued events with them.
+    virtual void beginTransaction() = 0;
+    virtual void commitTransaction() = 0;
 
-    // Add a breakpoint on a specific file and line number
-    virtual void beginAddFileLineBreakpoint(const QString& filename, int line) = 0;
+    // Add a breakpoint at a specific address. The backend only stops if the (optional) condition evaluates to non-zero
+    // and the breakpoint has been hit hitCount times (0 = stop every time)
+    virtual void beginAddAddressBreakpoint(uint64_t address, const QString& condition = QString(), uint32_t hitCount = 0) = 0;
+
+    // Add a breakpoint on a specific file and line number. condition and hitCount works the same as for address breakpoints
+    virtual void beginAddFileLineBreakpoint(const QString& filename, int line, const QString& condition = QString(),
+                                            uint32_t hitCount = 0) = 0;
 
     // Remove a breakpoint at a specific address
     virtual void beginRemoveAddressBreakpoint(uint64_t address) = 0;
@@ -88,6 +234,13 @@ public:
     // Remove a breakpoint on a specific file and line number
     virtual void beginRemoveFileLineBreakpoint(const QString& filename, int line) = 0;
 
+    // Stop the target when any byte in the range is accessed. The id is picked by the caller and is used to remove
+    // the watchpoint again. Adding a watchpoint with an id that is in use replaces it. The backend replies with
+    // endAddWatchpoint
+    virtual void beginAddWatchpoint(uint32_t id, uint64_t address, uint64_t size, WatchAccess access) = 0;
+
+    virtual void beginRemoveWatchpoint(uint32_t id) = 0;
+
     // Get hw registers from the backend
     // registers = array of registers
     virtual void beginReadRegisters(QVector<Register>* registers) = 0;
@@ -111,6 +264,30 @@ public:
     //          of MemoryAddressFlags
     virtual bool beginReadMemory(uint64_t lo, uint64_t hi, QVector<uint16_t>* target) = 0;
 
+    // Start/stop recording executed instructions in the backend. Starting throws away the previous recording
+    virtual void beginEnableTrace(bool enable) = 0;
+
+    // Read the recorded instructions (oldest first) that hasn't been read yet. The backend only keeps the latest
+    // instructions so records that was overwritten before they were read are counted as dropped
+    // maxCount = max number of records to read
+    // records = output of the records
+    virtual void beginReadTrace(uint32_t maxCount, QVector<TraceRecord>* records) = 0;
+
+    // Start/stop profiling in the backend. Starting throws away what has been counted so far
+    // interval = clock ticks between samples (sample mode only)
+    virtual void beginEnableProfiler(bool enable, ProfileMode mode, uint32_t interval) = 0;
+
+    // Read what the profiler has counted since the last read. The caller adds it up
+    virtual void beginReadProfile(Profile* profile) = 0;
+
+    // Resolve addresses to the function and source line they are in using the debug info in the backend
+    // info = one entry per address (in the same order)
+    virtual void beginResolveAddressInfo(const QVector<uint64_t>& addresses, QVector<AddressInfo>* info) = 0;
+
+    // Search target memory for a pattern/value (see MemorySearch). The backend replies with endSearchMemory and
+    // backends that can't search leave the matches empty
+    virtual void beginSearchMemory(MemorySearch* search) = 0;
+
 public:
     // Get hw registers from the backend
     // registers = array of registers
@@ -124,12 +301,34 @@ public:
     // dest = output of the evalutation
     Q_SIGNAL void endResolveAddress(uint64_t* dest);
 
+    // Sent when a transaction has been sent to the backend
+    // eventCount = number of events that was sent in the transaction
+    Q_SIGNAL void endCommitTransaction(int eventCount);
+
     // Response signal for a memory request. If target size is 0 the operation failed. TODO: Better way
     // target = filled with requested memory (if successful)
     // address = starting address
     // addressWidth = number of bytes an address uses. E.g. 4 for a 32-bit target.
     Q_SIGNAL void endReadMemory(QVector<uint16_t>* target, uint64_t address, int addressWidth);
 
+    // Response signal for beginReadTrace
+    // records = the records read
+    // dropped = total number of records that was overwritten before they could be read since tracing was started
+    Q_SIGNAL void endReadTrace(QVector<TraceRecord>* records, uint64_t dropped);
+
+    // Response signal for beginReadProfile
+    Q_SIGNAL void endReadProfile(Profile* profile);
+
+    // Response signal for beginResolveAddressInfo
+    Q_SIGNAL void endResolveAddressInfo(QVector<AddressInfo>* info);
+
+    // Response signal for beginAddWatchpoint
+    // ok = false if the backend couldn't set it (or doesn't support watchpoints)
+    Q_SIGNAL void endAddWatchpoint(uint32_t id, bool ok);
+
+    // Response signal for beginSearchMemory
+    Q_SIGNAL void endSearchMemory(MemorySearch* search);
+
     // This signal is being sent when the program counter of the debugged application has changed
     // This can be used to figure out if it's needed to re-request data. For example a Memory view may want to use
     // this as the program may have altered the same memory that is currently being displayed
@@ -4,17 +4,73 @@ namespace prodbg {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+uint64_t BreakpointModel::fileLineKey(int fileId, int line)
+{
+    return (uint64_t(uint32_t(fileId)) << 32) | uint32_t(line);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int BreakpointModel::fileId(const QString& filename)
+{
+    auto it = m_fileIds.constFind(filename);
+
+    if (it != m_fileIds.constEnd()) {
+        return it.value();
+    }
+
+    int id = m_fileLines.count();
+
+    m_fileIds.insert(filename, id);
+    m_fileLines.append(QBitArray());
+
+    return id;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 bool BreakpointModel::toggleFileLineBreakpoint(const QString& filename, int line)
 {
-    for (int i = 0, count = m_fileLineBreakpoints.count(); i < count; ++i) {
-        if (m_fileLineBreakpoints[i].line == line && m_fileLineBreakpoints[i].filename == filename) {
-            m_fileLineBreakpoints.remove(i);
-            return false;
+    if (line < 0) {
+        return false;
+    }
+
+    int id = fileId(filename);
+    uint64_t key = fileLineKey(id, line);
+    QBitArray& lines = m_fileLines[id];
+
+    auto it = m_fileLineIndex.find(key);
+
+    if (it != m_fileLineIndex.end()) {
+        // Move the last breakpoint into the removed slot to keep the removal O(1)
+        int index = it.value();
+        int last = m_fileLineBreakpoints.count() - 1;
+
+        m_fileLineIndex.erase(it);
+
+        if (index != last) {
+            const FileLineBreakpoint& moved = m_fileLineBreakpoints[last];
+            m_fileLineBreakpoints[index] = moved;
+            m_fileLineIndex[fileLineKey(fileId(moved.filename), moved.line)] = index;
         }
+
+        m_fileLineBreakpoints.removeLast();
+        lines.clearBit(line);
+
+        return false;
     }
 
-    FileLineBreakpoint bp = { filename, line };
+    if (line >= lines.size()) {
+        lines.resize(qMax(line + 1, lines.size() * 2));
+    }
 
+    lines.setBit(line);
+
+    FileLineBreakpoint bp;
+    bp.filename = filename;
+    bp.line = line;
+
+    m_fileLineIndex.insert(key, m_fileLineBreakpoints.count());
     m_fileLineBreakpoints.append(bp);
 
     return true;
@@ -24,42 +80,97 @@ bool BreakpointModel::toggleFileLineBreakpoint(const QString& filename, int line
 
 bool BreakpointModel::hasBreakpointFileLine(const QString& filename, int line)
 {
-    for (auto& bp : m_fileLineBreakpoints) {
-        if (bp.line == line && bp.filename == filename) {
-            return true;
-        }
+    auto it = m_fileIds.constFind(filename);
+
+    if (it == m_fileIds.constEnd()) {
+        return false;
     }
 
-    return false;
+    return hasBreakpointFileLine(it.value(), line);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool BreakpointModel::hasBreakpointAddress(uint64_t address)
+bool BreakpointModel::toggleAddressBreakpoint(uint64_t address)
 {
-    for (auto& bp : m_addressBreakpoints) {
-        if (bp == address) {
-            return true;
+    auto it = m_addressIndex.find(address);
+
+    if (it != m_addressIndex.end()) {
+        int index = it.value();
+        int last = m_addressBreakpoints.count() - 1;
+
+        m_addressIndex.erase(it);
+
+        if (index != last) {
+            m_addressBreakpoints[index] = m_addressBreakpoints[last];
+            m_addressIndex[m_addressBreakpoints[index].address] = index;
         }
+
+        m_addressBreakpoints.removeLast();
+
+        return false;
     }
 
-    return false;
+    AddressBreakpoint bp;
+    bp.address = address;
+
+    m_addressIndex.insert(address, m_addressBreakpoints.count());
+    m_addressBreakpoints.append(bp);
+
+    return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool BreakpointModel::toggleAddressBreakpoint(uint64_t address)
+const BreakpointModel::FileLineBreakpoint* BreakpointModel::fileLineBreakpoint(const QString& filename, int line)
 {
-    for (int i = 0, count = m_addressBreakpoints.count(); i < count; ++i) {
-        if (m_addressBreakpoints[i] == address) {
-            m_addressBreakpoints.remove(i);
-            return false;
-        }
+    auto it = m_fileLineIndex.constFind(fileLineKey(fileId(filename), line));
+
+    if (it == m_fileLineIndex.constEnd()) {
+        return nullptr;
     }
 
-    m_addressBreakpoints.append(address);
+    return &m_fileLineBreakpoints[it.value()];
+}
 
-    return true;
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const BreakpointModel::AddressBreakpoint* BreakpointModel::addressBreakpoint(uint64_t address) const
+{
+    auto it = m_addressIndex.constFind(address);
+
+    if (it == m_addressIndex.constEnd()) {
+        return nullptr;
+    }
+
+    return &m_addressBreakpoints[it.value()];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BreakpointModel::setFileLineCondition(const QString& filename, int line, const QString& condition,
+                                           uint32_t hitCount)
+{
+    if (!hasBreakpointFileLine(filename, line) && !toggleFileLineBreakpoint(filename, line)) {
+        return;
+    }
+
+    FileLineBreakpoint& bp = m_fileLineBreakpoints[m_fileLineIndex.value(fileLineKey(fileId(filename), line))];
+    bp.condition = condition;
+    bp.hitCount = hitCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BreakpointModel::setAddressCondition(uint64_t address, const QString& condition, uint32_t hitCount)
+{
+    if (!hasBreakpointAddress(address)) {
+        toggleAddressBreakpoint(address);
+    }
+
+    AddressBreakpoint& bp = m_addressBreakpoints[m_addressIndex.value(address)];
+    bp.condition = condition;
+    bp.hitCount = hitCount;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1,12 +1,22 @@
 #pragma once
 
 // #include <QStandardItemModel>
+#include <QBitArray>
+#include <QHash>
+#include <QString>
 #include <QVector>
 
 namespace prodbg {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // This should likley be a model. Temp for now
+//
+// Lookups are done for each visible line when painting the code views so they are backed by hashes. Filenames are
+// interned to an id which maps to a bitset of lines with breakpoints. Use fileId() once and the id version of
+// hasBreakpointFileLine when checking many lines in the same file.
+//
+// Each breakpoint can have a condition and a hit count which are sent to the backend and evaluated there (the
+// backend only stops when the condition is true and the breakpoint has been hit hitCount times).
 
 class BreakpointModel
 {
@@ -14,27 +24,72 @@ public:
     struct FileLineBreakpoint
     {
         QString filename;
-        int line;
+        int line = 0;
+        QString condition;
+        uint32_t hitCount = 0;
     };
 
     struct AddressBreakpoint
     {
-        uint64_t address;
+        uint64_t address = 0;
+        QString condition;
+        uint32_t hitCount = 0;
     };
 
+    int fileId(const QString& filename);
+
     bool hasBreakpointFileLine(const QString& filename, int line);
-    bool hasBreakpointAddress(uint64_t address);
+    bool hasBreakpointFileLine(int fileId, int line) const;
+    bool hasBreakpointAddress(uint64_t address) const;
 
     bool toggleFileLineBreakpoint(const QString& filename, int line);
     bool toggleAddressBreakpoint(uint64_t address);
 
+    // Adds the breakpoint if it isn't set
+    void setFileLineCondition(const QString& filename, int line, const QString& condition, uint32_t hitCount);
+    void setAddressCondition(uint64_t address, const QString& condition, uint32_t hitCount);
+
+    // Null if there is no breakpoint
+    const FileLineBreakpoint* fileLineBreakpoint(const QString& filename, int line);
+    const AddressBreakpoint* addressBreakpoint(uint64_t address) const;
+
     const QVector<FileLineBreakpoint>& getFileLineBreakpoints() { return m_fileLineBreakpoints; }
-    const QVector<uint64_t>& getAddressBreakpoints() { return m_addressBreakpoints; }
+    const QVector<AddressBreakpoint>& getAddressBreakpoints() { return m_addressBreakpoints; }
 
 private:
+    static uint64_t fileLineKey(int fileId, int line);
+
     QVector<FileLineBreakpoint> m_fileLineBreakpoints;
-    QVector<uint64_t> m_addressBreakpoints;
+    QVector<AddressBreakpoint> m_addressBreakpoints;
+
+    // Maps to index in m_fileLineBreakpoints/m_addressBreakpoints so removal doesn't need to search
+    QHash<uint64_t, int> m_fileLineIndex;
+    QHash<uint64_t, int> m_addressIndex;
+
+    // Interned filenames and the lines (bit per line) that has breakpoints for each file
+    QHash<QString, int> m_fileIds;
+    QVector<QBitArray> m_fileLines;
 };
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool BreakpointModel::hasBreakpointFileLine(int fileId, int line) const
+{
+    if (fileId < 0 || fileId >= m_fileLines.count()) {
+        return false;
+    }
+
+    const QBitArray& lines = m_fileLines[fileId];
+
+    return line >= 0 && line < lines.size() && lines.testBit(line);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool BreakpointModel::hasBreakpointAddress(uint64_t address) const
+{
+    return m_addressIndex.contains(address);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 }
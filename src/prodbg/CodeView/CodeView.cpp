@@ -1,13 +1,14 @@
 #include "CodeView.h"
 #include "Backend/IBackendRequests.h"
 #include "BreakpointModel.h"
+#include "SourceDocumentCache.h"
 #include <QFileDialog>
 #include <QFileSystemWatcher>
 #include <QMessageBox>
 #include <QPainter>
 #include <QSettings>
 #include <QTextBlock>
-#include <QTextStream>
+#include <QTimer>
 #include <QDebug>
 #include <QApplication>
 
@@ -17,6 +18,11 @@ namespace prodbg {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Number of source lines added to the view each time the event loop runs
+static const int s_linesPerFeed = 2000;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 class LineNumberArea : public QWidget
 {
 public:
@@ -37,10 +43,11 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-CodeView::CodeView(QWidget* parent)
+CodeView::CodeView(SourceDocumentCache* sourceCache, QWidget* parent)
     : QPlainTextEdit(parent)
     , m_lineNumberArea(nullptr)
     , m_fileWatcher(nullptr)
+    , m_sourceCache(sourceCache)
     , m_disassemblyStart(0)
     , m_disassemblyEnd(0)
 {
@@ -52,6 +59,13 @@ CodeView::CodeView(QWidget* parent)
     m_lineNumberArea = new LineNumberArea(this);
     m_fileWatcher = new QFileSystemWatcher(this);
 
+    // The text is read only so there is nothing to undo (and keeping undo steps for the fed text is expensive)
+    document()->setUndoRedoEnabled(false);
+
+    m_feedTimer = new QTimer(this);
+    m_feedTimer->setInterval(0);
+    connect(m_feedTimer, &QTimer::timeout, this, &CodeView::feedSourceText);
+
     connect(this, SIGNAL(blockCountChanged(int)), this, SLOT(updateLineNumberAreaWidth(int)));
     connect(this, SIGNAL(updateRequest(const QRect&, int)), this, SLOT(updateLineNumberArea(const QRect&, int)));
     connect(this, SIGNAL(cursorPositionChanged()), this, SLOT(highlightCurrentLine()));
@@ -98,9 +112,8 @@ void CodeView::openFile()
 
 void CodeView::reload()
 {
-    int currentLine = getCurrentLine();
-    readSourceFile(m_sourceFile);
-    setLine(currentLine);
+    m_pendingLine = getCurrentLine();
+    m_sourceCache->reload(m_sourceFile);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -116,18 +129,13 @@ void CodeView::fileChange(const QString filename)
     if (reply != QMessageBox::Yes)
         return;
 
-    QFile f(filename);
-
-    if (!f.exists())
+    if (!QFile::exists(filename))
         return;
 
-    int currentLine = getCurrentLine();
-
-    f.open(QFile::ReadOnly | QFile::Text);
-    QTextStream ts(&f);
-    setPlainText(ts.readAll());
+    // The text is updated in documentLoaded when the new version has been loaded
 
-    setLine(currentLine);
+    m_pendingLine = getCurrentLine();
+    m_sourceCache->reload(filename);
 
     // BUG: We need to readd the file here as it seems the watcher thinks it has been deleted (even if just changed)
     //      so we only get one notification of a change so when doing a re-add here we get correct notifications again
@@ -237,6 +245,9 @@ void CodeView::lineNumberAreaPaintEvent(QPaintEvent* event)
 
     int fontHeight = fontMetrics().height() - 2;
 
+    // Look up the file once instead of for each line
+    int fileId = m_breakpoints->fileId(m_sourceFile);
+
     while (block.isValid() && top <= event->rect().bottom()) {
         if (block.isVisible() && bottom >= event->rect().top()) {
             QString number = QString::number(blockNumber + 1);
@@ -244,7 +255,7 @@ void CodeView::lineNumberAreaPaintEvent(QPaintEvent* event)
 
             painter.drawText(0, top, width, height, Qt::AlignRight, number);
 
-            if (m_breakpoints->hasBreakpointFileLine(m_sourceFile, blockNumber + 1)) {
+            if (m_breakpoints->hasBreakpointFileLine(fileId, blockNumber + 1)) {
                 painter.setBrush(Qt::red);
                 painter.drawEllipse(4, top, fontHeight, fontHeight);
             }
@@ -330,6 +341,7 @@ void CodeView::updateDisassemblyCursor()
 void CodeView::toggleDisassembly()
 {
     m_mode = Disassembly;
+    m_feedTimer->stop();
     // programCounterChanged(m_currentPc);
     setPlainText(m_disassemblyText);
     updateDisassemblyCursor();
@@ -341,7 +353,12 @@ void CodeView::toggleSourceFile()
 {
     m_mode = Sourcefile;
     setCenterOnScroll(false);
-    setPlainText(m_sourceCodeData);
+
+    if (m_document && m_document->isLoaded()) {
+        showSourceText();
+    } else {
+        setPlainText(QString());
+    }
 
     if (m_currentSourceLine >= 0) {
         setLine(m_currentSourceLine);
@@ -393,13 +410,89 @@ void CodeView::readSourceFile(const QString& filename)
 
     m_fileWatcher->addPath(QString(filename));
 
-    f.open(QFile::ReadOnly | QFile::Text);
-    QTextStream ts(&f);
+    if (m_document) {
+        disconnect(m_document, &SourceDocument::loaded, this, &CodeView::documentLoaded);
+    }
+
+    m_document = m_sourceCache->document(filename);
 
-    m_sourceCodeData = ts.readAll();
+    connect(m_document, &SourceDocument::loaded, this, &CodeView::documentLoaded);
 
-    if (m_mode == Sourcefile) {
-        setPlainText(m_sourceCodeData);
+    // Already loaded (by another view or earlier) so no need to wait for it
+    if (m_document->isLoaded()) {
+        documentLoaded();
+    } else {
+        m_feedTimer->stop();
+
+        if (m_mode == Sourcefile) {
+            setPlainText(QString());
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CodeView::documentLoaded()
+{
+    if (m_mode != Sourcefile) {
+        return;
+    }
+
+    showSourceText();
+
+    if (m_pendingLine >= 0) {
+        setLine(m_pendingLine);
+        m_pendingLine = -1;
+    } else if (m_currentSourceLine > 0) {
+        setLine(m_currentSourceLine);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The first lines are added directly so the view isn't empty and the rest is added by the feed timer
+
+void CodeView::showSourceText()
+{
+    setPlainText(QString());
+
+    m_feedLine = 0;
+    m_feedGotoLine = -1;
+
+    feedSourceText();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CodeView::feedSourceText()
+{
+    if (!m_document || !m_document->isLoaded() || m_feedLine >= m_document->lineCount()) {
+        m_feedTimer->stop();
+        return;
+    }
+
+    // Lines are stored after each other in the document text so a range of lines is a single piece of it
+
+    const QString& text = m_document->text();
+    int endLine = qMin(m_feedLine + s_linesPerFeed, m_document->lineCount());
+    int start = m_document->line(m_feedLine).position();
+    int end = endLine < m_document->lineCount() ? m_document->line(endLine).position() : text.size();
+
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text.mid(start, end - start));
+
+    m_feedLine = endLine;
+
+    if (m_feedGotoLine > 0 && m_feedGotoLine <= m_feedLine) {
+        int line = m_feedGotoLine;
+        m_feedGotoLine = -1;
+        setLine(line);
+    }
+
+    if (m_feedLine < m_document->lineCount()) {
+        m_feedTimer->start();
+    } else {
+        m_feedTimer->stop();
     }
 }
 
@@ -431,6 +524,12 @@ int CodeView::getCurrentLine()
 
 void CodeView::setLine(int line)
 {
+    // Moved to when the line has been added
+    if (m_feedTimer->isActive() && line > m_feedLine) {
+        m_feedGotoLine = line;
+        return;
+    }
+
     const QTextBlock& block = document()->findBlockByNumber(line - 1);
     QTextCursor cursor(block);
     cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, 0);
@@ -15,6 +15,7 @@ class QResizeEvent;
 class QSize;
 class QWidget;
 class QThread;
+class QTimer;
 class QFileSystemWatcher;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -23,6 +24,8 @@ namespace prodbg {
 
 class LineNumberArea;
 class BreakpointModel;
+class SourceDocument;
+class SourceDocumentCache;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -46,7 +49,7 @@ public:
         Mixed,       // Mixed Source + Disassembly mode
     };
 
-    CodeView(QWidget* parent = 0);
+    CodeView(SourceDocumentCache* sourceCache, QWidget* parent = 0);
     virtual ~CodeView();
 
     void toggleBreakpoint();
@@ -81,10 +84,13 @@ private:
     Q_SLOT void highlightCurrentLine();
     Q_SLOT void updateLineNumberArea(const QRect&, int);
     Q_SLOT void fileChange(const QString filename);
+    Q_SLOT void documentLoaded();
+    Q_SLOT void feedSourceText();
 
 private:
     void toggleDisassembly();
     void toggleSourceFile();
+    void showSourceText();
     void updateDisassemblyCursor();
 
     void readSettings();
@@ -96,8 +102,19 @@ private:
     QWidget* m_lineNumberArea;
     QFileSystemWatcher* m_fileWatcher;
 
+    // Source files are loaded in the background and shared with other views of the same file
+    SourceDocumentCache* m_sourceCache;
+    SourceDocument* m_document = nullptr;
+    // Line to move to when the document has been (re)loaded
+    int m_pendingLine = -1;
+
+    // The text of the document is added a few lines at a time from the line index so showing a large file doesn't
+    // block the UI. m_feedLine is the next line to add and m_feedGotoLine is moved to once it has been added
+    QTimer* m_feedTimer;
+    int m_feedLine = 0;
+    int m_feedGotoLine = -1;
+
     QString m_sourceFile;
-    QString m_sourceCodeData;
     Mode m_mode = Mode::Sourcefile;
 
     int m_currentSourceLine = 0;
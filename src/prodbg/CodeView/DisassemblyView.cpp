@@ -1,8 +1,11 @@
 #include "BreakpointModel.h"
 #include "DisassemblyView.h"
+#include <QKeyEvent>
+#include <QHelpEvent>
 #include <QTextBlock>
 #include <QPainter>
 #include <QApplication>
+#include <QToolTip>
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -171,6 +174,12 @@ void DisassemblyView::lineNumberAreaPaintEvent(QPaintEvent* event)
 
             painter.drawText(0, top, width, height, Qt::AlignRight, addressText);
 
+            // Separate functions with a line (only available if the backend has analyzed the code)
+
+            if (m_disassemblyAdresses[blockNumber].flags & IBackendRequests::AssemblyFlag_FunctionStart) {
+                painter.drawLine(0, top, width, top);
+            }
+
             if (m_breakpoints->hasBreakpointAddress(address)) {
                 painter.setBrush(Qt::red);
                 painter.drawEllipse(4, top, fontHeight, fontHeight);
@@ -239,12 +248,24 @@ void DisassemblyView::endDisassembly(QVector<IBackendRequests::AssemblyInstructi
 
         m_disassemblyText.append(inst.text);
         m_disassemblyText.append(QLatin1Char('\n'));
-        m_disassemblyAdresses.append({ inst.address, addressText });
+        m_disassemblyAdresses.append(
+            { inst.address, inst.branch_target, inst.flags, inst.caller_count, inst.has_branch_target, addressText });
     }
 
     m_disassemblyEnd = instructions->at(instructions->count() - 1).address;
 
     setPlainText(m_disassemblyText);
+
+    // A jump to a branch target outside of the old range selects the target instead of the pc
+
+    if (m_hasJumpTarget) {
+        m_hasJumpTarget = false;
+
+        if (selectAddress(m_jumpTarget)) {
+            return;
+        }
+    }
+
     updateDisassemblyCursor();
 }
 
@@ -253,45 +274,71 @@ void DisassemblyView::endDisassembly(QVector<IBackendRequests::AssemblyInstructi
 void DisassemblyView::updatePc(uint64_t pc)
 {
     m_currentPc = pc;
+    m_hasJumpTarget = false;
 
     // check if pc is with the disassembly range and search for the current line to set
 
     if ((pc >= m_disassemblyStart && pc <= m_disassemblyEnd) && m_disassemblyEnd != 0) {
         updateDisassemblyCursor();
     } else {
-        // QSize size = frameSize();
-        int fontHeight = fontMetrics().height();
-        int linesInView = (height() / fontHeight) - 1;
-        if (linesInView <= 0) {
-            linesInView = 1;
-        }
+        requestDisassembly(pc);
+    }
+}
 
-        if (pc >= linesInView) {
-            pc -= linesInView;
-        }
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int DisassemblyView::linesInView() const
+{
+    // QSize size = frameSize();
+    int fontHeight = fontMetrics().height();
+    int linesInView = (height() / fontHeight) - 1;
+    if (linesInView <= 0) {
+        linesInView = 1;
+    }
 
-        // mask out the lower bits of start offset so we have a 4 byte even address to disassemble from
-        pc &= (uint64_t)(~3);
+    return linesInView;
+}
 
-        if (m_interface) {
-            m_interface->beginDisassembly(pc, linesInView * 2, &m_recvInstructions);
-        }
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DisassemblyView::requestDisassembly(uint64_t address)
+{
+    int lines = linesInView();
+
+    if (address >= lines) {
+        address -= lines;
+    }
+
+    // mask out the lower bits of start offset so we have a 4 byte even address to disassemble from
+    address &= (uint64_t)(~3);
+
+    if (m_interface) {
+        m_interface->beginDisassembly(address, lines * 2, &m_recvInstructions);
     }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void DisassemblyView::updateDisassemblyCursor()
+{
+    selectAddress(m_currentPc);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DisassemblyView::selectAddress(uint64_t address)
 {
     for (int i = 0, count = m_disassemblyAdresses.count(); i < count; ++i) {
-        if (m_disassemblyAdresses[i].address != m_currentPc) {
+        if (m_disassemblyAdresses[i].address != address) {
             continue;
         }
 
         setLine(i + 1);
 
-        return;
+        return true;
     }
+
+    return false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -314,6 +361,83 @@ void DisassemblyView::toggleBreakpoint()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+bool DisassemblyView::currentAddress(uint64_t* address)
+{
+    int index = textCursor().block().blockNumber();
+
+    if (index >= m_disassemblyAdresses.count()) {
+        return false;
+    }
+
+    *address = m_disassemblyAdresses[index].address;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DisassemblyView::jumpToBranchTarget()
+{
+    int index = textCursor().block().blockNumber();
+
+    if (index >= m_disassemblyAdresses.count() || !m_disassemblyAdresses[index].hasBranchTarget) {
+        return;
+    }
+
+    uint64_t target = m_disassemblyAdresses[index].branchTarget;
+
+    if (selectAddress(target)) {
+        return;
+    }
+
+    m_jumpTarget = target;
+    m_hasJumpTarget = true;
+
+    // The target is the only instruction start known there. Disassembling from before it could decode through the
+    // middle of it (68k instructions have varying sizes) so the target would never be found
+
+    if (m_interface) {
+        m_interface->beginDisassembly(target, linesInView() * 2, &m_recvInstructions);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DisassemblyView::keyPressEvent(QKeyEvent* event)
+{
+    if (event->key() == Qt::Key_Return || event->key() == Qt::Key_Enter) {
+        jumpToBranchTarget();
+        return;
+    }
+
+    QPlainTextEdit::keyPressEvent(event);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Function starts show how many places call them (from the call graph of the backend code analysis)
+
+bool DisassemblyView::viewportEvent(QEvent* event)
+{
+    if (event->type() != QEvent::ToolTip) {
+        return QPlainTextEdit::viewportEvent(event);
+    }
+
+    QHelpEvent* helpEvent = static_cast<QHelpEvent*>(event);
+    int index = cursorForPosition(helpEvent->pos()).blockNumber();
+
+    if (index < m_disassemblyAdresses.count() && m_disassemblyAdresses[index].callerCount > 0) {
+        QToolTip::showText(helpEvent->globalPos(),
+                           tr("Called from %n place(s)", nullptr, int(m_disassemblyAdresses[index].callerCount)));
+    } else {
+        QToolTip::hideText();
+        event->ignore();
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void DisassemblyView::setLine(int line)
 {
     const QTextBlock& block = document()->findBlockByNumber(line - 1);
@@ -9,6 +9,7 @@
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+class QKeyEvent;
 class QPaintEvent;
 class QResizeEvent;
 class QSize;
@@ -36,6 +37,9 @@ public:
     void updatePc(uint64_t pc);
 
     void toggleBreakpoint();
+    // Address of the instruction at the cursor. Returns false if there is no disassembly
+    bool currentAddress(uint64_t* address);
+    void jumpToBranchTarget();
     int lineNumberAreaWidth();
     void lineNumberAreaPaintEvent(QPaintEvent* event);
     void setBackendInterface(IBackendRequests* interface);
@@ -49,7 +53,12 @@ private:
     Q_SLOT void updateAddressArea(const QRect& rect, int dy);
 
     void resizeEvent(QResizeEvent* event);
+    void keyPressEvent(QKeyEvent* event);
+    bool viewportEvent(QEvent* event);
     void updateDisassemblyCursor();
+    bool selectAddress(uint64_t address);
+    int linesInView() const;
+    void requestDisassembly(uint64_t address);
     void setLine(int line);
 
     QWidget* m_addressArea;
@@ -59,12 +68,19 @@ private:
     struct AddressData
     {
         uint64_t address;
+        uint64_t branchTarget;
+        uint32_t flags;
+        uint32_t callerCount;
+        bool hasBranchTarget;
         QString addressText;
     };
 
     uint64_t m_disassemblyStart = 0;
     uint64_t m_disassemblyEnd = 0;
     uint64_t m_currentPc = 0;
+    // Branch target to select when the disassembly for it arrives
+    uint64_t m_jumpTarget = 0;
+    bool m_hasJumpTarget = false;
     int m_addressWidth = 0;
 
     QString m_disassemblyText;
@@ -0,0 +1,169 @@
+#include "SourceDocumentCache.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Maps the file, decodes it and builds the line index. Runs on the cache thread pool
+
+class SourceLoadJob : public QRunnable
+{
+public:
+    SourceLoadJob(SourceDocument* document, uint generation)
+        : m_document(document)
+        , m_filename(document->filename())
+        , m_generation(generation)
+    {
+    }
+
+    void run()
+    {
+        QString text;
+        QVector<int> lineStarts;
+        QFile file(m_filename);
+
+        if (file.open(QFile::ReadOnly)) {
+            qint64 size = file.size();
+            uchar* data = size > 0 ? file.map(0, size) : nullptr;
+
+            if (data) {
+                text = QString::fromUtf8((const char*)data, int(size));
+                file.unmap(data);
+            } else {
+                // Some files (pipes, special files) can't be mapped so fallback to a regular read
+                text = QString::fromUtf8(file.readAll());
+            }
+
+            // Same as reading in text mode
+            if (text.contains(QLatin1Char('\r'))) {
+                text.remove(QLatin1Char('\r'));
+            }
+
+            lineStarts.reserve(text.size() / 32);
+            lineStarts.append(0);
+
+            const QChar* chars = text.constData();
+
+            for (int i = 0, count = text.size(); i < count; ++i) {
+                if (chars[i] == QLatin1Char('\n')) {
+                    lineStarts.append(i + 1);
+                }
+            }
+        }
+
+        // The cache waits for all jobs before deleting the documents so m_document is still valid here
+        QMetaObject::invokeMethod(m_document, "loadFinished", Qt::QueuedConnection, Q_ARG(uint, m_generation),
+                                  Q_ARG(QString, text), Q_ARG(QVector<int>, lineStarts));
+    }
+
+private:
+    SourceDocument* m_document;
+    QString m_filename;
+    uint m_generation;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SourceDocument::SourceDocument(const QString& filename, QObject* parent)
+    : QObject(parent)
+    , m_filename(filename)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QStringRef SourceDocument::line(int line) const
+{
+    if (line < 0 || line >= m_lineStarts.count()) {
+        return QStringRef();
+    }
+
+    int start = m_lineStarts[line];
+    int end = line + 1 < m_lineStarts.count() ? m_lineStarts[line + 1] - 1 : m_text.size();
+
+    return QStringRef(&m_text, start, end - start);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceDocument::loadFinished(uint generation, const QString& text, const QVector<int>& lineStarts)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    m_text = text;
+    m_lineStarts = lineStarts;
+    m_loaded = true;
+
+    loaded();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SourceDocumentCache::SourceDocumentCache()
+{
+    // Needed to pass the line index with the queued loadFinished call
+    qRegisterMetaType<QVector<int>>("QVector<int>");
+
+    m_threadPool.setMaxThreadCount(2);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SourceDocumentCache::~SourceDocumentCache()
+{
+    m_threadPool.waitForDone();
+
+    // Posted loadFinished calls are removed when the documents are deleted
+    qDeleteAll(m_documents);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceDocumentCache::startLoad(SourceDocument* document)
+{
+    document->m_generation++;
+    m_threadPool.start(new SourceLoadJob(document, document->m_generation));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SourceDocument* SourceDocumentCache::document(const QString& filename)
+{
+    QString path = QFileInfo(filename).absoluteFilePath();
+
+    auto it = m_documents.constFind(path);
+
+    if (it != m_documents.constEnd()) {
+        return it.value();
+    }
+
+    // Views expect the filename they asked for (used for breakpoints and tabs) so keep that in the document
+
+    SourceDocument* document = new SourceDocument(filename, nullptr);
+    m_documents.insert(path, document);
+
+    startLoad(document);
+
+    return document;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceDocumentCache::reload(const QString& filename)
+{
+    auto it = m_documents.constFind(QFileInfo(filename).absoluteFilePath());
+
+    if (it == m_documents.constEnd()) {
+        document(filename);
+        return;
+    }
+
+    startLoad(it.value());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringRef>
+#include <QThreadPool>
+#include <QVector>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Source file loaded by the SourceDocumentCache. Loading is done on a worker thread (the file is memory mapped,
+// decoded and a line index is built) and loaded() is sent when the text is ready. All views showing the same file
+// shares the same document.
+
+class SourceDocument : public QObject
+{
+    Q_OBJECT
+
+public:
+    SourceDocument(const QString& filename, QObject* parent);
+
+    const QString& filename() const;
+    bool isLoaded() const;
+
+    // Only valid when the document has been loaded
+    const QString& text() const;
+    int lineCount() const;
+    QStringRef line(int line) const;
+
+    Q_SIGNAL void loaded();
+
+private:
+    friend class SourceDocumentCache;
+
+    Q_SLOT void loadFinished(uint generation, const QString& text, const QVector<int>& lineStarts);
+
+    QString m_filename;
+    QString m_text;
+    // Index into m_text where each line (0 indexed) starts
+    QVector<int> m_lineStarts;
+    // Bumped for each load so a result from an old load that finishes late is thrown away
+    uint m_generation = 0;
+    bool m_loaded = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline const QString& SourceDocument::filename() const
+{
+    return m_filename;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool SourceDocument::isLoaded() const
+{
+    return m_loaded;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline const QString& SourceDocument::text() const
+{
+    return m_text;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline int SourceDocument::lineCount() const
+{
+    return m_lineStarts.count();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Documents are owned by the cache and stays around until the cache is destroyed
+
+class SourceDocumentCache
+{
+public:
+    SourceDocumentCache();
+    ~SourceDocumentCache();
+
+    // Returns the (possibly still loading) document for the file. Starts loading it if it isn't in the cache
+    SourceDocument* document(const QString& filename);
+
+    // Load the file again (for example when it has been changed on disk)
+    void reload(const QString& filename);
+
+private:
+    void startLoad(SourceDocument* document);
+
+    QHash<QString, SourceDocument*> m_documents;
+    QThreadPool m_threadPool;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
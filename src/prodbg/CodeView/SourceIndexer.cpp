@@ -0,0 +1,216 @@
+#include "SourceIndexer.h"
+#include "SourceDocumentCache.h"
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSettings>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class SourcePrefetchJob : public QRunnable
+{
+public:
+    typedef QString (*ResolveFunc)(const QVector<SourceIndexer::PathMapping>& mappings, const QString& debugPath);
+
+    SourcePrefetchJob(SourceIndexer* indexer, ResolveFunc resolve, const QVector<SourceIndexer::PathMapping>& mappings,
+                      const QStringList& debugPaths)
+        : m_indexer(indexer)
+        , m_resolve(resolve)
+        , m_mappings(mappings)
+        , m_debugPaths(debugPaths)
+    {
+    }
+
+    void run()
+    {
+        QStringList localPaths;
+        localPaths.reserve(m_debugPaths.count());
+
+        for (const QString& path : m_debugPaths) {
+            localPaths.append(m_resolve(m_mappings, path));
+        }
+
+        // The indexer waits for all jobs before it's destroyed so m_indexer is still valid here
+        QMetaObject::invokeMethod(m_indexer, "prefetchFinished", Qt::QueuedConnection, Q_ARG(QStringList, m_debugPaths),
+                                  Q_ARG(QStringList, localPaths));
+    }
+
+private:
+    SourceIndexer* m_indexer;
+    ResolveFunc m_resolve;
+    QVector<SourceIndexer::PathMapping> m_mappings;
+    QStringList m_debugPaths;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SourceIndexer::SourceIndexer(SourceDocumentCache* sourceCache, QObject* parent)
+    : QObject(parent)
+    , m_sourceCache(sourceCache)
+{
+    m_threadPool.setMaxThreadCount(1);
+    readSettings();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SourceIndexer::~SourceIndexer()
+{
+    m_threadPool.waitForDone();
+    writeSettings();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceIndexer::setPathMappings(const QVector<PathMapping>& mappings)
+{
+    m_mappings = mappings;
+
+    // Paths may resolve to something else with the new rules
+    m_resolved.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Called on worker threads as well so this can only use the arguments
+
+QString SourceIndexer::resolvePath(const QVector<PathMapping>& mappings, const QString& debugPath)
+{
+#ifdef _WIN32
+    const Qt::CaseSensitivity cs = Qt::CaseInsensitive;
+#else
+    const Qt::CaseSensitivity cs = Qt::CaseSensitive;
+#endif
+
+    QString path = QString(debugPath).replace(QLatin1Char('\\'), QLatin1Char('/'));
+
+    for (const PathMapping& mapping : mappings) {
+        if (!path.startsWith(mapping.first, cs)) {
+            continue;
+        }
+
+        QString local = mapping.second + path.mid(mapping.first.size());
+
+        if (QFileInfo(local).isFile()) {
+            return local;
+        }
+    }
+
+    if (QFileInfo(debugPath).isFile()) {
+        return debugPath;
+    }
+
+    return QString();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QString SourceIndexer::resolve(const QString& debugPath)
+{
+    auto it = m_resolved.constFind(debugPath);
+
+    if (it != m_resolved.constEnd()) {
+        return it.value();
+    }
+
+    QString local = resolvePath(m_mappings, debugPath);
+    m_resolved.insert(debugPath, local);
+
+    return local;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceIndexer::prefetch(const QStringList& debugPaths)
+{
+    QStringList paths;
+
+    for (const QString& path : debugPaths) {
+        if (!m_resolved.contains(path)) {
+            paths.append(path);
+        }
+    }
+
+    if (paths.isEmpty()) {
+        return;
+    }
+
+    m_threadPool.start(new SourcePrefetchJob(this, resolvePath, m_mappings, paths));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceIndexer::restoreResolvedPaths(const QHash<QString, QString>& paths)
+{
+    for (auto it = paths.constBegin(), end = paths.constEnd(); it != end; ++it) {
+        // Paths that wasn't found are resolved again as the file may be there now
+        if (!it.value().isEmpty() && !m_resolved.contains(it.key())) {
+            m_resolved.insert(it.key(), it.value());
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceIndexer::prefetchFinished(const QStringList& debugPaths, const QStringList& localPaths)
+{
+    for (int i = 0, count = debugPaths.count(); i < count; ++i) {
+        // resolve() may have been called for the path while the job was running
+        if (m_resolved.contains(debugPaths[i])) {
+            continue;
+        }
+
+        const QString& local = localPaths[i];
+
+        m_resolved.insert(debugPaths[i], local);
+
+        // Starts loading the file and building the line index in the background
+        if (!local.isEmpty()) {
+            m_sourceCache->document(local);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceIndexer::readSettings()
+{
+    QSettings settings(QStringLiteral("TBL"), QStringLiteral("ProDBG"));
+    settings.beginGroup(QStringLiteral("SourceIndexer"));
+
+    int size = settings.beginReadArray(QStringLiteral("pathMappings"));
+
+    for (int i = 0; i < size; ++i) {
+        settings.setArrayIndex(i);
+
+        PathMapping mapping;
+        mapping.first = settings.value(QStringLiteral("from")).toString();
+        mapping.second = settings.value(QStringLiteral("to")).toString();
+
+        m_mappings.append(mapping);
+    }
+
+    settings.endArray();
+    settings.endGroup();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceIndexer::writeSettings()
+{
+    QSettings settings(QStringLiteral("TBL"), QStringLiteral("ProDBG"));
+    settings.beginGroup(QStringLiteral("SourceIndexer"));
+    settings.beginWriteArray(QStringLiteral("pathMappings"));
+
+    for (int i = 0, count = m_mappings.count(); i < count; ++i) {
+        settings.setArrayIndex(i);
+        settings.setValue(QStringLiteral("from"), m_mappings[i].first);
+        settings.setValue(QStringLiteral("to"), m_mappings[i].second);
+    }
+
+    settings.endArray();
+    settings.endGroup();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+namespace prodbg {
+
+class SourceDocumentCache;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Resolves source paths found in the debug info (which may be from another machine, an emulated target, etc) to
+// local files. Each path is only resolved once and then looked up in a hash. Paths are remapped using prefix rules
+// (from -> to) read from the settings, and the path as given is used if no rule gives an existing file.
+//
+// prefetch() resolves paths on a worker thread and starts loading the files in the SourceDocumentCache so
+// stepping into them later doesn't touch the disk.
+
+class SourceIndexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef QPair<QString, QString> PathMapping;
+
+    SourceIndexer(SourceDocumentCache* sourceCache, QObject* parent = nullptr);
+    ~SourceIndexer();
+
+    void setPathMappings(const QVector<PathMapping>& mappings);
+    const QVector<PathMapping>& pathMappings() const;
+
+    // Returns the local file for a debug info path or an empty string if it can't be found
+    QString resolve(const QString& debugPath);
+
+    void prefetch(const QStringList& debugPaths);
+
+    // Resolved paths (debug path -> local file) for storing in the session file. Restored paths are trusted as is and
+    // are thrown away if the path mappings changes
+    const QHash<QString, QString>& resolvedPaths() const;
+    void restoreResolvedPaths(const QHash<QString, QString>& paths);
+
+private:
+    Q_SLOT void prefetchFinished(const QStringList& debugPaths, const QStringList& localPaths);
+
+    static QString resolvePath(const QVector<PathMapping>& mappings, const QString& debugPath);
+
+    void readSettings();
+    void writeSettings();
+
+    SourceDocumentCache* m_sourceCache;
+    QVector<PathMapping> m_mappings;
+    QHash<QString, QString> m_resolved;
+    QThreadPool m_threadPool;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline const QVector<SourceIndexer::PathMapping>& SourceIndexer::pathMappings() const
+{
+    return m_mappings;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline const QHash<QString, QString>& SourceIndexer::resolvedPaths() const
+{
+    return m_resolved;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
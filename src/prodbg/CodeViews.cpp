@@ -3,8 +3,13 @@
 #include "CodeView/CodeView.h"
 #include "CodeView/DisassemblyView.h"
 #include <QDebug>
+#include <QDialog>
+#include <QDialogButtonBox>
 #include <QFileInfo>
+#include <QFormLayout>
+#include <QLineEdit>
 #include <QSettings>
+#include <QSpinBox>
 
 namespace prodbg {
 
@@ -13,6 +18,7 @@ namespace prodbg {
 CodeViews::CodeViews(BreakpointModel* breakpoints, QWidget* parent)
     : QTabWidget(parent)
     , m_breakpoints(breakpoints)
+    , m_sourceIndexer(&m_sourceCache)
 {
     setTabsClosable(true);
     m_disassemblyView = new DisassemblyView(nullptr);
@@ -47,11 +53,12 @@ void CodeViews::toggleBreakpoint()
         int line = view->getCurrentLine();
         bool added = m_breakpoints->toggleFileLineBreakpoint(filename, line + 1);
 
+        // The backend gets the same (1 based) line as the model so it can be removed again
         if (m_interface) {
             if (added) {
-                m_interface->beginAddFileLineBreakpoint(filename, line);
+                m_interface->beginAddFileLineBreakpoint(filename, line + 1);
             } else {
-                m_interface->beginRemoveFileLineBreakpoint(filename, line);
+                m_interface->beginRemoveFileLineBreakpoint(filename, line + 1);
             }
         }
 
@@ -61,6 +68,101 @@ void CodeViews::toggleBreakpoint()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static bool editCondition(QWidget* parent, QString* condition, uint32_t* hitCount)
+{
+    QDialog dialog(parent);
+    dialog.setWindowTitle(QObject::tr("Edit Breakpoint"));
+
+    QLineEdit* conditionEdit = new QLineEdit(*condition, &dialog);
+    conditionEdit->setPlaceholderText(QObject::tr("Always stop"));
+
+    QSpinBox* hitCountEdit = new QSpinBox(&dialog);
+    hitCountEdit->setRange(0, 0x7fffffff);
+    hitCountEdit->setValue(int(*hitCount));
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    QObject::connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    QObject::connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QFormLayout* layout = new QFormLayout(&dialog);
+    layout->addRow(QObject::tr("Condition"), conditionEdit);
+    layout->addRow(QObject::tr("Stop after hits"), hitCountEdit);
+    layout->addRow(buttons);
+
+    if (dialog.exec() != QDialog::Accepted) {
+        return false;
+    }
+
+    *condition = conditionEdit->text().trimmed();
+    *hitCount = uint32_t(hitCountEdit->value());
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sets the condition and hit count of the breakpoint at the cursor (adding the breakpoint if there isn't one). The
+// backend replaces the condition of a breakpoint that is already set
+
+void CodeViews::editBreakpoint()
+{
+    const int index = currentIndex();
+    QString condition;
+    uint32_t hitCount = 0;
+
+    if (index == 0 && tabText(0).indexOf(QStringLiteral("Disassembly")) == 0) {
+        uint64_t address;
+
+        if (!m_disassemblyView->currentAddress(&address)) {
+            return;
+        }
+
+        if (const BreakpointModel::AddressBreakpoint* bp = m_breakpoints->addressBreakpoint(address)) {
+            condition = bp->condition;
+            hitCount = bp->hitCount;
+        }
+
+        if (!editCondition(this, &condition, &hitCount)) {
+            return;
+        }
+
+        m_breakpoints->setAddressCondition(address, condition, hitCount);
+
+        if (m_interface) {
+            m_interface->beginAddAddressBreakpoint(address, condition, hitCount);
+        }
+
+        m_disassemblyView->repaint();
+    } else {
+        CodeView* view = dynamic_cast<CodeView*>(widget(index));
+
+        if (!view) {
+            return;
+        }
+
+        const QString& filename = tabToolTip(index);
+        int line = view->getCurrentLine() + 1;
+
+        if (const BreakpointModel::FileLineBreakpoint* bp = m_breakpoints->fileLineBreakpoint(filename, line)) {
+            condition = bp->condition;
+            hitCount = bp->hitCount;
+        }
+
+        if (!editCondition(this, &condition, &hitCount)) {
+            return;
+        }
+
+        m_breakpoints->setFileLineCondition(filename, line, condition, hitCount);
+
+        if (m_interface) {
+            m_interface->beginAddFileLineBreakpoint(filename, line, condition, hitCount);
+        }
+
+        view->repaint();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void CodeViews::sessionEnded()
 {
     for (int i = 0, c = count(); i < c; ++i) {
@@ -81,7 +183,7 @@ void CodeViews::openFile(const QString& filename, bool setActive)
 {
     QFileInfo info(filename);
 
-    CodeView* codeView = new CodeView;
+    CodeView* codeView = new CodeView(&m_sourceCache);
     codeView->initDefaultSourceFile(filename);
     codeView->setBreakpointModel(m_breakpoints);
 
@@ -89,6 +191,8 @@ void CodeViews::openFile(const QString& filename, bool setActive)
 
     setTabToolTip(index, filename);
 
+    m_fileViews.insert(filename, codeView);
+
     if (setActive) {
         setCurrentIndex(index);
     }
@@ -131,30 +235,29 @@ void CodeViews::programCounterChanged(const IBackendRequests::ProgramCounterChan
             m_wasInSourceView = false;
         }
 
-        int tabsCount = count();
+        // Map the debug info path to a local file. This is only done once per file
+        QString filename = m_sourceIndexer.resolve(pc.filename);
 
-        // Search for the source file if we already have it open activate it
-        for (int i = 0; i < tabsCount; ++i) {
-            const QString& filename = tabToolTip(i);
+        if (filename.isEmpty()) {
+            filename = pc.filename;
+        }
 
-            if (filename != pc.filename) {
-                continue;
-            }
+        // If we already have the file open activate it
+        CodeView* view = m_fileViews.value(filename);
 
-            CodeView* view = dynamic_cast<CodeView*>(widget(i));
-            Q_ASSERT(view);
+        if (view) {
             view->setExceptionLine(pc.line);
 
             if (m_mode == SourceView) {
-                setCurrentIndex(i);
+                setCurrentIndex(indexOf(view));
             }
 
             return;
         }
 
-        openFile(pc.filename, m_mode == SourceView);
+        openFile(filename, m_mode == SourceView);
 
-        CodeView* view = dynamic_cast<CodeView*>(widget(tabsCount));
+        view = m_fileViews.value(filename);
         view->setExceptionLine(pc.line);
     }
 }
@@ -224,11 +327,24 @@ void CodeViews::setSourceMode()
 
 void CodeViews::closeTab(int index)
 {
+    CodeView* view = dynamic_cast<CodeView*>(widget(index));
+
+    if (view && m_fileViews.value(tabToolTip(index)) == view) {
+        m_fileViews.remove(tabToolTip(index));
+    }
+
     removeTab(index);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void CodeViews::prefetchSourceFiles(const QStringList& debugPaths)
+{
+    m_sourceIndexer.prefetch(debugPaths);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void CodeViews::readSettings()
 {
     QSettings settings(QStringLiteral("TBL"), QStringLiteral("ProDBG"));
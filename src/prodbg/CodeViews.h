@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Backend/IBackendRequests.h"
+#include "CodeView/SourceDocumentCache.h"
+#include "CodeView/SourceIndexer.h"
+#include <QHash>
 #include <QPointer>
 #include <QTabWidget>
 
@@ -9,6 +12,7 @@ namespace prodbg {
 class BreakpointModel;
 class IBackendRequests;
 class DisassemblyView;
+class CodeView;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -21,8 +25,12 @@ public:
 
     void reloadCurrentFile();
     void toggleBreakpoint();
+    void editBreakpoint();
     void openFile(const QString& filename, bool setActive);
+    // Resolve and start loading source files in the background (for example files with breakpoints)
+    void prefetchSourceFiles(const QStringList& debugPaths);
     void setBackendInterface(IBackendRequests* iface);
+    SourceIndexer* sourceIndexer();
 
     Q_SLOT void programCounterChanged(const IBackendRequests::ProgramCounterChange& pc);
     Q_SLOT void sessionEnded();
@@ -54,6 +62,13 @@ private:
     BreakpointModel* m_breakpoints = nullptr;
     QPointer<IBackendRequests> m_interface;
     QVector<QString> m_files;
+
+    // Source files shared between the code views
+    SourceDocumentCache m_sourceCache;
+    SourceIndexer m_sourceIndexer;
+
+    // Open source views (filename -> view) so the view for a new pc is found without searching the tabs
+    QHash<QString, CodeView*> m_fileViews;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -63,5 +78,12 @@ inline void CodeViews::setBreakpointModel(BreakpointModel* breakpoints)
     m_breakpoints = breakpoints;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline SourceIndexer* CodeViews::sourceIndexer()
+{
+    return &m_sourceIndexer;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 }
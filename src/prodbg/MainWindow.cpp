@@ -9,7 +9,9 @@
 #include "CodeViews.h"
 #include "Config/AmigaUAEConfig.h"
 #include "MemoryView/MemoryView.h"
+#include "ProfileView/ProfileView.h"
 #include "RegisterView/RegisterView.h"
+#include "SessionFile.h"
 #include "ViewHandler.h"
 
 #include <QDebug>
@@ -36,6 +38,11 @@ MainWindow::MainWindow()
     qRegisterMetaType<uint32_t>("uint32_t");
     qRegisterMetaType<uint64_t>("uint64_t");
     qRegisterMetaType<IBackendRequests::ProgramCounterChange>("IBackendRequests::ProgramCounterChange");
+    qRegisterMetaType<QByteArray*>("QByteArray*");
+    qRegisterMetaType<IBackendRequests::Profile*>("IBackendRequests::Profile*");
+    qRegisterMetaType<QVector<IBackendRequests::AddressInfo>*>("QVector<IBackendRequests::AddressInfo>*");
+    qRegisterMetaType<IBackendRequests::MemorySearch*>("IBackendRequests::MemorySearch*");
+    qRegisterMetaType<QVector<uint64_t>>("QVector<uint64_t>");
 
     m_viewHandler = new ViewHandler(this);
 
@@ -82,11 +89,14 @@ MainWindow::MainWindow()
 
     setStatusBar(m_statusbar);
 
-    startDummyBackend();
-
     initActions();
     readSettings();
 
+    // Needs to be loaded before the backend is started to be able to give it the plugin state
+    loadSession();
+
+    startDummyBackend();
+
     initRecentFileActions();
 }
 
@@ -107,15 +117,19 @@ void MainWindow::initActions()
     connect(m_ui.actionReloadCurrentFile, &QAction::triggered, this, &MainWindow::reloadCurrentFile);
     connect(m_ui.actionStep_Over, &QAction::triggered, this, &MainWindow::stepOver);
     connect(m_ui.actionStep_In, &QAction::triggered, this, &MainWindow::stepIn);
+    connect(m_ui.actionReverseStep, &QAction::triggered, this, &MainWindow::reverseStep);
+    connect(m_ui.actionReverseContinue, &QAction::triggered, this, &MainWindow::reverseContinue);
     connect(m_ui.actionAmiga_UAE, &QAction::triggered, this, &MainWindow::amigaUAEConfig);
     connect(m_ui.actionDebugAmigaExe, &QAction::triggered, this, &MainWindow::debugAmigaExe);
     connect(m_ui.actionToggleBreakpoint, &QAction::triggered, this, &MainWindow::toggleBreakpoint);
+    connect(m_ui.actionEditBreakpoint, &QAction::triggered, this, &MainWindow::editBreakpoint);
     connect(m_ui.actionOpen, &QAction::triggered, this, &MainWindow::openSourceFile);
     connect(m_ui.actionBreak, &QAction::triggered, this, &MainWindow::breakContDebug);
     connect(m_ui.actionStop, &QAction::triggered, this, &MainWindow::stop);
     connect(m_ui.actionToggleSourceAsm, &QAction::triggered, m_codeViews, &CodeViews::toggleSourceAsm);
     connect(m_ui.actionMemoryView, &QAction::triggered, this, &MainWindow::newMemoryView);
     connect(m_ui.actionRegisterView, &QAction::triggered, this, &MainWindow::newRegisterView);
+    connect(m_ui.actionProfileView, &QAction::triggered, this, &MainWindow::newProfileView);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -157,18 +171,28 @@ void MainWindow::start()
     printf("MainWindow::start\n");
 
     const QVector<BreakpointModel::FileLineBreakpoint>& fileLineBreakpoints = m_breakpoints->getFileLineBreakpoints();
-    const QVector<uint64_t>& addressBreakpoints = m_breakpoints->getAddressBreakpoints();
+    const QVector<BreakpointModel::AddressBreakpoint>& addressBreakpoints = m_breakpoints->getAddressBreakpoints();
 
-    // add the breakpoints before we start
+    // add the breakpoints before we start. All of them are sent to the backend in one go
+
+    QStringList breakpointFiles;
+
+    m_backendRequests->beginTransaction();
 
     for (auto& bp : fileLineBreakpoints) {
-        m_backendRequests->beginAddFileLineBreakpoint(bp.filename, bp.line);
+        m_backendRequests->beginAddFileLineBreakpoint(bp.filename, bp.line, bp.condition, bp.hitCount);
+        breakpointFiles.append(bp.filename);
     }
 
+    // Likely that we will stop in these files so get them ready in the background
+    m_codeViews->prefetchSourceFiles(breakpointFiles);
+
     for (auto& bp : addressBreakpoints) {
-        m_backendRequests->beginAddAddressBreakpoint(bp);
+        m_backendRequests->beginAddAddressBreakpoint(bp.address, bp.condition, bp.hitCount);
     }
 
+    m_backendRequests->commitTransaction();
+
     startBackend();
 }
 
@@ -280,9 +304,12 @@ void MainWindow::setupBackendConnections()
 {
     connect(this, &MainWindow::stepInBackend, m_backend, &BackendSession::stepIn);
     connect(this, &MainWindow::stepOverBackend, m_backend, &BackendSession::stepOver);
+    connect(this, &MainWindow::reverseStepBackend, m_backend, &BackendSession::reverseStep);
+    connect(this, &MainWindow::reverseContinueBackend, m_backend, &BackendSession::reverseContinue);
     connect(this, &MainWindow::startBackend, m_backend, &BackendSession::start);
     connect(this, &MainWindow::breakContBackend, m_backend, &BackendSession::breakContDebug);
     connect(this, &MainWindow::stopBackend, m_backend, &BackendSession::stop);
+    connect(this, &MainWindow::loadBackendState, m_backend, &BackendSession::loadState);
     connect(m_backend, &BackendSession::statusUpdate, this, &MainWindow::statusUpdate);
 
     connect(m_backendThread, &QThread::finished, m_backend, &BackendSession::threadFinished);
@@ -306,6 +333,8 @@ void MainWindow::startDummyBackend()
 
 void MainWindow::closeCurrentBackend()
 {
+    storeBackendState();
+
     if (m_backendThread) {
         m_backendThread->quit();
         m_backendThread->wait();
@@ -366,6 +395,9 @@ void MainWindow::setupBackend(BackendSession* backend)
     m_backendThread->start();
 
     setupBackendConnections();
+
+    // Queued before any other request so the plugin has its state back before breakpoints etc are sent
+    loadBackendState(m_pluginStates.value(m_backend->backendName()));
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -408,6 +440,20 @@ void MainWindow::stepOver()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void MainWindow::reverseStep()
+{
+    reverseStepBackend();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::reverseContinue()
+{
+    reverseContinueBackend();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void MainWindow::toggleBreakpoint()
 {
     m_codeViews->toggleBreakpoint();
@@ -415,6 +461,13 @@ void MainWindow::toggleBreakpoint()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void MainWindow::editBreakpoint()
+{
+    m_codeViews->editBreakpoint();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void MainWindow::newMemoryView()
 {
     MemoryView* mv = new MemoryView(this);
@@ -447,6 +500,87 @@ Q_SLOT void MainWindow::newRegisterView()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void MainWindow::newProfileView()
+{
+    ProfileView* pv = new ProfileView(this);
+    pv->setBackendInterface(m_backendRequests);
+    QDockWidget* dock = new QDockWidget(QStringLiteral("ProfileView"), this);
+    dock->setAllowedAreas(Qt::AllDockWidgetAreas);
+    dock->setObjectName(QStringLiteral("ProfileViewDock"));
+    dock->setWidget(pv);
+    addDockWidget(Qt::TopDockWidgetArea, dock);
+    dock->setFloating(true);
+
+    m_viewHandler->addView(pv);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Gets the plugin state from the backend thread. Blocks but save_state is expected to be quick and this is only
+// done when closing the backend or the window
+
+void MainWindow::storeBackendState()
+{
+    if (!m_backend || !m_backendThread || !m_backendThread->isRunning()) {
+        return;
+    }
+
+    QByteArray state;
+
+    QMetaObject::invokeMethod(m_backend, "saveState", Qt::BlockingQueuedConnection, Q_ARG(QByteArray*, &state));
+
+    if (!state.isEmpty()) {
+        m_pluginStates.insert(m_backend->backendName(), state);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::loadSession()
+{
+    SessionFile session;
+
+    if (!session.load(SessionFile::defaultFilename())) {
+        return;
+    }
+
+    for (auto& bp : session.fileLineBreakpoints) {
+        m_breakpoints->setFileLineCondition(bp.filename, bp.line, bp.condition, bp.hitCount);
+    }
+
+    for (auto& bp : session.addressBreakpoints) {
+        m_breakpoints->setAddressCondition(bp.address, bp.condition, bp.hitCount);
+    }
+
+    m_codeViews->sourceIndexer()->restoreResolvedPaths(session.resolvedPaths);
+    m_pluginStates = session.pluginStates;
+
+    if (!session.layout.isEmpty()) {
+        restoreState(session.layout);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::saveSession()
+{
+    storeBackendState();
+
+    SessionFile session;
+
+    session.fileLineBreakpoints = m_breakpoints->getFileLineBreakpoints();
+    session.addressBreakpoints = m_breakpoints->getAddressBreakpoints();
+    session.layout = saveState();
+    session.resolvedPaths = m_codeViews->sourceIndexer()->resolvedPaths();
+    session.pluginStates = m_pluginStates;
+
+    if (!session.save(SessionFile::defaultFilename())) {
+        qDebug() << "Unable to write session file" << SessionFile::defaultFilename();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void MainWindow::statusUpdate(const QString& status)
 {
     m_statusbar->showMessage(status);
@@ -459,6 +593,7 @@ void MainWindow::closeEvent(QCloseEvent* event)
     QSettings settings(QStringLiteral("TBL"), QStringLiteral("ProDBG"));
 
     writeSettings();
+    saveSession();
 
     if (m_amigaUae) {
         m_amigaUae->writeSettings();
@@ -498,7 +633,9 @@ void MainWindow::writeSettings()
     settings.setValue(QStringLiteral("size"), size());
     settings.setValue(QStringLiteral("pos"), pos());
     settings.setValue(QStringLiteral("geometry"), saveGeometry());
-    settings.setValue(QStringLiteral("windowState"), saveState());
+
+    // The dock layout lives in the session file only
+    settings.remove(QStringLiteral("windowState"));
 
     settings.endGroup();
 }
@@ -540,7 +677,6 @@ void MainWindow::readSettings()
     */
 
     restoreGeometry(settings.value(QStringLiteral("geometry")).toByteArray());
-    restoreState(settings.value(QStringLiteral("windowState")).toByteArray());
     resize(settings.value(QStringLiteral("size"), QSize(800, 600)).toSize());
     move(settings.value(QStringLiteral("pos"), QPoint(100, 100)).toPoint());
     settings.endGroup();
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "ui_MainWindow.h"
+#include <QByteArray>
+#include <QHash>
 #include <QMainWindow>
 
 class QStatusBar;
@@ -42,19 +44,26 @@ private:
     Q_SLOT void stop();
     Q_SLOT void stepIn();
     Q_SLOT void stepOver();
+    Q_SLOT void reverseStep();
+    Q_SLOT void reverseContinue();
     Q_SLOT void toggleBreakpoint();
+    Q_SLOT void editBreakpoint();
     Q_SLOT void amigaUAEConfig();
     Q_SLOT void debugAmigaExe();
     Q_SLOT void openRecentExe();
 
     Q_SLOT void newMemoryView();
     Q_SLOT void newRegisterView();
+    Q_SLOT void newProfileView();
 
     Q_SIGNAL void breakContBackend();
     Q_SIGNAL void startBackend();
     Q_SIGNAL void stopBackend();
     Q_SIGNAL void stepInBackend();
     Q_SIGNAL void stepOverBackend();
+    Q_SIGNAL void reverseStepBackend();
+    Q_SIGNAL void reverseContinueBackend();
+    Q_SIGNAL void loadBackendState(const QByteArray& state);
 
 private:
     // Current supported backends (hard-coded for now)
@@ -69,6 +78,9 @@ private:
     void initActions();
     void writeSettings();
     void readSettings();
+    void loadSession();
+    void saveSession();
+    void storeBackendState();
     void startDummyBackend();
     void closeCurrentBackend();
     void startAmigaUAEBackend();
@@ -101,6 +113,10 @@ private:
     QStatusBar* m_statusbar = nullptr;
     BreakpointModel* m_breakpoints = nullptr;
 
+    // State of the backend plugins (by plugin name) from the session file. Kept for all backends so switching
+    // backend doesn't lose the state of the others
+    QHash<QString, QByteArray> m_pluginStates;
+
     Ui_MainWindow m_ui;
     Backend m_currentBackend = Dummy;
 
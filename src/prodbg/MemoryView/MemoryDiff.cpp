@@ -0,0 +1,273 @@
+#include "MemoryDiff.h"
+#include <QtAlgorithms>
+#include <string.h>
+
+namespace prodbg {
+
+// Bytes compared at a time. Blocks are compared as 64-bit words which the compiler turns into vector compares
+static const uint64_t s_blockSize = 32;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline bool blockEqual(const uint8_t* a, const uint8_t* b)
+{
+    uint64_t wa[4], wb[4];
+
+    memcpy(wa, a, sizeof(wa));
+    memcpy(wb, b, sizeof(wb));
+
+    return ((wa[0] ^ wb[0]) | (wa[1] ^ wb[1]) | (wa[2] ^ wb[2]) | (wa[3] ^ wb[3])) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void addChangedByte(QVector<MemoryDiff::Run>* runs, uint64_t address)
+{
+    if (!runs->isEmpty()) {
+        MemoryDiff::Run& last = runs->last();
+
+        if (last.address + last.size == address) {
+            last.size++;
+            return;
+        }
+    }
+
+    runs->append({ address, 1 });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryDiff::changedRuns(const MemorySnapshot& before, const MemorySnapshot& after, QVector<Run>* runs)
+{
+    runs->resize(0);
+
+    for (int i = 0; i < after.pageCount(); ++i) {
+        const uint64_t pageAddress = after.start() + uint64_t(i) * MemorySnapshot::PageSize;
+        const int beforeIndex = before.pageIndex(pageAddress);
+        const uint8_t* a = beforeIndex != -1 ? before.page(beforeIndex) : nullptr;
+        const uint8_t* b = after.page(i);
+
+        if (!a || !b || a == b) {
+            continue;
+        }
+
+        for (uint64_t offset = 0; offset < MemorySnapshot::PageSize; offset += s_blockSize) {
+            if (blockEqual(a + offset, b + offset)) {
+                continue;
+            }
+
+            for (uint64_t j = offset; j < offset + s_blockSize; ++j) {
+                if (a[j] != b[j]) {
+                    addChangedByte(runs, pageAddress + j);
+                }
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryDiff::reset()
+{
+    m_filtered = false;
+    m_candidateCount = 0;
+    m_bits.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint64_t readValue(const uint8_t* data, int size, bool bigEndian)
+{
+    uint64_t value = 0;
+
+    if (bigEndian) {
+        for (int i = 0; i < size; ++i) {
+            value = (value << 8) | data[i];
+        }
+    } else {
+        for (int i = size - 1; i >= 0; --i) {
+            value = (value << 8) | data[i];
+        }
+    }
+
+    return value;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Only called for values that differ. Returns 1 if the value increased, -1 if it decreased and 0 if neither (NaN)
+
+static int compareValues(const uint8_t* before, const uint8_t* after, const MemoryDiff::ValueType& type)
+{
+    const uint64_t a = readValue(before, type.size, type.bigEndian);
+    const uint64_t b = readValue(after, type.size, type.bigEndian);
+
+    if (type.isFloat && (type.size == 4 || type.size == 8)) {
+        double fa, fb;
+
+        if (type.size == 4) {
+            float f32;
+            uint32_t i32 = uint32_t(a);
+            memcpy(&f32, &i32, sizeof(f32));
+            fa = f32;
+            i32 = uint32_t(b);
+            memcpy(&f32, &i32, sizeof(f32));
+            fb = f32;
+        } else {
+            memcpy(&fa, &a, sizeof(fa));
+            memcpy(&fb, &b, sizeof(fb));
+        }
+
+        return fb > fa ? 1 : (fb < fa ? -1 : 0);
+    }
+
+    if (type.isSigned) {
+        const int shift = 64 - type.size * 8;
+        const int64_t sa = int64_t(a << shift) >> shift;
+        const int64_t sb = int64_t(b << shift) >> shift;
+
+        return sb > sa ? 1 : -1;
+    }
+
+    return b > a ? 1 : -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Values that are already filtered out are skipped 64 at a time and blocks of values that are all unchanged are found
+// with a block compare, so each filter only does real work for the candidates that are left in memory that changed
+
+bool MemoryDiff::filter(const MemorySnapshot& before, const MemorySnapshot& after, Filter filter,
+                        const ValueType& type)
+{
+    const int size = type.size;
+
+    if (before.start() != after.start() || before.pageCount() != after.pageCount() ||
+        (size != 1 && size != 2 && size != 4 && size != 8)) {
+        return false;
+    }
+
+    if (!m_filtered || m_start != after.start() || m_end != after.end() || m_valueSize != size) {
+        m_start = after.start();
+        m_end = after.end();
+        m_valueSize = size;
+        m_bits.fill(~uint64_t(0), int((m_end - m_start) / uint64_t(size) / 64));
+    }
+
+    // Pages hold a whole number of 64 value words for all value sizes
+    const int wordsPerPage = int(MemorySnapshot::PageSize / uint64_t(size) / 64);
+    const uint64_t bytesPerWord = 64 * uint64_t(size);
+
+    for (int i = 0; i < after.pageCount(); ++i) {
+        const uint8_t* a = before.page(i);
+        const uint8_t* b = after.page(i);
+        uint64_t* bits = m_bits.data() + i * wordsPerPage;
+
+        if (!a || !b || (a == b && filter != Filter_Unchanged)) {
+            memset(bits, 0, wordsPerPage * sizeof(uint64_t));
+            continue;
+        }
+
+        if (a == b) {
+            continue;
+        }
+
+        for (int w = 0; w < wordsPerPage; ++w) {
+            const uint8_t* wa = a + w * bytesPerWord;
+            const uint8_t* wb = b + w * bytesPerWord;
+            uint64_t keep = 0;
+
+            if (bits[w] == 0) {
+                continue;
+            }
+
+            for (uint64_t block = 0; block < bytesPerWord; block += s_blockSize) {
+                const int first = int(block / uint64_t(size));
+                const int count = int(s_blockSize / uint64_t(size));
+                const uint64_t blockBits = ((uint64_t(1) << count) - 1) << first;
+
+                if ((bits[w] & blockBits) == 0) {
+                    continue;
+                }
+
+                if (blockEqual(wa + block, wb + block)) {
+                    if (filter == Filter_Unchanged) {
+                        keep |= blockBits;
+                    }
+
+                    continue;
+                }
+
+                for (int v = first; v < first + count; ++v) {
+                    if (!(bits[w] & (uint64_t(1) << v))) {
+                        continue;
+                    }
+
+                    const uint8_t* va = wa + v * size;
+                    const uint8_t* vb = wb + v * size;
+                    bool changed = memcmp(va, vb, size_t(size)) != 0;
+                    bool match = false;
+
+                    switch (filter) {
+                        case Filter_Changed:
+                            match = changed;
+                            break;
+                        case Filter_Unchanged:
+                            match = !changed;
+                            break;
+                        case Filter_Increased:
+                            match = changed && compareValues(va, vb, type) > 0;
+                            break;
+                        case Filter_Decreased:
+                            match = changed && compareValues(va, vb, type) < 0;
+                            break;
+                    }
+
+                    if (match) {
+                        keep |= uint64_t(1) << v;
+                    }
+                }
+            }
+
+            bits[w] &= keep;
+        }
+    }
+
+    m_candidateCount = 0;
+
+    for (uint64_t word : m_bits) {
+        m_candidateCount += qPopulationCount(word);
+    }
+
+    m_filtered = true;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MemoryDiff::isCandidate(uint64_t address, int size) const
+{
+    if (!m_filtered || size <= 0) {
+        return false;
+    }
+
+    const uint64_t start = qMax(address, m_start);
+    const uint64_t end = qMin(address + uint64_t(size), m_end);
+
+    if (start >= end) {
+        return false;
+    }
+
+    const uint64_t first = (start - m_start) / uint64_t(m_valueSize);
+    const uint64_t last = (end - 1 - m_start) / uint64_t(m_valueSize);
+
+    for (uint64_t i = first; i <= last; ++i) {
+        if (m_bits[int(i / 64)] & (uint64_t(1) << (i % 64))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
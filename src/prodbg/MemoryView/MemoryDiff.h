@@ -0,0 +1,69 @@
+#pragma once
+
+#include "MemorySnapshot.h"
+#include <QVector>
+#include <stdint.h>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compares snapshots of the same range to show what changed between two stops and to narrow down where a value is
+// kept by filtering the values in the range on how they changed (cheat search style). Each filter is applied to the
+// values that are left from the previous one.
+
+class MemoryDiff
+{
+public:
+    // Bytes at [address, address + size) changed
+    struct Run
+    {
+        uint64_t address;
+        uint64_t size;
+    };
+
+    enum Filter
+    {
+        Filter_Changed,
+        Filter_Unchanged,
+        Filter_Increased,
+        Filter_Decreased,
+    };
+
+    // How values are read when filtering. Values are aligned to their size (1, 2, 4 or 8 bytes)
+    struct ValueType
+    {
+        int size = 1;
+        bool isSigned = false;
+        bool isFloat = false;
+        bool bigEndian = false;
+    };
+
+    // Runs of changed bytes (sorted on address). Pages that are shared between the snapshots are skipped without
+    // being compared and pages that couldn't be read in either snapshot are never reported as changed
+    static void changedRuns(const MemorySnapshot& before, const MemorySnapshot& after, QVector<Run>* runs);
+
+    // Makes every value a candidate again
+    void reset();
+
+    // Keeps the candidates whose value changed the way the filter says. Filtering a different range or value size
+    // than last time starts over with every value as a candidate. Returns false if the snapshots don't cover the same
+    // range (or the value size isn't supported)
+    bool filter(const MemorySnapshot& before, const MemorySnapshot& after, Filter filter, const ValueType& type);
+
+    bool isFiltered() const { return m_filtered; }
+    uint64_t candidateCount() const { return m_candidateCount; }
+    // True if a candidate overlaps [address, address + size)
+    bool isCandidate(uint64_t address, int size) const;
+
+private:
+    uint64_t m_start = 0;
+    uint64_t m_end = 0;
+    int m_valueSize = 0;
+    bool m_filtered = false;
+    uint64_t m_candidateCount = 0;
+    // One bit per value, set while it's a candidate
+    QVector<uint64_t> m_bits;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,101 @@
+#include "MemorySnapshot.h"
+#include "Backend/IBackendRequests.h"
+#include <string.h>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MemorySnapshot::MemorySnapshot(uint64_t start, uint64_t end)
+    : m_start(start & ~(PageSize - 1))
+{
+    uint64_t pageEnd = (end + PageSize - 1) & ~(PageSize - 1);
+
+    if (pageEnd > m_start && pageEnd - m_start <= MaxSize) {
+        m_pages.resize(int((pageEnd - m_start) / PageSize));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int MemorySnapshot::pageIndex(uint64_t address) const
+{
+    if (address < m_start || address >= end()) {
+        return -1;
+    }
+
+    return int((address - m_start) / PageSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const uint8_t* MemorySnapshot::page(int index) const
+{
+    const QByteArray& page = m_pages[index];
+
+    if (page.isEmpty()) {
+        return nullptr;
+    }
+
+    return reinterpret_cast<const uint8_t*>(page.constData());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemorySnapshot::setData(uint64_t address, const QVector<uint16_t>& data, const MemorySnapshot* previous)
+{
+    const uint64_t dataEnd = address + uint64_t(data.size());
+    uint64_t pageAddress = (address + PageSize - 1) & ~(PageSize - 1);
+
+    QByteArray content(int(PageSize), Qt::Uninitialized);
+
+    for (; pageAddress + PageSize <= dataEnd; pageAddress += PageSize) {
+        int index = pageIndex(pageAddress);
+
+        if (index == -1) {
+            continue;
+        }
+
+        const uint16_t* values = data.constData() + (pageAddress - address);
+        uint8_t* dest = reinterpret_cast<uint8_t*>(content.data());
+        uint16_t readable = IBackendRequests::MemoryAddressFlags::Readable;
+
+        for (uint64_t i = 0; i < PageSize; ++i) {
+            dest[i] = uint8_t(values[i]);
+            readable &= values[i];
+        }
+
+        if (!readable) {
+            continue;
+        }
+
+        // Same as in the previous snapshot is the common case so that is checked first
+
+        if (previous) {
+            int previousIndex = previous->pageIndex(pageAddress);
+            const uint8_t* previousPage = previousIndex != -1 ? previous->page(previousIndex) : nullptr;
+
+            if (previousPage && memcmp(previousPage, dest, PageSize) == 0) {
+                m_pages[index] = previous->m_pages[previousIndex];
+                continue;
+            }
+        }
+
+        auto pooled = m_pool.constFind(content);
+
+        if (pooled != m_pool.constEnd()) {
+            m_pages[index] = *pooled;
+            continue;
+        }
+
+        m_pages[index] = content;
+        m_pool.insert(content);
+        m_storedPages++;
+
+        // The stored page shares the data with content so the next page is read into a new buffer
+        content = QByteArray(int(PageSize), Qt::Uninitialized);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QByteArray>
+#include <QSet>
+#include <QVector>
+#include <stdint.h>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copy of a range of target memory. The memory is kept in pages that are implicitly shared so copying a snapshot is
+// cheap. A page that has the same content as the page at the same address in the previous snapshot (or as another
+// page in this snapshot, such as cleared memory) shares its data instead of storing it again, so snapshots taken a
+// few stops apart mostly share their memory and MemoryDiff can skip the shared pages without comparing them.
+
+class MemorySnapshot
+{
+public:
+    static const uint64_t PageSize = 4096;
+    // Largest range a snapshot can cover. This keeps the number of reads and the memory used for filtering (one bit
+    // per value, see MemoryDiff) reasonable
+    static const uint64_t MaxSize = 64 * 1024 * 1024;
+
+    MemorySnapshot() = default;
+    // The range is extended to whole pages. All pages are unreadable until they are set. The snapshot is left empty
+    // if the range is larger than MaxSize
+    MemorySnapshot(uint64_t start, uint64_t end);
+
+    // Stores memory as read with IBackendRequests::beginReadMemory. Pages that are only partly covered by the data
+    // or that have any byte not flagged as readable are left unreadable. previous is the snapshot to share unchanged
+    // pages with (can be null)
+    void setData(uint64_t address, const QVector<uint16_t>& data, const MemorySnapshot* previous);
+
+    uint64_t start() const { return m_start; }
+    uint64_t end() const { return m_start + uint64_t(m_pages.size()) * PageSize; }
+    bool isEmpty() const { return m_pages.isEmpty(); }
+    int pageCount() const { return m_pages.size(); }
+
+    // Index of the page with the address or -1 if it's outside the snapshot
+    int pageIndex(uint64_t address) const;
+    // Null if the page couldn't be read
+    const uint8_t* page(int index) const;
+    // Number of pages that had to be stored (that didn't share their data with another page)
+    int storedPageCount() const { return m_storedPages; }
+
+private:
+    uint64_t m_start = 0;
+    QVector<QByteArray> m_pages;
+    // Content of the pages stored so far, used to find pages that can share their data
+    QSet<QByteArray> m_pool;
+    int m_storedPages = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -3,6 +3,7 @@
 #include "Backend/IBackendRequests.h"
 #include <QtCore/QDebug>
 #include <QtCore/QMetaEnum>
+#include <QMenu>
 #include <QSettings>
 
 namespace prodbg {
@@ -45,6 +46,24 @@ MemoryView::MemoryView(QWidget* parent)
     connect(m_Ui->m_Count, static_cast<void (QComboBox::*)(const QString&)>(&QComboBox::currentIndexChanged), this,
             &MemoryView::countChanged);
 
+    QMenu* snapshotMenu = new QMenu(this);
+    MemoryViewWidget* view = m_Ui->m_View;
+
+    snapshotMenu->addAction(tr("Take Snapshot"), this, &MemoryView::takeSnapshot);
+    snapshotMenu->addSeparator();
+    snapshotMenu->addAction(tr("Keep Changed"), [view]() { view->filterSnapshots(MemoryDiff::Filter_Changed); });
+    snapshotMenu->addAction(tr("Keep Unchanged"), [view]() { view->filterSnapshots(MemoryDiff::Filter_Unchanged); });
+    snapshotMenu->addAction(tr("Keep Increased"), [view]() { view->filterSnapshots(MemoryDiff::Filter_Increased); });
+    snapshotMenu->addAction(tr("Keep Decreased"), [view]() { view->filterSnapshots(MemoryDiff::Filter_Decreased); });
+    snapshotMenu->addSeparator();
+    snapshotMenu->addAction(tr("Clear Snapshots"), view, &MemoryViewWidget::clearSnapshots);
+
+    m_Ui->m_Snapshot->setMenu(snapshotMenu);
+
+    connect(m_Ui->m_SnapshotRange, &QLineEdit::returnPressed, this, &MemoryView::takeSnapshot);
+    connect(view, &MemoryViewWidget::snapshotStatusChanged, m_Ui->m_SnapshotStatus, &QLabel::setText);
+    connect(m_Ui->m_Search, &QLineEdit::returnPressed, this, &MemoryView::search);
+
     readSettings();
 }
 
@@ -70,8 +89,14 @@ void MemoryView::interfaceSet()
 {
     m_Ui->m_View->setBackendInterface(m_interface);
 
+    // The old backend won't reply to a search that is running
+    m_searchInProgress = false;
+    m_searchKey.clear();
+    m_Ui->m_SearchStatus->clear();
+
     if (m_interface) {
         connect(m_interface, &IBackendRequests::endResolveAddress, this, &MemoryView::endResolveAddress);
+        connect(m_interface, &IBackendRequests::endSearchMemory, this, &MemoryView::endSearchMemory);
     }
 }
 
@@ -124,6 +149,141 @@ void MemoryView::countChanged(const QString& text)
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The range is given as "start-end" or "start+size" with the numbers in C syntax (0x for hex)
+
+bool MemoryView::parseRange(uint64_t* start, uint64_t* end) const
+{
+    const QString text = m_Ui->m_SnapshotRange->text().trimmed();
+    const bool isSize = text.contains(QLatin1Char('+'));
+    const QStringList parts = text.split(isSize ? QLatin1Char('+') : QLatin1Char('-'));
+
+    bool startOk = false;
+    bool endOk = false;
+
+    if (parts.size() == 2) {
+        *start = parts[0].trimmed().toULongLong(&startOk, /*base:*/ 0);
+        *end = parts[1].trimmed().toULongLong(&endOk, /*base:*/ 0);
+    }
+
+    if (isSize) {
+        *end += *start;
+    }
+
+    return startOk && endOk && *start < *end;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryView::takeSnapshot()
+{
+    uint64_t start = 0;
+    uint64_t end = 0;
+
+    if (!parseRange(&start, &end)) {
+        m_Ui->m_SnapshotStatus->setText(tr("Invalid snapshot range"));
+        return;
+    }
+
+    m_Ui->m_View->takeSnapshot(start, end);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The pattern is hex bytes ("4e75" or "4e 75") where ?? matches any byte. Searching for the same pattern in the same
+// range again steps to the next match instead of asking the backend again
+
+void MemoryView::search()
+{
+    const QString text = m_Ui->m_Search->text();
+    const QString key = text + QLatin1Char('@') + m_Ui->m_SnapshotRange->text();
+
+    if (!m_interface || m_searchInProgress) {
+        return;
+    }
+
+    if (key == m_searchKey && !m_search.matches.isEmpty()) {
+        m_searchIndex = (m_searchIndex + 1) % m_search.matches.size();
+        showSearchMatch();
+        return;
+    }
+
+    QString digits = text;
+    digits.remove(QLatin1Char(' '));
+
+    IBackendRequests::MemorySearch request;
+    bool maskUsed = false;
+    bool ok = !digits.isEmpty() && (digits.size() & 1) == 0;
+
+    for (int i = 0; ok && i < digits.size(); i += 2) {
+        const QStringRef byte = digits.midRef(i, 2);
+
+        if (byte == QLatin1String("??")) {
+            request.pattern.append(char(0));
+            request.mask.append(char(0));
+            maskUsed = true;
+        } else {
+            request.pattern.append(char(byte.toUInt(&ok, 16)));
+            request.mask.append(char(0xff));
+        }
+    }
+
+    if (!ok) {
+        m_Ui->m_SearchStatus->setText(tr("Invalid search pattern"));
+        return;
+    }
+
+    if (!parseRange(&request.start, &request.end)) {
+        m_Ui->m_SearchStatus->setText(tr("Invalid search range"));
+        return;
+    }
+
+    if (!maskUsed) {
+        request.mask.clear();
+    }
+
+    m_search = request;
+    m_searchKey = key;
+    m_searchIndex = 0;
+    m_searchInProgress = true;
+    m_Ui->m_SearchStatus->setText(tr("Searching..."));
+
+    m_interface->beginSearchMemory(&m_search);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryView::endSearchMemory(IBackendRequests::MemorySearch* search)
+{
+    if (search != &m_search || !m_searchInProgress) {
+        return;
+    }
+
+    m_searchInProgress = false;
+
+    if (m_search.matches.isEmpty()) {
+        m_Ui->m_SearchStatus->setText(tr("No matches"));
+        return;
+    }
+
+    showSearchMatch();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryView::showSearchMatch()
+{
+    const uint64_t address = m_search.matches[m_searchIndex];
+
+    m_Ui->m_SearchStatus->setText(tr("Match %1 of %2%3")
+                                      .arg(m_searchIndex + 1)
+                                      .arg(m_search.matches.size())
+                                      .arg(m_search.truncated ? QStringLiteral("+") : QString()));
+
+    m_Ui->m_Address->setText(QStringLiteral("0x") + QString::number(address, 16));
+    m_Ui->m_View->setAddress(address);
+    m_Ui->m_View->update();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     
 void MemoryView::readSettings()
@@ -134,6 +294,7 @@ void MemoryView::readSettings()
     settings.beginGroup(QStringLiteral("MemoryView_0"));
     m_Ui->m_Endianess->setCurrentIndex(settings.value(QStringLiteral("endian")).toInt());
     m_Ui->m_Type->setCurrentIndex(settings.value(QStringLiteral("data_type")).toInt());
+    m_Ui->m_SnapshotRange->setText(settings.value(QStringLiteral("snapshot_range")).toString());
     settings.endGroup();
 }
 
@@ -148,6 +309,7 @@ void MemoryView::writeSettings()
     settings.setValue(QStringLiteral("endian"), m_Ui->m_Endianess->currentIndex());
     settings.setValue(QStringLiteral("data_type"), m_Ui->m_Type->currentIndex());
     settings.setValue(QStringLiteral("count"), m_Ui->m_Type->currentIndex());
+    settings.setValue(QStringLiteral("snapshot_range"), m_Ui->m_SnapshotRange->text());
     settings.endGroup();
 }
 
@@ -38,10 +38,23 @@ private:
     Q_SLOT void endianChanged(int);
     Q_SLOT void dataTypeChanged(int);
     Q_SLOT void countChanged(const QString&);
+    Q_SLOT void takeSnapshot();
+    Q_SLOT void search();
+    Q_SLOT void endSearchMemory(IBackendRequests::MemorySearch* search);
+
+    bool parseRange(uint64_t* start, uint64_t* end) const;
+    void showSearchMatch();
 
 private:
     Ui_MemoryView* m_Ui = nullptr;
     uint64_t m_evalAddress = 0;
+    // Search the backend runs. It's owned by this view but must not be touched while m_searchInProgress is set
+    IBackendRequests::MemorySearch m_search;
+    bool m_searchInProgress = false;
+    // Pattern and range the current matches were found with and the match that is shown. Searching for the same
+    // again steps to the next match
+    QString m_searchKey;
+    int m_searchIndex = 0;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
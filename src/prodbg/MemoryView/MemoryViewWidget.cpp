@@ -8,6 +8,7 @@
 #include <QtWidgets/QMenu>
 #include <QApplication>
 
+#include <algorithm>
 #include <ctype.h>
 
 namespace prodbg {
@@ -197,6 +198,12 @@ static const struct MemViewTypeMeta s_TypeMeta[] = {
 
 static QChar s_AsciiTab[256];
 
+// Watchpoint ids are shared by all memory views so they don't remove each others watchpoints
+static uint32_t s_nextWatchpointId = 1;
+
+// Snapshots are read this much at a time so each read stays well within the event buffer
+static const uint64_t s_snapshotChunkSize = 64 * 1024;
+
 class MemoryViewPrivate
 {
 public:
@@ -219,6 +226,205 @@ public:
     QVector<uint16_t> m_Cache;
     QVector<uint16_t> m_transferCache;
 
+    struct Watchpoint
+    {
+        uint32_t id;
+        uint64_t address;
+        uint64_t size;
+    };
+
+    QVector<Watchpoint> m_watchpoints;
+
+    // The watchpoint the target last stopped on. The id is 0 if the backend only knows the address
+    bool m_watchHit = false;
+    uint32_t m_hitWatchId = 0;
+    uint64_t m_hitWatchAddress = 0;
+
+    // The two latest snapshots. m_pendingSnapshot is read a chunk at a time and becomes m_snapshot when it's done
+    MemorySnapshot m_previousSnapshot;
+    MemorySnapshot m_snapshot;
+    MemorySnapshot m_pendingSnapshot;
+    uint64_t m_snapshotReadAddress = 0;
+    bool m_snapshotInProgress = false;
+    QVector<uint16_t> m_snapshotTransfer;
+    // Changes between m_previousSnapshot and m_snapshot
+    QVector<MemoryDiff::Run> m_changedRuns;
+    MemoryDiff m_diff;
+
+    // Positions of the columns. Same for all rows
+    struct Layout
+    {
+        int charWidth;
+        int rowHeight;
+        int addressWidth;
+        int dataWidth;
+        int asciiWidth;
+        int gutterWidth;
+        int dataX() const { return addressWidth + gutterWidth; }
+        int asciiX() const { return dataX() + dataWidth + gutterWidth; }
+    };
+
+    Layout layout(QWidget* widget) const
+    {
+        QFontMetrics fontMetrics(widget->font());
+        const MemViewTypeMeta& typeMeta = s_TypeMeta[m_DataType];
+        Layout layout;
+
+        layout.charWidth = fontMetrics.boundingRect(QLatin1Char('W')).width();
+        layout.rowHeight = fontMetrics.height();
+        layout.addressWidth = (m_adddressWidth * 2) * layout.charWidth;
+        layout.dataWidth =
+            layout.charWidth * (m_ElementsPerRow * typeMeta.m_DisplayWidthChars + m_ElementsPerRow - 1);
+        layout.asciiWidth = m_ElementsPerRow * bytesPerElement() * layout.charWidth;
+        layout.gutterWidth = layout.charWidth;
+
+        return layout;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Finds the element (data column) or byte (ascii column) at a position in the widget
+
+    bool addressAt(QWidget* widget, const QPoint& pos, uint64_t* address, int* size) const
+    {
+        const Layout l = layout(widget);
+        const MemViewTypeMeta& typeMeta = s_TypeMeta[m_DataType];
+        const uint64_t rowStart = m_TopRow + uint64_t(pos.y() / l.rowHeight) * m_ElementsPerRow * bytesPerElement();
+
+        if (pos.x() >= l.dataX() && pos.x() < l.dataX() + l.dataWidth) {
+            int element = (pos.x() - l.dataX()) / (l.charWidth * (typeMeta.m_DisplayWidthChars + 1));
+            *address = rowStart + element * bytesPerElement();
+            *size = bytesPerElement();
+            return true;
+        }
+
+        if (pos.x() >= l.asciiX() && pos.x() < l.asciiX() + l.asciiWidth) {
+            *address = rowStart + (pos.x() - l.asciiX()) / l.charWidth;
+            *size = 1;
+            return true;
+        }
+
+        return false;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    bool isWatched(uint64_t address, int size) const
+    {
+        for (const Watchpoint& watchpoint : m_watchpoints) {
+            if (address < watchpoint.address + watchpoint.size && watchpoint.address < address + size) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    bool isWatchHit(uint64_t address, int size) const
+    {
+        if (!m_watchHit) {
+            return false;
+        }
+
+        for (const Watchpoint& watchpoint : m_watchpoints) {
+            bool hit = m_hitWatchId ? watchpoint.id == m_hitWatchId
+                                    : m_hitWatchAddress >= watchpoint.address &&
+                                          m_hitWatchAddress < watchpoint.address + watchpoint.size;
+
+            if (hit && address < watchpoint.address + watchpoint.size && watchpoint.address < address + size) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    bool isChanged(uint64_t address, int size) const
+    {
+        auto it = std::upper_bound(m_changedRuns.constBegin(), m_changedRuns.constEnd(), address,
+                                   [](uint64_t a, const MemoryDiff::Run& run) { return a < run.address; });
+
+        // The run before the first run that starts after the address is the only one that can start at or before it
+
+        if (it != m_changedRuns.constBegin() && address < (it - 1)->address + (it - 1)->size) {
+            return true;
+        }
+
+        return it != m_changedRuns.constEnd() && it->address < address + size;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Once the values have been filtered the ones that are left are shown instead of the changes
+
+    bool isDiffHighlighted(uint64_t address, int size) const
+    {
+        if (m_diff.isFiltered()) {
+            return m_diff.isCandidate(address, size);
+        }
+
+        return isChanged(address, size);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    MemoryDiff::ValueType valueType() const
+    {
+        MemoryDiff::ValueType type;
+
+        type.size = bytesPerElement();
+        type.isSigned = m_DataType == MemoryViewWidget::S8 || m_DataType == MemoryViewWidget::S16 ||
+                        m_DataType == MemoryViewWidget::S32 || m_DataType == MemoryViewWidget::S64;
+        type.isFloat = m_DataType == MemoryViewWidget::F32 || m_DataType == MemoryViewWidget::F64;
+        type.bigEndian = m_Endianess == MemoryViewWidget::Big;
+
+        return type;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // The transfer is cleared first as the backend doesn't touch it if none of the memory could be read. An empty
+    // or short reply leaves the pages it doesn't cover unreadable
+
+    void readSnapshotChunk()
+    {
+        uint64_t end = std::min(m_snapshotReadAddress + s_snapshotChunkSize, m_pendingSnapshot.end());
+        m_snapshotTransfer.clear();
+        m_Interface->beginReadMemory(m_snapshotReadAddress, end, &m_snapshotTransfer);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    void addWatchpoint(uint64_t address, int size, IBackendRequests::WatchAccess access)
+    {
+        if (!m_Interface) {
+            return;
+        }
+
+        Watchpoint watchpoint = { s_nextWatchpointId++, address, uint64_t(size) };
+
+        m_watchpoints.append(watchpoint);
+        m_Interface->beginAddWatchpoint(watchpoint.id, address, uint64_t(size), access);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    void removeWatchpoints(uint64_t address, int size)
+    {
+        for (int i = m_watchpoints.size() - 1; i >= 0; --i) {
+            const Watchpoint& watchpoint = m_watchpoints[i];
+
+            if (address < watchpoint.address + watchpoint.size && watchpoint.address < address + size) {
+                if (m_Interface) {
+                    m_Interface->beginRemoveWatchpoint(watchpoint.id);
+                }
+
+                m_watchpoints.remove(i);
+            }
+        }
+    }
+
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     void access(uint64_t address, uint64_t count, QVector<uint16_t>* values)
@@ -256,13 +462,18 @@ public:
     void paintEvent(QWidget* widget, QPaintEvent* ev)
     {
         QFont font = widget->font();
-        QFontMetrics fontMetrics(font);
         // QRect widgetRect = widget->rect();
         QRect dirtyRect = ev->rect();
         const int elementsPerRow = m_ElementsPerRow;
         const int bytesPerRow = elementsPerRow * bytesPerElement();
 
         QColor baseColor = QApplication::palette().base().color();
+        QColor watchColor = QApplication::palette().highlight().color();
+        QColor hitColor = watchColor;
+        watchColor.setAlpha(64);
+        hitColor.setAlpha(160);
+        QColor diffColor(Qt::red);
+        diffColor.setAlpha(64);
 
         QPainter painter(widget);
         painter.setFont(font);
@@ -274,8 +485,9 @@ public:
             return;
         }
 
-        const int charWidth = fontMetrics.boundingRect(QLatin1Char('W')).width();
-        const int rowHeight = fontMetrics.height();
+        const Layout l = layout(widget);
+        const int charWidth = l.charWidth;
+        const int rowHeight = l.rowHeight;
         const int rows = (widget->height() + rowHeight - 1) / rowHeight;
 
         uint64_t firstByte = m_TopRow;
@@ -292,10 +504,10 @@ public:
         QString rowText;
         rowText.reserve((1 + typeMeta.m_DisplayWidthChars));
 
-        const int addressWidth = (m_adddressWidth * 2) * charWidth;
-        const int dataWidth = charWidth * (elementsPerRow * typeMeta.m_DisplayWidthChars + elementsPerRow - 1);
-        const int asciiWidth = bytesPerRow * charWidth;
-        const int gutterWidth = charWidth;
+        const int addressWidth = l.addressWidth;
+        const int dataWidth = l.dataWidth;
+        const int asciiWidth = l.asciiWidth;
+        const int gutterWidth = l.gutterWidth;
 
         for (int row = 0; row < rows; ++row) {
             QRect addressRect(0, screenY, addressWidth, rowHeight);
@@ -332,6 +544,20 @@ public:
                         rowText.push_back(QLatin1Char(' '));
                     }
 
+                    const uint64_t elementAddress = m_TopRow + dataOffset + i * typeMeta.m_BytesPerElement;
+                    QRect elementRect(dataRect.x() + i * (typeMeta.m_DisplayWidthChars + 1) * charWidth, screenY,
+                                      typeMeta.m_DisplayWidthChars * charWidth, rowHeight);
+
+                    if (isDiffHighlighted(elementAddress, typeMeta.m_BytesPerElement)) {
+                        painter.fillRect(elementRect, diffColor);
+                    }
+
+                    if (isWatchHit(elementAddress, typeMeta.m_BytesPerElement)) {
+                        painter.fillRect(elementRect, hitColor);
+                    } else if (isWatched(elementAddress, typeMeta.m_BytesPerElement)) {
+                        painter.fillRect(elementRect, watchColor);
+                    }
+
                     const uint16_t* values = m_Cache.constData() + dataOffset + i * typeMeta.m_BytesPerElement;
                     (*typeMeta.m_Formatter)(&rowText, typeMeta.m_DisplayWidthChars, typeMeta.m_BytesPerElement, values,
                                             m_Endianess);
@@ -346,6 +572,18 @@ public:
                     uint16_t value = m_Cache.at(i + dataOffset);
                     uint8_t byte = value & 0xff;
                     rowText.append(s_AsciiTab[byte]);
+
+                    const QRect byteRect(asciiRect.x() + i * charWidth, screenY, charWidth, rowHeight);
+
+                    if (isDiffHighlighted(m_TopRow + dataOffset + i, 1)) {
+                        painter.fillRect(byteRect, diffColor);
+                    }
+
+                    if (isWatchHit(m_TopRow + dataOffset + i, 1)) {
+                        painter.fillRect(byteRect, hitColor);
+                    } else if (isWatched(m_TopRow + dataOffset + i, 1)) {
+                        painter.fillRect(byteRect, watchColor);
+                    }
                 }
 
                 painter.drawText(asciiRect, 0, rowText);
@@ -431,9 +669,24 @@ void MemoryViewWidget::setBackendInterface(IBackendRequests* interface)
 {
     m_Private->m_Interface = interface;
 
+    // Watchpoints belong to the backend they were set in
+    m_Private->m_watchpoints.clear();
+    m_Private->m_watchHit = false;
+
+    // Snapshots belong to the backend they were taken in and the old backend won't send the rest of a snapshot
+    // that is being read
+    const bool snapshotCancelled = m_Private->m_snapshotInProgress;
+
+    clearSnapshots();
+
+    if (snapshotCancelled) {
+        snapshotStatusChanged(tr("Snapshot cancelled"));
+    }
+
     if (interface) {
         connect(interface, &IBackendRequests::endReadMemory, this, &MemoryViewWidget::endReadMemory);
         connect(interface, &IBackendRequests::programCounterChanged, this, &MemoryViewWidget::programCounterChanged);
+        connect(interface, &IBackendRequests::endAddWatchpoint, this, &MemoryViewWidget::endAddWatchpoint);
     }
 
     update();
@@ -441,8 +694,12 @@ void MemoryViewWidget::setBackendInterface(IBackendRequests* interface)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void MemoryViewWidget::programCounterChanged(const IBackendRequests::ProgramCounterChange&)
+void MemoryViewWidget::programCounterChanged(const IBackendRequests::ProgramCounterChange& pc)
 {
+    m_Private->m_watchHit = pc.watchAccess != 0;
+    m_Private->m_hitWatchId = pc.watchId;
+    m_Private->m_hitWatchAddress = pc.watchAddress;
+
     // If pc has changed we re-request the current data again
     if (m_Private->m_Interface) {
         m_Private->m_Interface->beginReadMemory(m_Private->m_cachedRangeStart, m_Private->m_cachedRangeEnd,
@@ -451,11 +708,36 @@ void MemoryViewWidget::programCounterChanged(const IBackendRequests::ProgramCoun
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Watchpoints the backend couldn't set are removed so they aren't shown as watched
+
+void MemoryViewWidget::endAddWatchpoint(uint32_t id, bool ok)
+{
+    if (ok) {
+        return;
+    }
+
+    QVector<MemoryViewPrivate::Watchpoint>& watchpoints = m_Private->m_watchpoints;
+
+    for (int i = 0; i < watchpoints.size(); ++i) {
+        if (watchpoints[i].id == id) {
+            watchpoints.remove(i);
+            update();
+            return;
+        }
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Gets called when transfor from backend to frontend has finished
 
 void MemoryViewWidget::endReadMemory(QVector<uint16_t>* target, uint64_t address, int addressWidth)
 {
+    if (target == &m_Private->m_snapshotTransfer) {
+        endReadSnapshot(address);
+        return;
+    }
+
     // so this is a hack. We need a better way to do this. This is because if there are several memory requests
     // in flight we must make sure that its "ours" that gets called here.
     if (target != &m_Private->m_transferCache) {
@@ -474,6 +756,119 @@ void MemoryViewWidget::endReadMemory(QVector<uint16_t>* target, uint64_t address
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void MemoryViewWidget::takeSnapshot(uint64_t start, uint64_t end)
+{
+    MemoryViewPrivate* p = m_Private;
+
+    if (!p->m_Interface || start >= end) {
+        return;
+    }
+
+    if (p->m_snapshotInProgress) {
+        snapshotStatusChanged(tr("A snapshot is already being read"));
+        return;
+    }
+
+    MemorySnapshot snapshot(start, end);
+
+    if (snapshot.isEmpty()) {
+        snapshotStatusChanged(tr("The snapshot range can be at most %1 MB").arg(MemorySnapshot::MaxSize >> 20));
+        return;
+    }
+
+    p->m_pendingSnapshot = snapshot;
+    p->m_snapshotReadAddress = p->m_pendingSnapshot.start();
+    p->m_snapshotInProgress = true;
+    p->readSnapshotChunk();
+
+    snapshotStatusChanged(tr("Reading snapshot..."));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pages that are the same as in the latest snapshot share its memory (see MemorySnapshot)
+
+void MemoryViewWidget::endReadSnapshot(uint64_t address)
+{
+    MemoryViewPrivate* p = m_Private;
+
+    if (!p->m_snapshotInProgress) {
+        return;
+    }
+
+    p->m_pendingSnapshot.setData(address, p->m_snapshotTransfer, &p->m_snapshot);
+    p->m_snapshotReadAddress += s_snapshotChunkSize;
+
+    if (p->m_snapshotReadAddress < p->m_pendingSnapshot.end() && p->m_Interface) {
+        p->readSnapshotChunk();
+        return;
+    }
+
+    p->m_snapshotInProgress = false;
+    p->m_previousSnapshot = p->m_snapshot;
+    p->m_snapshot = p->m_pendingSnapshot;
+    p->m_pendingSnapshot = MemorySnapshot();
+    p->m_snapshotTransfer.clear();
+
+    MemoryDiff::changedRuns(p->m_previousSnapshot, p->m_snapshot, &p->m_changedRuns);
+
+    uint64_t changedBytes = 0;
+
+    for (const MemoryDiff::Run& run : p->m_changedRuns) {
+        changedBytes += run.size;
+    }
+
+    QString status = tr("Snapshot of %1 pages (%2 new)")
+                         .arg(p->m_snapshot.pageCount())
+                         .arg(p->m_snapshot.storedPageCount());
+
+    if (!p->m_previousSnapshot.isEmpty()) {
+        status += tr(", %1 bytes changed in %2 runs").arg(changedBytes).arg(p->m_changedRuns.size());
+    }
+
+    snapshotStatusChanged(status);
+    update();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryViewWidget::filterSnapshots(MemoryDiff::Filter filter)
+{
+    MemoryViewPrivate* p = m_Private;
+
+    if (p->m_previousSnapshot.isEmpty()) {
+        snapshotStatusChanged(tr("Take two snapshots to compare"));
+        return;
+    }
+
+    if (!p->m_diff.filter(p->m_previousSnapshot, p->m_snapshot, filter, p->valueType())) {
+        snapshotStatusChanged(tr("The snapshots cover different ranges"));
+        return;
+    }
+
+    snapshotStatusChanged(tr("%1 values left").arg(p->m_diff.candidateCount()));
+    update();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryViewWidget::clearSnapshots()
+{
+    MemoryViewPrivate* p = m_Private;
+
+    p->m_previousSnapshot = MemorySnapshot();
+    p->m_snapshot = MemorySnapshot();
+    p->m_pendingSnapshot = MemorySnapshot();
+    p->m_snapshotInProgress = false;
+    p->m_snapshotTransfer.clear();
+    p->m_changedRuns.clear();
+    p->m_diff.reset();
+
+    snapshotStatusChanged(QString());
+    update();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void MemoryViewWidget::setExpressionStatus(bool status)
 {
     m_Private->m_expressionStatus = status;
@@ -523,7 +918,48 @@ void MemoryViewWidget::displayPrevLine()
 void MemoryViewWidget::contextMenuEvent(QContextMenuEvent* ev)
 {
     QMenu contextMenu;
+    uint64_t address = 0;
+    int size = 0;
+
     contextMenu.addActions(actions());
+
+    if (m_Private->m_Interface && m_Private->addressAt(this, ev->pos(), &address, &size)) {
+        const QString addressText = QStringLiteral("0x%1").arg(address, 0, 16);
+
+        struct WatchAction
+        {
+            const char* text;
+            IBackendRequests::WatchAccess access;
+        };
+
+        static const WatchAction watchActions[] = {
+            { QT_TR_NOOP("Break on Write to %1"), IBackendRequests::WatchAccess_Write },
+            { QT_TR_NOOP("Break on Read from %1"), IBackendRequests::WatchAccess_Read },
+            { QT_TR_NOOP("Break on Access to %1"), IBackendRequests::WatchAccess_ReadWrite },
+        };
+
+        contextMenu.addSeparator();
+
+        for (const WatchAction& watchAction : watchActions) {
+            QAction* action = contextMenu.addAction(tr(watchAction.text).arg(addressText));
+            IBackendRequests::WatchAccess access = watchAction.access;
+
+            connect(action, &QAction::triggered, this, [this, address, size, access]() {
+                m_Private->addWatchpoint(address, size, access);
+                update();
+            });
+        }
+
+        if (m_Private->isWatched(address, size)) {
+            QAction* action = contextMenu.addAction(tr("Remove Watchpoints at %1").arg(addressText));
+
+            connect(action, &QAction::triggered, this, [this, address, size]() {
+                m_Private->removeWatchpoints(address, size);
+                update();
+            });
+        }
+    }
+
     contextMenu.exec(mapToGlobal(ev->pos()));
 }
 
@@ -2,6 +2,7 @@
 
 #include <QtWidgets/QWidget>
 #include "Backend/IBackendRequests.h"
+#include "MemoryDiff.h"
 
 namespace prodbg {
 
@@ -66,6 +67,15 @@ public:
     Q_SLOT void setDataType(DataType t);
     Q_SLOT void endReadMemory(QVector<uint16_t>* target, uint64_t address, int addressWidth);
     Q_SLOT void programCounterChanged(const IBackendRequests::ProgramCounterChange& pc);
+    Q_SLOT void endAddWatchpoint(uint32_t id, bool ok);
+
+    // Memory snapshots for finding what changed between stops. Bytes that changed between the two latest snapshots
+    // are highlighted until the values are filtered (using the current data type) and then the values that are left
+    // are highlighted instead. The status is sent with snapshotStatusChanged
+    void takeSnapshot(uint64_t start, uint64_t end);
+    void filterSnapshots(MemoryDiff::Filter filter);
+    void clearSnapshots();
+    Q_SIGNAL void snapshotStatusChanged(const QString& status);
 
     Endianess endianess() const;
     Q_SLOT void setEndianess(Endianess e);
@@ -80,6 +90,8 @@ public:
     Q_SLOT void displayPrevLine();
 
 private:
+    void endReadSnapshot(uint64_t address);
+
     MemoryViewPrivate* m_Private;
 };
 
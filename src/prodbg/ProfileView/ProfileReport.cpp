@@ -0,0 +1,221 @@
+#include "ProfileReport.h"
+#include <algorithm>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileReport::clear()
+{
+    m_ticks = 0;
+    m_totalCount = 0;
+    m_counts.clear();
+    m_calls.clear();
+
+    // Debug info doesn't change between runs so it's kept (apart from the addresses that never got resolved)
+
+    for (uint64_t address : m_unresolved) {
+        m_info.remove(address);
+    }
+
+    m_unresolved.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileReport::requestInfo(uint64_t address)
+{
+    if (m_info.contains(address)) {
+        return;
+    }
+
+    IBackendRequests::AddressInfo info;
+    info.address = address;
+
+    m_info.insert(address, info);
+    m_unresolved.append(address);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileReport::add(const IBackendRequests::Profile& profile)
+{
+    m_mode = profile.mode;
+    m_ticks += profile.ticks;
+
+    for (const IBackendRequests::ProfileSample& sample : profile.samples) {
+        m_counts[sample.address] += sample.count;
+        m_totalCount += sample.count;
+        requestInfo(sample.address);
+    }
+
+    for (const IBackendRequests::ProfileCall& call : profile.calls) {
+        IBackendRequests::ProfileCall& total = m_calls[qMakePair(call.site, call.target)];
+
+        total.site = call.site;
+        total.target = call.target;
+        total.count += call.count;
+        total.ticks += call.ticks;
+
+        requestInfo(call.site);
+        requestInfo(call.target);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QVector<uint64_t> ProfileReport::takeUnresolved()
+{
+    QVector<uint64_t> addresses;
+    addresses.swap(m_unresolved);
+    return addresses;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileReport::addAddressInfo(const QVector<IBackendRequests::AddressInfo>& info)
+{
+    for (const IBackendRequests::AddressInfo& entry : info) {
+        m_info.insert(entry.address, entry);
+
+        if (entry.hasSymbolAddress && !entry.symbol.isEmpty()) {
+            m_functionNames.insert(entry.symbolAddress, entry.symbol);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// targets has to be sorted
+
+uint64_t ProfileReport::functionAt(uint64_t address, const QVector<uint64_t>& targets) const
+{
+    auto info = m_info.constFind(address);
+
+    if (info != m_info.constEnd() && info->hasSymbolAddress) {
+        return info->symbolAddress;
+    }
+
+    auto it = std::upper_bound(targets.constBegin(), targets.constEnd(), address);
+
+    if (it == targets.constBegin()) {
+        return UnknownFunction;
+    }
+
+    return *(it - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QString ProfileReport::functionName(uint64_t function) const
+{
+    if (function == UnknownFunction) {
+        return QStringLiteral("(unknown)");
+    }
+
+    auto name = m_functionNames.constFind(function);
+
+    if (name != m_functionNames.constEnd()) {
+        return *name;
+    }
+
+    return QStringLiteral("sub_%1").arg(function, 0, 16);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QString ProfileReport::location(uint64_t address) const
+{
+    auto info = m_info.constFind(address);
+
+    if (info == m_info.constEnd() || info->filename.isEmpty()) {
+        return QString();
+    }
+
+    return QStringLiteral("%1:%2").arg(info->filename).arg(info->line);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileReport::build(QVector<Function>* functions, QVector<Edge>* edges, int maxLines) const
+{
+    QVector<uint64_t> targets;
+    QHash<uint64_t, int> functionIndex;
+    QHash<QPair<uint64_t, uint64_t>, int> edgeIndex;
+
+    functions->resize(0);
+    edges->resize(0);
+
+    for (const IBackendRequests::ProfileCall& call : m_calls) {
+        targets.append(call.target);
+    }
+
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    auto getFunction = [&](uint64_t address) -> Function& {
+        auto index = functionIndex.constFind(address);
+
+        if (index != functionIndex.constEnd()) {
+            return (*functions)[*index];
+        }
+
+        Function function;
+        function.address = address;
+        function.name = functionName(address);
+
+        auto info = m_info.constFind(address);
+
+        if (info != m_info.constEnd()) {
+            function.filename = info->filename;
+            function.line = info->line;
+        }
+
+        functionIndex.insert(address, functions->size());
+        functions->append(function);
+
+        return functions->last();
+    };
+
+    for (auto it = m_counts.constBegin(); it != m_counts.constEnd(); ++it) {
+        Function& function = getFunction(functionAt(it.key(), targets));
+
+        function.self += it.value();
+        function.lines.append({ it.key(), it.value() });
+    }
+
+    for (const IBackendRequests::ProfileCall& call : m_calls) {
+        uint64_t caller = functionAt(call.site, targets);
+        uint64_t callee = functionAt(call.target, targets);
+
+        Function& function = getFunction(callee);
+
+        function.total += call.ticks;
+        function.calls += call.count;
+
+        auto key = qMakePair(caller, callee);
+        auto index = edgeIndex.constFind(key);
+
+        if (index == edgeIndex.constEnd()) {
+            edgeIndex.insert(key, edges->size());
+            edges->append({ caller, callee, call.count, call.ticks });
+        } else {
+            (*edges)[*index].count += call.count;
+            (*edges)[*index].ticks += call.ticks;
+        }
+    }
+
+    for (Function& function : *functions) {
+        std::sort(function.lines.begin(), function.lines.end(),
+                  [](const Line& a, const Line& b) { return a.count > b.count; });
+
+        if (function.lines.size() > maxLines) {
+            function.lines.resize(maxLines);
+        }
+    }
+
+    std::sort(functions->begin(), functions->end(),
+              [](const Function& a, const Function& b) { return a.self > b.self; });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Backend/IBackendRequests.h"
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Adds up the profiles read from the backend and groups the addresses into functions. The function an address is in
+// comes from the debug info in the backend (see IBackendRequests::beginResolveAddressInfo) and if there is none the
+// closest call target before the address is used instead.
+
+class ProfileReport
+{
+public:
+    struct Line
+    {
+        uint64_t address;
+        uint64_t count;
+    };
+
+    struct Function
+    {
+        uint64_t address = 0;
+        QString name;
+        QString filename;
+        int line = -1;
+        // Samples/clock ticks in the function itself
+        uint64_t self = 0;
+        // Exact mode: clock ticks including the calls it made and the number of times it was called
+        uint64_t total = 0;
+        uint64_t calls = 0;
+        // Hottest addresses in the function, most counted first
+        QVector<Line> lines;
+    };
+
+    struct Edge
+    {
+        // Function addresses
+        uint64_t caller;
+        uint64_t callee;
+        uint64_t count;
+        uint64_t ticks;
+    };
+
+    // Address used for code that couldn't be put in any function
+    static const uint64_t UnknownFunction = ~uint64_t(0);
+
+    void clear();
+    void add(const IBackendRequests::Profile& profile);
+
+    // Addresses that hasn't been resolved yet. Each address is only returned once
+    QVector<uint64_t> takeUnresolved();
+    void addAddressInfo(const QVector<IBackendRequests::AddressInfo>& info);
+
+    // Functions sorted on self count (highest first) and the calls between them
+    void build(QVector<Function>* functions, QVector<Edge>* edges, int maxLines) const;
+
+    QString functionName(uint64_t function) const;
+    QString location(uint64_t address) const;
+
+    IBackendRequests::ProfileMode mode() const { return m_mode; }
+    uint64_t ticks() const { return m_ticks; }
+    uint64_t totalCount() const { return m_totalCount; }
+
+private:
+    uint64_t functionAt(uint64_t address, const QVector<uint64_t>& targets) const;
+    void requestInfo(uint64_t address);
+
+    IBackendRequests::ProfileMode m_mode = IBackendRequests::ProfileMode_Sample;
+    uint64_t m_ticks = 0;
+    uint64_t m_totalCount = 0;
+
+    QHash<uint64_t, uint64_t> m_counts;
+    QHash<QPair<uint64_t, uint64_t>, IBackendRequests::ProfileCall> m_calls;
+
+    // Info for each address that has been requested (the ones that hasn't been replied to yet only have the address)
+    QHash<uint64_t, IBackendRequests::AddressInfo> m_info;
+    QHash<uint64_t, QString> m_functionNames;
+    QVector<uint64_t> m_unresolved;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
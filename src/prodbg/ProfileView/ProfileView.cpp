@@ -0,0 +1,327 @@
+#include "ProfileView.h"
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QSettings>
+#include <QSpinBox>
+#include <QTabWidget>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace prodbg {
+
+// Max number of addresses shown under each function in the flat view
+static const int s_maxLines = 16;
+
+enum FlatColumn
+{
+    FlatColumn_Name,
+    FlatColumn_SelfPercent,
+    FlatColumn_Self,
+    FlatColumn_Total,
+    FlatColumn_Calls,
+    FlatColumn_Location,
+};
+
+enum CallColumn
+{
+    CallColumn_Name,
+    CallColumn_Count,
+    CallColumn_Ticks,
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ProfileView::ProfileView(QWidget* parent)
+    : View(parent)
+    , m_mode(new QComboBox(this))
+    , m_interval(new QSpinBox(this))
+    , m_start(new QPushButton(tr("Start"), this))
+    , m_status(new QLabel(this))
+    , m_flat(new QTreeWidget(this))
+    , m_callGraph(new QTreeWidget(this))
+    , m_timer(new QTimer(this))
+{
+    // Same order as IBackendRequests::ProfileMode
+    m_mode->addItem(tr("Sample"));
+    m_mode->addItem(tr("Exact"));
+
+    m_interval->setRange(16, 1000000);
+    m_interval->setValue(1000);
+    m_interval->setSuffix(tr(" ticks"));
+    m_interval->setToolTip(tr("Clock ticks between samples"));
+
+    m_flat->setHeaderLabels({ tr("Function"), tr("Self %"), tr("Self"), tr("Total"), tr("Calls"), tr("Location") });
+    m_flat->setSortingEnabled(false);
+    m_flat->header()->setSectionResizeMode(FlatColumn_Name, QHeaderView::ResizeToContents);
+
+    m_callGraph->setHeaderLabels({ tr("Caller / Callee"), tr("Count"), tr("Ticks") });
+    m_callGraph->header()->setSectionResizeMode(CallColumn_Name, QHeaderView::ResizeToContents);
+
+    QTabWidget* tabs = new QTabWidget(this);
+    tabs->addTab(m_flat, tr("Functions"));
+    tabs->addTab(m_callGraph, tr("Call graph"));
+
+    QHBoxLayout* controls = new QHBoxLayout;
+    controls->addWidget(m_mode);
+    controls->addWidget(m_interval);
+    controls->addWidget(m_start);
+    controls->addWidget(m_status, 1);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addLayout(controls);
+    layout->addWidget(tabs);
+
+    m_timer->setInterval(500);
+
+    connect(m_start, &QPushButton::clicked, this, &ProfileView::toggleProfiling);
+    connect(m_timer, &QTimer::timeout, this, &ProfileView::poll);
+    connect(m_mode, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this,
+            [this](int index) { m_interval->setEnabled(index == IBackendRequests::ProfileMode_Sample); });
+
+    readSettings();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ProfileView::~ProfileView()
+{
+    writeSettings();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileView::interfaceSet()
+{
+    if (m_interface) {
+        connect(m_interface, &IBackendRequests::endReadProfile, this, &ProfileView::endReadProfile);
+        connect(m_interface, &IBackendRequests::endResolveAddressInfo, this, &ProfileView::endResolveAddressInfo);
+        connect(m_interface, &IBackendRequests::sessionEnded, this, &ProfileView::sessionEnded);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stopping reads what was counted since the last poll before the profiler is disabled
+
+void ProfileView::toggleProfiling()
+{
+    if (!m_interface) {
+        return;
+    }
+
+    if (m_running) {
+        m_timer->stop();
+        poll();
+        m_interface->beginEnableProfiler(false, IBackendRequests::ProfileMode_Sample, 0);
+        m_running = false;
+    } else {
+        IBackendRequests::ProfileMode mode = IBackendRequests::ProfileMode(m_mode->currentIndex());
+
+        m_report.clear();
+        m_interface->beginEnableProfiler(true, mode, uint32_t(m_interval->value()));
+        m_timer->start();
+        m_running = true;
+
+        updateTrees();
+    }
+
+    m_start->setText(m_running ? tr("Stop") : tr("Start"));
+    m_mode->setEnabled(!m_running);
+    m_interval->setEnabled(!m_running && m_mode->currentIndex() == IBackendRequests::ProfileMode_Sample);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileView::poll()
+{
+    if (!m_interface || m_readPending) {
+        return;
+    }
+
+    m_readPending = true;
+    m_interface->beginReadProfile(&m_profile);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileView::endReadProfile(IBackendRequests::Profile* profile)
+{
+    // Other views may read the profile as well
+    if (profile != &m_profile) {
+        return;
+    }
+
+    m_readPending = false;
+
+    if (!profile->supported) {
+        sessionEnded();
+        m_status->setText(tr("The backend doesn't support profiling"));
+        return;
+    }
+
+    m_report.add(*profile);
+
+    resolveAddresses();
+    updateTrees();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileView::resolveAddresses()
+{
+    if (!m_interface || m_resolvePending) {
+        return;
+    }
+
+    QVector<uint64_t> addresses = m_report.takeUnresolved();
+
+    if (addresses.isEmpty()) {
+        return;
+    }
+
+    m_resolvePending = true;
+    m_interface->beginResolveAddressInfo(addresses, &m_addressInfo);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileView::endResolveAddressInfo(QVector<IBackendRequests::AddressInfo>* info)
+{
+    if (info != &m_addressInfo) {
+        return;
+    }
+
+    m_resolvePending = false;
+    m_report.addAddressInfo(*info);
+
+    // More addresses may have shown up while this was resolved
+    resolveAddresses();
+    updateTrees();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileView::sessionEnded()
+{
+    m_timer->stop();
+    m_running = false;
+    m_readPending = false;
+    m_resolvePending = false;
+
+    m_start->setText(tr("Start"));
+    m_mode->setEnabled(true);
+    m_interval->setEnabled(m_mode->currentIndex() == IBackendRequests::ProfileMode_Sample);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QString ProfileView::formatCount(uint64_t count) const
+{
+    return QString::number(qulonglong(count));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The trees are rebuilt each time but are kept small (functions plus a few lines each) so it's quick
+
+void ProfileView::updateTrees()
+{
+    QVector<ProfileReport::Function> functions;
+    QVector<ProfileReport::Edge> edges;
+    bool exact = m_report.mode() == IBackendRequests::ProfileMode_Exact;
+    double total = double(qMax<uint64_t>(m_report.totalCount(), 1));
+
+    m_report.build(&functions, &edges, s_maxLines);
+
+    m_status->setText(tr("%1 clock ticks, %2 %3")
+                          .arg(formatCount(m_report.ticks()))
+                          .arg(formatCount(m_report.totalCount()))
+                          .arg(exact ? tr("counted") : tr("samples")));
+
+    m_flat->setUpdatesEnabled(false);
+    m_flat->clear();
+
+    for (const ProfileReport::Function& function : functions) {
+        QTreeWidgetItem* item = new QTreeWidgetItem(m_flat);
+
+        item->setText(FlatColumn_Name, function.name);
+        item->setText(FlatColumn_SelfPercent, QString::number(100.0 * double(function.self) / total, 'f', 2));
+        item->setText(FlatColumn_Self, formatCount(function.self));
+
+        if (exact) {
+            item->setText(FlatColumn_Total, formatCount(function.total));
+            item->setText(FlatColumn_Calls, formatCount(function.calls));
+        }
+
+        if (!function.filename.isEmpty()) {
+            item->setText(FlatColumn_Location, QStringLiteral("%1:%2").arg(function.filename).arg(function.line));
+        }
+
+        for (const ProfileReport::Line& line : function.lines) {
+            QTreeWidgetItem* child = new QTreeWidgetItem(item);
+
+            child->setText(FlatColumn_Name, QStringLiteral("0x%1").arg(line.address, 0, 16));
+            child->setText(FlatColumn_SelfPercent, QString::number(100.0 * double(line.count) / total, 'f', 2));
+            child->setText(FlatColumn_Self, formatCount(line.count));
+            child->setText(FlatColumn_Location, m_report.location(line.address));
+        }
+    }
+
+    m_flat->setUpdatesEnabled(true);
+
+    // Call graph is shown with the callers at the top level and what they called under them
+
+    m_callGraph->setUpdatesEnabled(false);
+    m_callGraph->clear();
+
+    QHash<uint64_t, QTreeWidgetItem*> callers;
+
+    for (const ProfileReport::Edge& edge : edges) {
+        QTreeWidgetItem* caller = callers.value(edge.caller);
+
+        if (!caller) {
+            caller = new QTreeWidgetItem(m_callGraph);
+            caller->setText(CallColumn_Name, m_report.functionName(edge.caller));
+            callers.insert(edge.caller, caller);
+        }
+
+        QTreeWidgetItem* callee = new QTreeWidgetItem(caller);
+        callee->setText(CallColumn_Name, m_report.functionName(edge.callee));
+        callee->setText(CallColumn_Count, formatCount(edge.count));
+
+        if (exact) {
+            callee->setText(CallColumn_Ticks, formatCount(edge.ticks));
+        }
+    }
+
+    m_callGraph->setUpdatesEnabled(true);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileView::readSettings()
+{
+    QSettings settings(QStringLiteral("TBL"), QStringLiteral("ProDBG"));
+
+    settings.beginGroup(QStringLiteral("ProfileView"));
+    m_mode->setCurrentIndex(settings.value(QStringLiteral("mode"), 0).toInt());
+    m_interval->setValue(settings.value(QStringLiteral("interval"), 1000).toInt());
+    settings.endGroup();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileView::writeSettings()
+{
+    QSettings settings(QStringLiteral("TBL"), QStringLiteral("ProDBG"));
+
+    settings.beginGroup(QStringLiteral("ProfileView"));
+    settings.setValue(QStringLiteral("mode"), m_mode->currentIndex());
+    settings.setValue(QStringLiteral("interval"), m_interval->value());
+    settings.endGroup();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Backend/IBackendRequests.h"
+#include "ProfileReport.h"
+#include "View.h"
+#include <QVector>
+
+class QComboBox;
+class QLabel;
+class QPushButton;
+class QSpinBox;
+class QTimer;
+class QTreeWidget;
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Starts/stops the profiler in the backend and shows where the time went, both as a flat list of functions (with the
+// hottest addresses in each) and as the calls between them. The profile is read from the backend a couple of times
+// per second while it's running.
+
+class ProfileView : public View
+{
+    Q_OBJECT
+
+public:
+    ProfileView(QWidget* parent = nullptr);
+    ~ProfileView();
+
+    void interfaceSet();
+    void readSettings();
+    void writeSettings();
+
+private:
+    Q_SLOT void toggleProfiling();
+    Q_SLOT void poll();
+    Q_SLOT void endReadProfile(IBackendRequests::Profile* profile);
+    Q_SLOT void endResolveAddressInfo(QVector<IBackendRequests::AddressInfo>* info);
+    Q_SLOT void sessionEnded();
+
+    void resolveAddresses();
+    void updateTrees();
+    QString formatCount(uint64_t count) const;
+
+    QComboBox* m_mode = nullptr;
+    QSpinBox* m_interval = nullptr;
+    QPushButton* m_start = nullptr;
+    QLabel* m_status = nullptr;
+    QTreeWidget* m_flat = nullptr;
+    QTreeWidget* m_callGraph = nullptr;
+    QTimer* m_timer = nullptr;
+
+    ProfileReport m_report;
+    IBackendRequests::Profile m_profile;
+    QVector<IBackendRequests::AddressInfo> m_addressInfo;
+
+    bool m_running = false;
+    // Requests that hasn't been replied to yet. Only one of each is sent at a time
+    bool m_readPending = false;
+    bool m_resolvePending = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
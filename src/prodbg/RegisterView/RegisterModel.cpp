@@ -0,0 +1,174 @@
+#include "RegisterModel.h"
+#include <QBrush>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RegisterModel::RegisterModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Registers are stored in big endian order so the hex string is just the bytes in order
+
+static QString formatRegister(const IBackendRequests::Register& reg)
+{
+    static const char hexChars[] = "0123456789abcdef";
+
+    int count = reg.data.count();
+
+    if (count == 0) {
+        return QString();
+    }
+
+    QString text(count * 2, Qt::Uninitialized);
+    QChar* out = text.data();
+
+    for (uint8_t v : reg.data) {
+        *out++ = QLatin1Char(hexChars[v >> 4]);
+        *out++ = QLatin1Char(hexChars[v & 0xf]);
+    }
+
+    return text;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RegisterModel::sameLayout(const QVector<IBackendRequests::Register>& registers) const
+{
+    if (registers.count() != m_registers.count()) {
+        return false;
+    }
+
+    for (int i = 0, count = registers.count(); i < count; ++i) {
+        if (registers[i].name != m_registers[i].name) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RegisterModel::emitRowsChanged(int first, int last)
+{
+    dataChanged(index(first, Column_Value), index(last, Column_Value));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RegisterModel::update(const QVector<IBackendRequests::Register>& registers)
+{
+    // New target or register layout. Just reset everything
+
+    if (!sameLayout(registers)) {
+        beginResetModel();
+        m_registers = registers;
+        m_changed = QBitArray(registers.count());
+        endResetModel();
+        return;
+    }
+
+    // Diff the values and send contiguous ranges of rows that needs to be repainted
+
+    int rangeStart = -1;
+    int count = registers.count();
+
+    for (int i = 0; i < count; ++i) {
+        bool changed = registers[i].data != m_registers[i].data;
+        bool dirty = changed || m_changed.testBit(i);
+
+        m_changed.setBit(i, changed);
+
+        if (dirty && rangeStart < 0) {
+            rangeStart = i;
+        } else if (!dirty && rangeStart >= 0) {
+            emitRowsChanged(rangeStart, i - 1);
+            rangeStart = -1;
+        }
+    }
+
+    m_registers = registers;
+
+    if (rangeStart >= 0) {
+        emitRowsChanged(rangeStart, count - 1);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int RegisterModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_registers.count();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int RegisterModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : Column_Count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QVariant RegisterModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_registers.count()) {
+        return QVariant();
+    }
+
+    const IBackendRequests::Register& reg = m_registers[index.row()];
+
+    switch (role) {
+        case Qt::DisplayRole: {
+            if (index.column() == Column_Name) {
+                return reg.name;
+            }
+
+            return formatRegister(reg);
+        }
+
+        case Qt::ForegroundRole: {
+            if (index.column() == Column_Value && m_changed.testBit(index.row())) {
+                return QBrush(Qt::red);
+            }
+
+            break;
+        }
+    }
+
+    return QVariant();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QVariant RegisterModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (section) {
+        case Column_Name: return QStringLiteral("Name");
+        case Column_Value: return QStringLiteral("Value");
+    }
+
+    return QVariant();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Qt::ItemFlags RegisterModel::flags(const QModelIndex& index) const
+{
+    if (index.column() == Column_Value) {
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    }
+
+    return Qt::ItemIsEnabled;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Backend/IBackendRequests.h"
+#include <QAbstractTableModel>
+#include <QBitArray>
+#include <QVector>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Table model (name, value) over the raw register data from the backend.
+//
+// Values are compared as bytes when new registers arrive and dataChanged is only sent for rows that changed (or
+// stopped being marked as changed). Text for the values is only built when the view asks for it in data() so
+// only visible registers are formatted.
+
+class RegisterModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        Column_Name,
+        Column_Value,
+        Column_Count,
+    };
+
+    explicit RegisterModel(QObject* parent = nullptr);
+
+    void update(const QVector<IBackendRequests::Register>& registers);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    Qt::ItemFlags flags(const QModelIndex& index) const;
+
+private:
+    bool sameLayout(const QVector<IBackendRequests::Register>& registers) const;
+    void emitRowsChanged(int first, int last);
+
+    QVector<IBackendRequests::Register> m_registers;
+    // Registers that changed value since the previous update
+    QBitArray m_changed;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
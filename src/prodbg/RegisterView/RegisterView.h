@@ -10,6 +10,8 @@ class Ui_RegisterView;
 
 namespace prodbg {
 
+class RegisterModel;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 class RegisterView : public View
@@ -33,6 +35,7 @@ private:
 
 private:
     Ui_RegisterView* m_ui = nullptr;
+    RegisterModel* m_model = nullptr;
     QVector<IBackendRequests::Register> m_targetRegisters;
 };
 
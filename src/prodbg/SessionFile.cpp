@@ -0,0 +1,347 @@
+#include "SessionFile.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <string.h>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum
+{
+    // 2: Breakpoints have a condition and hit count
+    SessionVersion = 2,
+};
+
+#define SESSION_FOURCC(a, b, c, d) (uint32_t(a) | (uint32_t(b) << 8) | (uint32_t(c) << 16) | (uint32_t(d) << 24))
+
+static const uint32_t s_sessionMagic = SESSION_FOURCC('P', 'D', 'S', 'F');
+static const uint32_t s_chunkBreakpoints = SESSION_FOURCC('B', 'R', 'K', 'P');
+static const uint32_t s_chunkLayout = SESSION_FOURCC('L', 'A', 'Y', 'T');
+static const uint32_t s_chunkPaths = SESSION_FOURCC('P', 'A', 'T', 'H');
+static const uint32_t s_chunkPlugins = SESSION_FOURCC('P', 'L', 'U', 'G');
+
+struct SessionHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t chunkCount;
+};
+
+struct ChunkHeader
+{
+    uint32_t id;
+    uint32_t size;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writeU32(QByteArray& out, uint32_t v)
+{
+    out.append((const char*)&v, sizeof(v));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writeU64(QByteArray& out, uint64_t v)
+{
+    out.append((const char*)&v, sizeof(v));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writeBytes(QByteArray& out, const QByteArray& data)
+{
+    writeU32(out, uint32_t(data.size()));
+    out.append(data);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writeString(QByteArray& out, const QString& text)
+{
+    writeBytes(out, text.toUtf8());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writeChunk(QByteArray& out, uint32_t id, const QByteArray& data)
+{
+    writeU32(out, id);
+    writeU32(out, uint32_t(data.size()));
+    out.append(data);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reads from the mapped file. All reads are bounds checked and any read past the end sets the reader as failed so
+// a truncated or damaged file never reads outside the mapping.
+
+struct SessionReader
+{
+    const uchar* data;
+    const uchar* end;
+    bool failed;
+
+    SessionReader(const uchar* d, uint32_t size)
+        : data(d)
+        , end(d + size)
+        , failed(false)
+    {
+    }
+
+    const uchar* take(uint32_t size)
+    {
+        if (failed || uint32_t(end - data) < size) {
+            failed = true;
+            return nullptr;
+        }
+
+        const uchar* p = data;
+        data += size;
+        return p;
+    }
+
+    uint32_t readU32()
+    {
+        uint32_t v = 0;
+        const uchar* p = take(sizeof(v));
+
+        if (p) {
+            memcpy(&v, p, sizeof(v));
+        }
+
+        return v;
+    }
+
+    uint64_t readU64()
+    {
+        uint64_t v = 0;
+        const uchar* p = take(sizeof(v));
+
+        if (p) {
+            memcpy(&v, p, sizeof(v));
+        }
+
+        return v;
+    }
+
+    QByteArray readBytes()
+    {
+        uint32_t size = readU32();
+        const uchar* p = take(size);
+
+        return p ? QByteArray((const char*)p, int(size)) : QByteArray();
+    }
+
+    QString readString()
+    {
+        uint32_t size = readU32();
+        const uchar* p = take(size);
+
+        return p ? QString::fromUtf8((const char*)p, int(size)) : QString();
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool readBreakpoints(SessionReader& reader, SessionFile* session)
+{
+    uint32_t fileLineCount = reader.readU32();
+
+    for (uint32_t i = 0; i < fileLineCount && !reader.failed; ++i) {
+        BreakpointModel::FileLineBreakpoint bp;
+        bp.filename = reader.readString();
+        bp.line = int(reader.readU32());
+        bp.condition = reader.readString();
+        bp.hitCount = reader.readU32();
+        session->fileLineBreakpoints.append(bp);
+    }
+
+    uint32_t addressCount = reader.readU32();
+
+    for (uint32_t i = 0; i < addressCount && !reader.failed; ++i) {
+        BreakpointModel::AddressBreakpoint bp;
+        bp.address = reader.readU64();
+        bp.condition = reader.readString();
+        bp.hitCount = reader.readU32();
+        session->addressBreakpoints.append(bp);
+    }
+
+    return !reader.failed;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool readPaths(SessionReader& reader, SessionFile* session)
+{
+    uint32_t count = reader.readU32();
+
+    for (uint32_t i = 0; i < count && !reader.failed; ++i) {
+        QString debugPath = reader.readString();
+        QString localPath = reader.readString();
+        session->resolvedPaths.insert(debugPath, localPath);
+    }
+
+    return !reader.failed;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool readPlugins(SessionReader& reader, SessionFile* session)
+{
+    uint32_t count = reader.readU32();
+
+    for (uint32_t i = 0; i < count && !reader.failed; ++i) {
+        QString name = reader.readString();
+        QByteArray state = reader.readBytes();
+        session->pluginStates.insert(name, state);
+    }
+
+    return !reader.failed;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QString SessionFile::defaultFilename()
+{
+    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+
+    return path + QStringLiteral("/session.pds");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SessionFile::load(const QString& filename)
+{
+    QFile file(filename);
+
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    qint64 size = file.size();
+
+    if (size < qint64(sizeof(SessionHeader)) || size > 0x7fffffff) {
+        return false;
+    }
+
+    uchar* data = file.map(0, size);
+
+    if (!data) {
+        return false;
+    }
+
+    SessionReader reader(data, uint32_t(size));
+
+    uint32_t magic = reader.readU32();
+    uint32_t version = reader.readU32();
+    uint32_t chunkCount = reader.readU32();
+
+    // Older versions are just thrown away. It's only a cache of the last session
+    bool ok = magic == s_sessionMagic && version == SessionVersion;
+
+    for (uint32_t i = 0; ok && i < chunkCount; ++i) {
+        uint32_t id = reader.readU32();
+        uint32_t chunkSize = reader.readU32();
+        const uchar* chunkData = reader.take(chunkSize);
+
+        if (!chunkData) {
+            ok = false;
+            break;
+        }
+
+        SessionReader chunk(chunkData, chunkSize);
+
+        if (id == s_chunkBreakpoints) {
+            ok = readBreakpoints(chunk, this);
+        } else if (id == s_chunkLayout) {
+            layout = QByteArray((const char*)chunkData, int(chunkSize));
+        } else if (id == s_chunkPaths) {
+            ok = readPaths(chunk, this);
+        } else if (id == s_chunkPlugins) {
+            ok = readPlugins(chunk, this);
+        }
+    }
+
+    file.unmap(data);
+
+    if (!ok) {
+        *this = SessionFile();
+    }
+
+    return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SessionFile::save(const QString& filename) const
+{
+    QByteArray breakpoints;
+
+    writeU32(breakpoints, uint32_t(fileLineBreakpoints.count()));
+
+    for (const BreakpointModel::FileLineBreakpoint& bp : fileLineBreakpoints) {
+        writeString(breakpoints, bp.filename);
+        writeU32(breakpoints, uint32_t(bp.line));
+        writeString(breakpoints, bp.condition);
+        writeU32(breakpoints, bp.hitCount);
+    }
+
+    writeU32(breakpoints, uint32_t(addressBreakpoints.count()));
+
+    for (const BreakpointModel::AddressBreakpoint& bp : addressBreakpoints) {
+        writeU64(breakpoints, bp.address);
+        writeString(breakpoints, bp.condition);
+        writeU32(breakpoints, bp.hitCount);
+    }
+
+    QByteArray paths;
+
+    writeU32(paths, uint32_t(resolvedPaths.count()));
+
+    for (auto it = resolvedPaths.constBegin(), end = resolvedPaths.constEnd(); it != end; ++it) {
+        writeString(paths, it.key());
+        writeString(paths, it.value());
+    }
+
+    QByteArray plugins;
+
+    writeU32(plugins, uint32_t(pluginStates.count()));
+
+    for (auto it = pluginStates.constBegin(), end = pluginStates.constEnd(); it != end; ++it) {
+        writeString(plugins, it.key());
+        writeBytes(plugins, it.value());
+    }
+
+    QByteArray out;
+    out.reserve(int(sizeof(SessionHeader) + 4 * sizeof(ChunkHeader)) + breakpoints.size() + layout.size() +
+                paths.size() + plugins.size());
+
+    writeU32(out, s_sessionMagic);
+    writeU32(out, SessionVersion);
+    writeU32(out, 4);
+
+    writeChunk(out, s_chunkBreakpoints, breakpoints);
+    writeChunk(out, s_chunkLayout, layout);
+    writeChunk(out, s_chunkPaths, paths);
+    writeChunk(out, s_chunkPlugins, plugins);
+
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+
+    // Written to a temporary file and renamed so a crash while saving doesn't leave a broken session
+    QSaveFile file(filename);
+
+    if (!file.open(QFile::WriteOnly)) {
+        return false;
+    }
+
+    file.write(out);
+
+    return file.commit();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "BreakpointModel.h"
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+namespace prodbg {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Binary session file with the state needed to get back to where a debug session was left: breakpoints, the dock
+// layout, resolved source paths (debug path -> local file) and the state of each backend plugin (from the
+// save_state/load_state callbacks).
+//
+// The file is a small header followed by chunks (id, size, data) in native byte order. Loading maps the file and
+// copies each chunk out of the mapping. Unknown chunks are skipped so new ones can be added without bumping the version.
+
+class SessionFile
+{
+public:
+    bool load(const QString& filename);
+    bool save(const QString& filename) const;
+
+    // Default location of the session file
+    static QString defaultFilename();
+
+    QVector<BreakpointModel::FileLineBreakpoint> fileLineBreakpoints;
+    QVector<BreakpointModel::AddressBreakpoint> addressBreakpoints;
+
+    // QMainWindow::saveState() of the main window
+    QByteArray layout;
+
+    // Debug info path -> local file
+    QHash<QString, QString> resolvedPaths;
+
+    // Backend plugin name -> data written by the plugin save_state callback
+    QHash<QString, QByteArray> pluginStates;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -72,40 +72,6 @@ StaticLibrary {
 
 -----------------------------------------------------------------------------------------------------------------------
 
-StaticLibrary {
-    Name = "tinyexpr",
-
-    Env = {
-        CCOPTS = {
-        	{
-		-- "-Werror",
-		    "-Wno-parentheses",
-        	"-Wno-unused-variable",
-        	"-Wno-pointer-to-int-cast",
-        	"-Wno-int-to-pointer-cast",
-        	"-Wno-unused-but-set-variable",
-        	"-Wno-return-type",
-        	"-Wno-unused-function",
-			"-Wno-error=strict-aliasing" ; Config = "linux-*-*" },
-        	{ "-Wno-everything"; Config = "macosx-*-*" },
-        	{ "/wd4244", "/wd4267", "/wd4133", "/wd4047", "/wd4204", "/wd4201", "/wd4701", "/wd4703", "/wd4090", "/wd4146",
-			  "/wd4024", "/wd4100", "/wd4053", "/wd4431",
-			  "/wd4189", "/wd4127"; Config = "win64-*-*" },
-        },
-    },
-
-    Sources = {
-        Glob {
-            Dir = "src/native/external/tinyexpr",
-            Extensions = { ".c", ".h" },
-        },
-    },
-
-	IdeGenerationHints = { Msvc = { SolutionFolder = "External" } },
-}
-
------------------------------------------------------------------------------------------------------------------------
-
 StaticLibrary {
     Name = "capstone",
 
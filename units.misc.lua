@@ -31,7 +31,10 @@ Program {
         },
     },
 
-    Libs = { { "wsock32.lib", "kernel32.lib" ; Config = { "win32-*-*", "win64-*-*" } } },
+    Libs = {
+        { "wsock32.lib", "kernel32.lib" ; Config = { "win32-*-*", "win64-*-*" } },
+        { "pthread" ; Config = "linux-*-*" },
+    },
 
     Depends = { "remote_api" },
 
@@ -54,10 +57,34 @@ Program {
 	IdeGenerationHints = { Msvc = { SolutionFolder = "Misc" } },
 }
 
+-----------------------------------------------------------------------------------------------------------------------
+-- M68K decode benchmark
+
+Program {
+    Name = "m68k_bench",
+
+    Env = {
+        CPPPATH = { "src/native/external/capstone/include" },
+    },
+
+    Sources = {
+        "src/native/m68k_bench/m68k_bench.c",
+    },
+
+    Libs = {
+        { "pthread" ; Config = "linux-*-*" },
+    },
+
+    Depends = { "capstone" },
+
+	IdeGenerationHints = { Msvc = { SolutionFolder = "Misc" } },
+}
+
 -----------------------------------------------------------------------------------------------------------------------
 
 Default "fake6502"
 Default "crashing_native"
+Default "m68k_bench"
 
 -- vim: ts=4:sw=4:sts=4
 
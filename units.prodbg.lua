@@ -36,6 +36,7 @@ Program {
 
         gen_uic("src/prodbg/RegisterView/RegisterView.ui"),
         gen_moc("src/prodbg/RegisterView/RegisterView.h"),
+        gen_moc("src/prodbg/RegisterView/RegisterModel.h"),
 
         gen_uic("src/prodbg/MainWindow.ui"),
         gen_uic("src/prodbg/MemoryView/MemoryView.ui"),
@@ -50,8 +51,11 @@ Program {
         gen_moc("src/prodbg/ViewHandler.h"),
         gen_moc("src/prodbg/CodeView/CodeView.h"),
         gen_moc("src/prodbg/CodeView/DisassemblyView.h"),
+        gen_moc("src/prodbg/CodeView/SourceDocumentCache.h"),
+        gen_moc("src/prodbg/CodeView/SourceIndexer.h"),
         gen_moc("src/prodbg/MemoryView/MemoryView.h"),
         gen_moc("src/prodbg/MemoryView/MemoryViewWidget.h"),
+        gen_moc("src/prodbg/ProfileView/ProfileView.h"),
     },
 
     Env = {
@@ -78,7 +82,6 @@ Program {
             "$(QT5)/include/QtCore",
             "$(QT5)/include/QtGui",
             "$(QT5)/include/QtWidgets",
-            "src/native/external/tinyexpr",
             "src/prodbg",
         	"api/include",
             "$(OBJECTROOT)", "$(OBJECTDIR)",
@@ -103,7 +106,7 @@ Program {
 
     Frameworks = { "Cocoa", "QtWidgets", "QtGui", "QtCore" },
 
-    Depends = { "remote_api", "capstone", "tinyexpr" },
+    Depends = { "remote_api", "capstone" },
 }
 
 -----------------------------------------------------------------------------------------------------------------------